@@ -0,0 +1,164 @@
+// bit_vec.hpp
+//
+// A growable vector of bits packed into 64 bit words.
+//
+// Storage is cache line aligned and always a whole number of cache lines,
+// and bits past size() in the last word are kept zero. That lets the bulk
+// operations (and/or/xor/and_not, count) run over whole words with no
+// edge handling, in simple loops the compiler vectorizes. count picks a
+// popcnt kernel at run time where the CPU has the instruction.
+//
+// rank_select is an optional index over a bit_vec that answers "how many
+// ones before position i" in constant time and "where is the k-th one"
+// in near constant time, for about 25% extra space.
+//
+
+#ifndef INCLUDED_DATUM_BIT_VEC_HPP
+#define INCLUDED_DATUM_BIT_VEC_HPP
+
+#include <new>
+#include <utility>
+#include <initializer_list>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "dtm/vec.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/aligned_alloc.hpp"
+#include "dtm/detail/cpu.hpp"
+
+namespace dtm {
+
+class bit_vec {
+public:
+    using word_type = uint64_t;
+    static constexpr size_t bits_per_word = 64;
+
+    bit_vec() noexcept;
+    explicit bit_vec(size_t size, bool value = false);
+    bit_vec(std::initializer_list<bool> init);
+    bit_vec(const bit_vec& rhs);
+    bit_vec(bit_vec&& rhs) noexcept;
+    ~bit_vec();
+
+    bit_vec& operator= (const bit_vec& rhs);
+    bit_vec& operator= (bit_vec&& rhs) noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    size_t capacity() const noexcept;
+
+    // The packed words; bit i is bit (i % 64) of word i / 64.
+    size_t word_count() const noexcept;
+    word_type* words() noexcept;
+    const word_type* words() const noexcept;
+
+    bool operator[] (size_t index) const noexcept;
+    bool test(size_t index) const noexcept;
+    bool at(size_t index) const;
+
+    void set(size_t index) noexcept;
+    void set(size_t index, bool value) noexcept;
+    void reset(size_t index) noexcept;
+    void flip(size_t index) noexcept;
+
+    void set_all() noexcept;
+    void reset_all() noexcept;
+    void flip_all() noexcept;
+
+    void push_back(bool value);
+    void pop_back() noexcept;
+    void resize(size_t size, bool value = false);
+    void reserve(size_t size);
+    void clear() noexcept;
+    void swap(bit_vec& rhs) noexcept;
+
+    // Number of set bits.
+    size_t count() const noexcept;
+    bool any() const noexcept;
+    bool none() const noexcept;
+    bool all() const noexcept;
+
+    // Index of the first set bit at or after index, or size() if none.
+    size_t find_first() const noexcept;
+    size_t find_next(size_t index) const noexcept;
+
+    // Calls fn(index) for every set bit in increasing order.
+    template <typename Fn>
+    void for_each_set(Fn&& fn) const;
+
+    // Bulk operations. Both operands must have the same size, otherwise
+    // std::invalid_argument is thrown.
+    bit_vec& operator&= (const bit_vec& rhs);
+    bit_vec& operator|= (const bit_vec& rhs);
+    bit_vec& operator^= (const bit_vec& rhs);
+    bit_vec& and_not(const bit_vec& rhs);
+
+    bool operator== (const bit_vec& rhs) const noexcept;
+    bool operator!= (const bit_vec& rhs) const noexcept;
+
+private:
+    word_type* m_words;
+    size_t m_size;
+    size_t m_capacity; // in words
+
+    static constexpr size_t words_per_line = DATUM_CACHE_LINE_SIZE / sizeof(word_type);
+
+    static size_t words_for(size_t bits) noexcept;
+
+    void reallocate(size_t words);
+    void check_same_size(const bit_vec& rhs) const;
+    void clear_unused_bits() noexcept;
+};
+
+bit_vec operator& (bit_vec lhs, const bit_vec& rhs);
+bit_vec operator| (bit_vec lhs, const bit_vec& rhs);
+bit_vec operator^ (bit_vec lhs, const bit_vec& rhs);
+
+// Rank/select index over a bit_vec. The bit_vec must outlive the index and
+// must not be modified while it is in use; rebuild the index afterwards.
+class rank_select {
+public:
+    explicit rank_select(const bit_vec& bits);
+
+    // Number of set bits in [0, index). index may equal size().
+    size_t rank(size_t index) const noexcept;
+
+    // Index of the set bit with the given rank, counting from 0. Requires
+    // rank < count().
+    size_t select(size_t rank) const noexcept;
+
+    // Number of set bits in the whole vector.
+    size_t count() const noexcept;
+
+private:
+    // Each 512 bit block has two entries in m_counts: the number of ones
+    // before the block, and the 9 bit counts of ones before words 1..7 of
+    // the block relative to its start, packed together.
+    static constexpr size_t block_words = 8;
+    static constexpr size_t select_sample = 4096;
+
+    const bit_vec* m_bits;
+    vec<uint64_t> m_counts;
+    // Block holding the one of rank k * select_sample.
+    vec<uint32_t> m_select_samples;
+    size_t m_ones;
+
+    size_t block_count() const noexcept;
+};
+
+}
+
+// Implementation of bit_vec is in detail/bit_vec_impl.hpp
+#define INCLUDING_DATUM_DETAIL_BIT_VEC_IMPL_HPP
+#include "detail/bit_vec_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_BIT_VEC_IMPL_HPP
+
+#endif //INCLUDED_DATUM_BIT_VEC_HPP
@@ -0,0 +1,201 @@
+// bloom_filter.hpp
+//
+// A blocked Bloom filter for cheaply rejecting keys that are not in a set.
+//
+// The filter is an array of cache line sized blocks. A key's hash picks one
+// block, and sets one bit in each of the block's eight 64 bit words, so an
+// insert or a query touches exactly one cache line. The eight bit positions
+// come from multiplying the hash by eight fixed odd constants; where the
+// CPU has AVX2, picked at run time, all eight are computed and tested in a
+// couple of vector instructions.
+//
+// Compared with a classic Bloom filter of the same size the false positive
+// rate is somewhat higher, because keys are not spread perfectly evenly
+// over blocks. The sizing below accounts for that.
+//
+
+#ifndef INCLUDED_DATUM_BLOOM_FILTER_HPP
+#define INCLUDED_DATUM_BLOOM_FILTER_HPP
+
+#include <new>
+#include <utility>
+#include <stdexcept>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "dtm/hash.hpp"
+#include "dtm/iterator.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/aligned_alloc.hpp"
+#include "dtm/detail/cpu.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+struct bloom_block {
+    static constexpr size_t words = 8;
+    static constexpr size_t bytes = words * sizeof(uint64_t);
+
+    static_assert(bytes == DATUM_CACHE_LINE_SIZE, "a bloom_block is one cache line");
+
+    static uint32_t salt(size_t i) noexcept {
+        static const uint32_t salts[words] = {
+            0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+            0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+        };
+        return salts[i];
+    }
+
+    // Bit of word i to use for the given hash.
+    static uint64_t mask(uint32_t hash, size_t i) noexcept {
+        return uint64_t(1) << ((hash * salt(i)) >> 26);
+    }
+
+    // Whether to take the AVX2 kernels; a batch query asks once for all of
+    // its keys.
+    static bool use_avx2() noexcept {
+#if defined(__AVX2__)
+        return true;
+#elif DATUM_X86
+        return cpu().avx2;
+#else
+        return false;
+#endif
+    }
+
+    static void insert(uint64_t* block, uint32_t hash, bool avx2 = use_avx2()) noexcept {
+#if DATUM_X86
+        if (avx2) {
+            insert_avx2(block, hash);
+            return;
+        }
+#endif
+        insert_scalar(block, hash);
+    }
+
+    static bool contains(const uint64_t* block, uint32_t hash, bool avx2 = use_avx2()) noexcept {
+#if DATUM_X86
+        if (avx2)
+            return contains_avx2(block, hash);
+#endif
+        return contains_scalar(block, hash);
+    }
+
+    static void insert_scalar(uint64_t* block, uint32_t hash) noexcept {
+        for (size_t i = 0; i < words; i++)
+            block[i] |= mask(hash, i);
+    }
+
+    static bool contains_scalar(const uint64_t* block, uint32_t hash) noexcept {
+        uint64_t missing = 0;
+        for (size_t i = 0; i < words; i++)
+            missing |= mask(hash, i) & ~block[i];
+        return missing == 0;
+    }
+
+#if DATUM_X86
+    DATUM_TARGET("avx2") static void masks(uint32_t hash, __m256i& lo, __m256i& hi) noexcept {
+        const __m256i salts = _mm256_setr_epi32(
+            0x47b6137b, 0x44974d91, static_cast<int>(0x8824ad5bu), static_cast<int>(0xa2b7289du),
+            0x705495c7, 0x2df1424b, static_cast<int>(0x9efc4947u), 0x5c6bfb31);
+        __m256i shifts = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(hash)), salts), 26);
+        __m256i one = _mm256_set1_epi64x(1);
+        lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(shifts)));
+        hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(shifts, 1)));
+    }
+
+    // The eight masks as words, for checking against mask().
+    DATUM_TARGET("avx2") static void masks_avx2(uint32_t hash, uint64_t* out) noexcept {
+        __m256i lo, hi;
+        masks(hash, lo, hi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out) + 1, hi);
+    }
+
+    DATUM_TARGET("avx2") static void insert_avx2(uint64_t* block, uint32_t hash) noexcept {
+        __m256i lo, hi;
+        masks(hash, lo, hi);
+        __m256i* b = reinterpret_cast<__m256i*>(block);
+        _mm256_store_si256(b, _mm256_or_si256(_mm256_load_si256(b), lo));
+        _mm256_store_si256(b + 1, _mm256_or_si256(_mm256_load_si256(b + 1), hi));
+    }
+
+    DATUM_TARGET("avx2") static bool contains_avx2(const uint64_t* block, uint32_t hash) noexcept {
+        __m256i lo, hi;
+        masks(hash, lo, hi);
+        const __m256i* b = reinterpret_cast<const __m256i*>(block);
+        return _mm256_testc_si256(_mm256_load_si256(b), lo)
+             & _mm256_testc_si256(_mm256_load_si256(b + 1), hi);
+    }
+#endif
+};
+
+}
+
+template <typename Key, typename Hash = hash<Key>>
+class bloom_filter {
+public:
+    using key_type = Key;
+
+    // Size the filter to hold expected_keys keys with at most the given
+    // false positive rate.
+    explicit bloom_filter(size_t expected_keys, double false_positive_rate = 0.01);
+    bloom_filter(const bloom_filter& rhs);
+    bloom_filter(bloom_filter&& rhs) noexcept;
+    ~bloom_filter();
+
+    bloom_filter& operator= (const bloom_filter& rhs);
+    bloom_filter& operator= (bloom_filter&& rhs) noexcept;
+
+    void insert(const Key& key) noexcept;
+
+    // False means key was definitely never inserted.
+    bool contains(const Key& key) const noexcept;
+
+    // Query many keys at once, writing one result per key. Hashing and
+    // prefetching run ahead of the probes, so the cache misses of a batch
+    // overlap. Returns the number of keys that may be present.
+    size_t contains(span<const Key> keys, bool* results) const noexcept;
+
+    // Variants taking a precomputed 64 bit hash.
+    void insert_hash(uint64_t hash) noexcept;
+    bool contains_hash(uint64_t hash) const noexcept;
+
+    void clear() noexcept;
+    void swap(bloom_filter& rhs) noexcept;
+
+    // Add every key of rhs, which must have the same number of blocks.
+    bloom_filter& operator|= (const bloom_filter& rhs);
+
+    size_t block_count() const noexcept;
+    size_t size_in_bytes() const noexcept;
+
+    // Expected false positive rate once the filter holds num_keys keys.
+    double false_positive_rate(size_t num_keys) const noexcept;
+
+    // Expected false positive rate of num_blocks blocks holding num_keys keys.
+    static double false_positive_rate(size_t num_keys, size_t num_blocks) noexcept;
+
+    // Fewest blocks that keep num_keys keys under the given false positive rate.
+    static size_t blocks_for(size_t num_keys, double false_positive_rate);
+
+private:
+    uint64_t* m_blocks;
+    size_t m_block_count;
+    Hash m_hash;
+
+    uint64_t* block_for(uint64_t hash) const noexcept;
+};
+
+}
+
+// Implementation of bloom_filter is in detail/bloom_filter_impl.hpp
+#define INCLUDING_DATUM_DETAIL_BLOOM_FILTER_IMPL_HPP
+#include "detail/bloom_filter_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_BLOOM_FILTER_IMPL_HPP
+
+#endif //INCLUDED_DATUM_BLOOM_FILTER_HPP
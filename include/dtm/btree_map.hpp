@@ -0,0 +1,305 @@
+// btree_map.hpp
+//
+// An ordered map stored as a B+tree.
+//
+// Nodes are cache line aligned and fit in NodeBytes, a multiple of the
+// cache line size and 512 by default, so one node holds dozens of keys and a
+// lookup touches a handful of nodes instead of one per tree level as a
+// red-black tree does. Keys inside a node are contiguous and are searched
+// with SIMD comparisons for 32 and 64 bit integer keys. All entries live in
+// the leaves, which are linked, so range scans walk leaves sequentially.
+//
+// Keys and values must be relocatable: nodes move them with memcpy.
+//
+// erase() removes entries from their leaf but never merges nodes. That
+// keeps erase cheap and iterators simple at the cost of space after heavy
+// deletion; rebuild with bulk_load() if that matters.
+//
+
+#ifndef INCLUDED_DATUM_BTREE_MAP_HPP
+#define INCLUDED_DATUM_BTREE_MAP_HPP
+
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "dtm/vec.hpp"
+#include "dtm/flat_map.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/aligned_alloc.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+// In-node search: the number of keys less than key, i.e. its lower bound.
+// The generic version is the branchless binary search; integer keys with
+// the default ordering compare a whole vector of keys at a time. Callers
+// guarantee keys can be read up to count rounded up to a multiple of 8.
+template <typename Key, typename Compare>
+struct btree_search {
+    static size_t lower_bound(const Key* keys, size_t count, const Key& key, const Compare& comp) {
+        return sorted_layout::lower_bound(keys, count, key, comp);
+    }
+};
+
+#if defined(__SSE2__)
+
+template <typename Int, bool IsSigned>
+struct btree_simd_search {
+    static constexpr Int bias = IsSigned ? Int(0) : Int(Int(1) << (sizeof(Int) * 8 - 1));
+
+    static size_t lower_bound(const Int* keys, size_t count, Int key, const std::less<Int>&) {
+        size_t result = 0;
+#if defined(__AVX2__)
+        constexpr size_t lanes = 32 / sizeof(Int);
+        __m256i x = sizeof(Int) == 4 ? _mm256_set1_epi32(static_cast<int32_t>(key ^ bias))
+                                     : _mm256_set1_epi64x(static_cast<int64_t>(key ^ bias));
+        __m256i flip = sizeof(Int) == 4 ? _mm256_set1_epi32(static_cast<int32_t>(bias))
+                                        : _mm256_set1_epi64x(static_cast<int64_t>(bias));
+        for (size_t i = 0; i < count; i += lanes) {
+            __m256i k = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), flip);
+            __m256i less = sizeof(Int) == 4 ? _mm256_cmpgt_epi32(x, k) : _mm256_cmpgt_epi64(x, k);
+            unsigned mask = sizeof(Int) == 4 ? _mm256_movemask_ps(_mm256_castsi256_ps(less))
+                                             : _mm256_movemask_pd(_mm256_castsi256_pd(less));
+            if (count - i < lanes)
+                mask &= (1u << (count - i)) - 1;
+            result += __builtin_popcount(mask);
+        }
+#else
+        // SSE2 has no 64 bit compare; fall back to the scalar search there.
+        if (sizeof(Int) == 8) {
+            return sorted_layout::lower_bound(keys, count, key, std::less<Int>());
+        }
+        constexpr size_t lanes = 4;
+        __m128i x = _mm_set1_epi32(static_cast<int32_t>(key ^ bias));
+        __m128i flip = _mm_set1_epi32(static_cast<int32_t>(bias));
+        for (size_t i = 0; i < count; i += lanes) {
+            __m128i k = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), flip);
+            unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(x, k)));
+            if (count - i < lanes)
+                mask &= (1u << (count - i)) - 1;
+            result += __builtin_popcount(mask);
+        }
+#endif
+        return result;
+    }
+};
+
+template <> struct btree_search<int32_t, std::less<int32_t>> : btree_simd_search<int32_t, true> {};
+template <> struct btree_search<uint32_t, std::less<uint32_t>> : btree_simd_search<uint32_t, false> {};
+template <> struct btree_search<int64_t, std::less<int64_t>> : btree_simd_search<int64_t, true> {};
+template <> struct btree_search<uint64_t, std::less<uint64_t>> : btree_simd_search<uint64_t, false> {};
+
+#endif
+
+template <typename Key, typename Value>
+struct btree_entry_ref {
+    const Key& key;
+    Value& value;
+};
+
+}
+
+template <typename Key, typename Value, typename Compare = std::less<Key>, size_t NodeBytes = 512>
+class btree_map {
+    static_assert(is_relocatable<Key>::value && is_relocatable<Value>::value,
+                  "dtm::btree_map requires relocatable keys and values");
+    static_assert(NodeBytes % DATUM_CACHE_LINE_SIZE == 0, "NodeBytes must be a multiple of the cache line size");
+
+    struct node;
+    struct leaf;
+    struct inner;
+
+    template <bool> class iterator_base;
+
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+
+    btree_map();
+    btree_map(const btree_map& rhs);
+    btree_map(btree_map&& rhs) noexcept;
+    ~btree_map();
+
+    btree_map& operator= (const btree_map& rhs);
+    btree_map& operator= (btree_map&& rhs) noexcept;
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    void swap(btree_map& rhs) noexcept;
+    void clear();
+
+    // Replace the contents with the given columns, which must be sorted by
+    // strictly increasing key. Leaves are packed full, which suits
+    // read-mostly maps.
+    void bulk_load(const vec<Key>& keys, const vec<Value>& values);
+
+    // Returns true if key was not already present.
+    bool insert(const Key& key, const Value& value);
+
+    Value& operator[] (const Key& key);
+
+    Value& at(const Key& key);
+    const Value& at(const Key& key) const;
+
+    iterator find(const Key& key);
+    const_iterator find(const Key& key) const;
+
+    bool contains(const Key& key) const;
+
+    // First entry whose key is not less than / greater than key.
+    iterator lower_bound(const Key& key);
+    const_iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key);
+    const_iterator upper_bound(const Key& key) const;
+
+    // Calls fn(key, value) for every entry with first <= key < last, walking
+    // the leaf arrays directly.
+    template <typename Fn>
+    void for_each_in_range(const Key& first, const Key& last, Fn&& fn) const;
+
+    // Returns the number of entries removed.
+    size_t erase(const Key& key);
+
+private:
+    // Capacities are multiples of 8 so the SIMD search may read whole
+    // vectors past the last key. Nodes are split on the way down when
+    // full, so an insert never has to propagate a split back up.
+    static constexpr size_t round_down_8(size_t n) { return n < 8 ? 8 : n / 8 * 8; }
+    static constexpr size_t leaf_capacity =
+        round_down_8((NodeBytes - 3 * sizeof(void*)) / (sizeof(Key) + sizeof(Value)));
+    static constexpr size_t inner_capacity =
+        round_down_8((NodeBytes - 2 * sizeof(void*)) / (sizeof(Key) + sizeof(void*)) - 1);
+
+    // Not alignas(DATUM_CACHE_LINE_SIZE): that would pad the header to a
+    // whole line, which the capacities above don't leave room for. Nodes
+    // are still cache line aligned, by new_leaf and new_inner.
+    struct node {
+        uint32_t count;
+        bool is_leaf;
+    };
+
+    struct leaf : node {
+        leaf* next;
+        leaf* prev;
+        alignas(Key) unsigned char key_storage[sizeof(Key) * leaf_capacity];
+        alignas(Value) unsigned char value_storage[sizeof(Value) * leaf_capacity];
+
+        Key* keys() noexcept { return reinterpret_cast<Key*>(key_storage); }
+        Value* values() noexcept { return reinterpret_cast<Value*>(value_storage); }
+    };
+
+    struct inner : node {
+        node* children[inner_capacity + 1];
+        alignas(Key) unsigned char key_storage[sizeof(Key) * inner_capacity];
+
+        Key* keys() noexcept { return reinterpret_cast<Key*>(key_storage); }
+    };
+
+    static_assert(sizeof(leaf) <= NodeBytes, "dtm::btree_map leaf does not fit in NodeBytes; use larger nodes");
+    static_assert(sizeof(inner) <= NodeBytes, "dtm::btree_map inner node does not fit in NodeBytes; use larger nodes");
+
+    node* m_root;
+    leaf* m_first;
+    size_t m_size;
+    Compare m_comp;
+
+    static size_t node_lower_bound(const Key* keys, size_t count, const Key& key, const Compare& comp);
+
+    leaf* new_leaf();
+    inner* new_inner();
+    void free_node(node* n) noexcept;
+
+    size_t child_index(inner* n, const Key& key) const;
+    leaf* find_leaf(const Key& key) const;
+    static iterator skip_empty(leaf* l, size_t index) noexcept;
+
+    static bool is_full(const node* n) noexcept;
+    void split_child(inner* parent, size_t index);
+
+    void destroy(node* n) noexcept;
+
+    // Rebuild from n entries in strictly increasing key order.
+    template <typename KeyAt, typename ValueAt>
+    void load_sorted(size_t n, KeyAt&& key_at, ValueAt&& value_at);
+};
+
+template <typename Key, typename Value, typename Compare, size_t NodeBytes>
+template <bool IsConst>
+class btree_map<Key, Value, Compare, NodeBytes>::iterator_base {
+    friend class btree_map;
+    friend class iterator_base<!IsConst>;
+    using value_ref = typename std::conditional<IsConst, const Value, Value>::type;
+
+public:
+    using reference = detail::btree_entry_ref<Key, value_ref>;
+    using value_type = reference;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    struct pointer {
+        reference ref;
+        reference* operator-> () noexcept { return &ref; }
+    };
+
+    iterator_base(leaf* l, size_t index) noexcept
+        : m_leaf(l), m_index(index) {}
+
+    // iterator converts to const_iterator
+    template <bool RhsConst, typename = typename std::enable_if<IsConst && !RhsConst>::type>
+    iterator_base(const iterator_base<RhsConst>& rhs) noexcept
+        : m_leaf(rhs.m_leaf), m_index(rhs.m_index) {}
+
+    iterator_base& operator ++ () noexcept {
+        if (++m_index >= m_leaf->count) {
+            // Leaves emptied by erase() are skipped.
+            do {
+                m_leaf = m_leaf->next;
+            } while (m_leaf && m_leaf->count == 0);
+            m_index = 0;
+        }
+        return *this;
+    }
+
+    iterator_base operator ++ (int) noexcept { iterator_base prev = *this; ++*this; return prev; }
+
+    bool operator == (const iterator_base& rhs) const noexcept { return m_leaf == rhs.m_leaf && m_index == rhs.m_index; }
+    bool operator != (const iterator_base& rhs) const noexcept { return !(*this == rhs); }
+
+    reference operator* () const noexcept { return reference{ m_leaf->keys()[m_index], m_leaf->values()[m_index] }; }
+    pointer operator-> () const noexcept { return pointer{ **this }; }
+
+private:
+    leaf* m_leaf;
+    size_t m_index;
+};
+
+}
+
+// Implementation of btree_map is in detail/btree_map_impl.hpp
+#define INCLUDING_DATUM_DETAIL_BTREE_MAP_IMPL_HPP
+#include "detail/btree_map_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_BTREE_MAP_IMPL_HPP
+
+#endif //INCLUDED_DATUM_BTREE_MAP_HPP
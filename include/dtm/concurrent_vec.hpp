@@ -0,0 +1,174 @@
+// concurrent_vec.hpp
+//
+// An append-only vector that many threads can push into at once.
+//
+// Slots are reserved with a single atomic fetch-add and elements live in
+// segments of doubling size, so growing never moves an element that has
+// already been published. Each slot has a ready flag that its writer sets
+// once the element is constructed, and size() is the longest prefix of
+// ready slots, which makes it safe for readers to iterate [begin(), end())
+// while writers are still appending.
+//
+// Writers never wait for each other. The writer that completes a run of
+// ready slots moves size() past it; a writer that is slow to construct its
+// element holds size() back at its slot until it is done, but every other
+// writer carries on.
+//
+
+#ifndef INCLUDED_DATUM_CONCURRENT_VEC_HPP
+#define INCLUDED_DATUM_CONCURRENT_VEC_HPP
+
+#include <new>
+#include <atomic>
+#include <utility>
+#include <type_traits>
+#include <iterator>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/iterators.hpp"
+#include "dtm/detail/aligned_alloc.hpp"
+
+namespace dtm {
+
+template <typename T>
+class concurrent_vec {
+    // Segment 0 holds the first first_segment_size elements, segment s > 0
+    // holds first_segment_size << (s - 1) elements. Together the segments
+    // cover the whole size_t index space.
+    static constexpr size_t first_segment_log2 = 5;
+    static constexpr size_t first_segment_size = size_t(1) << first_segment_log2;
+    static constexpr size_t num_segments = sizeof(size_t) * 8 - first_segment_log2 + 1;
+
+public:
+    using value_type = T;
+
+    class const_iterator;
+
+    concurrent_vec() noexcept;
+    ~concurrent_vec();
+
+    concurrent_vec(const concurrent_vec&) = delete;
+    concurrent_vec& operator= (const concurrent_vec&) = delete;
+
+    // Thread safe. Returns the index of the new element.
+    size_t push_back(const T& val);
+    size_t push_back(T&& val);
+
+    template <typename... Args>
+    size_t emplace_back(Args&&... args);
+
+    // Thread safe. Reserves count consecutive indices and constructs each of
+    // them from args. Returns the index of the first element of the run.
+    template <typename... Args>
+    size_t grow_by(size_t count, Args&&... args);
+
+    // Thread safe. Reserves std::distance(begin, end) consecutive indices and
+    // copies the forward range into them. Returns the index of the first element.
+    // The range is read twice, so single pass iterators are not accepted.
+    template <typename It, typename = detail::require_forward_iterator<It>>
+    size_t grow_by(It begin, It end);
+
+    // Number of published elements. Every index below size() is safe to read.
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    // Only valid for index < size().
+    const T& operator[] (size_t index) const noexcept;
+    T& operator[] (size_t index) noexcept;
+
+    const T& at(size_t index) const;
+    T& at(size_t index);
+
+    // Iterate the prefix that was published when begin()/end() was called.
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    // Calls fn(const T* chunk, size_t length) for each contiguous run of the
+    // first count published elements. Much cheaper than element-wise indexing.
+    template <typename Fn>
+    void for_each_chunk(size_t count, Fn&& fn) const;
+
+    // Not thread safe. Destroys all elements but keeps the segments.
+    void clear();
+
+private:
+    std::atomic<size_t> m_reserved;
+    std::atomic<size_t> m_published;
+    std::atomic<T*> m_segments[num_segments];
+
+    // Segments are aligned for T even when it is over-aligned.
+    static constexpr size_t segment_alignment = alignof(T) < sizeof(void*) ? sizeof(void*) : alignof(T);
+
+    static size_t segment_of(size_t index) noexcept;
+    static size_t segment_begin(size_t segment) noexcept;
+    static size_t segment_size(size_t segment) noexcept;
+
+    // Each segment's block holds its elements followed by a ready flag
+    // for each of them.
+    static std::atomic<unsigned char>* ready_flags(T* block, size_t segment) noexcept;
+    bool is_ready(size_t index) const noexcept;
+
+    T* slot(size_t index) const noexcept;
+    T* ensure_segment(size_t segment);
+
+    size_t reserve_slots(size_t count);
+    void publish() noexcept;
+
+    template <typename Fn>
+    void construct_range(size_t first, size_t count, Fn&& construct) noexcept;
+};
+
+template <typename T>
+class concurrent_vec<T>::const_iterator {
+public:
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T&;
+    using pointer = const T*;
+    using iterator_category = std::random_access_iterator_tag;
+
+    const_iterator(const concurrent_vec* owner, size_t index) noexcept
+        : m_owner(owner), m_index(index) {}
+
+    const_iterator& operator ++ () noexcept { ++m_index; return *this; }
+    const_iterator& operator -- () noexcept { --m_index; return *this; }
+
+    const_iterator operator ++ (int) noexcept { return const_iterator(m_owner, m_index++); }
+    const_iterator operator -- (int) noexcept { return const_iterator(m_owner, m_index--); }
+
+    const_iterator& operator += (std::ptrdiff_t n) noexcept { m_index += n; return *this; }
+    const_iterator& operator -= (std::ptrdiff_t n) noexcept { m_index -= n; return *this; }
+
+    const_iterator operator + (std::ptrdiff_t n) const noexcept { return const_iterator(m_owner, m_index + n); }
+    const_iterator operator - (std::ptrdiff_t n) const noexcept { return const_iterator(m_owner, m_index - n); }
+
+    std::ptrdiff_t operator - (const_iterator rhs) const noexcept { return m_index - rhs.m_index; }
+
+    bool operator == (const_iterator rhs) const noexcept { return m_index == rhs.m_index; }
+    bool operator != (const_iterator rhs) const noexcept { return m_index != rhs.m_index; }
+    bool operator < (const_iterator rhs) const noexcept { return m_index < rhs.m_index; }
+    bool operator > (const_iterator rhs) const noexcept { return m_index > rhs.m_index; }
+    bool operator <= (const_iterator rhs) const noexcept { return m_index <= rhs.m_index; }
+    bool operator >= (const_iterator rhs) const noexcept { return m_index >= rhs.m_index; }
+
+    const T& operator[] (size_t n) const noexcept { return (*m_owner)[m_index + n]; }
+    const T& operator* () const noexcept { return (*m_owner)[m_index]; }
+    const T* operator-> () const noexcept { return &(*m_owner)[m_index]; }
+
+private:
+    const concurrent_vec* m_owner;
+    size_t m_index;
+};
+
+}
+
+// Implementation of concurrent_vec is in detail/concurrent_vec_impl.hpp
+#define INCLUDING_DATUM_DETAIL_CONCURRENT_VEC_IMPL_HPP
+#include "detail/concurrent_vec_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_CONCURRENT_VEC_IMPL_HPP
+
+#endif //INCLUDED_DATUM_CONCURRENT_VEC_HPP
@@ -0,0 +1,31 @@
+// detail/aligned_alloc.hpp
+//
+// Allocation with an alignment stronger than malloc's.
+
+#ifndef INCLUDED_DATUM_DETAIL_ALIGNED_ALLOC_HPP
+#define INCLUDED_DATUM_DETAIL_ALIGNED_ALLOC_HPP
+
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+
+#include "dtm/detail/config.hpp"
+
+namespace dtm {
+namespace detail {
+
+// alignment must be a power of two multiple of sizeof(void*).
+inline void* aligned_allocate(size_t alignment, size_t size) {
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, alignment, size ? size : alignment) != 0)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+inline void aligned_free(void* ptr) noexcept {
+    free(ptr);
+}
+
+} } // namespace
+
+#endif //INCLUDED_DATUM_DETAIL_ALIGNED_ALLOC_HPP
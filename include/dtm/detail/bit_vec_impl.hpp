@@ -0,0 +1,527 @@
+// details/bit_vec_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_BIT_VEC_IMPL_HPP
+#error "Don't include or compile datum/detail/bit_vec_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+namespace detail {
+
+// For single words, where a dispatch would cost more than the count.
+inline size_t popcount64(uint64_t word) noexcept {
+#if defined(__POPCNT__) || !DATUM_X86
+    return static_cast<size_t>(__builtin_popcountll(word));
+#else
+    return popcount_swar(word);
+#endif
+}
+
+// Four independent accumulators keep several popcnts in flight.
+#define DATUM_POPCOUNT_WORDS(popcount)                  \
+    size_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;              \
+    size_t i = 0;                                       \
+    for (; i + 4 <= count; i += 4) {                    \
+        c0 += popcount(words[i]);                       \
+        c1 += popcount(words[i + 1]);                   \
+        c2 += popcount(words[i + 2]);                   \
+        c3 += popcount(words[i + 3]);                   \
+    }                                                   \
+    for (; i < count; i++)                              \
+        c0 += popcount(words[i]);                       \
+    return c0 + c1 + c2 + c3;
+
+inline size_t popcount_words_scalar(const uint64_t* words, size_t count) noexcept {
+    DATUM_POPCOUNT_WORDS(popcount64)
+}
+
+#if DATUM_X86
+DATUM_TARGET("popcnt")
+inline size_t popcount_words_popcnt(const uint64_t* words, size_t count) noexcept {
+    DATUM_POPCOUNT_WORDS(__builtin_popcountll)
+}
+#endif
+
+#undef DATUM_POPCOUNT_WORDS
+
+inline size_t popcount_words(const uint64_t* words, size_t count) noexcept {
+#if DATUM_X86 && !defined(__POPCNT__)
+    if (cpu().popcnt)
+        return popcount_words_popcnt(words, count);
+#endif
+    return popcount_words_scalar(words, count);
+}
+
+// Position of the lowest set bit; word must not be zero. Compiles to tzcnt
+// when BMI is available.
+inline size_t lowest_bit64(uint64_t word) noexcept {
+    return static_cast<size_t>(__builtin_ctzll(word));
+}
+
+// Position of the set bit of the given rank within word.
+inline size_t select64(uint64_t word, size_t rank) noexcept {
+#if defined(__BMI2__)
+    return lowest_bit64(_pdep_u64(uint64_t(1) << rank, word));
+#else
+    for (size_t i = 0; i < rank; i++)
+        word &= word - 1;
+    return lowest_bit64(word);
+#endif
+}
+
+}
+
+inline bit_vec::bit_vec() noexcept
+    : m_words(nullptr), m_size(0), m_capacity(0)
+{}
+
+inline bit_vec::bit_vec(size_t size, bool value)
+    : bit_vec()
+{
+    resize(size, value);
+}
+
+inline bit_vec::bit_vec(std::initializer_list<bool> init)
+    : bit_vec()
+{
+    reserve(init.size());
+    for (bool value : init)
+        push_back(value);
+}
+
+inline bit_vec::bit_vec(const bit_vec& rhs)
+    : bit_vec()
+{
+    *this = rhs;
+}
+
+inline bit_vec::bit_vec(bit_vec&& rhs) noexcept
+    : bit_vec()
+{
+    swap(rhs);
+}
+
+inline bit_vec::~bit_vec()
+{
+    detail::aligned_free(m_words);
+}
+
+inline bit_vec& bit_vec::operator= (const bit_vec& rhs)
+{
+    if (this != &rhs) {
+        if (m_capacity < rhs.word_count())
+            reallocate(rhs.word_count());
+        reset_all();
+        m_size = rhs.m_size;
+        if (m_size)
+            std::memcpy(m_words, rhs.m_words, word_count() * sizeof(word_type));
+    }
+    return *this;
+}
+
+inline bit_vec& bit_vec::operator= (bit_vec&& rhs) noexcept
+{
+    bit_vec moved(std::move(rhs));
+    swap(moved);
+    return *this;
+}
+
+inline size_t bit_vec::size() const noexcept
+{
+    return m_size;
+}
+
+inline bool bit_vec::empty() const noexcept
+{
+    return m_size == 0;
+}
+
+inline size_t bit_vec::capacity() const noexcept
+{
+    return m_capacity * bits_per_word;
+}
+
+inline size_t bit_vec::word_count() const noexcept
+{
+    return words_for(m_size);
+}
+
+inline bit_vec::word_type* bit_vec::words() noexcept
+{
+    return m_words;
+}
+
+inline const bit_vec::word_type* bit_vec::words() const noexcept
+{
+    return m_words;
+}
+
+inline bool bit_vec::operator[] (size_t index) const noexcept
+{
+    return test(index);
+}
+
+inline bool bit_vec::test(size_t index) const noexcept
+{
+    return (m_words[index / bits_per_word] >> (index % bits_per_word)) & 1;
+}
+
+inline bool bit_vec::at(size_t index) const
+{
+    if (index >= m_size)
+        throw std::out_of_range("dtm::bit_vec::at");
+    return test(index);
+}
+
+inline void bit_vec::set(size_t index) noexcept
+{
+    m_words[index / bits_per_word] |= word_type(1) << (index % bits_per_word);
+}
+
+inline void bit_vec::set(size_t index, bool value) noexcept
+{
+    // Branch free so it is cheap on unpredictable values.
+    word_type& word = m_words[index / bits_per_word];
+    word_type mask = word_type(1) << (index % bits_per_word);
+    word = (word & ~mask) | (-word_type(value) & mask);
+}
+
+inline void bit_vec::reset(size_t index) noexcept
+{
+    m_words[index / bits_per_word] &= ~(word_type(1) << (index % bits_per_word));
+}
+
+inline void bit_vec::flip(size_t index) noexcept
+{
+    m_words[index / bits_per_word] ^= word_type(1) << (index % bits_per_word);
+}
+
+inline void bit_vec::set_all() noexcept
+{
+    size_t n = word_count();
+    for (size_t i = 0; i < n; i++)
+        m_words[i] = ~word_type(0);
+    clear_unused_bits();
+}
+
+inline void bit_vec::reset_all() noexcept
+{
+    size_t n = word_count();
+    for (size_t i = 0; i < n; i++)
+        m_words[i] = 0;
+}
+
+inline void bit_vec::flip_all() noexcept
+{
+    size_t n = word_count();
+    for (size_t i = 0; i < n; i++)
+        m_words[i] = ~m_words[i];
+    clear_unused_bits();
+}
+
+inline void bit_vec::push_back(bool value)
+{
+    if (m_size == capacity())
+        reallocate(m_capacity ? m_capacity * 2 : words_per_line);
+    set(m_size++, value);
+}
+
+inline void bit_vec::pop_back() noexcept
+{
+    reset(--m_size);
+}
+
+inline void bit_vec::resize(size_t size, bool value)
+{
+    if (size > capacity()) {
+        size_t words = words_for(size);
+        reallocate(words > m_capacity * 2 ? words : m_capacity * 2);
+    }
+
+    size_t old_size = m_size;
+    if (size > old_size && value) {
+        // Fill the tail of the old last word, then whole words.
+        size_t first_word = (old_size + bits_per_word - 1) / bits_per_word;
+        if (old_size % bits_per_word)
+            m_words[old_size / bits_per_word] |= ~word_type(0) << (old_size % bits_per_word);
+        size_t last_word = words_for(size);
+        for (size_t i = first_word; i < last_word; i++)
+            m_words[i] = ~word_type(0);
+    }
+
+    m_size = size;
+    clear_unused_bits();
+    size_t last_word = words_for(old_size);
+    for (size_t i = word_count(); i < last_word; i++)
+        m_words[i] = 0;
+}
+
+inline void bit_vec::reserve(size_t size)
+{
+    if (size > capacity())
+        reallocate(words_for(size));
+}
+
+inline void bit_vec::clear() noexcept
+{
+    reset_all();
+    m_size = 0;
+}
+
+inline void bit_vec::swap(bit_vec& rhs) noexcept
+{
+    using std::swap;
+    swap(m_words, rhs.m_words);
+    swap(m_size, rhs.m_size);
+    swap(m_capacity, rhs.m_capacity);
+}
+
+inline size_t bit_vec::count() const noexcept
+{
+    return detail::popcount_words(m_words, word_count());
+}
+
+inline bool bit_vec::any() const noexcept
+{
+    return find_first() != m_size;
+}
+
+inline bool bit_vec::none() const noexcept
+{
+    return !any();
+}
+
+inline bool bit_vec::all() const noexcept
+{
+    return count() == m_size;
+}
+
+inline size_t bit_vec::find_first() const noexcept
+{
+    return m_size ? find_next(0) : 0;
+}
+
+inline size_t bit_vec::find_next(size_t index) const noexcept
+{
+    if (index >= m_size)
+        return m_size;
+
+    size_t w = index / bits_per_word;
+    word_type word = m_words[w] & (~word_type(0) << (index % bits_per_word));
+    size_t n = word_count();
+    while (word == 0) {
+        if (++w == n)
+            return m_size;
+        word = m_words[w];
+    }
+    return w * bits_per_word + detail::lowest_bit64(word);
+}
+
+template <typename Fn>
+void bit_vec::for_each_set(Fn&& fn) const
+{
+    const word_type* words = m_words;
+    size_t n = word_count();
+    for (size_t w = 0; w < n; w++) {
+        word_type word = words[w];
+        while (word) {
+            fn(w * bits_per_word + detail::lowest_bit64(word));
+            word &= word - 1;
+        }
+    }
+}
+
+inline bit_vec& bit_vec::operator&= (const bit_vec& rhs)
+{
+    check_same_size(rhs);
+    word_type* __restrict dst = m_words;
+    const word_type* __restrict src = rhs.m_words;
+    size_t n = word_count();
+    for (size_t i = 0; i < n; i++)
+        dst[i] &= src[i];
+    return *this;
+}
+
+inline bit_vec& bit_vec::operator|= (const bit_vec& rhs)
+{
+    check_same_size(rhs);
+    word_type* __restrict dst = m_words;
+    const word_type* __restrict src = rhs.m_words;
+    size_t n = word_count();
+    for (size_t i = 0; i < n; i++)
+        dst[i] |= src[i];
+    return *this;
+}
+
+inline bit_vec& bit_vec::operator^= (const bit_vec& rhs)
+{
+    check_same_size(rhs);
+    // x ^= x must still clear, so no __restrict here.
+    word_type* dst = m_words;
+    const word_type* src = rhs.m_words;
+    size_t n = word_count();
+    for (size_t i = 0; i < n; i++)
+        dst[i] ^= src[i];
+    return *this;
+}
+
+inline bit_vec& bit_vec::and_not(const bit_vec& rhs)
+{
+    check_same_size(rhs);
+    word_type* dst = m_words;
+    const word_type* src = rhs.m_words;
+    size_t n = word_count();
+    for (size_t i = 0; i < n; i++)
+        dst[i] &= ~src[i];
+    return *this;
+}
+
+inline bool bit_vec::operator== (const bit_vec& rhs) const noexcept
+{
+    return m_size == rhs.m_size
+        && std::memcmp(m_words, rhs.m_words, word_count() * sizeof(word_type)) == 0;
+}
+
+inline bool bit_vec::operator!= (const bit_vec& rhs) const noexcept
+{
+    return !(*this == rhs);
+}
+
+inline size_t bit_vec::words_for(size_t bits) noexcept
+{
+    return (bits + bits_per_word - 1) / bits_per_word;
+}
+
+inline void bit_vec::reallocate(size_t words)
+{
+    // Whole cache lines, all zero past the live words.
+    words = (words + words_per_line - 1) / words_per_line * words_per_line;
+    word_type* new_words = static_cast<word_type*>(
+        detail::aligned_allocate(DATUM_CACHE_LINE_SIZE, words * sizeof(word_type)));
+    size_t live = word_count();
+    if (live)
+        std::memcpy(new_words, m_words, live * sizeof(word_type));
+    std::memset(new_words + live, 0, (words - live) * sizeof(word_type));
+
+    detail::aligned_free(m_words);
+    m_words = new_words;
+    m_capacity = words;
+}
+
+inline void bit_vec::check_same_size(const bit_vec& rhs) const
+{
+    if (m_size != rhs.m_size)
+        throw std::invalid_argument("dtm::bit_vec: operands differ in size");
+}
+
+inline void bit_vec::clear_unused_bits() noexcept
+{
+    if (m_size % bits_per_word)
+        m_words[m_size / bits_per_word] &= ~(~word_type(0) << (m_size % bits_per_word));
+}
+
+inline bit_vec operator& (bit_vec lhs, const bit_vec& rhs)
+{
+    return std::move(lhs &= rhs);
+}
+
+inline bit_vec operator| (bit_vec lhs, const bit_vec& rhs)
+{
+    return std::move(lhs |= rhs);
+}
+
+inline bit_vec operator^ (bit_vec lhs, const bit_vec& rhs)
+{
+    return std::move(lhs ^= rhs);
+}
+
+inline rank_select::rank_select(const bit_vec& bits)
+    : m_bits(&bits), m_ones(0)
+{
+    const uint64_t* words = bits.words();
+    size_t num_words = bits.word_count();
+    size_t blocks = block_count();
+    m_counts.resize(blocks * 2 + 2);
+
+    size_t ones = 0;
+    for (size_t b = 0; b < blocks; b++) {
+        m_counts[b * 2] = ones;
+        uint64_t packed = 0;
+        size_t in_block = 0;
+        for (size_t w = 0; w < block_words; w++) {
+            if (w > 0)
+                packed |= uint64_t(in_block) << (9 * (w - 1));
+            size_t index = b * block_words + w;
+            if (index < num_words)
+                in_block += detail::popcount64(words[index]);
+        }
+        m_counts[b * 2 + 1] = packed;
+
+        // Record the block of every select_sample-th one.
+        size_t next_sample = m_select_samples.size() * select_sample;
+        while (next_sample < ones + in_block) {
+            m_select_samples.push_back(static_cast<uint32_t>(b));
+            next_sample += select_sample;
+        }
+        ones += in_block;
+    }
+
+    // Sentinel block so rank(size()) needs no special case.
+    m_counts[blocks * 2] = ones;
+    m_counts[blocks * 2 + 1] = 0;
+    m_select_samples.push_back(static_cast<uint32_t>(blocks));
+    m_ones = ones;
+}
+
+inline size_t rank_select::rank(size_t index) const noexcept
+{
+    size_t word = index / 64;
+    size_t block = word / block_words;
+    size_t sub = word % block_words;
+
+    size_t result = m_counts[block * 2];
+    if (sub)
+        result += (m_counts[block * 2 + 1] >> (9 * (sub - 1))) & 0x1ff;
+    if (index % 64)
+        result += detail::popcount64(m_bits->words()[word] & ~(~uint64_t(0) << (index % 64)));
+    return result;
+}
+
+inline size_t rank_select::select(size_t rank) const noexcept
+{
+    // The samples bound the search to the blocks between two sampled ones;
+    // for all but very sparse vectors that is a handful of blocks.
+    size_t lo = m_select_samples[rank / select_sample];
+    size_t hi = m_select_samples[rank / select_sample + 1] + 1;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (m_counts[mid * 2] <= rank)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    size_t remaining = rank - m_counts[lo * 2];
+    uint64_t packed = m_counts[lo * 2 + 1];
+    size_t sub = 0;
+    while (sub + 1 < block_words && ((packed >> (9 * sub)) & 0x1ff) <= remaining)
+        sub++;
+    if (sub)
+        remaining -= (packed >> (9 * (sub - 1))) & 0x1ff;
+
+    size_t word = lo * block_words + sub;
+    return word * 64 + detail::select64(m_bits->words()[word], remaining);
+}
+
+inline size_t rank_select::count() const noexcept
+{
+    return m_ones;
+}
+
+inline size_t rank_select::block_count() const noexcept
+{
+    return (m_bits->word_count() + block_words - 1) / block_words;
+}
+
+}
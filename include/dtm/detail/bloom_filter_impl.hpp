@@ -0,0 +1,213 @@
+// details/bloom_filter_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_BLOOM_FILTER_IMPL_HPP
+#error "Don't include or compile datum/detail/bloom_filter_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+#define DATUM_BLOOM_FILTER_TEMPLATE template <typename Key, typename Hash>
+#define DATUM_BLOOM_FILTER bloom_filter<Key, Hash>
+
+DATUM_BLOOM_FILTER_TEMPLATE
+DATUM_BLOOM_FILTER::bloom_filter(size_t expected_keys, double false_positive_rate)
+    : m_blocks(nullptr), m_block_count(blocks_for(expected_keys, false_positive_rate))
+{
+    m_blocks = static_cast<uint64_t*>(detail::aligned_allocate(DATUM_CACHE_LINE_SIZE, size_in_bytes()));
+    clear();
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+DATUM_BLOOM_FILTER::bloom_filter(const bloom_filter& rhs)
+    : m_blocks(nullptr), m_block_count(rhs.m_block_count), m_hash(rhs.m_hash)
+{
+    m_blocks = static_cast<uint64_t*>(detail::aligned_allocate(DATUM_CACHE_LINE_SIZE, size_in_bytes()));
+    std::memcpy(m_blocks, rhs.m_blocks, size_in_bytes());
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+DATUM_BLOOM_FILTER::bloom_filter(bloom_filter&& rhs) noexcept
+    : m_blocks(nullptr), m_block_count(0)
+{
+    swap(rhs);
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+DATUM_BLOOM_FILTER::~bloom_filter()
+{
+    detail::aligned_free(m_blocks);
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+DATUM_BLOOM_FILTER& DATUM_BLOOM_FILTER::operator= (const bloom_filter& rhs)
+{
+    if (this != &rhs) {
+        bloom_filter copy(rhs);
+        swap(copy);
+    }
+    return *this;
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+DATUM_BLOOM_FILTER& DATUM_BLOOM_FILTER::operator= (bloom_filter&& rhs) noexcept
+{
+    bloom_filter moved(std::move(rhs));
+    swap(moved);
+    return *this;
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+void DATUM_BLOOM_FILTER::insert(const Key& key) noexcept
+{
+    insert_hash(m_hash(key));
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+bool DATUM_BLOOM_FILTER::contains(const Key& key) const noexcept
+{
+    return contains_hash(m_hash(key));
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+size_t DATUM_BLOOM_FILTER::contains(span<const Key> keys, bool* results) const noexcept
+{
+    constexpr size_t batch = 16;
+    uint64_t hashes[batch];
+    const uint64_t* blocks[batch];
+
+    bool avx2 = detail::bloom_block::use_avx2();
+    size_t hits = 0;
+    for (size_t base = 0; base < keys.size(); base += batch) {
+        size_t n = keys.size() - base < batch ? keys.size() - base : batch;
+        for (size_t i = 0; i < n; i++) {
+            hashes[i] = m_hash(keys[base + i]);
+            blocks[i] = block_for(hashes[i]);
+            __builtin_prefetch(blocks[i]);
+        }
+        for (size_t i = 0; i < n; i++) {
+            bool found = detail::bloom_block::contains(blocks[i], static_cast<uint32_t>(hashes[i]), avx2);
+            results[base + i] = found;
+            hits += found;
+        }
+    }
+    return hits;
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+void DATUM_BLOOM_FILTER::insert_hash(uint64_t hash) noexcept
+{
+    detail::bloom_block::insert(block_for(hash), static_cast<uint32_t>(hash));
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+bool DATUM_BLOOM_FILTER::contains_hash(uint64_t hash) const noexcept
+{
+    return detail::bloom_block::contains(block_for(hash), static_cast<uint32_t>(hash));
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+void DATUM_BLOOM_FILTER::clear() noexcept
+{
+    std::memset(m_blocks, 0, size_in_bytes());
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+void DATUM_BLOOM_FILTER::swap(bloom_filter& rhs) noexcept
+{
+    using std::swap;
+    swap(m_blocks, rhs.m_blocks);
+    swap(m_block_count, rhs.m_block_count);
+    swap(m_hash, rhs.m_hash);
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+DATUM_BLOOM_FILTER& DATUM_BLOOM_FILTER::operator|= (const bloom_filter& rhs)
+{
+    if (m_block_count != rhs.m_block_count)
+        throw std::invalid_argument("dtm::bloom_filter: filters differ in size");
+    size_t words = m_block_count * detail::bloom_block::words;
+    uint64_t* __restrict dst = m_blocks;
+    const uint64_t* __restrict src = rhs.m_blocks;
+    for (size_t i = 0; i < words; i++)
+        dst[i] |= src[i];
+    return *this;
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+size_t DATUM_BLOOM_FILTER::block_count() const noexcept
+{
+    return m_block_count;
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+size_t DATUM_BLOOM_FILTER::size_in_bytes() const noexcept
+{
+    return m_block_count * detail::bloom_block::bytes;
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+double DATUM_BLOOM_FILTER::false_positive_rate(size_t num_keys) const noexcept
+{
+    return false_positive_rate(num_keys, m_block_count);
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+double DATUM_BLOOM_FILTER::false_positive_rate(size_t num_keys, size_t num_blocks) noexcept
+{
+    // The number of keys landing in a block is Poisson distributed. A block
+    // holding i keys has each bit of a word set with probability
+    // 1 - (1 - 1/64)^i, and a query must find all eight of its bits set.
+    double lambda = double(num_keys) / double(num_blocks);
+    double spread = 10 * std::sqrt(lambda) + 20;
+    size_t first = lambda > spread ? static_cast<size_t>(lambda - spread) : 0;
+    size_t last = static_cast<size_t>(lambda + spread);
+
+    // Poisson terms are computed in log space so large loads don't underflow.
+    double rate = 0;
+    for (size_t i = first; i <= last; i++) {
+        double poisson = lambda > 0
+            ? std::exp(double(i) * std::log(lambda) - lambda - std::lgamma(double(i) + 1))
+            : (i == 0 ? 1.0 : 0.0);
+        double bit_set = 1 - std::pow(1 - 1.0 / 64, double(i));
+        rate += poisson * std::pow(bit_set, double(detail::bloom_block::words));
+    }
+    return rate;
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+size_t DATUM_BLOOM_FILTER::blocks_for(size_t num_keys, double false_positive_rate)
+{
+    if (!(false_positive_rate > 0 && false_positive_rate < 1))
+        throw std::invalid_argument("dtm::bloom_filter: false positive rate must be in (0, 1)");
+    if (num_keys == 0)
+        return 1;
+
+    // The rate falls as blocks are added, so double then bisect. Even at
+    // 256 keys per block the rate is far above anything useful.
+    size_t hi = num_keys / 256 + 1;
+    while (bloom_filter::false_positive_rate(num_keys, hi) > false_positive_rate)
+        hi *= 2;
+    size_t lo = hi / 2 > num_keys / 256 ? hi / 2 : num_keys / 256;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (bloom_filter::false_positive_rate(num_keys, mid) > false_positive_rate)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return hi;
+}
+
+DATUM_BLOOM_FILTER_TEMPLATE
+uint64_t* DATUM_BLOOM_FILTER::block_for(uint64_t hash) const noexcept
+{
+    // The high half of the hash picks the block, the low half the bits.
+    size_t index = static_cast<size_t>(((hash >> 32) * m_block_count) >> 32);
+    return m_blocks + index * detail::bloom_block::words;
+}
+
+#undef DATUM_BLOOM_FILTER
+#undef DATUM_BLOOM_FILTER_TEMPLATE
+
+}
@@ -0,0 +1,562 @@
+// details/btree_map_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_BTREE_MAP_IMPL_HPP
+#error "Don't include or compile datum/detail/btree_map_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+#define DATUM_BTREE_MAP_TEMPLATE template <typename Key, typename Value, typename Compare, size_t NodeBytes>
+#define DATUM_BTREE_MAP btree_map<Key, Value, Compare, NodeBytes>
+
+DATUM_BTREE_MAP_TEMPLATE
+DATUM_BTREE_MAP::btree_map()
+    : m_root(nullptr), m_first(nullptr), m_size(0)
+{}
+
+DATUM_BTREE_MAP_TEMPLATE
+DATUM_BTREE_MAP::btree_map(const btree_map& rhs)
+    : btree_map()
+{
+    m_comp = rhs.m_comp;
+    const_iterator it = rhs.begin();
+    load_sorted(rhs.m_size,
+                [&](size_t) -> const Key& { return it->key; },
+                [&](size_t) -> const Value& { return (it++)->value; });
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+DATUM_BTREE_MAP::btree_map(btree_map&& rhs) noexcept
+    : btree_map()
+{
+    swap(rhs);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+DATUM_BTREE_MAP::~btree_map()
+{
+    clear();
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+DATUM_BTREE_MAP& DATUM_BTREE_MAP::operator= (const btree_map& rhs)
+{
+    if (this != &rhs) {
+        btree_map copy(rhs);
+        swap(copy);
+    }
+    return *this;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+DATUM_BTREE_MAP& DATUM_BTREE_MAP::operator= (btree_map&& rhs) noexcept
+{
+    btree_map moved(std::move(rhs));
+    swap(moved);
+    return *this;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::iterator DATUM_BTREE_MAP::begin() noexcept
+{
+    return skip_empty(m_first, 0);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::iterator DATUM_BTREE_MAP::end() noexcept
+{
+    return iterator(nullptr, 0);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::const_iterator DATUM_BTREE_MAP::begin() const noexcept
+{
+    return skip_empty(m_first, 0);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::const_iterator DATUM_BTREE_MAP::end() const noexcept
+{
+    return const_iterator(nullptr, 0);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+size_t DATUM_BTREE_MAP::size() const noexcept
+{
+    return m_size;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+bool DATUM_BTREE_MAP::empty() const noexcept
+{
+    return m_size == 0;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+void DATUM_BTREE_MAP::swap(btree_map& rhs) noexcept
+{
+    using std::swap;
+    swap(m_root, rhs.m_root);
+    swap(m_first, rhs.m_first);
+    swap(m_size, rhs.m_size);
+    swap(m_comp, rhs.m_comp);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+void DATUM_BTREE_MAP::clear()
+{
+    if (m_root)
+        destroy(m_root);
+    m_root = nullptr;
+    m_first = nullptr;
+    m_size = 0;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+void DATUM_BTREE_MAP::bulk_load(const vec<Key>& keys, const vec<Value>& values)
+{
+    if (keys.size() != values.size())
+        throw std::invalid_argument("dtm::btree_map::bulk_load: key and value counts differ");
+    for (size_t i = 1; i < keys.size(); i++)
+        if (!m_comp(keys[i - 1], keys[i]))
+            throw std::invalid_argument("dtm::btree_map::bulk_load: keys are not strictly increasing");
+
+    load_sorted(keys.size(),
+                [&](size_t i) -> const Key& { return keys[i]; },
+                [&](size_t i) -> const Value& { return values[i]; });
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+bool DATUM_BTREE_MAP::insert(const Key& key, const Value& value)
+{
+    if (!m_root) {
+        m_first = new_leaf();
+        m_root = m_first;
+    }
+
+    if (is_full(m_root)) {
+        inner* root = new_inner();
+        root->children[0] = m_root;
+        try {
+            split_child(root, 0);
+        }
+        catch (...) {
+            free_node(root);
+            throw;
+        }
+        m_root = root;
+    }
+
+    node* n = m_root;
+    while (!n->is_leaf) {
+        inner* in = static_cast<inner*>(n);
+        size_t index = child_index(in, key);
+        if (is_full(in->children[index])) {
+            split_child(in, index);
+            if (!m_comp(key, in->keys()[index]))
+                ++index;
+        }
+        n = in->children[index];
+    }
+
+    leaf* l = static_cast<leaf*>(n);
+    Key* keys = l->keys();
+    Value* values = l->values();
+    size_t count = l->count;
+    size_t index = node_lower_bound(keys, count, key, m_comp);
+    if (index < count && !m_comp(key, keys[index]))
+        return false;
+
+    // Construct in the free slot at the end, then rotate it into place so a
+    // throwing copy leaves the leaf untouched.
+    new (&keys[count]) Key(key);
+    try {
+        new (&values[count]) Value(value);
+    }
+    catch (...) {
+        keys[count].~Key();
+        throw;
+    }
+
+    if (index < count) {
+        typename std::aligned_storage<sizeof(Key), alignof(Key)>::type key_tmp;
+        typename std::aligned_storage<sizeof(Value), alignof(Value)>::type value_tmp;
+        std::memcpy(static_cast<void*>(&key_tmp), &keys[count], sizeof(Key));
+        std::memcpy(static_cast<void*>(&value_tmp), &values[count], sizeof(Value));
+        std::memmove(static_cast<void*>(&keys[index + 1]), &keys[index], (count - index) * sizeof(Key));
+        std::memmove(static_cast<void*>(&values[index + 1]), &values[index], (count - index) * sizeof(Value));
+        std::memcpy(static_cast<void*>(&keys[index]), &key_tmp, sizeof(Key));
+        std::memcpy(static_cast<void*>(&values[index]), &value_tmp, sizeof(Value));
+    }
+
+    l->count++;
+    m_size++;
+    return true;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+Value& DATUM_BTREE_MAP::operator[] (const Key& key)
+{
+    iterator it = find(key);
+    if (it == end()) {
+        insert(key, Value());
+        it = find(key);
+    }
+    return it->value;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+Value& DATUM_BTREE_MAP::at(const Key& key)
+{
+    iterator it = find(key);
+    if (it == end())
+        throw std::out_of_range("dtm::btree_map::at");
+    return it->value;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+const Value& DATUM_BTREE_MAP::at(const Key& key) const
+{
+    const_iterator it = find(key);
+    if (it == end())
+        throw std::out_of_range("dtm::btree_map::at");
+    return it->value;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::iterator DATUM_BTREE_MAP::find(const Key& key)
+{
+    leaf* l = find_leaf(key);
+    if (!l)
+        return end();
+    size_t index = node_lower_bound(l->keys(), l->count, key, m_comp);
+    if (index < l->count && !m_comp(key, l->keys()[index]))
+        return iterator(l, index);
+    return end();
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::const_iterator DATUM_BTREE_MAP::find(const Key& key) const
+{
+    return const_cast<btree_map*>(this)->find(key);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+bool DATUM_BTREE_MAP::contains(const Key& key) const
+{
+    return find(key) != end();
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::iterator DATUM_BTREE_MAP::lower_bound(const Key& key)
+{
+    leaf* l = find_leaf(key);
+    if (!l)
+        return end();
+    return skip_empty(l, node_lower_bound(l->keys(), l->count, key, m_comp));
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::const_iterator DATUM_BTREE_MAP::lower_bound(const Key& key) const
+{
+    return const_cast<btree_map*>(this)->lower_bound(key);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::iterator DATUM_BTREE_MAP::upper_bound(const Key& key)
+{
+    iterator it = lower_bound(key);
+    if (it != end() && !m_comp(key, it->key))
+        ++it;
+    return it;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::const_iterator DATUM_BTREE_MAP::upper_bound(const Key& key) const
+{
+    return const_cast<btree_map*>(this)->upper_bound(key);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+template <typename Fn>
+void DATUM_BTREE_MAP::for_each_in_range(const Key& first, const Key& last, Fn&& fn) const
+{
+    leaf* l = find_leaf(first);
+    if (!l)
+        return;
+
+    size_t index = node_lower_bound(l->keys(), l->count, first, m_comp);
+    for (; l; l = l->next, index = 0) {
+        const Key* keys = l->keys();
+        const Value* values = l->values();
+        size_t count = l->count;
+        for (; index < count; index++) {
+            if (!m_comp(keys[index], last))
+                return;
+            fn(keys[index], values[index]);
+        }
+    }
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+size_t DATUM_BTREE_MAP::erase(const Key& key)
+{
+    iterator it = find(key);
+    if (it == end())
+        return 0;
+
+    leaf* l = it.m_leaf;
+    size_t index = it.m_index;
+    l->keys()[index].~Key();
+    l->values()[index].~Value();
+    size_t tail = l->count - index - 1;
+    std::memmove(static_cast<void*>(&l->keys()[index]), &l->keys()[index + 1], tail * sizeof(Key));
+    std::memmove(static_cast<void*>(&l->values()[index]), &l->values()[index + 1], tail * sizeof(Value));
+    l->count--;
+    m_size--;
+    return 1;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+size_t DATUM_BTREE_MAP::node_lower_bound(const Key* keys, size_t count, const Key& key, const Compare& comp)
+{
+    return detail::btree_search<Key, Compare>::lower_bound(keys, count, key, comp);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::leaf* DATUM_BTREE_MAP::new_leaf()
+{
+    leaf* l = static_cast<leaf*>(detail::aligned_allocate(DATUM_CACHE_LINE_SIZE, sizeof(leaf)));
+    l->count = 0;
+    l->is_leaf = true;
+    l->next = nullptr;
+    l->prev = nullptr;
+    return l;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::inner* DATUM_BTREE_MAP::new_inner()
+{
+    inner* n = static_cast<inner*>(detail::aligned_allocate(DATUM_CACHE_LINE_SIZE, sizeof(inner)));
+    n->count = 0;
+    n->is_leaf = false;
+    return n;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+void DATUM_BTREE_MAP::free_node(node* n) noexcept
+{
+    detail::aligned_free(n);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+size_t DATUM_BTREE_MAP::child_index(inner* n, const Key& key) const
+{
+    // Separator i is the smallest key in child i + 1, so a key equal to a
+    // separator belongs to its right.
+    size_t index = node_lower_bound(n->keys(), n->count, key, m_comp);
+    return index + (index < n->count && !m_comp(key, n->keys()[index]));
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::leaf* DATUM_BTREE_MAP::find_leaf(const Key& key) const
+{
+    node* n = m_root;
+    if (!n)
+        return nullptr;
+    while (!n->is_leaf) {
+        inner* in = static_cast<inner*>(n);
+        n = in->children[child_index(in, key)];
+    }
+    return static_cast<leaf*>(n);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+typename DATUM_BTREE_MAP::iterator DATUM_BTREE_MAP::skip_empty(leaf* l, size_t index) noexcept
+{
+    while (l && index >= l->count) {
+        l = l->next;
+        index = 0;
+    }
+    return iterator(l, index);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+bool DATUM_BTREE_MAP::is_full(const node* n) noexcept
+{
+    return n->count == (n->is_leaf ? leaf_capacity : inner_capacity);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+void DATUM_BTREE_MAP::split_child(inner* parent, size_t index)
+{
+    // parent is never full here; the right half of its child moves to a new
+    // node at index + 1 and the separator is inserted at index.
+    node* child = parent->children[index];
+    size_t mid = child->count / 2;
+    node* right;
+    typename std::aligned_storage<sizeof(Key), alignof(Key)>::type separator;
+
+    if (child->is_leaf) {
+        leaf* left = static_cast<leaf*>(child);
+        leaf* r = new_leaf();
+        try {
+            new (&separator) Key(left->keys()[mid]);
+        }
+        catch (...) {
+            free_node(r);
+            throw;
+        }
+
+        size_t moved = left->count - mid;
+        std::memcpy(static_cast<void*>(r->keys()), &left->keys()[mid], moved * sizeof(Key));
+        std::memcpy(static_cast<void*>(r->values()), &left->values()[mid], moved * sizeof(Value));
+        r->count = moved;
+        left->count = mid;
+
+        r->next = left->next;
+        r->prev = left;
+        if (left->next)
+            left->next->prev = r;
+        left->next = r;
+        right = r;
+    }
+    else {
+        // The middle key moves up into the parent rather than being copied.
+        inner* left = static_cast<inner*>(child);
+        inner* r = new_inner();
+        std::memcpy(static_cast<void*>(&separator), &left->keys()[mid], sizeof(Key));
+
+        size_t moved = left->count - mid - 1;
+        std::memcpy(static_cast<void*>(r->keys()), &left->keys()[mid + 1], moved * sizeof(Key));
+        std::memcpy(static_cast<void*>(r->children), &left->children[mid + 1], (moved + 1) * sizeof(node*));
+        r->count = moved;
+        left->count = mid;
+        right = r;
+    }
+
+    size_t count = parent->count;
+    std::memmove(static_cast<void*>(&parent->keys()[index + 1]), &parent->keys()[index], (count - index) * sizeof(Key));
+    std::memmove(static_cast<void*>(&parent->children[index + 2]), &parent->children[index + 1], (count - index) * sizeof(node*));
+    std::memcpy(static_cast<void*>(&parent->keys()[index]), &separator, sizeof(Key));
+    parent->children[index + 1] = right;
+    parent->count++;
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+void DATUM_BTREE_MAP::destroy(node* n) noexcept
+{
+    if (n->is_leaf) {
+        leaf* l = static_cast<leaf*>(n);
+        for (size_t i = 0; i < l->count; i++) {
+            l->keys()[i].~Key();
+            l->values()[i].~Value();
+        }
+    }
+    else {
+        inner* in = static_cast<inner*>(n);
+        for (size_t i = 0; i <= in->count; i++)
+            destroy(in->children[i]);
+        for (size_t i = 0; i < in->count; i++)
+            in->keys()[i].~Key();
+    }
+    free_node(n);
+}
+
+DATUM_BTREE_MAP_TEMPLATE
+template <typename KeyAt, typename ValueAt>
+void DATUM_BTREE_MAP::load_sorted(size_t n, KeyAt&& key_at, ValueAt&& value_at)
+{
+    clear();
+    if (n == 0)
+        return;
+
+    // Build the leaf chain packed full, then each inner level from the
+    // smallest key of the level below. Until the root is set, m_root is
+    // null and the partial tree is torn down by hand on failure.
+    vec<node*> level;
+    vec<const Key*> level_min;
+    vec<inner*> inners;
+
+    try {
+        leaf* prev = nullptr;
+        for (size_t i = 0; i < n; ) {
+            leaf* l = new_leaf();
+            l->prev = prev;
+            if (prev)
+                prev->next = l;
+            else
+                m_first = l;
+            prev = l;
+
+            size_t end = n - i < leaf_capacity ? n : i + leaf_capacity;
+            for (; i < end; i++) {
+                new (&l->keys()[l->count]) Key(key_at(i));
+                try {
+                    new (&l->values()[l->count]) Value(value_at(i));
+                }
+                catch (...) {
+                    l->keys()[l->count].~Key();
+                    throw;
+                }
+                l->count++;
+            }
+
+            level.push_back(l);
+            level_min.push_back(&l->keys()[0]);
+        }
+
+        // Spread children evenly so no inner node is left nearly empty.
+        while (level.size() > 1) {
+            size_t fanout = inner_capacity + 1;
+            size_t groups = (level.size() + fanout - 1) / fanout;
+            vec<node*> next_level;
+            vec<const Key*> next_min;
+
+            size_t pos = 0;
+            for (size_t g = 0; g < groups; g++) {
+                size_t take = (level.size() - pos) / (groups - g);
+                inners.push_back(nullptr);
+                inner* in = new_inner();
+                inners.back() = in;
+
+                in->children[0] = level[pos];
+                for (size_t c = 1; c < take; c++) {
+                    new (&in->keys()[in->count]) Key(*level_min[pos + c]);
+                    in->children[in->count + 1] = level[pos + c];
+                    in->count++;
+                }
+
+                next_level.push_back(in);
+                next_min.push_back(level_min[pos]);
+                pos += take;
+            }
+
+            level = std::move(next_level);
+            level_min = std::move(next_min);
+        }
+    }
+    catch (...) {
+        for (size_t i = 0; i < inners.size() && inners[i]; i++) {
+            for (size_t k = 0; k < inners[i]->count; k++)
+                inners[i]->keys()[k].~Key();
+            free_node(inners[i]);
+        }
+        for (leaf* l = m_first; l; ) {
+            leaf* next = l->next;
+            destroy(l);
+            l = next;
+        }
+        m_first = nullptr;
+        throw;
+    }
+
+    m_root = level[0];
+    m_size = n;
+}
+
+#undef DATUM_BTREE_MAP
+#undef DATUM_BTREE_MAP_TEMPLATE
+
+}
@@ -0,0 +1,272 @@
+// details/concurrent_vec_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_CONCURRENT_VEC_IMPL_HPP
+#error "Don't include or compile datum/detail/concurrent_vec_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+template <typename T>
+concurrent_vec<T>::concurrent_vec() noexcept
+    : m_reserved(0), m_published(0)
+{
+    for (size_t s = 0; s < num_segments; s++)
+        m_segments[s].store(nullptr, std::memory_order_relaxed);
+}
+
+template <typename T>
+concurrent_vec<T>::~concurrent_vec()
+{
+    clear();
+    for (size_t s = 0; s < num_segments; s++)
+        detail::aligned_free(m_segments[s].load(std::memory_order_relaxed));
+}
+
+// Segment arithmetic
+
+template <typename T>
+size_t concurrent_vec<T>::segment_of(size_t index) noexcept
+{
+    // Position of the highest set bit, treating everything in the first
+    // segment as if it had the bits of first_segment_size - 1.
+    size_t high_bit = sizeof(unsigned long long) * 8 - 1 -
+        __builtin_clzll(static_cast<unsigned long long>(index | (first_segment_size - 1)));
+    return high_bit - first_segment_log2 + 1;
+}
+
+template <typename T>
+size_t concurrent_vec<T>::segment_begin(size_t segment) noexcept
+{
+    return segment == 0 ? 0 : first_segment_size << (segment - 1);
+}
+
+template <typename T>
+size_t concurrent_vec<T>::segment_size(size_t segment) noexcept
+{
+    return segment == 0 ? first_segment_size : first_segment_size << (segment - 1);
+}
+
+template <typename T>
+std::atomic<unsigned char>* concurrent_vec<T>::ready_flags(T* block, size_t segment) noexcept
+{
+    return reinterpret_cast<std::atomic<unsigned char>*>(block + segment_size(segment));
+}
+
+template <typename T>
+bool concurrent_vec<T>::is_ready(size_t index) const noexcept
+{
+    size_t segment = segment_of(index);
+    T* block = m_segments[segment].load(std::memory_order_acquire);
+    return block && ready_flags(block, segment)[index - segment_begin(segment)].load(std::memory_order_acquire);
+}
+
+template <typename T>
+T* concurrent_vec<T>::slot(size_t index) const noexcept
+{
+    size_t segment = segment_of(index);
+    return m_segments[segment].load(std::memory_order_acquire) + (index - segment_begin(segment));
+}
+
+template <typename T>
+T* concurrent_vec<T>::ensure_segment(size_t segment)
+{
+    T* block = m_segments[segment].load(std::memory_order_acquire);
+    if (block)
+        return block;
+
+    // Several writers can race to allocate the same segment. Exactly one
+    // of them wins the exchange; the rest give their block back.
+    size_t size = segment_size(segment);
+    T* new_block = static_cast<T*>(detail::aligned_allocate(segment_alignment, sizeof(T) * size + size));
+    std::atomic<unsigned char>* flags = ready_flags(new_block, segment);
+    for (size_t i = 0; i < size; i++)
+        new (&flags[i]) std::atomic<unsigned char>(0);
+
+    if (m_segments[segment].compare_exchange_strong(block, new_block, std::memory_order_acq_rel))
+        return new_block;
+
+    detail::aligned_free(new_block);
+    return block;
+}
+
+// Writers
+
+template <typename T>
+size_t concurrent_vec<T>::reserve_slots(size_t count)
+{
+    return m_reserved.fetch_add(count, std::memory_order_relaxed);
+}
+
+template <typename T>
+void concurrent_vec<T>::publish() noexcept
+{
+    // Move m_published over every ready slot past it. The fence orders this
+    // writer's flags before its scan, so whichever writer of a run of ready
+    // slots gets here last sees all of their flags and publishes the run;
+    // the others stop at a slot that isn't ready yet and leave it to them.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    size_t published = m_published.load(std::memory_order_acquire);
+    for (;;) {
+        size_t end = published;
+        while (is_ready(end))
+            ++end;
+        if (end == published)
+            return;
+        // On failure published is reloaded; another writer got further.
+        if (m_published.compare_exchange_weak(published, end, std::memory_order_acq_rel, std::memory_order_acquire))
+            return;
+    }
+}
+
+template <typename T>
+template <typename Fn>
+void concurrent_vec<T>::construct_range(size_t first, size_t count, Fn&& construct) noexcept
+{
+    // Once slots are reserved, size() can't pass them until they are ready,
+    // so there is no way to back out. An allocation failure or a throwing
+    // constructor in here terminates the program.
+    size_t index = first;
+    size_t last = first + count;
+    while (index != last) {
+        size_t segment = segment_of(index);
+        size_t segment_end = segment_begin(segment) + segment_size(segment);
+        size_t chunk_end = last < segment_end ? last : segment_end;
+
+        T* block = ensure_segment(segment);
+        std::atomic<unsigned char>* flags = ready_flags(block, segment);
+        for (; index != chunk_end; ++index) {
+            size_t offset = index - segment_begin(segment);
+            construct(block + offset);
+            flags[offset].store(1, std::memory_order_release);
+        }
+    }
+    publish();
+}
+
+template <typename T>
+size_t concurrent_vec<T>::push_back(const T& val)
+{
+    return emplace_back(val);
+}
+
+template <typename T>
+size_t concurrent_vec<T>::push_back(T&& val)
+{
+    return emplace_back(std::move(val));
+}
+
+template <typename T>
+template <typename... Args>
+size_t concurrent_vec<T>::emplace_back(Args&&... args)
+{
+    size_t index = reserve_slots(1);
+    construct_range(index, 1, [&](T* ptr) { new (ptr) T(std::forward<Args>(args)...); });
+    return index;
+}
+
+template <typename T>
+template <typename... Args>
+size_t concurrent_vec<T>::grow_by(size_t count, Args&&... args)
+{
+    size_t first = reserve_slots(count);
+    construct_range(first, count, [&](T* ptr) { new (ptr) T(args...); });
+    return first;
+}
+
+template <typename T>
+template <typename It, typename>
+size_t concurrent_vec<T>::grow_by(It begin, It end)
+{
+    size_t count = std::distance(begin, end);
+    size_t first = reserve_slots(count);
+    construct_range(first, count, [&](T* ptr) { new (ptr) T(*begin++); });
+    return first;
+}
+
+// Readers
+
+template <typename T>
+size_t concurrent_vec<T>::size() const noexcept
+{
+    return m_published.load(std::memory_order_acquire);
+}
+
+template <typename T>
+bool concurrent_vec<T>::empty() const noexcept
+{
+    return size() == 0;
+}
+
+template <typename T>
+const T& concurrent_vec<T>::operator[] (size_t index) const noexcept
+{
+    return *slot(index);
+}
+
+template <typename T>
+T& concurrent_vec<T>::operator[] (size_t index) noexcept
+{
+    return *slot(index);
+}
+
+template <typename T>
+const T& concurrent_vec<T>::at(size_t index) const
+{
+    if (index >= size())
+        throw std::out_of_range("dtm::concurrent_vec::at");
+
+    return *slot(index);
+}
+
+template <typename T>
+T& concurrent_vec<T>::at(size_t index)
+{
+    if (index >= size())
+        throw std::out_of_range("dtm::concurrent_vec::at");
+
+    return *slot(index);
+}
+
+template <typename T>
+typename concurrent_vec<T>::const_iterator concurrent_vec<T>::begin() const noexcept
+{
+    return const_iterator(this, 0);
+}
+
+template <typename T>
+typename concurrent_vec<T>::const_iterator concurrent_vec<T>::end() const noexcept
+{
+    return const_iterator(this, size());
+}
+
+template <typename T>
+template <typename Fn>
+void concurrent_vec<T>::for_each_chunk(size_t count, Fn&& fn) const
+{
+    size_t index = 0;
+    for (size_t segment = 0; index < count; segment++) {
+        size_t length = segment_size(segment);
+        if (length > count - index)
+            length = count - index;
+        fn(static_cast<const T*>(m_segments[segment].load(std::memory_order_acquire)), length);
+        index += length;
+    }
+}
+
+template <typename T>
+void concurrent_vec<T>::clear()
+{
+    size_t count = m_published.load(std::memory_order_relaxed);
+    for (size_t index = 0; index < count; index++) {
+        slot(index)->~T();
+        size_t segment = segment_of(index);
+        T* block = m_segments[segment].load(std::memory_order_relaxed);
+        ready_flags(block, segment)[index - segment_begin(segment)].store(0, std::memory_order_relaxed);
+    }
+
+    m_reserved.store(0, std::memory_order_relaxed);
+    m_published.store(0, std::memory_order_relaxed);
+}
+
+} // namespace dtm
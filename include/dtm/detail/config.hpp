@@ -7,4 +7,10 @@
 
 #define DATUM_IS_64BIT_SIZET
 
+// Size of a cache line in bytes. 64 on x86.
+#define DATUM_CACHE_LINE_SIZE 64
+
+// Size of a memory page in bytes. 4096 on x86 without huge pages.
+#define DATUM_PAGE_SIZE 4096
+
 #endif //INCLUDED_DATUM_DETAIL_CONFIG_HPP
@@ -0,0 +1,71 @@
+// detail/cpu.hpp
+//
+// Runtime detection of x86 instruction set extensions.
+//
+// Kernels that have faster versions for newer instruction sets compile
+// each version with DATUM_TARGET and pick one at run time from cpu(), so
+// a binary built for baseline x86-64 still uses AVX2 where it exists.
+
+#ifndef INCLUDED_DATUM_DETAIL_CPU_HPP
+#define INCLUDED_DATUM_DETAIL_CPU_HPP
+
+#include <cstdint>
+
+#include "dtm/detail/config.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DATUM_X86 1
+#define DATUM_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#else
+#define DATUM_X86 0
+#define DATUM_TARGET(isa)
+#endif
+
+namespace dtm {
+namespace detail {
+
+struct cpu_features {
+    bool ssse3;
+    bool sse41;
+    bool sse42;
+    bool popcnt;
+    bool avx2;
+    bool bmi2;
+    bool avx512f;
+    bool avx512bw;
+};
+
+inline cpu_features detect_cpu_features() noexcept {
+    cpu_features features = {};
+#if DATUM_X86
+    __builtin_cpu_init();
+    features.ssse3 = __builtin_cpu_supports("ssse3");
+    features.sse41 = __builtin_cpu_supports("sse4.1");
+    features.sse42 = __builtin_cpu_supports("sse4.2");
+    features.popcnt = __builtin_cpu_supports("popcnt");
+    features.avx2 = __builtin_cpu_supports("avx2");
+    features.bmi2 = __builtin_cpu_supports("bmi2");
+    features.avx512f = __builtin_cpu_supports("avx512f");
+    features.avx512bw = __builtin_cpu_supports("avx512bw");
+#endif
+    return features;
+}
+
+// Features of the CPU we are running on, detected once.
+inline const cpu_features& cpu() noexcept {
+    static const cpu_features features = detect_cpu_features();
+    return features;
+}
+
+// Without the popcnt instruction __builtin_popcountll is a library call.
+inline unsigned popcount_swar(uint64_t x) noexcept {
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return unsigned((x * 0x0101010101010101ull) >> 56);
+}
+
+} } // namespace
+
+#endif //INCLUDED_DATUM_DETAIL_CPU_HPP
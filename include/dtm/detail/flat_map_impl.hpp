@@ -0,0 +1,389 @@
+// details/flat_map_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_FLAT_MAP_IMPL_HPP
+#error "Don't include or compile datum/detail/flat_map_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+namespace detail {
+
+template <typename Layout, typename Key, typename Compare>
+vec<size_t> flat_build_order(const vec<Key>& keys, const Compare& comp)
+{
+    size_t n = keys.size();
+    vec<size_t> order;
+    order.resize_for_overwrite(n);
+    for (size_t i = 0; i < n; i++)
+        order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return comp(keys[a], keys[b]);
+    });
+
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (unique == 0 || comp(keys[order[unique - 1]], keys[order[i]]))
+            order[unique++] = order[i];
+    }
+    order.resize(unique);
+
+    Layout::arrange(order);
+    return order;
+}
+
+template <typename T>
+vec<T> flat_gather(vec<T>& src, const vec<size_t>& order)
+{
+    vec<T> result;
+    result.reserve(order.size());
+    for (size_t index : order)
+        result.push_back(std::move(src[index]));
+    return result;
+}
+
+}
+
+// flat_set
+
+#define DATUM_FLAT_SET_TEMPLATE template <typename Key, typename Compare, typename Layout>
+#define DATUM_FLAT_SET flat_set<Key, Compare, Layout>
+
+DATUM_FLAT_SET_TEMPLATE
+DATUM_FLAT_SET::flat_set(vec<Key> keys, const Compare& comp)
+    : m_comp(comp)
+{
+    vec<size_t> order = detail::flat_build_order<Layout>(keys, m_comp);
+    m_keys = detail::flat_gather(keys, order);
+}
+
+DATUM_FLAT_SET_TEMPLATE
+DATUM_FLAT_SET::flat_set(std::initializer_list<Key> init, const Compare& comp)
+    : flat_set(vec<Key>(init), comp)
+{}
+
+DATUM_FLAT_SET_TEMPLATE
+template <typename It, typename>
+DATUM_FLAT_SET::flat_set(It begin, It end, const Compare& comp)
+    : flat_set(vec<Key>(begin, end), comp)
+{}
+
+DATUM_FLAT_SET_TEMPLATE
+typename DATUM_FLAT_SET::const_iterator DATUM_FLAT_SET::begin() const noexcept
+{
+    return make_iterator(Layout::first(size()));
+}
+
+DATUM_FLAT_SET_TEMPLATE
+typename DATUM_FLAT_SET::const_iterator DATUM_FLAT_SET::end() const noexcept
+{
+    return make_iterator(size());
+}
+
+DATUM_FLAT_SET_TEMPLATE
+size_t DATUM_FLAT_SET::size() const noexcept
+{
+    return m_keys.size();
+}
+
+DATUM_FLAT_SET_TEMPLATE
+bool DATUM_FLAT_SET::empty() const noexcept
+{
+    return m_keys.empty();
+}
+
+DATUM_FLAT_SET_TEMPLATE
+span<const Key> DATUM_FLAT_SET::keys() const noexcept
+{
+    return m_keys;
+}
+
+DATUM_FLAT_SET_TEMPLATE
+typename DATUM_FLAT_SET::const_iterator DATUM_FLAT_SET::lower_bound(const Key& key) const
+{
+    return make_iterator(Layout::lower_bound(m_keys.data(), size(), key, m_comp));
+}
+
+DATUM_FLAT_SET_TEMPLATE
+typename DATUM_FLAT_SET::const_iterator DATUM_FLAT_SET::find(const Key& key) const
+{
+    return make_iterator(find_index(key));
+}
+
+DATUM_FLAT_SET_TEMPLATE
+bool DATUM_FLAT_SET::contains(const Key& key) const
+{
+    return find_index(key) != size();
+}
+
+DATUM_FLAT_SET_TEMPLATE
+size_t DATUM_FLAT_SET::count(const Key& key) const
+{
+    return contains(key) ? 1 : 0;
+}
+
+DATUM_FLAT_SET_TEMPLATE
+bool DATUM_FLAT_SET::insert(const Key& key)
+{
+    static_assert(Layout::is_mutable, "this flat_set layout is read only");
+    size_t index = Layout::lower_bound(m_keys.data(), size(), key, m_comp);
+    if (index != size() && !m_comp(key, m_keys[index]))
+        return false;
+    m_keys.insert(m_keys.begin() + index, key);
+    return true;
+}
+
+DATUM_FLAT_SET_TEMPLATE
+size_t DATUM_FLAT_SET::erase(const Key& key)
+{
+    static_assert(Layout::is_mutable, "this flat_set layout is read only");
+    size_t index = find_index(key);
+    if (index == size())
+        return 0;
+    std::move(m_keys.begin() + index + 1, m_keys.end(), m_keys.begin() + index);
+    m_keys.pop_back();
+    return 1;
+}
+
+DATUM_FLAT_SET_TEMPLATE
+void DATUM_FLAT_SET::clear()
+{
+    m_keys.clear();
+}
+
+DATUM_FLAT_SET_TEMPLATE
+typename DATUM_FLAT_SET::const_iterator DATUM_FLAT_SET::make_iterator(size_t index) const noexcept
+{
+    return const_iterator(detail::flat_set_accessor<Key>{ m_keys.data() }, index, size());
+}
+
+DATUM_FLAT_SET_TEMPLATE
+size_t DATUM_FLAT_SET::find_index(const Key& key) const
+{
+    size_t index = Layout::lower_bound(m_keys.data(), size(), key, m_comp);
+    return index != size() && !m_comp(key, m_keys[index]) ? index : size();
+}
+
+#undef DATUM_FLAT_SET
+#undef DATUM_FLAT_SET_TEMPLATE
+
+// flat_map
+
+#define DATUM_FLAT_MAP_TEMPLATE template <typename Key, typename Value, typename Compare, typename Layout>
+#define DATUM_FLAT_MAP flat_map<Key, Value, Compare, Layout>
+
+DATUM_FLAT_MAP_TEMPLATE
+DATUM_FLAT_MAP::flat_map(vec<Key> keys, vec<Value> values, const Compare& comp)
+    : m_comp(comp)
+{
+    if (keys.size() != values.size())
+        throw std::invalid_argument("dtm::flat_map: key and value counts differ");
+
+    vec<size_t> order = detail::flat_build_order<Layout>(keys, m_comp);
+    m_keys = detail::flat_gather(keys, order);
+    m_values = detail::flat_gather(values, order);
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+template <typename It, typename>
+DATUM_FLAT_MAP::flat_map(It begin, It end, const Compare& comp)
+    : flat_map(split(begin, end), comp)
+{}
+
+DATUM_FLAT_MAP_TEMPLATE
+DATUM_FLAT_MAP::flat_map(std::initializer_list<std::pair<Key, Value>> init, const Compare& comp)
+    : flat_map(init.begin(), init.end(), comp)
+{}
+
+DATUM_FLAT_MAP_TEMPLATE
+DATUM_FLAT_MAP::flat_map(std::pair<vec<Key>, vec<Value>>&& columns, const Compare& comp)
+    : flat_map(std::move(columns.first), std::move(columns.second), comp)
+{}
+
+DATUM_FLAT_MAP_TEMPLATE
+template <typename It>
+std::pair<vec<Key>, vec<Value>> DATUM_FLAT_MAP::split(It begin, It end)
+{
+    std::pair<vec<Key>, vec<Value>> columns;
+    for (It it = begin; it != end; ++it) {
+        columns.first.push_back(it->first);
+        columns.second.push_back(it->second);
+    }
+    return columns;
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+typename DATUM_FLAT_MAP::iterator DATUM_FLAT_MAP::begin() noexcept
+{
+    return make_iterator(Layout::first(size()));
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+typename DATUM_FLAT_MAP::iterator DATUM_FLAT_MAP::end() noexcept
+{
+    return make_iterator(size());
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+typename DATUM_FLAT_MAP::const_iterator DATUM_FLAT_MAP::begin() const noexcept
+{
+    return make_iterator(Layout::first(size()));
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+typename DATUM_FLAT_MAP::const_iterator DATUM_FLAT_MAP::end() const noexcept
+{
+    return make_iterator(size());
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+size_t DATUM_FLAT_MAP::size() const noexcept
+{
+    return m_keys.size();
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+bool DATUM_FLAT_MAP::empty() const noexcept
+{
+    return m_keys.empty();
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+span<const Key> DATUM_FLAT_MAP::keys() const noexcept
+{
+    return m_keys;
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+span<const Value> DATUM_FLAT_MAP::values() const noexcept
+{
+    return m_values;
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+span<Value> DATUM_FLAT_MAP::values() noexcept
+{
+    return m_values;
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+typename DATUM_FLAT_MAP::iterator DATUM_FLAT_MAP::lower_bound(const Key& key)
+{
+    return make_iterator(Layout::lower_bound(m_keys.data(), size(), key, m_comp));
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+typename DATUM_FLAT_MAP::const_iterator DATUM_FLAT_MAP::lower_bound(const Key& key) const
+{
+    return make_iterator(Layout::lower_bound(m_keys.data(), size(), key, m_comp));
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+typename DATUM_FLAT_MAP::iterator DATUM_FLAT_MAP::find(const Key& key)
+{
+    return make_iterator(find_index(key));
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+typename DATUM_FLAT_MAP::const_iterator DATUM_FLAT_MAP::find(const Key& key) const
+{
+    return make_iterator(find_index(key));
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+bool DATUM_FLAT_MAP::contains(const Key& key) const
+{
+    return find_index(key) != size();
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+size_t DATUM_FLAT_MAP::count(const Key& key) const
+{
+    return contains(key) ? 1 : 0;
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+Value& DATUM_FLAT_MAP::at(const Key& key)
+{
+    size_t index = find_index(key);
+    if (index == size())
+        throw std::out_of_range("dtm::flat_map::at");
+    return m_values[index];
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+const Value& DATUM_FLAT_MAP::at(const Key& key) const
+{
+    size_t index = find_index(key);
+    if (index == size())
+        throw std::out_of_range("dtm::flat_map::at");
+    return m_values[index];
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+std::pair<typename DATUM_FLAT_MAP::iterator, bool> DATUM_FLAT_MAP::insert(const Key& key, const Value& value)
+{
+    static_assert(Layout::is_mutable, "this flat_map layout is read only");
+    size_t index = Layout::lower_bound(m_keys.data(), size(), key, m_comp);
+    if (index != size() && !m_comp(key, m_keys[index]))
+        return std::make_pair(make_iterator(index), false);
+    m_keys.insert(m_keys.begin() + index, key);
+    m_values.insert(m_values.begin() + index, value);
+    return std::make_pair(make_iterator(index), true);
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+Value& DATUM_FLAT_MAP::operator[] (const Key& key)
+{
+    static_assert(Layout::is_mutable, "this flat_map layout is read only");
+    size_t index = find_index(key);
+    if (index == size())
+        index = insert(key, Value()).first.index();
+    return m_values[index];
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+size_t DATUM_FLAT_MAP::erase(const Key& key)
+{
+    static_assert(Layout::is_mutable, "this flat_map layout is read only");
+    size_t index = find_index(key);
+    if (index == size())
+        return 0;
+    std::move(m_keys.begin() + index + 1, m_keys.end(), m_keys.begin() + index);
+    std::move(m_values.begin() + index + 1, m_values.end(), m_values.begin() + index);
+    m_keys.pop_back();
+    m_values.pop_back();
+    return 1;
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+void DATUM_FLAT_MAP::clear()
+{
+    m_keys.clear();
+    m_values.clear();
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+typename DATUM_FLAT_MAP::iterator DATUM_FLAT_MAP::make_iterator(size_t index) noexcept
+{
+    return iterator(detail::flat_map_accessor<Key, Value>{ m_keys.data(), m_values.data() }, index, size());
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+typename DATUM_FLAT_MAP::const_iterator DATUM_FLAT_MAP::make_iterator(size_t index) const noexcept
+{
+    return const_iterator(detail::flat_map_accessor<Key, const Value>{ m_keys.data(), m_values.data() }, index, size());
+}
+
+DATUM_FLAT_MAP_TEMPLATE
+size_t DATUM_FLAT_MAP::find_index(const Key& key) const
+{
+    size_t index = Layout::lower_bound(m_keys.data(), size(), key, m_comp);
+    return index != size() && !m_comp(key, m_keys[index]) ? index : size();
+}
+
+#undef DATUM_FLAT_MAP
+#undef DATUM_FLAT_MAP_TEMPLATE
+
+}
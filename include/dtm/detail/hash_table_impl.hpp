@@ -0,0 +1,380 @@
+// details/hash_table_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_HASH_TABLE_IMPL_HPP
+#error "Don't include or compile datum/detail/hash_table_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+#define DATUM_HASH_TABLE_TEMPLATE template <typename Key, typename Value, typename Hash, typename KeyEqual>
+#define DATUM_HASH_TABLE hash_table<Key, Value, Hash, KeyEqual>
+
+DATUM_HASH_TABLE_TEMPLATE
+DATUM_HASH_TABLE::hash_table()
+    : m_control(nullptr), m_entries(nullptr), m_capacity(0), m_size(0), m_erased(0), m_shift(0)
+{}
+
+DATUM_HASH_TABLE_TEMPLATE
+DATUM_HASH_TABLE::hash_table(size_t capacity)
+    : hash_table()
+{
+    reserve(capacity);
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+DATUM_HASH_TABLE::hash_table(const hash_table& rhs)
+    : hash_table()
+{
+    *this = rhs;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+DATUM_HASH_TABLE::hash_table(hash_table&& rhs) noexcept
+    : hash_table()
+{
+    swap(rhs);
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+DATUM_HASH_TABLE::~hash_table()
+{
+    release();
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+DATUM_HASH_TABLE& DATUM_HASH_TABLE::operator= (const hash_table& rhs)
+{
+    if (this == &rhs)
+        return *this;
+
+    clear();
+    reserve(rhs.size());
+    for (const entry& e : rhs)
+        emplace(e.key, e.value);
+    return *this;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+DATUM_HASH_TABLE& DATUM_HASH_TABLE::operator= (hash_table&& rhs) noexcept
+{
+    hash_table temp(std::move(rhs));
+    swap(temp);
+    return *this;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+void DATUM_HASH_TABLE::swap(hash_table& rhs) noexcept
+{
+    std::swap(m_control, rhs.m_control);
+    std::swap(m_entries, rhs.m_entries);
+    std::swap(m_capacity, rhs.m_capacity);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_erased, rhs.m_erased);
+    std::swap(m_shift, rhs.m_shift);
+    std::swap(m_hash, rhs.m_hash);
+    std::swap(m_equal, rhs.m_equal);
+}
+
+// Iterators
+
+DATUM_HASH_TABLE_TEMPLATE
+size_t DATUM_HASH_TABLE::next_full(size_t slot) const noexcept
+{
+    while (slot < m_capacity && !is_full(m_control[slot]))
+        ++slot;
+    return slot;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+typename DATUM_HASH_TABLE::iterator DATUM_HASH_TABLE::begin() noexcept {
+    return iterator(this, next_full(0));
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+typename DATUM_HASH_TABLE::iterator DATUM_HASH_TABLE::end() noexcept {
+    return iterator(this, m_capacity);
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+typename DATUM_HASH_TABLE::const_iterator DATUM_HASH_TABLE::begin() const noexcept {
+    return const_iterator(this, next_full(0));
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+typename DATUM_HASH_TABLE::const_iterator DATUM_HASH_TABLE::end() const noexcept {
+    return const_iterator(this, m_capacity);
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+typename DATUM_HASH_TABLE::const_iterator DATUM_HASH_TABLE::cbegin() const noexcept {
+    return begin();
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+typename DATUM_HASH_TABLE::const_iterator DATUM_HASH_TABLE::cend() const noexcept {
+    return end();
+}
+
+// Capacity
+
+DATUM_HASH_TABLE_TEMPLATE
+size_t DATUM_HASH_TABLE::size() const noexcept
+{
+    return m_size;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+bool DATUM_HASH_TABLE::empty() const noexcept
+{
+    return m_size == 0;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+size_t DATUM_HASH_TABLE::capacity() const noexcept
+{
+    return m_capacity;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+const Hash& DATUM_HASH_TABLE::hash_function() const noexcept
+{
+    return m_hash;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+void DATUM_HASH_TABLE::reserve(size_t count)
+{
+    // Keep the load factor at or below 7/8.
+    size_t needed = count + count / 7 + 1;
+    size_t new_capacity = min_capacity;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    if (new_capacity > m_capacity)
+        rehash(new_capacity);
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+void DATUM_HASH_TABLE::grow_if_necessary()
+{
+    if ((m_size + m_erased + 1) * 8 <= m_capacity * 7)
+        return;
+
+    // Lots of erased slots means we can reclaim them without growing.
+    if (m_erased > m_size / 2)
+        rehash(m_capacity);
+    else
+        rehash(m_capacity ? m_capacity * 2 : min_capacity);
+}
+
+// Storage
+
+DATUM_HASH_TABLE_TEMPLATE
+void DATUM_HASH_TABLE::allocate(size_t capacity)
+{
+    m_control = reinterpret_cast<uint8_t*>(calloc(capacity, 1));
+    m_entries = reinterpret_cast<entry*>(calloc(capacity, sizeof(entry)));
+    if (!m_control || !m_entries) {
+        free(m_control);
+        free(m_entries);
+        m_control = nullptr;
+        m_entries = nullptr;
+        throw std::bad_alloc();
+    }
+    m_capacity = capacity;
+    m_shift = sizeof(size_t) * 8 - __builtin_ctzll(capacity);
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+void DATUM_HASH_TABLE::release() noexcept
+{
+    clear();
+    free(m_control);
+    free(m_entries);
+    m_control = nullptr;
+    m_entries = nullptr;
+    m_capacity = 0;
+    m_shift = 0;
+}
+
+DATUM_HASH_TABLE_TEMPLATE // XXX not exception safe
+void DATUM_HASH_TABLE::rehash(size_t new_capacity)
+{
+    uint8_t* old_control = m_control;
+    entry* old_entries = m_entries;
+    size_t old_capacity = m_capacity;
+
+    allocate(new_capacity);
+    m_erased = 0;
+
+    for (size_t slot = 0; slot < old_capacity; slot++) {
+        if (!is_full(old_control[slot]))
+            continue;
+
+        entry& e = old_entries[slot];
+        size_t h = m_hash(e.key);
+        size_t new_slot = find_insert_slot(h);
+        m_control[new_slot] = control_for(h);
+        new (&m_entries[new_slot]) entry(std::move(e));
+        e.~entry();
+    }
+
+    free(old_control);
+    free(old_entries);
+}
+
+// Lookup
+
+DATUM_HASH_TABLE_TEMPLATE
+bool DATUM_HASH_TABLE::is_full(uint8_t control) noexcept
+{
+    return (control & control_full) != 0;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+uint8_t DATUM_HASH_TABLE::control_for(size_t hash) noexcept
+{
+    // The slot comes from the high bits, so tag with the low ones.
+    return control_full | static_cast<uint8_t>(hash & 0x7f);
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+size_t DATUM_HASH_TABLE::home_slot(size_t hash) const noexcept
+{
+    return hash >> m_shift;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+size_t DATUM_HASH_TABLE::find_slot(const Key& key, size_t hash) const noexcept
+{
+    if (m_capacity == 0)
+        return m_capacity;
+
+    size_t mask = m_capacity - 1;
+    uint8_t tag = control_for(hash);
+    for (size_t slot = home_slot(hash); ; slot = (slot + 1) & mask) {
+        uint8_t control = m_control[slot];
+        if (control == control_empty)
+            return m_capacity;
+        if (control == tag && m_equal(m_entries[slot].key, key))
+            return slot;
+    }
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+size_t DATUM_HASH_TABLE::find_insert_slot(size_t hash) const noexcept
+{
+    // Callers guarantee there is at least one empty slot.
+    size_t mask = m_capacity - 1;
+    size_t slot = home_slot(hash);
+    while (is_full(m_control[slot]))
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+typename DATUM_HASH_TABLE::iterator DATUM_HASH_TABLE::find(const Key& key) noexcept
+{
+    return iterator(this, find_slot(key, m_hash(key)));
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+typename DATUM_HASH_TABLE::const_iterator DATUM_HASH_TABLE::find(const Key& key) const noexcept
+{
+    return const_iterator(this, find_slot(key, m_hash(key)));
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+bool DATUM_HASH_TABLE::contains(const Key& key) const noexcept
+{
+    return find_slot(key, m_hash(key)) != m_capacity;
+}
+
+// Modifiers
+
+DATUM_HASH_TABLE_TEMPLATE
+template <typename... Args>
+std::pair<typename DATUM_HASH_TABLE::iterator, bool> DATUM_HASH_TABLE::emplace(const Key& key, Args&&... args)
+{
+    size_t h = m_hash(key);
+    size_t slot = find_slot(key, h);
+    if (slot != m_capacity)
+        return std::make_pair(iterator(this, slot), false);
+
+    grow_if_necessary();
+    slot = find_insert_slot(h);
+    new (&m_entries[slot]) entry{key, Value(std::forward<Args>(args)...)};
+    if (m_control[slot] == control_erased)
+        m_erased--;
+    m_control[slot] = control_for(h);
+    m_size++;
+    return std::make_pair(iterator(this, slot), true);
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+std::pair<typename DATUM_HASH_TABLE::iterator, bool> DATUM_HASH_TABLE::insert(const Key& key)
+{
+    return emplace(key);
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+std::pair<typename DATUM_HASH_TABLE::iterator, bool> DATUM_HASH_TABLE::insert(const Key& key, const Value& value)
+{
+    return emplace(key, value);
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+std::pair<typename DATUM_HASH_TABLE::iterator, bool> DATUM_HASH_TABLE::insert(const Key& key, Value&& value)
+{
+    return emplace(key, std::move(value));
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+Value& DATUM_HASH_TABLE::operator[] (const Key& key)
+{
+    return emplace(key).first->value;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+size_t DATUM_HASH_TABLE::erase(const Key& key)
+{
+    size_t slot = find_slot(key, m_hash(key));
+    if (slot == m_capacity)
+        return 0;
+
+    m_entries[slot].~entry();
+    memset(static_cast<void*>(&m_entries[slot]), 0, sizeof(entry));
+    m_size--;
+
+    // If the next slot is empty no probe sequence runs through this one, so
+    // it can go straight back to empty instead of leaving a marker.
+    if (m_control[(slot + 1) & (m_capacity - 1)] == control_empty) {
+        m_control[slot] = control_empty;
+    }
+    else {
+        m_control[slot] = control_erased;
+        m_erased++;
+    }
+    return 1;
+}
+
+DATUM_HASH_TABLE_TEMPLATE
+void DATUM_HASH_TABLE::clear()
+{
+    for (size_t slot = 0; slot < m_capacity; slot++) {
+        if (is_full(m_control[slot])) {
+            m_entries[slot].~entry();
+            memset(static_cast<void*>(&m_entries[slot]), 0, sizeof(entry));
+        }
+    }
+    if (m_control)
+        memset(m_control, control_empty, m_capacity);
+    m_size = 0;
+    m_erased = 0;
+}
+
+#undef DATUM_HASH_TABLE
+#undef DATUM_HASH_TABLE_TEMPLATE
+
+} // namespace dtm
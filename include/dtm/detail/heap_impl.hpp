@@ -0,0 +1,334 @@
+// details/heap_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_HEAP_IMPL_HPP
+#error "Don't include or compile datum/detail/heap_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+#define DATUM_HEAP_TEMPLATE template <typename T, size_t D, typename Compare, typename Index>
+#define DATUM_HEAP heap<T, D, Compare, Index>
+
+DATUM_HEAP_TEMPLATE
+DATUM_HEAP::heap(const Compare& comp, const Index& index)
+    : m_compare(comp), m_index(index)
+{}
+
+DATUM_HEAP_TEMPLATE
+DATUM_HEAP::heap(vec<T> values, const Compare& comp, const Index& index)
+    : m_data(std::move(values)), m_compare(comp), m_index(index)
+{
+    heapify();
+}
+
+DATUM_HEAP_TEMPLATE
+template <typename It, typename>
+DATUM_HEAP::heap(It begin, It end, const Compare& comp, const Index& index)
+    : m_data(begin, end), m_compare(comp), m_index(index)
+{
+    heapify();
+}
+
+DATUM_HEAP_TEMPLATE
+DATUM_HEAP::heap(std::initializer_list<T> init, const Compare& comp, const Index& index)
+    : m_data(init), m_compare(comp), m_index(index)
+{
+    heapify();
+}
+
+DATUM_HEAP_TEMPLATE
+DATUM_HEAP::~heap()
+{
+    // vec leaves its elements to its owner.
+    m_data.clear();
+}
+
+DATUM_HEAP_TEMPLATE
+DATUM_HEAP& DATUM_HEAP::operator= (const heap& rhs)
+{
+    heap temp(rhs);
+    swap(temp);
+    return *this;
+}
+
+DATUM_HEAP_TEMPLATE
+DATUM_HEAP& DATUM_HEAP::operator= (heap&& rhs) noexcept
+{
+    heap temp(std::move(rhs));
+    swap(temp);
+    return *this;
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::swap(heap& rhs) noexcept
+{
+    using std::swap;
+    m_data.swap(rhs.m_data);
+    swap(m_compare, rhs.m_compare);
+    swap(m_index, rhs.m_index);
+}
+
+DATUM_HEAP_TEMPLATE
+size_t DATUM_HEAP::size() const noexcept
+{
+    return m_data.size();
+}
+
+DATUM_HEAP_TEMPLATE
+bool DATUM_HEAP::empty() const noexcept
+{
+    return m_data.empty();
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::reserve(size_t size)
+{
+    m_data.reserve(size);
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::clear()
+{
+    for (const T& value : m_data)
+        m_index(value, size_t(npos));
+    m_data.clear();
+}
+
+DATUM_HEAP_TEMPLATE
+const T& DATUM_HEAP::top() const noexcept
+{
+    return m_data[0];
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::push(const T& value)
+{
+    m_data.push_back(value);
+    sift_up(m_data.size() - 1);
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::push(T&& value)
+{
+    m_data.push_back(std::move(value));
+    sift_up(m_data.size() - 1);
+}
+
+DATUM_HEAP_TEMPLATE
+template <typename... Args>
+void DATUM_HEAP::emplace(Args&&... args)
+{
+    m_data.emplace_back(std::forward<Args>(args)...);
+    sift_up(m_data.size() - 1);
+}
+
+DATUM_HEAP_TEMPLATE
+template <typename It, typename>
+void DATUM_HEAP::push(It begin, It end)
+{
+    size_t old_size = m_data.size();
+    m_data.insert(m_data.end(), begin, end);
+
+    // k pushes cost O(k log n) and a rebuild O(n + k); rebuilding wins
+    // once the new elements are about as many as the old ones.
+    if (m_data.size() - old_size >= old_size) {
+        heapify();
+        return;
+    }
+    for (size_t i = old_size; i < m_data.size(); i++)
+        sift_up(i);
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::pop()
+{
+    m_index(m_data[0], size_t(npos));
+    T last = std::move(m_data.back());
+    m_data.pop_back();
+    if (!m_data.empty())
+        pop_into_top(std::move(last));
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::pop_push(const T& value)
+{
+    m_index(m_data[0], size_t(npos));
+    m_data[0] = value;
+    sift_down(0);
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::pop_push(T&& value)
+{
+    m_index(m_data[0], size_t(npos));
+    m_data[0] = std::move(value);
+    sift_down(0);
+}
+
+DATUM_HEAP_TEMPLATE
+const T& DATUM_HEAP::operator[] (size_t position) const noexcept
+{
+    return m_data[position];
+}
+
+DATUM_HEAP_TEMPLATE
+const T* DATUM_HEAP::data() const noexcept
+{
+    return m_data.data();
+}
+
+DATUM_HEAP_TEMPLATE
+typename DATUM_HEAP::const_iterator DATUM_HEAP::begin() const noexcept
+{
+    return m_data.data();
+}
+
+DATUM_HEAP_TEMPLATE
+typename DATUM_HEAP::const_iterator DATUM_HEAP::end() const noexcept
+{
+    return m_data.data() + m_data.size();
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::update(size_t position)
+{
+    if (position > 0 && m_compare(m_data[(position - 1) / D], m_data[position]))
+        sift_up(position);
+    else
+        sift_down(position);
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::update(size_t position, const T& value)
+{
+    m_data[position] = value;
+    update(position);
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::update(size_t position, T&& value)
+{
+    m_data[position] = std::move(value);
+    update(position);
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::erase(size_t position)
+{
+    m_index(m_data[position], size_t(npos));
+    if (position + 1 < m_data.size()) {
+        m_data[position] = std::move(m_data.back());
+        m_data.pop_back();
+        update(position);
+    }
+    else {
+        m_data.pop_back();
+    }
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::heapify()
+{
+    // Floyd's method: sift down every parent, last first.
+    size_t size = m_data.size();
+    if (size > 1) {
+        for (size_t i = (size - 2) / D + 1; i-- > 0; )
+            sift_down(i);
+    }
+    // Elements the sifts left alone have not been placed yet.
+    for (size_t i = 0; i < size; i++)
+        m_index(m_data[i], i);
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::sift_up(size_t position)
+{
+    // Parents move down into the hole until value fits.
+    T value = std::move(m_data[position]);
+    while (position > 0) {
+        size_t parent = (position - 1) / D;
+        if (!m_compare(m_data[parent], value))
+            break;
+        place(position, std::move(m_data[parent]));
+        position = parent;
+    }
+    place(position, std::move(value));
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::sift_down(size_t position)
+{
+    // The greatest child moves up into the hole until value fits.
+    size_t size = m_data.size();
+    T value = std::move(m_data[position]);
+    for (;;) {
+        size_t first = position * D + 1;
+        if (first >= size)
+            break;
+        size_t best = best_child(first, size);
+        if (!m_compare(value, m_data[best]))
+            break;
+        place(position, std::move(m_data[best]));
+        position = best;
+    }
+    place(position, std::move(value));
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::pop_into_top(T&& value)
+{
+    // The greatest child moves up into the hole all the way to the bottom,
+    // then value sifts up from there. The last element nearly always sinks
+    // back to the bottom, and this way it is not compared on the way down.
+    size_t size = m_data.size();
+    size_t position = 0;
+    for (;;) {
+        size_t first = position * D + 1;
+        if (first >= size)
+            break;
+        size_t best = best_child(first, size);
+        place(position, std::move(m_data[best]));
+        position = best;
+    }
+    while (position > 0) {
+        size_t parent = (position - 1) / D;
+        if (!m_compare(m_data[parent], value))
+            break;
+        place(position, std::move(m_data[parent]));
+        position = parent;
+    }
+    place(position, std::move(value));
+}
+
+DATUM_HEAP_TEMPLATE
+size_t DATUM_HEAP::best_child(size_t first, size_t size) const
+{
+    size_t best = first;
+    if (first + D <= size) {
+        // All D children: a fixed count the compiler can unroll.
+        for (size_t k = 1; k < D; k++) {
+            if (m_compare(m_data[best], m_data[first + k]))
+                best = first + k;
+        }
+    }
+    else {
+        for (size_t child = first + 1; child < size; child++) {
+            if (m_compare(m_data[best], m_data[child]))
+                best = child;
+        }
+    }
+    return best;
+}
+
+DATUM_HEAP_TEMPLATE
+void DATUM_HEAP::place(size_t position, T&& value)
+{
+    m_data[position] = std::move(value);
+    m_index(m_data[position], position);
+}
+
+#undef DATUM_HEAP
+#undef DATUM_HEAP_TEMPLATE
+
+}
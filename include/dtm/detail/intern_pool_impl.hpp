@@ -0,0 +1,191 @@
+// details/intern_pool_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_INTERN_POOL_IMPL_HPP
+#error "Don't include or compile datum/detail/intern_pool_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+inline intern_pool::intern_pool(size_t chunk_size)
+    : m_arena(chunk_size)
+{}
+
+inline uint32_t intern_pool::intern(str_view s)
+{
+    if (m_strings.size() == m_strings.capacity())
+        m_strings.reserve(m_strings.size() * 1.5 + 4);
+    if (m_strings.size() == npos)
+        throw std::length_error("dtm::intern_pool: out of ids");
+
+    // Insert with the caller's characters, which hashes once, then point
+    // the key at the stored copy.
+    uint32_t id = uint32_t(m_strings.size());
+    auto inserted = m_index.emplace(s, id);
+    if (!inserted.second)
+        return inserted.first->value;
+    try {
+        inserted.first->key = m_arena.store(s);
+    } catch (...) {
+        m_index.erase(s);
+        throw;
+    }
+    m_strings.push_back(inserted.first->key);
+    return id;
+}
+
+inline uint32_t intern_pool::find(str_view s) const noexcept
+{
+    auto it = m_index.find(s);
+    return it == m_index.end() ? uint32_t(npos) : it->value;
+}
+
+inline str_view intern_pool::operator[] (uint32_t id) const noexcept
+{
+    return m_strings[id];
+}
+
+inline str_view intern_pool::at(uint32_t id) const
+{
+    if (id >= m_strings.size())
+        throw std::out_of_range("dtm::intern_pool::at");
+    return m_strings[id];
+}
+
+inline const char* intern_pool::c_str(uint32_t id) const noexcept
+{
+    return m_strings[id].data();
+}
+
+inline size_t intern_pool::size() const noexcept
+{
+    return m_strings.size();
+}
+
+inline bool intern_pool::empty() const noexcept
+{
+    return m_strings.empty();
+}
+
+inline void intern_pool::reserve(size_t count)
+{
+    m_strings.reserve(count);
+    m_index.reserve(count);
+}
+
+inline void intern_pool::clear()
+{
+    m_index.clear();
+    m_strings.clear();
+    m_arena.clear();
+}
+
+inline size_t intern_pool::size_in_bytes() const noexcept
+{
+    return m_arena.bytes()
+         + m_strings.capacity() * sizeof(str_view)
+         + m_index.capacity() * (sizeof(hash_table<str_view, uint32_t>::entry) + 1);
+}
+
+inline concurrent_intern_pool::concurrent_intern_pool(size_t shards, size_t chunk_size)
+    : m_shards(nullptr), m_shard_count(1), m_shard_bits(0)
+{
+    while (m_shard_count < std::min<size_t>(shards, 65536)) {
+        m_shard_count *= 2;
+        m_shard_bits++;
+    }
+    m_shards = static_cast<shard*>(detail::aligned_allocate(alignof(shard), m_shard_count * sizeof(shard)));
+    size_t constructed = 0;
+    try {
+        for (; constructed < m_shard_count; constructed++)
+            new (&m_shards[constructed]) shard(chunk_size);
+    } catch (...) {
+        for (size_t i = 0; i < constructed; i++)
+            m_shards[i].~shard();
+        detail::aligned_free(m_shards);
+        throw;
+    }
+}
+
+inline concurrent_intern_pool::~concurrent_intern_pool()
+{
+    for (size_t i = 0; i < m_shard_count; i++)
+        m_shards[i].~shard();
+    detail::aligned_free(m_shards);
+}
+
+inline uint32_t concurrent_intern_pool::intern(str_view s)
+{
+    shard& sh = shard_for(s);
+    size_t shard_index = &sh - m_shards;
+    std::lock_guard<std::mutex> lock(sh.mutex);
+
+    // The last local id of the last shard would make npos.
+    size_t local = sh.strings.size();
+    if (local >= (uint64_t(1) << (32 - m_shard_bits)) - 1)
+        throw std::length_error("dtm::concurrent_intern_pool: shard out of ids");
+
+    auto inserted = sh.index.emplace(s, uint32_t(local));
+    if (!inserted.second)
+        return uint32_t(inserted.first->value << m_shard_bits | shard_index);
+    try {
+        inserted.first->key = sh.arena.store(s);
+        sh.strings.push_back(inserted.first->key);
+    } catch (...) {
+        sh.index.erase(s);
+        throw;
+    }
+    return uint32_t(local << m_shard_bits | shard_index);
+}
+
+inline uint32_t concurrent_intern_pool::find(str_view s) const
+{
+    shard& sh = shard_for(s);
+    size_t shard_index = &sh - m_shards;
+    std::lock_guard<std::mutex> lock(sh.mutex);
+    auto it = sh.index.find(s);
+    return it == sh.index.end() ? uint32_t(npos) : uint32_t(it->value << m_shard_bits | shard_index);
+}
+
+inline str_view concurrent_intern_pool::operator[] (uint32_t id) const noexcept
+{
+    return m_shards[id & (m_shard_count - 1)].strings[id >> m_shard_bits];
+}
+
+inline str_view concurrent_intern_pool::at(uint32_t id) const
+{
+    const shard& sh = m_shards[id & (m_shard_count - 1)];
+    if (id >> m_shard_bits >= sh.strings.size())
+        throw std::out_of_range("dtm::concurrent_intern_pool::at");
+    return sh.strings[id >> m_shard_bits];
+}
+
+inline const char* concurrent_intern_pool::c_str(uint32_t id) const noexcept
+{
+    return (*this)[id].data();
+}
+
+inline size_t concurrent_intern_pool::size() const noexcept
+{
+    size_t total = 0;
+    for (size_t i = 0; i < m_shard_count; i++)
+        total += m_shards[i].strings.size();
+    return total;
+}
+
+inline bool concurrent_intern_pool::empty() const noexcept
+{
+    return size() == 0;
+}
+
+inline size_t concurrent_intern_pool::shard_count() const noexcept
+{
+    return m_shard_count;
+}
+
+inline concurrent_intern_pool::shard& concurrent_intern_pool::shard_for(str_view s) const noexcept
+{
+    return m_shards[(hash<str_view>()(s) >> 7) & (m_shard_count - 1)];
+}
+
+}
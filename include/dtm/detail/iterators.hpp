@@ -1,6 +1,9 @@
 // detail/iterators.hpp
 //
 
+#ifndef INCLUDED_DATUM_DETAIL_ITERATORS_HPP
+#define INCLUDED_DATUM_DETAIL_ITERATORS_HPP
+
 #include <iterator>
 #include <type_traits>
 #include <cstddef>
@@ -16,6 +19,14 @@ template<typename It> using require_input_iterator = typename
         >::value
     >::type;
 
+template<typename It> using require_forward_iterator = typename
+    std::enable_if<
+        std::is_convertible<
+            typename std::iterator_traits<It>::iterator_category,
+            std::forward_iterator_tag
+        >::value
+    >::type;
+
 template <typename It>
 size_t min_range_size(It begin, It end, std::forward_iterator_tag) {
     return std::distance(begin, end);
@@ -31,4 +42,6 @@ size_t min_range_size(It begin, It end) {
     return min_range_size(begin, end, typename std::iterator_traits<It>::iterator_category());
 }
 
-} } // namespace
\ No newline at end of file
+} } // namespace
+
+#endif //INCLUDED_DATUM_DETAIL_ITERATORS_HPP
@@ -0,0 +1,560 @@
+// details/mmap_vec_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_MMAP_VEC_IMPL_HPP
+#error "Don't include or compile datum/detail/mmap_vec_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+namespace detail {
+
+static const char mmap_vec_magic[8] = { 'd', 't', 'm', 'm', 'v', 'e', 'c', '\0' };
+
+inline void throw_system_error(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+inline size_t round_up_to_page(size_t length) {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (length + page - 1) / page * page;
+}
+
+}
+
+template <typename T>
+mmap_vec<T>::mmap_vec(const char* path, mmap_mode mode, mmap_advice advice)
+    : mmap_vec(path, mode, advice, false)
+{}
+
+template <typename T>
+mmap_vec<T>::mmap_vec(const char* path, mmap_mode mode, mmap_advice advice, bool read_only)
+    : m_fd(-1), m_read_only(read_only), m_advice(mmap_advice::normal),
+      m_map(nullptr), m_map_length(0), m_capacity(0)
+{
+    int flags = O_RDWR | O_CREAT;
+    if (read_only)
+        flags = O_RDONLY;
+    else if (mode == mmap_mode::create)
+        flags |= O_TRUNC;
+
+    m_fd = ::open(path, flags, 0644);
+    if (m_fd < 0)
+        detail::throw_system_error("dtm::mmap_vec: open");
+
+    try {
+        struct stat st;
+        if (fstat(m_fd, &st) != 0)
+            detail::throw_system_error("dtm::mmap_vec: fstat");
+
+        size_t file_length = static_cast<size_t>(st.st_size);
+        bool is_new = file_length == 0;
+        if (is_new) {
+            if (m_read_only)
+                throw std::runtime_error("dtm::mmap_vec: file is empty");
+
+            file_length = detail::round_up_to_page(sizeof(header));
+            if (ftruncate(m_fd, file_length) != 0)
+                detail::throw_system_error("dtm::mmap_vec: ftruncate");
+        }
+        else if (file_length < sizeof(header)) {
+            throw std::runtime_error("dtm::mmap_vec: file is not a mmap_vec");
+        }
+
+        map_file(file_length);
+
+        header* h = get_header();
+        if (is_new) {
+            memcpy(h->magic, detail::mmap_vec_magic, sizeof(h->magic));
+            h->version = current_version;
+            h->element_size = sizeof(T);
+            h->size = 0;
+        }
+        else {
+            if (memcmp(h->magic, detail::mmap_vec_magic, sizeof(h->magic)) != 0 || h->version != current_version)
+                throw std::runtime_error("dtm::mmap_vec: file is not a mmap_vec");
+            if (h->element_size != sizeof(T))
+                throw std::runtime_error("dtm::mmap_vec: element size mismatch");
+            if (h->size > m_capacity)
+                throw std::runtime_error("dtm::mmap_vec: file is truncated");
+        }
+
+        advise(advice);
+    }
+    catch (...) {
+        release();
+        throw;
+    }
+}
+
+template <typename T>
+mmap_vec<T>::mmap_vec(mmap_vec&& v) noexcept
+    : m_fd(v.m_fd), m_read_only(v.m_read_only), m_advice(v.m_advice),
+      m_map(v.m_map), m_map_length(v.m_map_length), m_capacity(v.m_capacity)
+{
+    v.m_fd = -1;
+    v.m_map = nullptr;
+    v.m_map_length = 0;
+    v.m_capacity = 0;
+}
+
+template <typename T>
+mmap_vec<T>& mmap_vec<T>::operator= (mmap_vec&& rhs) noexcept
+{
+    if (this != &rhs) {
+        release();
+        m_fd = rhs.m_fd;
+        m_read_only = rhs.m_read_only;
+        m_advice = rhs.m_advice;
+        m_map = rhs.m_map;
+        m_map_length = rhs.m_map_length;
+        m_capacity = rhs.m_capacity;
+
+        rhs.m_fd = -1;
+        rhs.m_map = nullptr;
+        rhs.m_map_length = 0;
+        rhs.m_capacity = 0;
+    }
+    return *this;
+}
+
+template <typename T>
+mmap_vec<T>::~mmap_vec()
+{
+    release();
+}
+
+// Mapping
+
+template <typename T>
+typename mmap_vec<T>::header* mmap_vec<T>::get_header() const noexcept
+{
+    return static_cast<header*>(m_map);
+}
+
+template <typename T>
+T* mmap_vec<T>::elements() const noexcept
+{
+    return reinterpret_cast<T*>(static_cast<char*>(m_map) + sizeof(header));
+}
+
+template <typename T>
+void mmap_vec<T>::map_file(size_t length)
+{
+    int prot = m_read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    void* map = mmap(nullptr, length, prot, MAP_SHARED, m_fd, 0);
+    if (map == MAP_FAILED)
+        detail::throw_system_error("dtm::mmap_vec: mmap");
+
+    m_map = map;
+    m_map_length = length;
+    m_capacity = (length - sizeof(header)) / sizeof(T);
+}
+
+template <typename T>
+void mmap_vec<T>::remap(size_t new_capacity)
+{
+    size_t old_length = m_map_length;
+    size_t new_length = detail::round_up_to_page(sizeof(header) + sizeof(T) * new_capacity);
+    if (new_length == old_length)
+        return;
+
+    // The file must never be shorter than the part of the mapping we touch,
+    // so extend it before growing the mapping and cut it after shrinking.
+    if (new_length > old_length && ftruncate(m_fd, new_length) != 0)
+        detail::throw_system_error("dtm::mmap_vec: ftruncate");
+
+#ifdef MREMAP_MAYMOVE
+    void* map = mremap(m_map, old_length, new_length, MREMAP_MAYMOVE);
+    if (map == MAP_FAILED)
+        detail::throw_system_error("dtm::mmap_vec: mremap");
+    m_map = map;
+    m_map_length = new_length;
+    m_capacity = (new_length - sizeof(header)) / sizeof(T);
+#else
+    munmap(m_map, old_length);
+    m_map = nullptr;
+    map_file(new_length);
+#endif
+
+    if (new_length < old_length && ftruncate(m_fd, new_length) != 0)
+        detail::throw_system_error("dtm::mmap_vec: ftruncate");
+
+    advise(m_advice);
+}
+
+template <typename T>
+void mmap_vec<T>::release() noexcept
+{
+    if (m_map)
+        munmap(m_map, m_map_length);
+    if (m_fd >= 0)
+        ::close(m_fd);
+    m_map = nullptr;
+    m_fd = -1;
+}
+
+template <typename T>
+void mmap_vec<T>::flush()
+{
+    if (m_map && msync(m_map, m_map_length, MS_SYNC) != 0)
+        detail::throw_system_error("dtm::mmap_vec: msync");
+}
+
+template <typename T>
+void mmap_vec<T>::advise(mmap_advice advice)
+{
+    m_advice = advice;
+
+    int flag = MADV_NORMAL;
+    switch (advice) {
+        case mmap_advice::normal:     flag = MADV_NORMAL; break;
+        case mmap_advice::sequential: flag = MADV_SEQUENTIAL; break;
+        case mmap_advice::random:     flag = MADV_RANDOM; break;
+        case mmap_advice::willneed:   flag = MADV_WILLNEED; break;
+    }
+
+    // Only a hint, so failures are ignored.
+    if (m_map)
+        madvise(m_map, m_map_length, flag);
+}
+
+template <typename T>
+void mmap_vec<T>::check_writable() const
+{
+    if (m_read_only)
+        throw std::logic_error("dtm::mmap_vec: the mapping is read only");
+}
+
+// Iterators
+
+template <typename T>
+typename mmap_vec<T>::iterator mmap_vec<T>::begin() noexcept {
+    return iterator(elements());
+}
+
+template <typename T>
+typename mmap_vec<T>::iterator mmap_vec<T>::end() noexcept {
+    return iterator(elements() + size());
+}
+
+template <typename T>
+typename mmap_vec<T>::const_iterator mmap_vec<T>::begin() const noexcept {
+    return const_iterator(elements());
+}
+
+template <typename T>
+typename mmap_vec<T>::const_iterator mmap_vec<T>::end() const noexcept {
+    return const_iterator(elements() + size());
+}
+
+template <typename T>
+typename mmap_vec<T>::const_iterator mmap_vec<T>::cbegin() const noexcept {
+    return begin();
+}
+
+template <typename T>
+typename mmap_vec<T>::const_iterator mmap_vec<T>::cend() const noexcept {
+    return end();
+}
+
+template <typename T>
+typename mmap_vec<T>::reverse_iterator mmap_vec<T>::rbegin() noexcept {
+    return std::make_reverse_iterator(end());
+}
+
+template <typename T>
+typename mmap_vec<T>::reverse_iterator mmap_vec<T>::rend() noexcept {
+    return std::make_reverse_iterator(begin());
+}
+
+template <typename T>
+typename mmap_vec<T>::const_reverse_iterator mmap_vec<T>::rbegin() const noexcept {
+    return std::make_reverse_iterator(end());
+}
+
+template <typename T>
+typename mmap_vec<T>::const_reverse_iterator mmap_vec<T>::rend() const noexcept {
+    return std::make_reverse_iterator(begin());
+}
+
+// Element access
+
+template <typename T>
+T* mmap_vec<T>::data() noexcept
+{
+    return elements();
+}
+
+template <typename T>
+const T* mmap_vec<T>::data() const noexcept
+{
+    return elements();
+}
+
+template <typename T>
+T& mmap_vec<T>::front() noexcept
+{
+    return elements()[0];
+}
+
+template <typename T>
+T& mmap_vec<T>::back() noexcept
+{
+    return elements()[size() - 1];
+}
+
+template <typename T>
+const T& mmap_vec<T>::front() const noexcept
+{
+    return elements()[0];
+}
+
+template <typename T>
+const T& mmap_vec<T>::back() const noexcept
+{
+    return elements()[size() - 1];
+}
+
+template <typename T>
+T& mmap_vec<T>::operator[] (size_t index) noexcept
+{
+    return elements()[index];
+}
+
+template <typename T>
+const T& mmap_vec<T>::operator[] (size_t index) const noexcept
+{
+    return elements()[index];
+}
+
+template <typename T>
+T& mmap_vec<T>::at(size_t index)
+{
+    if (index >= size())
+        throw std::out_of_range("dtm::mmap_vec::at");
+
+    return elements()[index];
+}
+
+template <typename T>
+const T& mmap_vec<T>::at(size_t index) const
+{
+    if (index >= size())
+        throw std::out_of_range("dtm::mmap_vec::at");
+
+    return elements()[index];
+}
+
+// Capacity
+
+template <typename T>
+size_t mmap_vec<T>::size() const noexcept
+{
+    return m_map ? static_cast<size_t>(get_header()->size) : 0;
+}
+
+template <typename T>
+bool mmap_vec<T>::empty() const noexcept
+{
+    return size() == 0;
+}
+
+template <typename T>
+size_t mmap_vec<T>::capacity() const noexcept
+{
+    return m_capacity;
+}
+
+template <typename T>
+void mmap_vec<T>::reserve(size_t new_capacity)
+{
+    check_writable();
+    if (new_capacity <= m_capacity)
+        return;
+
+    remap(new_capacity);
+}
+
+template <typename T>
+void mmap_vec<T>::shrink_to_fit()
+{
+    check_writable();
+    remap(size());
+}
+
+template <typename T>
+void mmap_vec<T>::grow_if_necessary()
+{
+    if (size() == m_capacity)
+        reserve(size() * 1.5 + 4);
+}
+
+// Modifiers
+
+template <typename T>
+void mmap_vec<T>::clear()
+{
+    check_writable();
+    T* begin = elements();
+    T* end = begin + size();
+    for (T* ptr = begin; ptr != end; ++ptr)
+        ptr->~T();
+    get_header()->size = 0;
+}
+
+template <typename T>
+template <typename... Args>
+void mmap_vec<T>::resize(size_t new_size, Args&&... args)
+{
+    check_writable();
+    size_t old_size = size();
+    if (new_size > old_size) {
+        reserve(new_size);
+        T* end = elements() + new_size;
+        for (T* ptr = elements() + old_size; ptr != end; ++ptr)
+            new(ptr) T(std::forward<Args>(args)...);
+    }
+    else {
+        T* end = elements() + old_size;
+        for (T* ptr = elements() + new_size; ptr != end; ++ptr)
+            ptr->~T();
+    }
+    get_header()->size = new_size;
+}
+
+template <typename T>
+template <typename... Args>
+void mmap_vec<T>::fill(size_t count, Args&&... args)
+{
+    clear();
+    resize(count, std::forward<Args>(args)...);
+}
+
+template <typename T>
+void mmap_vec<T>::pop_back()
+{
+    check_writable();
+    header* h = get_header();
+    h->size--;
+    elements()[h->size].~T();
+}
+
+template <typename T>
+void mmap_vec<T>::push_back(const T& val)
+{
+    emplace_back(val);
+}
+
+template <typename T>
+void mmap_vec<T>::push_back(T&& val)
+{
+    emplace_back(std::move(val));
+}
+
+template <typename T>
+template <typename... Args>
+void mmap_vec<T>::emplace_back(Args&&... args)
+{
+    check_writable();
+    grow_if_necessary();
+    header* h = get_header();
+    new (elements() + h->size) T(std::forward<Args>(args)...);
+    h->size++;
+}
+
+// mmap_view
+
+template <typename T>
+mmap_view<T>::mmap_view(const char* path, mmap_advice advice)
+    : m_vec(path, mmap_mode::read_write, advice, true)
+{}
+
+template <typename T>
+typename mmap_view<T>::const_iterator mmap_view<T>::begin() const noexcept
+{
+    return m_vec.data();
+}
+
+template <typename T>
+typename mmap_view<T>::const_iterator mmap_view<T>::end() const noexcept
+{
+    return m_vec.data() + m_vec.size();
+}
+
+template <typename T>
+typename mmap_view<T>::const_iterator mmap_view<T>::cbegin() const noexcept
+{
+    return begin();
+}
+
+template <typename T>
+typename mmap_view<T>::const_iterator mmap_view<T>::cend() const noexcept
+{
+    return end();
+}
+
+template <typename T>
+typename mmap_view<T>::const_reverse_iterator mmap_view<T>::rbegin() const noexcept
+{
+    return const_reverse_iterator(end());
+}
+
+template <typename T>
+typename mmap_view<T>::const_reverse_iterator mmap_view<T>::rend() const noexcept
+{
+    return const_reverse_iterator(begin());
+}
+
+template <typename T>
+const T* mmap_view<T>::data() const noexcept
+{
+    return m_vec.data();
+}
+
+template <typename T>
+const T& mmap_view<T>::front() const noexcept
+{
+    return m_vec.front();
+}
+
+template <typename T>
+const T& mmap_view<T>::back() const noexcept
+{
+    return m_vec.back();
+}
+
+template <typename T>
+const T& mmap_view<T>::operator[] (size_t index) const noexcept
+{
+    return m_vec[index];
+}
+
+template <typename T>
+const T& mmap_view<T>::at(size_t index) const
+{
+    if (index >= size())
+        throw std::out_of_range("dtm::mmap_view::at");
+
+    return m_vec[index];
+}
+
+template <typename T>
+size_t mmap_view<T>::size() const noexcept
+{
+    return m_vec.size();
+}
+
+template <typename T>
+bool mmap_view<T>::empty() const noexcept
+{
+    return m_vec.empty();
+}
+
+template <typename T>
+void mmap_view<T>::advise(mmap_advice advice)
+{
+    m_vec.advise(advice);
+}
+
+} // namespace dtm
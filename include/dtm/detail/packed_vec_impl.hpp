@@ -0,0 +1,259 @@
+// details/packed_vec_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_PACKED_VEC_IMPL_HPP
+#error "Don't include or compile datum/detail/packed_vec_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+#define DATUM_PACKED_VEC_TEMPLATE template <typename T>
+#define DATUM_PACKED_VEC packed_vec<T>
+
+DATUM_PACKED_VEC_TEMPLATE
+constexpr size_t DATUM_PACKED_VEC::block_size;
+
+DATUM_PACKED_VEC_TEMPLATE
+DATUM_PACKED_VEC::packed_vec(packed_encoding encoding) noexcept
+    : m_encoding(encoding)
+{}
+
+DATUM_PACKED_VEC_TEMPLATE
+DATUM_PACKED_VEC::packed_vec(span<const T> values, packed_encoding encoding)
+    : packed_vec(encoding)
+{
+    if (encoding == packed_encoding::delta && !std::is_sorted(values.begin(), values.end()))
+        throw std::invalid_argument("dtm::packed_vec: delta encoding needs non-decreasing values");
+
+    size_t blocks = values.size() / block_size;
+    m_blocks.reserve(blocks);
+    for (size_t b = 0; b < blocks; b++)
+        pack_block(values.data() + b * block_size);
+    m_tail.reserve(block_size);
+    for (size_t i = blocks * block_size; i < values.size(); i++)
+        m_tail.push_back(values[i]);
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+packed_encoding DATUM_PACKED_VEC::encoding() const noexcept
+{
+    return m_encoding;
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+size_t DATUM_PACKED_VEC::size() const noexcept
+{
+    return m_blocks.size() * block_size + m_tail.size();
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+bool DATUM_PACKED_VEC::empty() const noexcept
+{
+    return size() == 0;
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+T DATUM_PACKED_VEC::operator[] (size_t index) const noexcept
+{
+    size_t b = index / block_size;
+    size_t i = index % block_size;
+    if (b == m_blocks.size())
+        return m_tail[i];
+
+    const detail::packed_block& block = m_blocks[b];
+    if (block.width == 0) {
+        if (m_encoding == packed_encoding::frame_of_reference)
+            return from_bits(block.reference);
+        return from_bits(block.reference + i * block.step);
+    }
+
+    const uint64_t* words = m_words.data() + block.offset;
+    if (m_encoding == packed_encoding::frame_of_reference)
+        return from_bits(block.reference + detail::packed_get(words, i, block.width));
+
+    uint64_t value = block.reference + i * block.step;
+    for (size_t k = 1; k <= i; k++)
+        value += detail::packed_get(words, k, block.width);
+    return from_bits(value);
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+T DATUM_PACKED_VEC::at(size_t index) const
+{
+    if (index >= size())
+        throw std::out_of_range("dtm::packed_vec::at");
+    return (*this)[index];
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+T DATUM_PACKED_VEC::front() const noexcept
+{
+    return (*this)[0];
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+T DATUM_PACKED_VEC::back() const noexcept
+{
+    return (*this)[size() - 1];
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+void DATUM_PACKED_VEC::push_back(T value)
+{
+    if (m_encoding == packed_encoding::delta && !empty() && value < back())
+        throw std::invalid_argument("dtm::packed_vec: delta encoding needs non-decreasing values");
+
+    if (m_tail.empty())
+        m_tail.reserve(block_size);
+    m_tail.push_back(value);
+    if (m_tail.size() == block_size) {
+        pack_block(m_tail.data());
+        m_tail.clear();
+    }
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+void DATUM_PACKED_VEC::clear()
+{
+    m_words.clear();
+    m_blocks.clear();
+    m_tail.clear();
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+void DATUM_PACKED_VEC::swap(packed_vec& rhs) noexcept
+{
+    m_words.swap(rhs.m_words);
+    m_blocks.swap(rhs.m_blocks);
+    m_tail.swap(rhs.m_tail);
+    std::swap(m_encoding, rhs.m_encoding);
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+size_t DATUM_PACKED_VEC::block_count() const noexcept
+{
+    return m_blocks.size();
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+unsigned DATUM_PACKED_VEC::block_width(size_t block) const noexcept
+{
+    return m_blocks[block].width;
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+void DATUM_PACKED_VEC::decode_block(size_t block, T* out) const noexcept
+{
+    const detail::packed_block& header = m_blocks[block];
+    const uint64_t* words = m_words.data() + header.offset;
+
+    uint64_t values[block_size];
+    if (m_encoding == packed_encoding::frame_of_reference) {
+        detail::packed_unpack(words, header.width, block_size, header.reference, values);
+        for (size_t i = 0; i < block_size; i++)
+            out[i] = from_bits(values[i]);
+        return;
+    }
+
+    // Unpack the gaps, then add them up. The first value has no gap.
+    detail::packed_unpack(words, header.width, block_size, header.step, values);
+    uint64_t value = header.reference;
+    out[0] = from_bits(value);
+    for (size_t i = 1; i < block_size; i++) {
+        value += values[i];
+        out[i] = from_bits(value);
+    }
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+void DATUM_PACKED_VEC::decode(vec<T>& out) const
+{
+    out.clear();
+    out.resize_for_overwrite(size());
+    T* data = out.data();
+    for (size_t b = 0; b < m_blocks.size(); b++)
+        decode_block(b, data + b * block_size);
+    std::copy(m_tail.begin(), m_tail.end(), data + m_blocks.size() * block_size);
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+template <typename Fn>
+void DATUM_PACKED_VEC::for_each(Fn&& fn) const
+{
+    T values[block_size];
+    for (size_t b = 0; b < m_blocks.size(); b++) {
+        decode_block(b, values);
+        for (size_t i = 0; i < block_size; i++)
+            fn(values[i]);
+    }
+    for (size_t i = 0; i < m_tail.size(); i++)
+        fn(m_tail[i]);
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+size_t DATUM_PACKED_VEC::size_in_bytes() const noexcept
+{
+    return m_words.size() * sizeof(uint64_t)
+         + m_blocks.size() * sizeof(detail::packed_block)
+         + m_tail.size() * sizeof(T);
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+uint64_t DATUM_PACKED_VEC::to_bits(T value) noexcept
+{
+    return uint64_t(unsigned_type(value));
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+T DATUM_PACKED_VEC::from_bits(uint64_t bits) noexcept
+{
+    return T(unsigned_type(bits));
+}
+
+DATUM_PACKED_VEC_TEMPLATE
+void DATUM_PACKED_VEC::pack_block(const T* values)
+{
+    // What gets packed: offsets from the minimum, or gaps beyond the
+    // smallest gap. Differences are taken in the unsigned type of T's
+    // width, so they are right for negative values too.
+    uint64_t packed[block_size];
+    detail::packed_block header = {};
+
+    if (m_encoding == packed_encoding::frame_of_reference) {
+        T min = *std::min_element(values, values + block_size);
+        header.reference = to_bits(min);
+        for (size_t i = 0; i < block_size; i++)
+            packed[i] = uint64_t(unsigned_type(unsigned_type(values[i]) - unsigned_type(min)));
+    } else {
+        packed[0] = 0;
+        uint64_t step = ~uint64_t(0);
+        for (size_t i = 1; i < block_size; i++) {
+            packed[i] = uint64_t(unsigned_type(unsigned_type(values[i]) - unsigned_type(values[i - 1])));
+            step = std::min(step, packed[i]);
+        }
+        for (size_t i = 1; i < block_size; i++)
+            packed[i] -= step;
+        header.reference = to_bits(values[0]);
+        header.step = step;
+    }
+
+    uint64_t max = *std::max_element(packed, packed + block_size);
+    header.width = detail::packed_width(max);
+
+    // The new block goes where the padding word was, and gets a new one
+    // after it. 128 values of width bits take exactly 2 * width words.
+    size_t start = m_words.empty() ? 0 : m_words.size() - 1;
+    m_words.resize(start + 2 * header.width + 1, uint64_t(0));
+    header.offset = start;
+    if (header.width > 0) {
+        uint64_t* words = m_words.data() + start;
+        for (size_t i = 0; i < block_size; i++)
+            detail::packed_put(words, i, header.width, packed[i]);
+    }
+    m_blocks.push_back(header);
+}
+
+#undef DATUM_PACKED_VEC
+#undef DATUM_PACKED_VEC_TEMPLATE
+
+}
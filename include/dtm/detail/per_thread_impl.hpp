@@ -0,0 +1,134 @@
+// details/per_thread_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_PER_THREAD_IMPL_HPP
+#error "Don't include or compile datum/detail/per_thread_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+#define DATUM_PER_THREAD_TEMPLATE template <typename T>
+#define DATUM_PER_THREAD per_thread<T>
+
+DATUM_PER_THREAD_TEMPLATE
+template <typename... Args>
+DATUM_PER_THREAD::per_thread(thread_pool& pool, Args&&... args)
+    : m_pool(&pool), m_slots(nullptr), m_size(pool.size() + 1)
+{
+    m_slots = static_cast<slot*>(detail::aligned_allocate(alignof(slot), m_size * sizeof(slot)));
+    size_t constructed = 0;
+    try {
+        for (; constructed < m_size; constructed++)
+            new (&m_slots[constructed]) slot(args...);
+    } catch (...) {
+        for (size_t i = 0; i < constructed; i++)
+            m_slots[i].~slot();
+        detail::aligned_free(m_slots);
+        throw;
+    }
+}
+
+DATUM_PER_THREAD_TEMPLATE
+DATUM_PER_THREAD::per_thread()
+    : per_thread(default_thread_pool())
+{}
+
+DATUM_PER_THREAD_TEMPLATE
+DATUM_PER_THREAD::~per_thread()
+{
+    for (size_t i = 0; i < m_size; i++)
+        m_slots[i].~slot();
+    detail::aligned_free(m_slots);
+}
+
+DATUM_PER_THREAD_TEMPLATE
+T& DATUM_PER_THREAD::local() noexcept
+{
+    size_t index = m_pool->this_worker_index();
+    return m_slots[index == thread_pool::npos ? m_size - 1 : index].value;
+}
+
+DATUM_PER_THREAD_TEMPLATE
+size_t DATUM_PER_THREAD::size() const noexcept
+{
+    return m_size;
+}
+
+DATUM_PER_THREAD_TEMPLATE
+T& DATUM_PER_THREAD::operator[] (size_t slot) noexcept
+{
+    return m_slots[slot].value;
+}
+
+DATUM_PER_THREAD_TEMPLATE
+const T& DATUM_PER_THREAD::operator[] (size_t slot) const noexcept
+{
+    return m_slots[slot].value;
+}
+
+DATUM_PER_THREAD_TEMPLATE
+template <typename Fn>
+void DATUM_PER_THREAD::for_each(Fn&& fn)
+{
+    for (size_t i = 0; i < m_size; i++)
+        fn(m_slots[i].value);
+}
+
+DATUM_PER_THREAD_TEMPLATE
+template <typename Fn>
+void DATUM_PER_THREAD::for_each(Fn&& fn) const
+{
+    for (size_t i = 0; i < m_size; i++)
+        fn(static_cast<const T&>(m_slots[i].value));
+}
+
+DATUM_PER_THREAD_TEMPLATE
+template <typename Fn>
+T DATUM_PER_THREAD::combine(Fn fn) const
+{
+    T combined = m_slots[0].value;
+    for (size_t i = 1; i < m_size; i++)
+        combined = fn(combined, m_slots[i].value);
+    return combined;
+}
+
+DATUM_PER_THREAD_TEMPLATE
+template <typename U>
+void DATUM_PER_THREAD::merge_into(vec<U>& out) const
+{
+    static_assert(std::is_same<T, vec<U>>::value, "dtm::per_thread::merge_into needs slots of the vec's type");
+    size_t total = out.size();
+    for (size_t i = 0; i < m_size; i++)
+        total += m_slots[i].value.size();
+    out.reserve(total);
+    for (size_t i = 0; i < m_size; i++) {
+        for (const U& x : m_slots[i].value)
+            out.push_back(x);
+    }
+}
+
+DATUM_PER_THREAD_TEMPLATE
+template <typename K, typename V, typename H, typename E>
+void DATUM_PER_THREAD::merge_into(hash_table<K, V, H, E>& out) const
+{
+    merge_into(out, [](const V& present, const V&) { return present; });
+}
+
+DATUM_PER_THREAD_TEMPLATE
+template <typename K, typename V, typename H, typename E, typename Fn>
+void DATUM_PER_THREAD::merge_into(hash_table<K, V, H, E>& out, Fn fn) const
+{
+    static_assert(std::is_same<T, hash_table<K, V, H, E>>::value, "dtm::per_thread::merge_into needs slots of the table's type");
+    for (size_t i = 0; i < m_size; i++) {
+        for (const auto& e : m_slots[i].value) {
+            auto inserted = out.emplace(e.key, e.value);
+            if (!inserted.second)
+                inserted.first->value = fn(inserted.first->value, e.value);
+        }
+    }
+}
+
+#undef DATUM_PER_THREAD
+#undef DATUM_PER_THREAD_TEMPLATE
+
+}
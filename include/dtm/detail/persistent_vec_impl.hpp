@@ -0,0 +1,607 @@
+// details/persistent_vec_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_PERSISTENT_VEC_IMPL_HPP
+#error "Don't include or compile datum/detail/persistent_vec_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+#define DATUM_PERSISTENT_VEC_TEMPLATE template <typename T>
+#define DATUM_PERSISTENT_VEC persistent_vec<T>
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC::persistent_vec() noexcept
+    : m_root(nullptr), m_tail(nullptr), m_size(0), m_shift(bits)
+{}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC::persistent_vec(std::initializer_list<T> init)
+    : persistent_vec(init.begin(), init.end())
+{}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+template <typename It, typename>
+DATUM_PERSISTENT_VEC::persistent_vec(It first, It last)
+    : persistent_vec()
+{
+    // Nothing else holds the nodes yet, so every push is in place.
+    for (; first != last; ++first)
+        push_back_in_place(*first);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC::persistent_vec(const persistent_vec& rhs) noexcept
+    : m_root(rhs.m_root), m_tail(rhs.m_tail), m_size(rhs.m_size), m_shift(rhs.m_shift)
+{
+    if (m_root)
+        retain(m_root);
+    if (m_tail)
+        retain(m_tail);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC::persistent_vec(persistent_vec&& rhs) noexcept
+    : persistent_vec()
+{
+    swap(rhs);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC::~persistent_vec()
+{
+    if (m_root)
+        release(m_root, m_shift);
+    if (m_tail)
+        release(m_tail, 0);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC& DATUM_PERSISTENT_VEC::operator= (const persistent_vec& rhs) noexcept
+{
+    persistent_vec temp(rhs);
+    swap(temp);
+    return *this;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC& DATUM_PERSISTENT_VEC::operator= (persistent_vec&& rhs) noexcept
+{
+    persistent_vec temp(std::move(rhs));
+    swap(temp);
+    return *this;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+void DATUM_PERSISTENT_VEC::swap(persistent_vec& rhs) noexcept
+{
+    std::swap(m_root, rhs.m_root);
+    std::swap(m_tail, rhs.m_tail);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_shift, rhs.m_shift);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+size_t DATUM_PERSISTENT_VEC::size() const noexcept
+{
+    return m_size;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+bool DATUM_PERSISTENT_VEC::empty() const noexcept
+{
+    return m_size == 0;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+const T& DATUM_PERSISTENT_VEC::operator[] (size_t index) const noexcept
+{
+    return elements(leaf_for(index))[index & mask];
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+const T& DATUM_PERSISTENT_VEC::at(size_t index) const
+{
+    if (index >= m_size)
+        throw std::out_of_range("dtm::persistent_vec::at");
+    return (*this)[index];
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+const T& DATUM_PERSISTENT_VEC::front() const noexcept
+{
+    return (*this)[0];
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+const T& DATUM_PERSISTENT_VEC::back() const noexcept
+{
+    return elements(m_tail)[m_tail->count - 1];
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+typename DATUM_PERSISTENT_VEC::const_iterator DATUM_PERSISTENT_VEC::begin() const noexcept
+{
+    return const_iterator(this, 0);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+typename DATUM_PERSISTENT_VEC::const_iterator DATUM_PERSISTENT_VEC::end() const noexcept
+{
+    return const_iterator(this, m_size);
+}
+
+// The new version starts out sharing both the root and the tail with this
+// one, so the in place edits copy every node on their path.
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC DATUM_PERSISTENT_VEC::set(size_t index, const T& value) const
+{
+    persistent_vec result(*this);
+    result.set_in_place(index, value);
+    return result;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC DATUM_PERSISTENT_VEC::set(size_t index, T&& value) const
+{
+    persistent_vec result(*this);
+    result.set_in_place(index, std::move(value));
+    return result;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC DATUM_PERSISTENT_VEC::push_back(const T& value) const
+{
+    persistent_vec result(*this);
+    result.push_back_in_place(value);
+    return result;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC DATUM_PERSISTENT_VEC::push_back(T&& value) const
+{
+    persistent_vec result(*this);
+    result.push_back_in_place(std::move(value));
+    return result;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+DATUM_PERSISTENT_VEC DATUM_PERSISTENT_VEC::pop_back() const
+{
+    persistent_vec result(*this);
+    result.pop_back_in_place();
+    return result;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+transient_vec<T> DATUM_PERSISTENT_VEC::transient() const noexcept
+{
+    return transient_vec<T>(*this);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+template <typename F>
+void DATUM_PERSISTENT_VEC::for_each_chunk(F&& f) const
+{
+    if (m_root)
+        visit_chunks(m_root, m_shift, f);
+    if (m_tail)
+        f(static_cast<const T*>(elements(m_tail)), size_t(m_tail->count));
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+template <typename F>
+void DATUM_PERSISTENT_VEC::for_each(F&& f) const
+{
+    for_each_chunk([&f](const T* data, size_t count) {
+        for (size_t i = 0; i < count; i++)
+            f(data[i]);
+    });
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+vec<T> DATUM_PERSISTENT_VEC::to_vec() const
+{
+    vec<T> result;
+    result.reserve(m_size);
+    for_each_chunk([&result](const T* data, size_t count) {
+        for (size_t i = 0; i < count; i++)
+            result.push_back(data[i]);
+    });
+    return result;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+size_t DATUM_PERSISTENT_VEC::tail_offset() const noexcept
+{
+    // The tail is never empty, so a multiple of 32 elements leaves a full
+    // one.
+    return m_size == 0 ? 0 : (m_size - 1) & ~size_t(mask);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+const typename DATUM_PERSISTENT_VEC::node* DATUM_PERSISTENT_VEC::leaf_for(size_t index) const noexcept
+{
+    if (index >= tail_offset())
+        return m_tail;
+    const node* n = m_root;
+    for (unsigned level = m_shift; level > 0; level -= bits)
+        n = children(n)[(index >> level) & mask];
+    return n;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+const T* DATUM_PERSISTENT_VEC::element_or_null(size_t index) const noexcept
+{
+    return index < m_size ? elements(leaf_for(index)) + (index & mask) : nullptr;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+template <typename U>
+void DATUM_PERSISTENT_VEC::push_back_in_place(U&& value)
+{
+    size_t tail_count = m_size - tail_offset();
+    if (m_tail && tail_count < branches) {
+        make_writable(m_tail, 0);
+        new (elements(m_tail) + tail_count) T(std::forward<U>(value));
+        m_tail->count++;
+    }
+    else {
+        // Build the new tail before the old one goes into the tree, so a
+        // throwing constructor leaves the vec as it was.
+        node* leaf = allocate_leaf();
+        try {
+            new (elements(leaf)) T(std::forward<U>(value));
+        } catch (...) {
+            free(leaf);
+            throw;
+        }
+        leaf->count = 1;
+        if (m_tail) {
+            try {
+                push_tail(m_tail);
+            } catch (...) {
+                release(leaf, 0);
+                throw;
+            }
+        }
+        m_tail = leaf;
+    }
+    m_size++;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+template <typename U>
+void DATUM_PERSISTENT_VEC::set_in_place(size_t index, U&& value)
+{
+    node** slot = &m_tail;
+    unsigned level = 0;
+    if (index < tail_offset()) {
+        slot = &m_root;
+        level = m_shift;
+        for (; level > 0; level -= bits) {
+            make_writable(*slot, level);
+            slot = &children(*slot)[(index >> level) & mask];
+        }
+    }
+    make_writable(*slot, 0);
+    elements(*slot)[index & mask] = std::forward<U>(value);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+void DATUM_PERSISTENT_VEC::pop_back_in_place()
+{
+    size_t tail_count = m_size - tail_offset();
+    if (tail_count > 1) {
+        make_writable(m_tail, 0);
+        elements(m_tail)[tail_count - 1].~T();
+        m_tail->count--;
+        m_size--;
+        return;
+    }
+
+    node* leaf = nullptr;
+    if (m_size > 1) {
+        // The last leaf of the tree becomes the tail. Copies made on the
+        // way down are the only step that can throw, and they leave the
+        // tree as it was.
+        make_writable(m_root, m_shift);
+        leaf = pop_last(m_root, m_shift);
+        if (m_root->count == 0) {
+            release(m_root, m_shift);
+            m_root = nullptr;
+            m_shift = bits;
+        }
+        else if (m_shift > bits && m_root->count == 1) {
+            node* child = children(m_root)[0];
+            retain(child);
+            release(m_root, m_shift);
+            m_root = child;
+            m_shift -= bits;
+        }
+    }
+    release(m_tail, 0);
+    m_tail = leaf;
+    m_size--;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+void DATUM_PERSISTENT_VEC::push_tail(node* leaf)
+{
+    size_t index = tail_offset();
+    if (!m_root) {
+        node* root = allocate_inner();
+        children(root)[0] = leaf;
+        root->count = 1;
+        m_root = root;
+        m_shift = bits;
+        return;
+    }
+
+    if (index >> (m_shift + bits)) {
+        // The root is full: the tree grows a level.
+        node* root = allocate_inner();
+        node* path;
+        try {
+            path = new_path(m_shift, leaf);
+        } catch (...) {
+            free(root);
+            throw;
+        }
+        children(root)[0] = m_root;
+        children(root)[1] = path;
+        root->count = 2;
+        m_root = root;
+        m_shift += bits;
+        return;
+    }
+
+    make_writable(m_root, m_shift);
+    node* n = m_root;
+    for (unsigned level = m_shift; ; level -= bits) {
+        size_t sub = (index >> level) & mask;
+        if (level == bits) {
+            children(n)[sub] = leaf;
+            n->count++;
+            return;
+        }
+        if (sub < n->count) {
+            make_writable(children(n)[sub], level - bits);
+            n = children(n)[sub];
+        }
+        else {
+            children(n)[sub] = new_path(level - bits, leaf);
+            n->count++;
+            return;
+        }
+    }
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+typename DATUM_PERSISTENT_VEC::node* DATUM_PERSISTENT_VEC::pop_last(node* n, unsigned level)
+{
+    node*& last = children(n)[n->count - 1];
+    if (level == bits) {
+        n->count--;
+        return last;
+    }
+    make_writable(last, level - bits);
+    node* leaf = pop_last(last, level - bits);
+    if (last->count == 0) {
+        release(last, level - bits);
+        n->count--;
+    }
+    return leaf;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+typename DATUM_PERSISTENT_VEC::node* DATUM_PERSISTENT_VEC::new_path(unsigned level, node* leaf)
+{
+    node* path = leaf;
+    for (unsigned l = bits; l <= level; l += bits) {
+        node* n;
+        try {
+            n = allocate_inner();
+        } catch (...) {
+            while (path != leaf) {
+                node* next = children(path)[0];
+                free(path);
+                path = next;
+            }
+            throw;
+        }
+        children(n)[0] = path;
+        n->count = 1;
+        path = n;
+    }
+    return path;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+typename DATUM_PERSISTENT_VEC::node* DATUM_PERSISTENT_VEC::allocate_leaf()
+{
+    void* block = malloc(elements_offset() + branches * sizeof(T));
+    if (!block)
+        throw std::bad_alloc();
+    return new (block) node{{1}, 0};
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+typename DATUM_PERSISTENT_VEC::node* DATUM_PERSISTENT_VEC::allocate_inner()
+{
+    void* block = malloc(sizeof(node) + branches * sizeof(node*));
+    if (!block)
+        throw std::bad_alloc();
+    return new (block) node{{1}, 0};
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+size_t DATUM_PERSISTENT_VEC::elements_offset() noexcept
+{
+    return (sizeof(node) + alignof(T) - 1) / alignof(T) * alignof(T);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+T* DATUM_PERSISTENT_VEC::elements(const node* n) noexcept
+{
+    return reinterpret_cast<T*>(reinterpret_cast<uintptr_t>(n) + elements_offset());
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+typename DATUM_PERSISTENT_VEC::node** DATUM_PERSISTENT_VEC::children(const node* n) noexcept
+{
+    return reinterpret_cast<node**>(const_cast<node*>(n + 1));
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+void DATUM_PERSISTENT_VEC::retain(node* n) noexcept
+{
+    n->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+void DATUM_PERSISTENT_VEC::release(node* n, unsigned level) noexcept
+{
+    if (n->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        return;
+    if (level == 0) {
+        T* data = elements(n);
+        for (size_t i = 0; i < n->count; i++)
+            data[i].~T();
+    }
+    else {
+        node** child = children(n);
+        for (size_t i = 0; i < n->count; i++)
+            release(child[i], level - bits);
+    }
+    // The header is trivially destructible.
+    free(n);
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+typename DATUM_PERSISTENT_VEC::node* DATUM_PERSISTENT_VEC::copy(const node* n, unsigned level)
+{
+    if (level > 0) {
+        node* result = allocate_inner();
+        for (size_t i = 0; i < n->count; i++) {
+            children(result)[i] = children(n)[i];
+            retain(children(n)[i]);
+        }
+        result->count = n->count;
+        return result;
+    }
+
+    node* result = allocate_leaf();
+    const T* from = elements(n);
+    T* to = elements(result);
+    size_t constructed = 0;
+    try {
+        for (; constructed < n->count; constructed++)
+            new (to + constructed) T(from[constructed]);
+    } catch (...) {
+        for (size_t i = 0; i < constructed; i++)
+            to[i].~T();
+        free(result);
+        throw;
+    }
+    result->count = n->count;
+    return result;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+void DATUM_PERSISTENT_VEC::make_writable(node*& n, unsigned level)
+{
+    // Acquire, so that reads through references dropped by other threads
+    // happen before our writes.
+    if (n->references.load(std::memory_order_acquire) == 1)
+        return;
+    node* fresh = copy(n, level);
+    release(n, level);
+    n = fresh;
+}
+
+DATUM_PERSISTENT_VEC_TEMPLATE
+template <typename F>
+void DATUM_PERSISTENT_VEC::visit_chunks(const node* n, unsigned level, F& f)
+{
+    if (level == 0) {
+        f(static_cast<const T*>(elements(n)), size_t(n->count));
+        return;
+    }
+    node** child = children(n);
+    for (size_t i = 0; i < n->count; i++)
+        visit_chunks(child[i], level - bits, f);
+}
+
+#undef DATUM_PERSISTENT_VEC
+#undef DATUM_PERSISTENT_VEC_TEMPLATE
+
+template <typename T>
+transient_vec<T>::transient_vec(persistent_vec<T> v) noexcept
+    : m_vec(std::move(v))
+{}
+
+template <typename T>
+size_t transient_vec<T>::size() const noexcept
+{
+    return m_vec.size();
+}
+
+template <typename T>
+bool transient_vec<T>::empty() const noexcept
+{
+    return m_vec.empty();
+}
+
+template <typename T>
+const T& transient_vec<T>::operator[] (size_t index) const noexcept
+{
+    return m_vec[index];
+}
+
+template <typename T>
+const T& transient_vec<T>::at(size_t index) const
+{
+    if (index >= m_vec.size())
+        throw std::out_of_range("dtm::transient_vec::at");
+    return m_vec[index];
+}
+
+template <typename T>
+void transient_vec<T>::set(size_t index, const T& value)
+{
+    m_vec.set_in_place(index, value);
+}
+
+template <typename T>
+void transient_vec<T>::set(size_t index, T&& value)
+{
+    m_vec.set_in_place(index, std::move(value));
+}
+
+template <typename T>
+void transient_vec<T>::push_back(const T& value)
+{
+    m_vec.push_back_in_place(value);
+}
+
+template <typename T>
+void transient_vec<T>::push_back(T&& value)
+{
+    m_vec.push_back_in_place(std::move(value));
+}
+
+template <typename T>
+void transient_vec<T>::pop_back()
+{
+    m_vec.pop_back_in_place();
+}
+
+template <typename T>
+persistent_vec<T> transient_vec<T>::persistent() const noexcept
+{
+    return m_vec;
+}
+
+}
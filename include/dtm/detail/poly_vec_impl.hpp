@@ -0,0 +1,409 @@
+// details/poly_vec_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_POLY_VEC_IMPL_HPP
+#error "Don't include or compile datum/detail/poly_vec_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+#define DATUM_POLY_VEC_TEMPLATE template <typename Base>
+#define DATUM_POLY_VEC poly_vec<Base>
+
+DATUM_POLY_VEC_TEMPLATE
+DATUM_POLY_VEC::poly_vec() noexcept
+    : m_data(nullptr), m_bytes(0), m_capacity(0), m_last_type(0), m_grouped(0)
+{}
+
+DATUM_POLY_VEC_TEMPLATE
+DATUM_POLY_VEC::~poly_vec()
+{
+    release();
+}
+
+DATUM_POLY_VEC_TEMPLATE
+DATUM_POLY_VEC::poly_vec(poly_vec&& rhs) noexcept
+    : poly_vec()
+{
+    swap(rhs);
+}
+
+DATUM_POLY_VEC_TEMPLATE
+DATUM_POLY_VEC& DATUM_POLY_VEC::operator= (poly_vec&& rhs) noexcept
+{
+    poly_vec temp(std::move(rhs));
+    swap(temp);
+    return *this;
+}
+
+DATUM_POLY_VEC_TEMPLATE
+template <typename D, typename... Args>
+D& DATUM_POLY_VEC::emplace_back(Args&&... args)
+{
+    static_assert(std::is_base_of<Base, D>::value, "dtm::poly_vec holds classes derived from its base");
+    static_assert(alignof(D) <= DATUM_CACHE_LINE_SIZE, "dtm::poly_vec holds classes aligned up to DATUM_CACHE_LINE_SIZE");
+
+    size_t start = (m_bytes + alignof(D) - 1) / alignof(D) * alignof(D);
+    if (start + sizeof(D) > m_capacity)
+        grow(start + sizeof(D));
+    if (m_entries.size() == m_entries.capacity())
+        m_entries.reserve(m_entries.size() * 1.5 + 4);
+
+    // Register a new class before constructing, so that nothing can throw
+    // once the object exists. Its base offset is filled in below.
+    const detail::poly_ops* ops = &detail::poly_ops_of<D>::ops;
+    uint32_t type = find_type(ops);
+    bool new_type = type == m_types.size();
+    if (new_type)
+        m_types.push_back(detail::poly_type{ops, 0});
+
+    D* object;
+    try {
+        object = new (m_data + start) D(std::forward<Args>(args)...);
+    } catch (...) {
+        if (new_type)
+            m_types.pop_back();
+        throw;
+    }
+
+    size_t base = reinterpret_cast<unsigned char*>(static_cast<Base*>(object)) - (m_data + start);
+    m_types[type].base_offset = base;
+    m_entries.push_back(detail::poly_entry{start + base, type});
+    m_bytes = start + sizeof(D);
+    m_last_type = type;
+    return *object;
+}
+
+DATUM_POLY_VEC_TEMPLATE
+template <typename D>
+typename std::decay<D>::type& DATUM_POLY_VEC::push_back(D&& value)
+{
+    return emplace_back<typename std::decay<D>::type>(std::forward<D>(value));
+}
+
+DATUM_POLY_VEC_TEMPLATE
+void DATUM_POLY_VEC::pop_back() noexcept
+{
+    const detail::poly_entry& entry = m_entries.back();
+    unsigned char* last = object(entry);
+    if (m_types[entry.type].ops->destroy)
+        m_types[entry.type].ops->destroy(last);
+    m_bytes = last - m_data;
+    m_entries.pop_back();
+    m_grouped = std::min(m_grouped, size());
+}
+
+DATUM_POLY_VEC_TEMPLATE
+void DATUM_POLY_VEC::clear() noexcept
+{
+    for (const detail::poly_entry& entry : m_entries) {
+        if (m_types[entry.type].ops->destroy)
+            m_types[entry.type].ops->destroy(object(entry));
+    }
+    m_entries.clear();
+    m_bytes = 0;
+    m_grouped = 0;
+}
+
+DATUM_POLY_VEC_TEMPLATE
+void DATUM_POLY_VEC::swap(poly_vec& rhs) noexcept
+{
+    std::swap(m_data, rhs.m_data);
+    std::swap(m_bytes, rhs.m_bytes);
+    std::swap(m_capacity, rhs.m_capacity);
+    m_entries.swap(rhs.m_entries);
+    m_types.swap(rhs.m_types);
+    std::swap(m_last_type, rhs.m_last_type);
+    m_type_begin.swap(rhs.m_type_begin);
+    std::swap(m_grouped, rhs.m_grouped);
+}
+
+DATUM_POLY_VEC_TEMPLATE
+void DATUM_POLY_VEC::reserve(size_t count, size_t bytes)
+{
+    m_entries.reserve(count);
+    if (bytes > m_capacity)
+        grow(bytes);
+}
+
+DATUM_POLY_VEC_TEMPLATE
+size_t DATUM_POLY_VEC::size() const noexcept
+{
+    return m_entries.size();
+}
+
+DATUM_POLY_VEC_TEMPLATE
+bool DATUM_POLY_VEC::empty() const noexcept
+{
+    return m_entries.empty();
+}
+
+DATUM_POLY_VEC_TEMPLATE
+Base& DATUM_POLY_VEC::operator[] (size_t index) noexcept
+{
+    return *reinterpret_cast<Base*>(m_data + m_entries[index].offset);
+}
+
+DATUM_POLY_VEC_TEMPLATE
+const Base& DATUM_POLY_VEC::operator[] (size_t index) const noexcept
+{
+    return *reinterpret_cast<const Base*>(m_data + m_entries[index].offset);
+}
+
+DATUM_POLY_VEC_TEMPLATE
+Base& DATUM_POLY_VEC::at(size_t index)
+{
+    if (index >= size())
+        throw std::out_of_range("dtm::poly_vec::at");
+    return (*this)[index];
+}
+
+DATUM_POLY_VEC_TEMPLATE
+const Base& DATUM_POLY_VEC::at(size_t index) const
+{
+    if (index >= size())
+        throw std::out_of_range("dtm::poly_vec::at");
+    return (*this)[index];
+}
+
+DATUM_POLY_VEC_TEMPLATE
+Base& DATUM_POLY_VEC::front() noexcept
+{
+    return (*this)[0];
+}
+
+DATUM_POLY_VEC_TEMPLATE
+const Base& DATUM_POLY_VEC::front() const noexcept
+{
+    return (*this)[0];
+}
+
+DATUM_POLY_VEC_TEMPLATE
+Base& DATUM_POLY_VEC::back() noexcept
+{
+    return (*this)[size() - 1];
+}
+
+DATUM_POLY_VEC_TEMPLATE
+const Base& DATUM_POLY_VEC::back() const noexcept
+{
+    return (*this)[size() - 1];
+}
+
+DATUM_POLY_VEC_TEMPLATE
+typename DATUM_POLY_VEC::iterator DATUM_POLY_VEC::begin() noexcept
+{
+    return iterator(this, 0);
+}
+
+DATUM_POLY_VEC_TEMPLATE
+typename DATUM_POLY_VEC::iterator DATUM_POLY_VEC::end() noexcept
+{
+    return iterator(this, size());
+}
+
+DATUM_POLY_VEC_TEMPLATE
+typename DATUM_POLY_VEC::const_iterator DATUM_POLY_VEC::begin() const noexcept
+{
+    return const_iterator(this, 0);
+}
+
+DATUM_POLY_VEC_TEMPLATE
+typename DATUM_POLY_VEC::const_iterator DATUM_POLY_VEC::end() const noexcept
+{
+    return const_iterator(this, size());
+}
+
+DATUM_POLY_VEC_TEMPLATE
+const std::type_info& DATUM_POLY_VEC::type(size_t index) const noexcept
+{
+    return *m_types[m_entries[index].type].ops->type;
+}
+
+DATUM_POLY_VEC_TEMPLATE
+template <typename D>
+bool DATUM_POLY_VEC::holds(size_t index) const noexcept
+{
+    return m_types[m_entries[index].type].ops == &detail::poly_ops_of<D>::ops;
+}
+
+DATUM_POLY_VEC_TEMPLATE
+size_t DATUM_POLY_VEC::type_count() const noexcept
+{
+    return m_types.size();
+}
+
+DATUM_POLY_VEC_TEMPLATE
+template <typename Fn>
+void DATUM_POLY_VEC::for_each(Fn&& fn)
+{
+    for (const detail::poly_entry& entry : m_entries)
+        fn(*reinterpret_cast<Base*>(m_data + entry.offset));
+}
+
+DATUM_POLY_VEC_TEMPLATE
+template <typename Fn>
+void DATUM_POLY_VEC::for_each(Fn&& fn) const
+{
+    for (const detail::poly_entry& entry : m_entries)
+        fn(*reinterpret_cast<const Base*>(m_data + entry.offset));
+}
+
+DATUM_POLY_VEC_TEMPLATE
+template <typename D, typename Fn>
+void DATUM_POLY_VEC::for_each_of(Fn&& fn)
+{
+    uint32_t type = find_type(&detail::poly_ops_of<D>::ops);
+    if (type + size_t(1) < m_type_begin.size()) {
+        size_t end = std::min(m_type_begin[type + 1], m_grouped);
+        for (size_t i = std::min(m_type_begin[type], m_grouped); i < end; i++)
+            fn(*reinterpret_cast<D*>(object(m_entries[i])));
+    }
+    for (size_t i = m_grouped; i < size(); i++) {
+        if (m_entries[i].type == type)
+            fn(*reinterpret_cast<D*>(object(m_entries[i])));
+    }
+}
+
+DATUM_POLY_VEC_TEMPLATE
+template <typename D, typename Fn>
+void DATUM_POLY_VEC::for_each_of(Fn&& fn) const
+{
+    uint32_t type = find_type(&detail::poly_ops_of<D>::ops);
+    if (type + size_t(1) < m_type_begin.size()) {
+        size_t end = std::min(m_type_begin[type + 1], m_grouped);
+        for (size_t i = std::min(m_type_begin[type], m_grouped); i < end; i++)
+            fn(*reinterpret_cast<const D*>(object(m_entries[i])));
+    }
+    for (size_t i = m_grouped; i < size(); i++) {
+        if (m_entries[i].type == type)
+            fn(*reinterpret_cast<const D*>(object(m_entries[i])));
+    }
+}
+
+DATUM_POLY_VEC_TEMPLATE // XXX not exception safe
+void DATUM_POLY_VEC::group_by_type()
+{
+    // Counting sort of the index by class, which keeps the order within
+    // each class.
+    vec<size_t> next(m_types.size() + 1, size_t(0));
+    for (const detail::poly_entry& entry : m_entries)
+        next[entry.type + 1]++;
+    for (size_t t = 1; t < next.size(); t++)
+        next[t] += next[t - 1];
+    m_type_begin = next;
+    m_grouped = size();
+    if (m_types.size() < 2)
+        return;
+    vec<detail::poly_entry> grouped;
+    grouped.resize_for_overwrite(size());
+    for (const detail::poly_entry& entry : m_entries)
+        grouped[next[entry.type]++] = entry;
+
+    size_t bytes = 0;
+    for (const detail::poly_entry& entry : grouped) {
+        const detail::poly_ops* ops = m_types[entry.type].ops;
+        bytes = (bytes + ops->alignment - 1) / ops->alignment * ops->alignment + ops->size;
+    }
+
+    size_t capacity = std::max(bytes, m_capacity);
+    unsigned char* data = static_cast<unsigned char*>(detail::aligned_allocate(DATUM_CACHE_LINE_SIZE, capacity));
+    bytes = 0;
+    for (detail::poly_entry& entry : grouped) {
+        const detail::poly_type& type = m_types[entry.type];
+        size_t start = (bytes + type.ops->alignment - 1) / type.ops->alignment * type.ops->alignment;
+        if (type.ops->relocate)
+            type.ops->relocate(object(entry), data + start);
+        else
+            memcpy(data + start, object(entry), type.ops->size);
+        entry.offset = start + type.base_offset;
+        bytes = start + type.ops->size;
+    }
+
+    detail::aligned_free(m_data);
+    m_data = data;
+    m_bytes = bytes;
+    m_capacity = capacity;
+    m_entries.swap(grouped);
+}
+
+DATUM_POLY_VEC_TEMPLATE
+size_t DATUM_POLY_VEC::buffer_size() const noexcept
+{
+    return m_bytes;
+}
+
+DATUM_POLY_VEC_TEMPLATE
+size_t DATUM_POLY_VEC::buffer_capacity() const noexcept
+{
+    return m_capacity;
+}
+
+DATUM_POLY_VEC_TEMPLATE
+size_t DATUM_POLY_VEC::size_in_bytes() const noexcept
+{
+    return m_capacity + m_entries.capacity() * sizeof(detail::poly_entry) + m_types.capacity() * sizeof(detail::poly_type);
+}
+
+DATUM_POLY_VEC_TEMPLATE
+unsigned char* DATUM_POLY_VEC::object(const detail::poly_entry& entry) const noexcept
+{
+    return m_data + entry.offset - m_types[entry.type].base_offset;
+}
+
+DATUM_POLY_VEC_TEMPLATE
+uint32_t DATUM_POLY_VEC::find_type(const detail::poly_ops* ops) const noexcept
+{
+    if (m_last_type < m_types.size() && m_types[m_last_type].ops == ops)
+        return m_last_type;
+    for (size_t t = 0; t < m_types.size(); t++) {
+        if (m_types[t].ops == ops)
+            return uint32_t(t);
+    }
+    return uint32_t(m_types.size());
+}
+
+DATUM_POLY_VEC_TEMPLATE // XXX not exception safe
+void DATUM_POLY_VEC::grow(size_t bytes)
+{
+    size_t capacity = std::max<size_t>(std::max<size_t>(bytes, m_capacity * 2), 256);
+    unsigned char* data = static_cast<unsigned char*>(detail::aligned_allocate(DATUM_CACHE_LINE_SIZE, capacity));
+
+    // Both buffers have the same alignment, so every object keeps its
+    // offset. If every class is relocatable the whole buffer is one copy.
+    bool relocatable = true;
+    for (const detail::poly_type& type : m_types)
+        relocatable = relocatable && !type.ops->relocate;
+    if (relocatable) {
+        if (m_bytes > 0)
+            memcpy(data, m_data, m_bytes);
+    }
+    else {
+        for (const detail::poly_entry& entry : m_entries) {
+            const detail::poly_ops* ops = m_types[entry.type].ops;
+            unsigned char* from = object(entry);
+            if (ops->relocate)
+                ops->relocate(from, data + (from - m_data));
+            else
+                memcpy(data + (from - m_data), from, ops->size);
+        }
+    }
+
+    detail::aligned_free(m_data);
+    m_data = data;
+    m_capacity = capacity;
+}
+
+DATUM_POLY_VEC_TEMPLATE
+void DATUM_POLY_VEC::release() noexcept
+{
+    clear();
+    detail::aligned_free(m_data);
+    m_data = nullptr;
+    m_capacity = 0;
+}
+
+#undef DATUM_POLY_VEC
+#undef DATUM_POLY_VEC_TEMPLATE
+
+}
@@ -1,12 +1,21 @@
 // ptr.hpp
 
+#ifndef INCLUDED_DATUM_DETAIL_PTR_HPP
+#define INCLUDED_DATUM_DETAIL_PTR_HPP
+
+#include <iterator>
+#include <cstddef>
+
 namespace dtm {
+
+template <typename> class vec;
+
 namespace detail {
 
 template <typename T>
 class ptr
 {
-    template <typename> friend class vec;
+    template <typename> friend class dtm::vec;
 public:
     explicit ptr(T* p_) noexcept { p = p_; }
 
@@ -48,4 +57,6 @@ private:
 
 
 }
-}
\ No newline at end of file
+}
+
+#endif //INCLUDED_DATUM_DETAIL_PTR_HPP
@@ -0,0 +1,277 @@
+// details/shared_vec_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_SHARED_VEC_IMPL_HPP
+#error "Don't include or compile datum/detail/shared_vec_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+#define DATUM_SHARED_VEC_TEMPLATE template <typename T>
+#define DATUM_SHARED_VEC shared_vec<T>
+
+DATUM_SHARED_VEC_TEMPLATE
+DATUM_SHARED_VEC::shared_vec() noexcept
+    : m_data(nullptr), m_size(0)
+{}
+
+DATUM_SHARED_VEC_TEMPLATE
+DATUM_SHARED_VEC::shared_vec(vec<T>&& v)
+    : shared_vec()
+{
+    size_t size = v.size();
+    if (size == 0)
+        return;
+
+    size_t bytes = header_offset(size) + sizeof(detail::shared_vec_header);
+    if (v.m_local_storage) {
+        // The buffer belongs to a small_vec.
+        allocate(size);
+        size_t constructed = 0;
+        try {
+            for (; constructed < size; constructed++)
+                new (m_data + constructed) T(std::move(v[constructed]));
+        } catch (...) {
+            for (size_t i = 0; i < constructed; i++)
+                m_data[i].~T();
+            free(m_data);
+            m_data = nullptr;
+            throw;
+        }
+        m_size = size;
+        v.clear();
+        return;
+    }
+
+    if (bytes > v.m_capacity * sizeof(T)) {
+        if (!is_relocatable<T>::value) {
+            // Moving the elements into a buffer of the right size leaves the
+            // vec with room for the header.
+            v.reserve((bytes + sizeof(T) - 1) / sizeof(T));
+        }
+        else {
+            void* block = realloc(static_cast<void*>(v.m_begin), bytes);
+            if (!block)
+                throw std::bad_alloc();
+            v.m_begin = static_cast<T*>(block);
+        }
+    }
+    m_data = v.m_begin;
+    m_size = size;
+    new (header()) detail::shared_vec_header{{1}};
+
+    v.m_begin = nullptr;
+    v.m_end = nullptr;
+    v.m_capacity = 0;
+    v.m_local_storage = true;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+DATUM_SHARED_VEC::shared_vec(const vec<T>& v)
+    : shared_vec()
+{
+    copy_from(v.data(), v.size());
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+DATUM_SHARED_VEC::shared_vec(std::initializer_list<T> init)
+    : shared_vec()
+{
+    copy_from(init.begin(), init.size());
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+DATUM_SHARED_VEC::shared_vec(const shared_vec& rhs) noexcept
+    : m_data(rhs.m_data), m_size(rhs.m_size)
+{
+    if (m_data)
+        header()->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+DATUM_SHARED_VEC::shared_vec(shared_vec&& rhs) noexcept
+    : m_data(rhs.m_data), m_size(rhs.m_size)
+{
+    rhs.m_data = nullptr;
+    rhs.m_size = 0;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+DATUM_SHARED_VEC::~shared_vec()
+{
+    reset();
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+DATUM_SHARED_VEC& DATUM_SHARED_VEC::operator= (const shared_vec& rhs) noexcept
+{
+    shared_vec temp(rhs);
+    swap(temp);
+    return *this;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+DATUM_SHARED_VEC& DATUM_SHARED_VEC::operator= (shared_vec&& rhs) noexcept
+{
+    shared_vec temp(std::move(rhs));
+    swap(temp);
+    return *this;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+void DATUM_SHARED_VEC::swap(shared_vec& rhs) noexcept
+{
+    std::swap(m_data, rhs.m_data);
+    std::swap(m_size, rhs.m_size);
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+size_t DATUM_SHARED_VEC::size() const noexcept
+{
+    return m_size;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+bool DATUM_SHARED_VEC::empty() const noexcept
+{
+    return m_size == 0;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+const T* DATUM_SHARED_VEC::data() const noexcept
+{
+    return m_data;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+const T& DATUM_SHARED_VEC::operator[] (size_t index) const noexcept
+{
+    return m_data[index];
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+const T& DATUM_SHARED_VEC::at(size_t index) const
+{
+    if (index >= m_size)
+        throw std::out_of_range("dtm::shared_vec::at");
+    return m_data[index];
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+const T& DATUM_SHARED_VEC::front() const noexcept
+{
+    return m_data[0];
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+const T& DATUM_SHARED_VEC::back() const noexcept
+{
+    return m_data[m_size - 1];
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+const T* DATUM_SHARED_VEC::begin() const noexcept
+{
+    return m_data;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+const T* DATUM_SHARED_VEC::end() const noexcept
+{
+    return m_data + m_size;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+size_t DATUM_SHARED_VEC::use_count() const noexcept
+{
+    return m_data ? header()->references.load(std::memory_order_relaxed) : 0;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+bool DATUM_SHARED_VEC::unique() const noexcept
+{
+    // Acquire, so that reads through references dropped by other threads
+    // happen before our writes.
+    return m_data && header()->references.load(std::memory_order_acquire) == 1;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+span<T> DATUM_SHARED_VEC::mutate()
+{
+    if (m_data && !unique()) {
+        shared_vec copy;
+        copy.copy_from(m_data, m_size);
+        swap(copy);
+    }
+    return span<T>(m_data, m_size);
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+vec<T> DATUM_SHARED_VEC::to_vec() const
+{
+    return vec<T>(begin(), end());
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+void DATUM_SHARED_VEC::reset() noexcept
+{
+    if (m_data && header()->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        for (size_t i = 0; i < m_size; i++)
+            m_data[i].~T();
+        // The header is trivially destructible.
+        free(m_data);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+size_t DATUM_SHARED_VEC::header_offset(size_t size) noexcept
+{
+    const size_t alignment = alignof(detail::shared_vec_header);
+    return (size * sizeof(T) + alignment - 1) / alignment * alignment;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+detail::shared_vec_header* DATUM_SHARED_VEC::header() const noexcept
+{
+    return reinterpret_cast<detail::shared_vec_header*>(reinterpret_cast<char*>(m_data) + header_offset(m_size));
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+void DATUM_SHARED_VEC::allocate(size_t size)
+{
+    void* block = malloc(header_offset(size) + sizeof(detail::shared_vec_header));
+    if (!block)
+        throw std::bad_alloc();
+    m_data = static_cast<T*>(block);
+    m_size = size;
+    new (header()) detail::shared_vec_header{{1}};
+    m_size = 0;
+}
+
+DATUM_SHARED_VEC_TEMPLATE
+template <typename It>
+void DATUM_SHARED_VEC::copy_from(It first, size_t size)
+{
+    if (size == 0)
+        return;
+    allocate(size);
+    size_t constructed = 0;
+    try {
+        for (; constructed < size; constructed++, ++first)
+            new (m_data + constructed) T(*first);
+    } catch (...) {
+        for (size_t i = 0; i < constructed; i++)
+            m_data[i].~T();
+        free(m_data);
+        m_data = nullptr;
+        throw;
+    }
+    m_size = size;
+}
+
+#undef DATUM_SHARED_VEC
+#undef DATUM_SHARED_VEC_TEMPLATE
+
+}
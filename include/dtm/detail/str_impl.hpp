@@ -0,0 +1,490 @@
+// details/str_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_STR_IMPL_HPP
+#error "Don't include or compile datum/detail/str_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+inline str_view str_view::substr(size_t pos, size_t count) const
+{
+    if (pos > m_size)
+        throw std::out_of_range("dtm::str_view::substr");
+    return str_view(m_data + pos, std::min(count, m_size - pos));
+}
+
+inline int str_view::compare(str_view rhs) const noexcept
+{
+    int result = memcmp(m_data, rhs.m_data, std::min(m_size, rhs.m_size));
+    if (result != 0)
+        return result;
+    return m_size < rhs.m_size ? -1 : m_size > rhs.m_size ? 1 : 0;
+}
+
+inline size_t str_view::find(str_view needle, size_t pos) const noexcept
+{
+    return detail::str_find(m_data, m_size, needle.m_data, needle.m_size, pos);
+}
+
+inline size_t str_view::find(char c, size_t pos) const noexcept
+{
+    if (pos >= m_size)
+        return npos;
+    const void* p = memchr(m_data + pos, c, m_size - pos);
+    return p ? static_cast<const char*>(p) - m_data : size_t(npos);
+}
+
+inline size_t str_view::rfind(str_view needle, size_t pos) const noexcept
+{
+    if (needle.m_size > m_size)
+        return npos;
+    size_t i = std::min(pos, m_size - needle.m_size);
+    for (;; i--) {
+        if (memcmp(m_data + i, needle.m_data, needle.m_size) == 0)
+            return i;
+        if (i == 0)
+            return npos;
+    }
+}
+
+inline size_t str_view::rfind(char c, size_t pos) const noexcept
+{
+    if (m_size == 0)
+        return npos;
+    for (size_t i = std::min(pos, m_size - 1) + 1; i-- > 0; ) {
+        if (m_data[i] == c)
+            return i;
+    }
+    return npos;
+}
+
+inline bool str_view::starts_with(str_view prefix) const noexcept
+{
+    return m_size >= prefix.m_size && memcmp(m_data, prefix.m_data, prefix.m_size) == 0;
+}
+
+inline bool str_view::ends_with(str_view suffix) const noexcept
+{
+    return m_size >= suffix.m_size && memcmp(m_data + m_size - suffix.m_size, suffix.m_data, suffix.m_size) == 0;
+}
+
+inline str::str() noexcept
+{
+    memset(m_inline, 0, sizeof(m_inline));
+    m_inline[inline_capacity] = char(inline_capacity);
+}
+
+inline str::str(const char* s)
+{
+    init(s, strlen(s));
+}
+
+inline str::str(const char* s, size_t length)
+{
+    init(s, length);
+}
+
+inline str::str(size_t count, char c)
+    : str()
+{
+    resize(count, c);
+}
+
+inline str::str(str_view s)
+{
+    init(s.data(), s.size());
+}
+
+inline str::str(const str& rhs)
+{
+    if (rhs.is_inline())
+        memcpy(m_inline, rhs.m_inline, sizeof(m_inline));
+    else
+        init(rhs.data(), rhs.size());
+}
+
+inline str::str(str&& rhs) noexcept
+{
+    memcpy(m_inline, rhs.m_inline, sizeof(m_inline));
+    new (&rhs) str();
+}
+
+inline str::~str()
+{
+    release();
+}
+
+inline str& str::operator= (const str& rhs)
+{
+    if (this != &rhs)
+        *this = rhs.view();
+    return *this;
+}
+
+inline str& str::operator= (str&& rhs) noexcept
+{
+    if (this != &rhs) {
+        release();
+        memcpy(m_inline, rhs.m_inline, sizeof(m_inline));
+        new (&rhs) str();
+    }
+    return *this;
+}
+
+inline str& str::operator= (str_view rhs)
+{
+    // rhs may be part of this string, so copy before letting go.
+    if (rhs.size() <= capacity()) {
+        memmove(data(), rhs.data(), rhs.size());
+        set_size(rhs.size());
+    }
+    else {
+        str copy(rhs);
+        swap(copy);
+    }
+    return *this;
+}
+
+inline const char* str::data() const noexcept
+{
+    return is_inline() ? m_inline : m_heap.data;
+}
+
+inline char* str::data() noexcept
+{
+    return is_inline() ? m_inline : m_heap.data;
+}
+
+inline const char* str::c_str() const noexcept
+{
+    return data();
+}
+
+inline size_t str::size() const noexcept
+{
+    return is_inline() ? inline_capacity - size_t(m_inline[inline_capacity]) : m_heap.size;
+}
+
+inline size_t str::length() const noexcept
+{
+    return size();
+}
+
+inline bool str::empty() const noexcept
+{
+    return size() == 0;
+}
+
+inline size_t str::capacity() const noexcept
+{
+    return is_inline() ? size_t(inline_capacity) : m_heap.capacity & ~heap_flag;
+}
+
+inline bool str::is_inline() const noexcept
+{
+    return !(static_cast<unsigned char>(m_inline[inline_capacity]) & 0x80);
+}
+
+inline char* str::begin() noexcept
+{
+    return data();
+}
+
+inline char* str::end() noexcept
+{
+    return data() + size();
+}
+
+inline const char* str::begin() const noexcept
+{
+    return data();
+}
+
+inline const char* str::end() const noexcept
+{
+    return data() + size();
+}
+
+inline char& str::operator[] (size_t index) noexcept
+{
+    return data()[index];
+}
+
+inline char str::operator[] (size_t index) const noexcept
+{
+    return data()[index];
+}
+
+inline char& str::at(size_t index)
+{
+    if (index >= size())
+        throw std::out_of_range("dtm::str::at");
+    return data()[index];
+}
+
+inline char str::at(size_t index) const
+{
+    if (index >= size())
+        throw std::out_of_range("dtm::str::at");
+    return data()[index];
+}
+
+inline char& str::front() noexcept
+{
+    return data()[0];
+}
+
+inline char str::front() const noexcept
+{
+    return data()[0];
+}
+
+inline char& str::back() noexcept
+{
+    return data()[size() - 1];
+}
+
+inline char str::back() const noexcept
+{
+    return data()[size() - 1];
+}
+
+inline str::operator str_view() const noexcept
+{
+    return view();
+}
+
+inline str_view str::view() const noexcept
+{
+    return is_inline() ? str_view(m_inline, inline_capacity - size_t(m_inline[inline_capacity]))
+                       : str_view(m_heap.data, m_heap.size);
+}
+
+inline void str::reserve(size_t new_capacity)
+{
+    if (new_capacity <= capacity())
+        return;
+    size_t length = size();
+    char* block = allocate(new_capacity);
+    memcpy(block, data(), length + 1);
+    release();
+    m_heap.data = block;
+    m_heap.size = length;
+    m_heap.capacity = new_capacity | heap_flag;
+}
+
+inline void str::clear() noexcept
+{
+    set_size(0);
+}
+
+inline void str::resize(size_t new_size, char c)
+{
+    size_t length = size();
+    if (new_size > length) {
+        if (new_size > capacity())
+            reserve(std::max(new_size, 2 * capacity()));
+        memset(data() + length, c, new_size - length);
+    }
+    set_size(new_size);
+}
+
+inline void str::push_back(char c)
+{
+    append(&c, 1);
+}
+
+inline void str::pop_back() noexcept
+{
+    set_size(size() - 1);
+}
+
+inline void str::swap(str& rhs) noexcept
+{
+    char temp[sizeof(m_inline)];
+    memcpy(temp, m_inline, sizeof(m_inline));
+    memcpy(m_inline, rhs.m_inline, sizeof(m_inline));
+    memcpy(rhs.m_inline, temp, sizeof(m_inline));
+}
+
+inline str& str::append(const char* s, size_t length)
+{
+    size_t old_size = size();
+    if (old_size + length <= capacity()) {
+        memmove(data() + old_size, s, length);
+        set_size(old_size + length);
+        return *this;
+    }
+
+    // Copy s before releasing the old characters, in case it is one of them.
+    size_t new_capacity = std::max(old_size + length, 2 * capacity());
+    char* block = allocate(new_capacity);
+    memcpy(block, data(), old_size);
+    memcpy(block + old_size, s, length);
+    block[old_size + length] = '\0';
+    release();
+    m_heap.data = block;
+    m_heap.size = old_size + length;
+    m_heap.capacity = new_capacity | heap_flag;
+    return *this;
+}
+
+inline str& str::append(str_view s)
+{
+    return append(s.data(), s.size());
+}
+
+inline str& str::operator+= (str_view s)
+{
+    return append(s.data(), s.size());
+}
+
+inline str& str::operator+= (char c)
+{
+    return append(&c, 1);
+}
+
+inline str str::substr(size_t pos, size_t count) const
+{
+    if (pos > size())
+        throw std::out_of_range("dtm::str::substr");
+    return str(view().substr(pos, count));
+}
+
+inline int str::compare(str_view rhs) const noexcept
+{
+    return view().compare(rhs);
+}
+
+inline size_t str::find(str_view needle, size_t pos) const noexcept
+{
+    return view().find(needle, pos);
+}
+
+inline size_t str::find(char c, size_t pos) const noexcept
+{
+    return view().find(c, pos);
+}
+
+inline size_t str::rfind(str_view needle, size_t pos) const noexcept
+{
+    return view().rfind(needle, pos);
+}
+
+inline size_t str::rfind(char c, size_t pos) const noexcept
+{
+    return view().rfind(c, pos);
+}
+
+inline bool str::contains(str_view needle) const noexcept
+{
+    return view().contains(needle);
+}
+
+inline bool str::contains(char c) const noexcept
+{
+    return view().contains(c);
+}
+
+inline bool str::starts_with(str_view prefix) const noexcept
+{
+    return view().starts_with(prefix);
+}
+
+inline bool str::ends_with(str_view suffix) const noexcept
+{
+    return view().ends_with(suffix);
+}
+
+inline void str::init(const char* s, size_t length)
+{
+    if (length <= inline_capacity) {
+        memset(m_inline, 0, sizeof(m_inline));
+        memcpy(m_inline, s, length);
+        m_inline[inline_capacity] = char(inline_capacity - length);
+    }
+    else {
+        m_heap.data = allocate(length);
+        memcpy(m_heap.data, s, length);
+        m_heap.data[length] = '\0';
+        m_heap.size = length;
+        m_heap.capacity = length | heap_flag;
+    }
+}
+
+// Inline characters past the end are kept zero, so the terminator is
+// always there.
+inline void str::set_size(size_t new_size) noexcept
+{
+    if (is_inline()) {
+        size_t old_size = size();
+        if (new_size < old_size)
+            memset(m_inline + new_size, 0, old_size - new_size);
+        m_inline[inline_capacity] = char(inline_capacity - new_size);
+    }
+    else {
+        m_heap.size = new_size;
+        m_heap.data[new_size] = '\0';
+    }
+}
+
+inline void str::release() noexcept
+{
+    if (!is_inline())
+        free(m_heap.data);
+}
+
+inline char* str::allocate(size_t capacity)
+{
+    char* block = static_cast<char*>(malloc(capacity + 1));
+    if (!block)
+        throw std::bad_alloc();
+    return block;
+}
+
+inline bool operator== (str_view lhs, str_view rhs) noexcept
+{
+    return lhs.size() == rhs.size() && memcmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+
+inline bool operator!= (str_view lhs, str_view rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+inline bool operator< (str_view lhs, str_view rhs) noexcept
+{
+    return lhs.compare(rhs) < 0;
+}
+
+inline bool operator> (str_view lhs, str_view rhs) noexcept
+{
+    return lhs.compare(rhs) > 0;
+}
+
+inline bool operator<= (str_view lhs, str_view rhs) noexcept
+{
+    return lhs.compare(rhs) <= 0;
+}
+
+inline bool operator>= (str_view lhs, str_view rhs) noexcept
+{
+    return lhs.compare(rhs) >= 0;
+}
+
+inline str operator+ (str_view lhs, str_view rhs)
+{
+    str result;
+    result.reserve(lhs.size() + rhs.size());
+    result.append(lhs);
+    result.append(rhs);
+    return result;
+}
+
+inline std::ostream& operator<< (std::ostream& out, str_view s)
+{
+    return out.write(s.data(), s.size());
+}
+
+}
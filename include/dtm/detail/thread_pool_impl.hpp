@@ -0,0 +1,490 @@
+// details/thread_pool_impl.hpp
+//
+
+#ifndef INCLUDING_DATUM_DETAIL_THREAD_POOL_IMPL_HPP
+#error "Don't include or compile datum/detail/thread_pool_impl.hpp directly."
+#endif
+
+namespace dtm {
+
+namespace detail {
+
+inline work_deque::ring::ring(int64_t capacity)
+    : capacity(capacity), slots(new std::atomic<pool_task*>[size_t(capacity)])
+{}
+
+inline work_deque::ring::~ring()
+{
+    delete[] slots;
+}
+
+inline pool_task* work_deque::ring::get(int64_t index) const noexcept
+{
+    return slots[index & (capacity - 1)].load(std::memory_order_relaxed);
+}
+
+inline void work_deque::ring::put(int64_t index, pool_task* task) noexcept
+{
+    slots[index & (capacity - 1)].store(task, std::memory_order_relaxed);
+}
+
+inline work_deque::work_deque()
+    : m_top(0), m_bottom(0), m_ring(new ring(64))
+{}
+
+inline work_deque::~work_deque()
+{
+    delete m_ring.load(std::memory_order_relaxed);
+    for (ring* r : m_retired)
+        delete r;
+}
+
+inline void work_deque::push(pool_task* task)
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    int64_t top = m_top.load(std::memory_order_acquire);
+    ring* r = m_ring.load(std::memory_order_relaxed);
+    if (bottom - top > r->capacity - 1)
+        r = grow(r, top, bottom);
+    r->put(bottom, task);
+    // A release store rather than Le et al.'s release fence and relaxed
+    // store; the same instructions, and visible to race detectors.
+    m_bottom.store(bottom + 1, std::memory_order_release);
+}
+
+inline pool_task* work_deque::pop() noexcept
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    ring* r = m_ring.load(std::memory_order_relaxed);
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    pool_task* task = r->get(bottom);
+    if (top == bottom) {
+        // The last task; race the thieves for it.
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            task = nullptr;
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+inline pool_task* work_deque::steal() noexcept
+{
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = m_bottom.load(std::memory_order_acquire);
+    if (top >= bottom)
+        return nullptr;
+
+    ring* r = m_ring.load(std::memory_order_acquire);
+    pool_task* task = r->get(top);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return task;
+}
+
+inline bool work_deque::empty() const noexcept
+{
+    int64_t top = m_top.load(std::memory_order_relaxed);
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    return top >= bottom;
+}
+
+inline work_deque::ring* work_deque::grow(ring* old, int64_t top, int64_t bottom)
+{
+    ring* r = new ring(old->capacity * 2);
+    for (int64_t i = top; i < bottom; i++)
+        r->put(i, old->get(i));
+    m_retired.push_back(old);
+    m_ring.store(r, std::memory_order_release);
+    return r;
+}
+
+template <typename Fn>
+struct pool_closure : pool_task {
+    Fn& fn;
+    std::exception_ptr error;
+
+    explicit pool_closure(Fn& fn) noexcept
+        : pool_task(&execute_closure), fn(fn)
+    {}
+
+    static void execute_closure(pool_task* task) {
+        pool_closure* self = static_cast<pool_closure*>(task);
+        try {
+            self->fn();
+        } catch (...) {
+            self->error = std::current_exception();
+        }
+        self->done.store(true, std::memory_order_release);
+    }
+};
+
+// A task from a thread outside the pool, which blocks rather than helps
+// while it waits.
+template <typename Fn>
+struct pool_external_closure : pool_task {
+    Fn& fn;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    explicit pool_external_closure(Fn& fn) noexcept
+        : pool_task(&execute_closure), fn(fn)
+    {}
+
+    static void execute_closure(pool_task* task) {
+        pool_external_closure* self = static_cast<pool_external_closure*>(task);
+        try {
+            self->fn();
+        } catch (...) {
+            self->error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->done.store(true, std::memory_order_release);
+        self->finished.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!done.load(std::memory_order_acquire))
+            finished.wait(lock);
+    }
+};
+
+}
+
+inline thread_pool::thread_pool(size_t threads)
+    : m_workers(nullptr), m_size(0), m_injected_count(0), m_epoch(0), m_sleepers(0), m_stopping(false)
+{
+    if (threads == 0)
+        threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    // Workers hold over-aligned deques, which new only aligns from C++17.
+    m_workers = static_cast<detail::pool_worker*>(
+        detail::aligned_allocate(alignof(detail::pool_worker), threads * sizeof(detail::pool_worker)));
+    for (size_t i = 0; i < threads; i++) {
+        detail::pool_worker* worker = new (&m_workers[i]) detail::pool_worker();
+        worker->pool = this;
+        worker->index = i;
+        worker->rng = 0x9e3779b97f4a7c15ull * (i + 1);
+    }
+    m_size = threads;
+
+    size_t started = 0;
+    try {
+        for (; started < threads; started++)
+            m_workers[started].thread = std::thread([this, started] { worker_main(m_workers[started]); });
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+            m_stopping.store(true);
+        }
+        m_sleep_cv.notify_all();
+        for (size_t i = 0; i < started; i++)
+            m_workers[i].thread.join();
+        for (size_t i = 0; i < threads; i++)
+            m_workers[i].~pool_worker();
+        detail::aligned_free(m_workers);
+        throw;
+    }
+}
+
+inline thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stopping.store(true);
+        m_epoch.fetch_add(1);
+    }
+    m_sleep_cv.notify_all();
+
+    for (size_t i = 0; i < m_size; i++)
+        m_workers[i].thread.join();
+    for (size_t i = 0; i < m_size; i++)
+        m_workers[i].~pool_worker();
+    detail::aligned_free(m_workers);
+}
+
+inline size_t thread_pool::size() const noexcept
+{
+    return m_size;
+}
+
+inline size_t thread_pool::this_worker_index() const noexcept
+{
+    detail::pool_worker* worker = current_worker();
+    return worker ? worker->index : npos;
+}
+
+template <typename Fn>
+void thread_pool::run(Fn&& fn)
+{
+    if (current_worker()) {
+        fn();
+        return;
+    }
+
+    using fn_type = typename std::remove_reference<Fn>::type;
+    detail::pool_external_closure<fn_type> task(fn);
+    inject(&task);
+    task.wait();
+    if (task.error)
+        std::rethrow_exception(task.error);
+}
+
+template <typename F, typename G>
+void thread_pool::invoke(F&& f, G&& g)
+{
+    detail::pool_worker* self = current_worker();
+    if (!self) {
+        run([&] { invoke(f, g); });
+        return;
+    }
+
+    using g_type = typename std::remove_reference<G>::type;
+    detail::pool_closure<g_type> right(g);
+    self->deque.push(&right);
+    wake_one();
+
+    std::exception_ptr error;
+    try {
+        f();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    // Everything f forked has been joined, so right is on top unless it
+    // was stolen.
+    if (self->deque.pop() == &right)
+        right.execute(&right);
+    else
+        wait_for(right, *self);
+
+    if (error)
+        std::rethrow_exception(error);
+    if (right.error)
+        std::rethrow_exception(right.error);
+}
+
+template <typename Fn>
+void thread_pool::parallel_for_chunks(size_t begin, size_t end, Fn&& fn, size_t grain)
+{
+    if (begin >= end)
+        return;
+    if (grain == 0)
+        grain = auto_grain(end - begin);
+    if (end - begin <= grain) {
+        fn(begin, end);
+        return;
+    }
+    run([&] { split(begin, end, grain, fn); });
+}
+
+template <typename Fn>
+void thread_pool::parallel_for(size_t begin, size_t end, Fn&& fn, size_t grain)
+{
+    parallel_for_chunks(begin, end, [&](size_t chunk_begin, size_t chunk_end) {
+        for (size_t i = chunk_begin; i < chunk_end; i++)
+            fn(i);
+    }, grain);
+}
+
+inline detail::pool_worker* thread_pool::current_worker() const noexcept
+{
+    detail::pool_worker* worker = detail::current_pool_worker();
+    return worker && worker->pool == this ? worker : nullptr;
+}
+
+inline size_t thread_pool::auto_grain(size_t count) const noexcept
+{
+    // Enough chunks that a worker that falls behind leaves the others
+    // something to steal, few enough that forking stays cheap.
+    size_t chunks = m_size == 1 ? 1 : 8 * m_size;
+    return std::max<size_t>(1, (count + chunks - 1) / chunks);
+}
+
+template <typename Fn>
+void thread_pool::split(size_t begin, size_t end, size_t grain, Fn& fn)
+{
+    if (end - begin <= grain) {
+        fn(begin, end);
+        return;
+    }
+    size_t middle = begin + (end - begin) / 2;
+    invoke([&] { split(begin, middle, grain, fn); },
+           [&] { split(middle, end, grain, fn); });
+}
+
+inline void thread_pool::worker_main(detail::pool_worker& self)
+{
+    detail::current_pool_worker() = &self;
+
+    size_t idle = 0;
+    while (!m_stopping.load(std::memory_order_acquire)) {
+        detail::pool_task* task = self.deque.pop();
+        if (!task)
+            task = steal(self);
+        if (!task)
+            task = take_injected();
+
+        if (task) {
+            task->execute(task);
+            idle = 0;
+        } else if (++idle < idle_sweeps) {
+            std::this_thread::yield();
+        } else {
+            sleep();
+            idle = 0;
+        }
+    }
+
+    detail::current_pool_worker() = nullptr;
+}
+
+inline detail::pool_task* thread_pool::steal(detail::pool_worker& self) noexcept
+{
+    if (m_size == 1)
+        return nullptr;
+
+    // xorshift64
+    self.rng ^= self.rng << 13;
+    self.rng ^= self.rng >> 7;
+    self.rng ^= self.rng << 17;
+
+    size_t victim = size_t(self.rng % m_size);
+    for (size_t i = 0; i < m_size; i++, victim = victim + 1 == m_size ? 0 : victim + 1) {
+        if (victim == self.index)
+            continue;
+        if (detail::pool_task* task = m_workers[victim].deque.steal())
+            return task;
+    }
+    return nullptr;
+}
+
+inline detail::pool_task* thread_pool::take_injected()
+{
+    if (m_injected_count.load(std::memory_order_acquire) == 0)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(m_inject_mutex);
+    if (m_injected.empty())
+        return nullptr;
+    detail::pool_task* task = m_injected.front();
+    m_injected.pop_front();
+    m_injected_count.fetch_sub(1, std::memory_order_relaxed);
+    return task;
+}
+
+inline bool thread_pool::has_work() const noexcept
+{
+    if (m_injected_count.load(std::memory_order_relaxed) != 0)
+        return true;
+    for (size_t i = 0; i < m_size; i++) {
+        if (!m_workers[i].deque.empty())
+            return true;
+    }
+    return false;
+}
+
+inline void thread_pool::sleep()
+{
+    // Announce the sleeper before the last look for work. A thread that
+    // publishes work then checks for sleepers, so either it sees us and
+    // bumps the epoch, or we see its work. That takes a fence on both
+    // sides: the seq_cst increment alone doesn't keep the relaxed loads in
+    // has_work() from moving above it, and wake_one() fences between the
+    // push and its load of m_sleepers.
+    uint64_t epoch = m_epoch.load(std::memory_order_acquire);
+    m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!has_work()) {
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        while (m_epoch.load(std::memory_order_relaxed) == epoch && !m_stopping.load(std::memory_order_relaxed))
+            m_sleep_cv.wait(lock);
+    }
+    m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline void thread_pool::wake_one()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleepers.load(std::memory_order_relaxed) == 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_epoch.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_sleep_cv.notify_one();
+}
+
+inline void thread_pool::inject(detail::pool_task* task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_inject_mutex);
+        m_injected.push_back(task);
+        m_injected_count.fetch_add(1, std::memory_order_release);
+    }
+    wake_one();
+}
+
+inline void thread_pool::wait_for(detail::pool_task& task, detail::pool_worker& self)
+{
+    // The thief will finish task; help with whatever else is around until
+    // it does.
+    while (!task.done.load(std::memory_order_acquire)) {
+        if (detail::pool_task* other = steal(self))
+            other->execute(other);
+        else
+            std::this_thread::yield();
+    }
+}
+
+inline thread_pool& default_thread_pool()
+{
+    static thread_pool pool;
+    return pool;
+}
+
+namespace detail {
+
+template <typename F>
+void pool_invoke_all(thread_pool&, F& f)
+{
+    f();
+}
+
+template <typename F, typename G, typename... Rest>
+void pool_invoke_all(thread_pool& pool, F& f, G& g, Rest&... rest)
+{
+    pool.invoke(f, [&] { pool_invoke_all(pool, g, rest...); });
+}
+
+}
+
+template <typename F, typename G, typename... Rest>
+void parallel_invoke(F&& f, G&& g, Rest&&... rest)
+{
+    detail::pool_invoke_all(default_thread_pool(), f, g, rest...);
+}
+
+template <typename Fn>
+void parallel_for_chunks(size_t begin, size_t end, Fn&& fn, size_t grain)
+{
+    default_thread_pool().parallel_for_chunks(begin, end, std::forward<Fn>(fn), grain);
+}
+
+template <typename Fn>
+void parallel_for(size_t begin, size_t end, Fn&& fn, size_t grain)
+{
+    default_thread_pool().parallel_for(begin, end, std::forward<Fn>(fn), grain);
+}
+
+}
@@ -112,6 +112,10 @@ vec<T>::vec(T* local_store, size_t local_store_capacity, It begin, It end)
 template <typename T>
 vec<T>::~vec()
 {
+    // Elements in a small_vec's local storage belong to its array, which
+    // destroys them itself.
+    if (!m_local_storage)
+        clear();
     release();
 }
 
@@ -228,6 +232,18 @@ const T& vec<T>::at(size_t index) const
     return m_begin[index];
 }
 
+template <typename T>
+T* vec<T>::data() noexcept
+{
+    return m_begin;
+}
+
+template <typename T>
+const T* vec<T>::data() const noexcept
+{
+    return m_begin;
+}
+
 template <typename T>
 void vec<T>::swap(vec& rhs) noexcept
 {
@@ -288,7 +304,7 @@ void vec<T>::reserve_internal(size_t new_capacity, std::true_type)
 {   // Relocatable
     size_t old_size = size();
     if (old_size > 0) {
-        T* new_block = reinterpret_cast<T*>(realloc(m_begin, sizeof(T) * new_capacity));
+        T* new_block = reinterpret_cast<T*>(realloc(static_cast<void*>(m_begin), sizeof(T) * new_capacity));
         if (!new_block)
             throw std::bad_alloc();
         m_begin = new_block;
@@ -342,6 +358,21 @@ void vec<T>::resize(size_t new_size, Args&&... args)
     }
 }
 
+template <typename T>
+void vec<T>::resize_for_overwrite(size_t new_size)
+{
+    if (new_size > size()) {
+        reserve(new_size);
+        T* old_end = m_end;
+        m_end = m_begin + new_size;
+        for (T* ptr = old_end; ptr != m_end; ++ptr)
+            new(ptr) T;
+    }
+    else {
+        resize(new_size);
+    }
+}
+
 template <typename T>
 void vec<T>::assign(const vec<T>& rhs)
 {
@@ -536,17 +567,12 @@ tup<T*, bool> vec<T>::create_space(const_iterator pos, size_t length, std::true_
     std::ptrdiff_t old_size = size();
     std::ptrdiff_t offset = pos.p - m_begin;
 
-    if (old_size + length > m_capacity) {
-        size_t new_capacity = old_size + length;
-        T* new_block = reinterpret_cast<T*>(realloc(m_begin, sizeof(T) * new_capacity));
-        if (!new_block)
-            throw std::bad_alloc();
-        m_begin = new_block;
-        m_capacity = new_capacity;
-    }
+    // Through reserve, so that the first block of an empty vec is owned and
+    // released like any other.
+    reserve(old_size + length);
 
     m_end = m_begin + old_size + length;
-    memmove(m_begin + offset + length, m_begin + offset, sizeof(T) * (old_size - offset));
+    memmove(static_cast<void*>(m_begin + offset + length), static_cast<const void*>(m_begin + offset), sizeof(T) * (old_size - offset));
 
     // Returning not constructed her may seem weird, since we just memmoved values out of this
     // location. But conceptually we have now relocated the original value and the residual
@@ -0,0 +1,331 @@
+// flat_map.hpp
+//
+// Sorted associative containers stored in flat columns.
+//
+// flat_set keeps its keys in one dtm::vec; flat_map keeps keys and values
+// in two, so a lookup only streams through keys. They are built in bulk by
+// sorting and dropping duplicates, and are meant for read-mostly data:
+// single inserts and erases are O(n).
+//
+// The Layout parameter selects how keys are searched:
+//
+//   sorted_layout     Keys in ascending order, branchless binary search.
+//                     Supports insert and erase.
+//
+//   eytzinger_layout  Keys in the BFS order of an implicit binary search
+//                     tree. The top levels of the tree share a few cache
+//                     lines and the search prefetches the descendants it
+//                     is about to visit, so large frozen sets take far
+//                     fewer cache misses per lookup. Read only once built.
+//
+// Both layouts iterate in ascending key order.
+//
+
+#ifndef INCLUDED_DATUM_FLAT_MAP_HPP
+#define INCLUDED_DATUM_FLAT_MAP_HPP
+
+#include <utility>
+#include <type_traits>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <stdexcept>
+#include <cstddef>
+
+#include "dtm/vec.hpp"
+#include "dtm/iterator.hpp"
+
+#include "dtm/detail/iterators.hpp"
+
+namespace dtm {
+
+struct sorted_layout {
+    static constexpr bool is_mutable = true;
+
+    static size_t first(size_t) noexcept { return 0; }
+    static size_t next(size_t index, size_t) noexcept { return index + 1; }
+
+    // Index of the first key not less than key, or n.
+    template <typename Key, typename Compare>
+    static size_t lower_bound(const Key* keys, size_t n, const Key& key, const Compare& comp) {
+        if (n == 0)
+            return 0;
+
+        // Halve the range without branching on the comparison; compilers
+        // turn the select into a conditional move.
+        const Key* base = keys;
+        while (n > 1) {
+            size_t half = n / 2;
+            base = comp(base[half - 1], key) ? base + half : base;
+            n -= half;
+        }
+        return (base - keys) + comp(*base, key);
+    }
+
+    // Turn a list of sorted ranks into storage order.
+    static void arrange(vec<size_t>&) {}
+};
+
+struct eytzinger_layout {
+    static constexpr bool is_mutable = false;
+
+    // The tree uses 1-based node numbers j internally, where the children of
+    // j are 2j and 2j + 1 and node j is stored at index j - 1.
+
+    static size_t first(size_t n) noexcept {
+        if (n == 0)
+            return 0;
+        size_t j = 1;
+        while (2 * j <= n)
+            j *= 2;
+        return j - 1;
+    }
+
+    static size_t next(size_t index, size_t n) noexcept {
+        size_t j = index + 1;
+        if (2 * j + 1 <= n) {
+            // Leftmost node of the right subtree.
+            j = 2 * j + 1;
+            while (2 * j <= n)
+                j *= 2;
+        }
+        else {
+            // Climb while we are a right child, then once more.
+            j >>= __builtin_ctzll(~static_cast<unsigned long long>(j)) + 1;
+        }
+        return j == 0 ? n : j - 1;
+    }
+
+    template <typename Key, typename Compare>
+    static size_t lower_bound(const Key* keys, size_t n, const Key& key, const Compare& comp) {
+        // Number of consecutive nodes per cache line. The descendants of
+        // node j this many levels down start at node j * stride.
+        constexpr size_t stride = sizeof(Key) < 64 ? 64 / sizeof(Key) : 1;
+
+        size_t j = 1;
+        while (j <= n) {
+            if (stride > 1 && j * stride <= n)
+                __builtin_prefetch(keys + j * stride - 1);
+            j = 2 * j + comp(keys[j - 1], key);
+        }
+
+        // Each bit of j below the leading one is a turn taken, 1 for right.
+        // The answer is the last node where we went left, so drop the
+        // trailing right turns and that left turn.
+        j >>= __builtin_ffsll(~static_cast<unsigned long long>(j));
+        return j == 0 ? n : j - 1;
+    }
+
+    static void arrange(vec<size_t>& order) {
+        size_t n = order.size();
+        vec<size_t> tree;
+        tree.resize_for_overwrite(n);
+
+        size_t rank = 0;
+        for (size_t index = first(n); index != n; index = next(index, n))
+            tree[index] = order[rank++];
+        order = std::move(tree);
+    }
+};
+
+namespace detail {
+
+// Storage order for a bulk build: sort, keep the first of each run of equal
+// keys, then let the layout permute the survivors.
+template <typename Layout, typename Key, typename Compare>
+vec<size_t> flat_build_order(const vec<Key>& keys, const Compare& comp);
+
+template <typename T>
+vec<T> flat_gather(vec<T>& src, const vec<size_t>& order);
+
+// Iterates a flat container's storage in key order. Accessor turns a storage
+// index into the element.
+template <typename Layout, typename Accessor>
+class flat_iterator {
+public:
+    using reference = decltype(std::declval<const Accessor&>()(size_t()));
+    using value_type = typename std::decay<reference>::type;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    struct pointer {
+        reference ref;
+        typename std::remove_reference<reference>::type* operator-> () { return &ref; }
+    };
+
+    flat_iterator(const Accessor& accessor, size_t index, size_t size) noexcept
+        : m_accessor(accessor), m_index(index), m_size(size) {}
+
+    flat_iterator& operator ++ () noexcept { m_index = Layout::next(m_index, m_size); return *this; }
+    flat_iterator operator ++ (int) noexcept { flat_iterator prev = *this; ++*this; return prev; }
+
+    bool operator == (const flat_iterator& rhs) const noexcept { return m_index == rhs.m_index; }
+    bool operator != (const flat_iterator& rhs) const noexcept { return m_index != rhs.m_index; }
+
+    reference operator* () const noexcept { return m_accessor(m_index); }
+    pointer operator-> () const noexcept { return pointer{ m_accessor(m_index) }; }
+
+    // Position in storage order, e.g. for indexing keys() and values().
+    size_t index() const noexcept { return m_index; }
+
+private:
+    Accessor m_accessor;
+    size_t m_index;
+    size_t m_size;
+};
+
+template <typename Key>
+struct flat_set_accessor {
+    const Key* keys;
+    const Key& operator() (size_t index) const noexcept { return keys[index]; }
+};
+
+}
+
+template <typename Key, typename Compare = std::less<Key>, typename Layout = sorted_layout>
+class flat_set {
+public:
+    using key_type = Key;
+    using value_type = Key;
+    using const_iterator = detail::flat_iterator<Layout, detail::flat_set_accessor<Key>>;
+    using iterator = const_iterator;
+
+    flat_set() = default;
+
+    explicit flat_set(vec<Key> keys, const Compare& comp = Compare());
+    flat_set(std::initializer_list<Key> init, const Compare& comp = Compare());
+
+    template <typename It, typename = detail::require_input_iterator<It>>
+    flat_set(It begin, It end, const Compare& comp = Compare());
+
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    // The keys in storage order.
+    span<const Key> keys() const noexcept;
+
+    const_iterator lower_bound(const Key& key) const;
+    const_iterator find(const Key& key) const;
+
+    bool contains(const Key& key) const;
+    size_t count(const Key& key) const;
+
+    // sorted_layout only.
+    bool insert(const Key& key);
+
+    // sorted_layout only. Returns the number of keys removed.
+    size_t erase(const Key& key);
+
+    void clear();
+
+private:
+    vec<Key> m_keys;
+    Compare m_comp;
+
+    const_iterator make_iterator(size_t index) const noexcept;
+    size_t find_index(const Key& key) const;
+};
+
+template <typename Key, typename Value>
+struct flat_map_ref {
+    const Key& key;
+    Value& value;
+};
+
+namespace detail {
+
+template <typename Key, typename Value>
+struct flat_map_accessor {
+    const Key* keys;
+    Value* values;
+    flat_map_ref<Key, Value> operator() (size_t index) const noexcept {
+        return flat_map_ref<Key, Value>{ keys[index], values[index] };
+    }
+};
+
+}
+
+template <typename Key, typename Value, typename Compare = std::less<Key>, typename Layout = sorted_layout>
+class flat_map {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using iterator = detail::flat_iterator<Layout, detail::flat_map_accessor<Key, Value>>;
+    using const_iterator = detail::flat_iterator<Layout, detail::flat_map_accessor<Key, const Value>>;
+
+    flat_map() = default;
+
+    // Build from parallel key and value columns. When a key appears more
+    // than once the first occurrence wins.
+    flat_map(vec<Key> keys, vec<Value> values, const Compare& comp = Compare());
+
+    // Build from a range of pairs.
+    template <typename It, typename = detail::require_input_iterator<It>>
+    flat_map(It begin, It end, const Compare& comp = Compare());
+
+    flat_map(std::initializer_list<std::pair<Key, Value>> init, const Compare& comp = Compare());
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    // The columns in storage order.
+    span<const Key> keys() const noexcept;
+    span<const Value> values() const noexcept;
+    span<Value> values() noexcept;
+
+    iterator lower_bound(const Key& key);
+    const_iterator lower_bound(const Key& key) const;
+
+    iterator find(const Key& key);
+    const_iterator find(const Key& key) const;
+
+    bool contains(const Key& key) const;
+    size_t count(const Key& key) const;
+
+    Value& at(const Key& key);
+    const Value& at(const Key& key) const;
+
+    // sorted_layout only.
+    std::pair<iterator, bool> insert(const Key& key, const Value& value);
+
+    // sorted_layout only.
+    Value& operator[] (const Key& key);
+
+    // sorted_layout only. Returns the number of entries removed.
+    size_t erase(const Key& key);
+
+    void clear();
+
+private:
+    vec<Key> m_keys;
+    vec<Value> m_values;
+    Compare m_comp;
+
+    flat_map(std::pair<vec<Key>, vec<Value>>&& columns, const Compare& comp);
+
+    template <typename It>
+    static std::pair<vec<Key>, vec<Value>> split(It begin, It end);
+
+    iterator make_iterator(size_t index) noexcept;
+    const_iterator make_iterator(size_t index) const noexcept;
+
+    size_t find_index(const Key& key) const;
+};
+
+}
+
+// Implementation of flat_set and flat_map is in detail/flat_map_impl.hpp
+#define INCLUDING_DATUM_DETAIL_FLAT_MAP_IMPL_HPP
+#include "detail/flat_map_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_FLAT_MAP_IMPL_HPP
+
+#endif //INCLUDED_DATUM_FLAT_MAP_HPP
@@ -0,0 +1,121 @@
+// hash.hpp
+//
+// Hash functions used by datum's hashed containers.
+//
+// std::hash is the identity for integers on most standard libraries, which
+// is a poor fit for tables that index by the high bits of the hash. Every
+// dtm::hash therefore finishes with a full 64 bit mix. The results are
+// deterministic across processes, so hashed containers can be serialized.
+//
+
+#ifndef INCLUDED_DATUM_HASH_HPP
+#define INCLUDED_DATUM_HASH_HPP
+
+#include <string>
+#include <functional>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "dtm/detail/config.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+// Finalizer of splitmix64. Every input bit affects every output bit.
+inline uint64_t hash_mix(uint64_t x) noexcept {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// Multiply and fold the 128 bit product.
+inline uint64_t hash_fold(uint64_t a, uint64_t b) noexcept {
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+inline uint64_t hash_read64(const unsigned char* p) noexcept {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Hash an arbitrary byte string, eight bytes at a time.
+inline uint64_t hash_bytes(const void* data, size_t length, uint64_t seed = 0) noexcept {
+    const uint64_t k0 = 0xa0761d6478bd642full;
+    const uint64_t k1 = 0xe7037ed1a0b428dbull;
+    const uint64_t k2 = 0x8ebc6af09c88c6e3ull;
+
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    uint64_t h = seed ^ k0;
+    size_t remaining = length;
+
+    while (remaining >= 16) {
+        h = hash_fold(hash_read64(p) ^ k1, hash_read64(p + 8) ^ h);
+        p += 16;
+        remaining -= 16;
+    }
+
+    uint64_t a = 0;
+    uint64_t b = 0;
+    if (remaining >= 8) {
+        a = hash_read64(p);
+        memcpy(&b, p + 8, remaining - 8);
+    }
+    else {
+        memcpy(&a, p, remaining);
+    }
+
+    h = hash_fold(a ^ k1, b ^ h);
+    return hash_fold(h ^ k2, static_cast<uint64_t>(length) ^ k1);
+}
+
+}
+
+template <typename T, typename = void>
+struct hash {
+    size_t operator() (const T& val) const noexcept {
+        return detail::hash_mix(std::hash<T>()(val));
+    }
+};
+
+template <typename T>
+struct hash<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type> {
+    size_t operator() (T val) const noexcept {
+        return detail::hash_mix(static_cast<uint64_t>(val));
+    }
+};
+
+template <typename T>
+struct hash<T*> {
+    size_t operator() (T* val) const noexcept {
+        return detail::hash_mix(reinterpret_cast<uintptr_t>(val));
+    }
+};
+
+template <typename T>
+struct hash<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    size_t operator() (T val) const noexcept {
+        // 0.0 and -0.0 compare equal, so they must hash equal.
+        if (val == 0)
+            val = 0;
+        return detail::hash_bytes(&val, sizeof(val));
+    }
+};
+
+template <>
+struct hash<std::string> {
+    size_t operator() (const std::string& val) const noexcept {
+        return detail::hash_bytes(val.data(), val.size());
+    }
+};
+
+}
+
+#endif //INCLUDED_DATUM_HASH_HPP
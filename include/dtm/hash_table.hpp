@@ -1,19 +1,187 @@
 // hash_table.hpp
 //
+// A flat, open addressing hash table.
+//
+// Entries live in one array and a parallel array of control bytes records
+// which slots are empty, erased or full. A full slot's control byte holds
+// seven bits of the key's hash, so most mismatches are rejected without
+// touching the entry. Slots are indexed by the high bits of the hash and
+// collisions are resolved by linear probing.
+//
+// Entries of slots that aren't full are kept zeroed, so that a snapshot
+// (see serialize.hpp) can write both arrays as they are.
+//
+
+#ifndef INCLUDED_DATUM_HASH_TABLE_HPP
+#define INCLUDED_DATUM_HASH_TABLE_HPP
+
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "dtm/vec.hpp"
+#include "dtm/hash.hpp"
 
-#include <vec.hpp>
+#include "dtm/detail/config.hpp"
 
-namespace dtm
-{
-    struct empty_t {};
+namespace dtm {
 
-    template <typename Key, typename Value = empty_t{}>
-    class hash_table
-    {
-    public:
-        hash_table()
+struct empty_t {};
 
-    private:
-        vec<
+namespace detail {
+    struct serializer;
+    struct parallel_builder;
+}
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+class hash_table_view;
+
+template <typename Key, typename Value = empty_t, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class hash_table {
+    template <bool> class iterator_base;
+
+public:
+    struct entry {
+        Key key;
+        Value value;
     };
-}
\ No newline at end of file
+
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = entry;
+
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+
+    hash_table();
+    explicit hash_table(size_t capacity);
+
+    hash_table(const hash_table& rhs);
+    hash_table(hash_table&& rhs) noexcept;
+
+    ~hash_table();
+
+    hash_table& operator= (const hash_table& rhs);
+    hash_table& operator= (hash_table&& rhs) noexcept;
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+    const_iterator cbegin() const noexcept;
+    const_iterator cend() const noexcept;
+
+    void swap(hash_table& rhs) noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    size_t capacity() const noexcept;
+
+    // Make room for at least count entries without rehashing.
+    void reserve(size_t count);
+
+    void clear();
+
+    // Inserts key -> Value(args...) unless key is already present. Returns
+    // the entry for key and whether it was inserted.
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(const Key& key, Args&&... args);
+
+    std::pair<iterator, bool> insert(const Key& key);
+    std::pair<iterator, bool> insert(const Key& key, const Value& value);
+    std::pair<iterator, bool> insert(const Key& key, Value&& value);
+
+    Value& operator[] (const Key& key);
+
+    iterator find(const Key& key) noexcept;
+    const_iterator find(const Key& key) const noexcept;
+
+    bool contains(const Key& key) const noexcept;
+
+    // Returns the number of entries removed.
+    size_t erase(const Key& key);
+
+    const Hash& hash_function() const noexcept;
+
+private:
+    friend struct detail::serializer;
+    friend struct detail::parallel_builder;
+    friend class hash_table_view<Key, Value, Hash, KeyEqual>;
+
+    static constexpr uint8_t control_empty = 0;
+    static constexpr uint8_t control_erased = 1;
+    static constexpr uint8_t control_full = 0x80;
+    static constexpr size_t min_capacity = 8;
+
+    uint8_t* m_control;
+    // Zeroed where the slot isn't full.
+    entry* m_entries;
+    size_t m_capacity;
+    size_t m_size;
+    size_t m_erased;
+    unsigned m_shift;
+    Hash m_hash;
+    KeyEqual m_equal;
+
+    static bool is_full(uint8_t control) noexcept;
+    static uint8_t control_for(size_t hash) noexcept;
+
+    size_t home_slot(size_t hash) const noexcept;
+    size_t find_slot(const Key& key, size_t hash) const noexcept;
+    size_t find_insert_slot(size_t hash) const noexcept;
+    size_t next_full(size_t slot) const noexcept;
+
+    void allocate(size_t capacity);
+    void release() noexcept;
+    void rehash(size_t new_capacity);
+    void grow_if_necessary();
+};
+
+template <typename Key, typename Value, typename Hash, typename KeyEqual>
+template <bool IsConst>
+class hash_table<Key, Value, Hash, KeyEqual>::iterator_base {
+    friend class hash_table;
+    using table_pointer = typename std::conditional<IsConst, const hash_table*, hash_table*>::type;
+
+public:
+    using value_type = entry;
+    using difference_type = std::ptrdiff_t;
+    using reference = typename std::conditional<IsConst, const entry&, entry&>::type;
+    using pointer = typename std::conditional<IsConst, const entry*, entry*>::type;
+    using iterator_category = std::forward_iterator_tag;
+
+    iterator_base(table_pointer table, size_t slot) noexcept
+        : m_table(table), m_slot(slot) {}
+
+    // iterator converts to const_iterator
+    operator iterator_base<true>() const noexcept { return iterator_base<true>(m_table, m_slot); }
+
+    iterator_base& operator ++ () noexcept { m_slot = m_table->next_full(m_slot + 1); return *this; }
+    iterator_base operator ++ (int) noexcept { iterator_base prev = *this; ++*this; return prev; }
+
+    bool operator == (const iterator_base& rhs) const noexcept { return m_slot == rhs.m_slot; }
+    bool operator != (const iterator_base& rhs) const noexcept { return m_slot != rhs.m_slot; }
+
+    reference operator* () const noexcept { return m_table->m_entries[m_slot]; }
+    pointer operator-> () const noexcept { return &m_table->m_entries[m_slot]; }
+
+private:
+    table_pointer m_table;
+    size_t m_slot;
+};
+
+}
+
+// Implementation of hash_table is in detail/hash_table_impl.hpp
+#define INCLUDING_DATUM_DETAIL_HASH_TABLE_IMPL_HPP
+#include "detail/hash_table_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_HASH_TABLE_IMPL_HPP
+
+#endif //INCLUDED_DATUM_HASH_TABLE_HPP
@@ -0,0 +1,151 @@
+// heap.hpp
+//
+// A priority queue kept as a d-ary heap in a vec.
+//
+//     dtm::heap<int> queue = {3, 1, 4};
+//     queue.push(5);
+//     queue.top();            // 5
+//     queue.pop_push(2);      // replaces 5 with 2 in one sift: 4 is next
+//
+// Each node has D children, stored next to each other, so the heap is
+// log_D(n) levels deep and each level down reads one run of D elements.
+// With D = 4 or 8 and small elements that run is one cache line, and a
+// big queue takes half or a third of the cache misses of the binary heap
+// in std::priority_queue. Pushes compare against fewer parents, too; pops
+// pay D - 1 compares a level for fewer levels.
+//
+// Like std::priority_queue the top is the greatest element under Compare,
+// so std::greater makes a min heap.
+//
+// Index is for changing the keys of queued elements, as in Dijkstra's
+// decrease-key. Whenever the heap puts an element at a position it calls
+// index(element, position), and index(element, heap::npos) when the
+// element leaves, so the caller can keep a map from its elements to
+// positions. After changing an element's key, update(position) moves it
+// to its new place:
+//
+//     struct track {
+//         dtm::vec<size_t>* where;
+//         void operator() (const entry& e, size_t position) const { (*where)[e.id] = position; }
+//     };
+//     dtm::heap<entry, 4, by_distance, track> queue(by_distance(), track{&where});
+//     queue.update(where[id], entry{id, shorter});
+//
+// The default Index keeps nothing and costs nothing.
+//
+
+#ifndef INCLUDED_DATUM_HEAP_HPP
+#define INCLUDED_DATUM_HEAP_HPP
+
+#include <functional>
+#include <initializer_list>
+#include <utility>
+#include <cstddef>
+
+#include "dtm/vec.hpp"
+#include "dtm/detail/iterators.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+// The default heap Index, which keeps no positions.
+struct heap_no_index {
+    template <typename T>
+    void operator() (const T&, size_t) const noexcept {}
+};
+
+}
+
+template <typename T, size_t D = 4, typename Compare = std::less<T>, typename Index = detail::heap_no_index>
+class heap {
+    static_assert(D >= 2, "dtm::heap needs at least two children a node");
+
+public:
+    using value_type = T;
+    using const_iterator = const T*;
+
+    // The position given to Index for an element leaving the heap.
+    enum : size_t { npos = ~size_t(0) };
+
+    explicit heap(const Compare& comp = Compare(), const Index& index = Index());
+
+    // Builds the heap from values in O(n).
+    explicit heap(vec<T> values, const Compare& comp = Compare(), const Index& index = Index());
+
+    template <typename It, typename = detail::require_input_iterator<It>>
+    heap(It begin, It end, const Compare& comp = Compare(), const Index& index = Index());
+
+    heap(std::initializer_list<T> init, const Compare& comp = Compare(), const Index& index = Index());
+
+    heap(const heap& rhs) = default;
+    heap(heap&& rhs) = default;
+    ~heap();
+
+    heap& operator= (const heap& rhs);
+    heap& operator= (heap&& rhs) noexcept;
+
+    void swap(heap& rhs) noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    void reserve(size_t size);
+    void clear();
+
+    // The greatest element. The heap must not be empty, here and in pop,
+    // pop_push, update and erase.
+    const T& top() const noexcept;
+
+    void push(const T& value);
+    void push(T&& value);
+
+    template <typename... Args>
+    void emplace(Args&&... args);
+
+    // Pushes many elements, rebuilding the whole heap in O(n) instead when
+    // that is cheaper than pushing them one by one.
+    template <typename It, typename = detail::require_input_iterator<It>>
+    void push(It begin, It end);
+
+    void pop();
+
+    // Removes the top and adds value, in one sift instead of two.
+    void pop_push(const T& value);
+    void pop_push(T&& value);
+
+    // The elements in heap order, and the one at a position from Index.
+    const T& operator[] (size_t position) const noexcept;
+    const T* data() const noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    // Moves the element at position to its place after its key changed,
+    // in either direction.
+    void update(size_t position);
+    void update(size_t position, const T& value);
+    void update(size_t position, T&& value);
+
+    void erase(size_t position);
+
+private:
+    vec<T> m_data;
+    Compare m_compare;
+    Index m_index;
+
+    void heapify();
+    void sift_up(size_t position);
+    void sift_down(size_t position);
+    // Fills the top, left empty by pop, with the last element.
+    void pop_into_top(T&& value);
+    size_t best_child(size_t first, size_t size) const;
+    void place(size_t position, T&& value);
+};
+
+}
+
+// Implementation of heap is in detail/heap_impl.hpp
+#define INCLUDING_DATUM_DETAIL_HEAP_IMPL_HPP
+#include "detail/heap_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_HEAP_IMPL_HPP
+
+#endif //INCLUDED_DATUM_HEAP_HPP
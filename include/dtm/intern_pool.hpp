@@ -0,0 +1,222 @@
+// intern_pool.hpp
+//
+// String interning: each distinct string is stored once and named by a
+// 32 bit id.
+//
+//     dtm::intern_pool symbols;
+//     uint32_t a = symbols.intern("width");
+//     uint32_t b = symbols.intern(std::string("wid") + "th");
+//     // a == b, and symbols[a] == "width"
+//
+// Once strings are ids, comparing them is comparing integers and hashing
+// them is hashing an integer, however long the strings are.
+//
+// The characters of every string are copied back to back, each followed
+// by a terminator, into chunks of chunk_size bytes that are never moved or
+// freed before the pool is, so the str_view and c_str of an id stay valid.
+// A dtm::hash_table keyed by views into the chunks finds the id of a
+// string. intern_pool gives out ids 0, 1, 2 ... in order of first intern.
+//
+// concurrent_intern_pool takes strings from many threads at once. It
+// splits the strings over shards by their hash, each with its own mutex,
+// chunks and table, so threads interning different strings rarely wait on
+// each other. Its ids are unique but not consecutive: the low bits name
+// the shard. Looking up the string of an id takes no lock.
+//
+
+#ifndef INCLUDED_DATUM_INTERN_POOL_HPP
+#define INCLUDED_DATUM_INTERN_POOL_HPP
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "dtm/vec.hpp"
+#include "dtm/str.hpp"
+#include "dtm/hash.hpp"
+#include "dtm/hash_table.hpp"
+#include "dtm/concurrent_vec.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/aligned_alloc.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+// Chunks of characters that only grow.
+class intern_arena {
+public:
+    explicit intern_arena(size_t chunk_size) noexcept
+        : m_next(nullptr), m_remaining(0), m_chunk_size(chunk_size), m_bytes(0) {}
+
+    ~intern_arena() {
+        clear();
+    }
+
+    intern_arena(const intern_arena&) = delete;
+    intern_arena& operator= (const intern_arena&) = delete;
+
+    // Copies s and a terminator into the arena.
+    str_view store(str_view s) {
+        size_t length = s.size() + 1;
+        char* copy;
+        if (length <= m_remaining) {
+            copy = m_next;
+            m_next += length;
+            m_remaining -= length;
+        }
+        else if (length > m_chunk_size / 4) {
+            // Big strings get a chunk of their own, leaving the current
+            // chunk's space for the small ones after them.
+            copy = allocate(length);
+        }
+        else {
+            copy = allocate(m_chunk_size);
+            m_next = copy + length;
+            m_remaining = m_chunk_size - length;
+        }
+        memcpy(copy, s.data(), s.size());
+        copy[s.size()] = '\0';
+        return str_view(copy, s.size());
+    }
+
+    void clear() noexcept {
+        for (char* chunk : m_chunks)
+            free(chunk);
+        m_chunks.clear();
+        m_next = nullptr;
+        m_remaining = 0;
+        m_bytes = 0;
+    }
+
+    // Bytes of every chunk.
+    size_t bytes() const noexcept {
+        return m_bytes;
+    }
+
+private:
+    vec<char*> m_chunks;
+    char* m_next;
+    size_t m_remaining;
+    size_t m_chunk_size;
+    size_t m_bytes;
+
+    char* allocate(size_t bytes) {
+        if (m_chunks.size() == m_chunks.capacity())
+            m_chunks.reserve(m_chunks.size() * 1.5 + 4);
+        char* chunk = static_cast<char*>(malloc(bytes));
+        if (!chunk)
+            throw std::bad_alloc();
+        m_chunks.push_back(chunk);
+        m_bytes += bytes;
+        return chunk;
+    }
+};
+
+}
+
+class intern_pool {
+public:
+    // Returned by find for strings never interned.
+    enum : uint32_t { npos = 0xffffffff };
+
+    explicit intern_pool(size_t chunk_size = 64 * 1024);
+
+    intern_pool(const intern_pool&) = delete;
+    intern_pool& operator= (const intern_pool&) = delete;
+
+    // The id of s, storing it first if it is new. Throws std::length_error
+    // once every id below npos is taken.
+    uint32_t intern(str_view s);
+
+    // The id of s, or npos.
+    uint32_t find(str_view s) const noexcept;
+
+    // The string of an id, valid as long as the pool.
+    str_view operator[] (uint32_t id) const noexcept;
+    str_view at(uint32_t id) const;
+    const char* c_str(uint32_t id) const noexcept;
+
+    // Number of distinct strings, which is one more than the last id.
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    // Room for count strings without growing the index.
+    void reserve(size_t count);
+
+    // Forgets every string. Earlier ids and views are no longer valid.
+    void clear();
+
+    // Memory used by the chunks and the index.
+    size_t size_in_bytes() const noexcept;
+
+private:
+    detail::intern_arena m_arena;
+    vec<str_view> m_strings;
+    hash_table<str_view, uint32_t> m_index;
+};
+
+class concurrent_intern_pool {
+public:
+    enum : uint32_t { npos = 0xffffffff };
+
+    // shards is rounded up to a power of two, up to 65536.
+    explicit concurrent_intern_pool(size_t shards = 32, size_t chunk_size = 64 * 1024);
+    ~concurrent_intern_pool();
+
+    concurrent_intern_pool(const concurrent_intern_pool&) = delete;
+    concurrent_intern_pool& operator= (const concurrent_intern_pool&) = delete;
+
+    // Thread safe. The id of s, storing it first if it is new. Throws
+    // std::length_error when the shard of s is full.
+    uint32_t intern(str_view s);
+
+    // Thread safe. The id of s, or npos.
+    uint32_t find(str_view s) const;
+
+    // Thread safe for ids returned by intern or find.
+    str_view operator[] (uint32_t id) const noexcept;
+    str_view at(uint32_t id) const;
+    const char* c_str(uint32_t id) const noexcept;
+
+    // Number of distinct strings. Exact only when no intern is running.
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    size_t shard_count() const noexcept;
+
+private:
+    struct alignas(DATUM_CACHE_LINE_SIZE) shard {
+        mutable std::mutex mutex;
+        detail::intern_arena arena;
+        concurrent_vec<str_view> strings;
+        hash_table<str_view, uint32_t> index;
+
+        explicit shard(size_t chunk_size) : arena(chunk_size) {}
+    };
+
+    shard* m_shards;
+    size_t m_shard_count;
+    unsigned m_shard_bits;
+
+    // Each shard's hash table picks slots with the high bits of the hash
+    // and tags them with the low seven, so shards are picked by the bits
+    // just above the tag; using the tag bits would leave every key in a
+    // shard with the same few tags.
+    shard& shard_for(str_view s) const noexcept;
+};
+
+}
+
+// Implementation of intern_pool is in detail/intern_pool_impl.hpp
+#define INCLUDING_DATUM_DETAIL_INTERN_POOL_IMPL_HPP
+#include "detail/intern_pool_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_INTERN_POOL_IMPL_HPP
+
+#endif //INCLUDED_DATUM_INTERN_POOL_HPP
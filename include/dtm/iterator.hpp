@@ -1,11 +1,278 @@
 // iterator.hpp
 //
+// Non-owning views over contiguous storage and lazy adaptors on top of them.
+//
+// span<T> is a pointer and a length. It converts implicitly from any
+// contiguous container with data() and size(), which covers vec, small_vec,
+// mmap_vec and vec_view. The adaptors (zip, enumerate, strided, chunked)
+// never allocate: their iterators are a copy of a few base pointers plus an
+// index, so a loop over them compiles to the same indexed loop over raw
+// pointers you would write by hand.
+//
+// Like span, adaptors don't own their data. Don't adapt a temporary vec.
+//
 
 #ifndef INCLUDED_DATUM_ITERATOR_HPP
 #define INCLUDED_DATUM_ITERATOR_HPP
 
+#include <utility>
+#include <type_traits>
+#include <iterator>
+#include <stdexcept>
+#include <cstddef>
+
+#include "dtm/tup.hpp"
+
 namespace dtm {
 
+template <typename T>
+class span {
+    template <typename C>
+    using require_container = typename std::enable_if<
+        std::is_convertible<decltype(std::declval<C&>().data()), T*>::value &&
+        std::is_convertible<decltype(std::declval<C&>().size()), size_t>::value
+    >::type;
+
+public:
+    using element_type = T;
+    using value_type = typename std::remove_cv<T>::type;
+    using iterator = T*;
+    using const_iterator = T*;
+    using reference = T&;
+    using pointer = T*;
+
+    constexpr span() noexcept : m_data(nullptr), m_size(0) {}
+    constexpr span(T* data, size_t size) noexcept : m_data(data), m_size(size) {}
+    constexpr span(T* begin, T* end) noexcept : m_data(begin), m_size(end - begin) {}
+
+    template <size_t N>
+    constexpr span(T (&array)[N]) noexcept : m_data(array), m_size(N) {}
+
+    // span<T> converts to span<const T>
+    template <typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    constexpr span(span<U> s) noexcept : m_data(s.data()), m_size(s.size()) {}
+
+    template <typename C, typename = require_container<C>>
+    span(C& c) noexcept : m_data(c.data()), m_size(c.size()) {}
+
+    template <typename C, typename = require_container<const C>>
+    span(const C& c) noexcept : m_data(c.data()), m_size(c.size()) {}
+
+    constexpr T* begin() const noexcept { return m_data; }
+    constexpr T* end() const noexcept { return m_data + m_size; }
+
+    constexpr T* data() const noexcept { return m_data; }
+    constexpr size_t size() const noexcept { return m_size; }
+    constexpr bool empty() const noexcept { return m_size == 0; }
+
+    constexpr T& operator[] (size_t index) const noexcept { return m_data[index]; }
+    constexpr T& front() const noexcept { return m_data[0]; }
+    constexpr T& back() const noexcept { return m_data[m_size - 1]; }
+
+    constexpr span first(size_t count) const noexcept { return span(m_data, count); }
+    constexpr span last(size_t count) const noexcept { return span(m_data + m_size - count, count); }
+    constexpr span subspan(size_t offset, size_t count) const noexcept { return span(m_data + offset, count); }
+    constexpr span subspan(size_t offset) const noexcept { return span(m_data + offset, m_size - offset); }
+
+private:
+    T* m_data;
+    size_t m_size;
+};
+
+// Make a span over a container, deducing the element type from data().
+template <typename C>
+span<typename std::remove_pointer<decltype(std::declval<C&>().data())>::type> make_span(C& c) noexcept {
+    return { c.data(), static_cast<size_t>(c.size()) };
+}
+
+template <typename T>
+span<T> make_span(T* data, size_t size) noexcept {
+    return span<T>(data, size);
+}
+
+namespace detail {
+
+// Random access iterator over positions 0..n of an accessor, a small value
+// type whose operator()(i) produces the i'th element.
+template <typename Accessor>
+class index_iterator {
+public:
+    using reference = decltype(std::declval<const Accessor&>()(size_t()));
+    using value_type = typename std::decay<reference>::type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using iterator_category = std::random_access_iterator_tag;
+
+    index_iterator(const Accessor& accessor, size_t index) noexcept
+        : m_accessor(accessor), m_index(index) {}
+
+    index_iterator& operator ++ () noexcept { ++m_index; return *this; }
+    index_iterator& operator -- () noexcept { --m_index; return *this; }
+
+    index_iterator operator ++ (int) noexcept { return index_iterator(m_accessor, m_index++); }
+    index_iterator operator -- (int) noexcept { return index_iterator(m_accessor, m_index--); }
+
+    index_iterator& operator += (std::ptrdiff_t n) noexcept { m_index += n; return *this; }
+    index_iterator& operator -= (std::ptrdiff_t n) noexcept { m_index -= n; return *this; }
+
+    index_iterator operator + (std::ptrdiff_t n) const noexcept { return index_iterator(m_accessor, m_index + n); }
+    index_iterator operator - (std::ptrdiff_t n) const noexcept { return index_iterator(m_accessor, m_index - n); }
+
+    std::ptrdiff_t operator - (const index_iterator& rhs) const noexcept { return m_index - rhs.m_index; }
+
+    bool operator == (const index_iterator& rhs) const noexcept { return m_index == rhs.m_index; }
+    bool operator != (const index_iterator& rhs) const noexcept { return m_index != rhs.m_index; }
+    bool operator < (const index_iterator& rhs) const noexcept { return m_index < rhs.m_index; }
+    bool operator > (const index_iterator& rhs) const noexcept { return m_index > rhs.m_index; }
+    bool operator <= (const index_iterator& rhs) const noexcept { return m_index <= rhs.m_index; }
+    bool operator >= (const index_iterator& rhs) const noexcept { return m_index >= rhs.m_index; }
+
+    reference operator* () const noexcept { return m_accessor(m_index); }
+    reference operator[] (size_t n) const noexcept { return m_accessor(m_index + n); }
+
+private:
+    Accessor m_accessor;
+    size_t m_index;
+};
+
+template <typename Accessor>
+class index_range {
+public:
+    using iterator = index_iterator<Accessor>;
+    using reference = typename iterator::reference;
+
+    index_range(const Accessor& accessor, size_t size) noexcept
+        : m_accessor(accessor), m_size(size) {}
+
+    iterator begin() const noexcept { return iterator(m_accessor, 0); }
+    iterator end() const noexcept { return iterator(m_accessor, m_size); }
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+
+    reference operator[] (size_t index) const noexcept { return m_accessor(index); }
+
+private:
+    Accessor m_accessor;
+    size_t m_size;
+};
+
+template <typename... Ts>
+struct zip_accessor {
+    tup<Ts*...> bases;
+
+    tup<Ts&...> operator() (size_t index) const noexcept {
+        return at(index, std::make_index_sequence<sizeof...(Ts)>());
+    }
+
+    template <size_t... Is>
+    tup<Ts&...> at(size_t index, std::index_sequence<Is...>) const noexcept {
+        return tup<Ts&...>(std::get<Is>(bases)[index]...);
+    }
+};
+
+template <typename T>
+struct enumerate_accessor;
+
+template <typename T>
+struct strided_accessor {
+    T* base;
+    size_t stride;
+
+    T& operator() (size_t index) const noexcept { return base[index * stride]; }
+};
+
+template <typename T>
+struct chunk_accessor {
+    T* base;
+    size_t size;
+    size_t chunk_size;
+
+    span<T> operator() (size_t index) const noexcept {
+        size_t offset = index * chunk_size;
+        size_t remaining = size - offset;
+        return span<T>(base + offset, remaining < chunk_size ? remaining : chunk_size);
+    }
+};
+
+inline size_t min_size(size_t size) noexcept {
+    return size;
+}
+
+template <typename... Sizes>
+size_t min_size(size_t size, Sizes... sizes) noexcept {
+    size_t rest = min_size(sizes...);
+    return size < rest ? size : rest;
+}
+
+}
+
+// An element of an enumerate() range.
+template <typename T>
+struct indexed {
+    size_t index;
+    T& value;
+};
+
+namespace detail {
+
+template <typename T>
+struct enumerate_accessor {
+    T* base;
+
+    indexed<T> operator() (size_t index) const noexcept { return indexed<T>{index, base[index]}; }
+};
+
+}
+
+// Iterate several containers in lockstep. Each element is a tup of
+// references; the range is as long as the shortest input.
+template <typename... Cs>
+auto zip(Cs&&... cs) noexcept
+    -> detail::index_range<detail::zip_accessor<typename decltype(make_span(cs))::element_type...>>
+{
+    using accessor = detail::zip_accessor<typename decltype(make_span(cs))::element_type...>;
+    return { accessor{ tup<typename decltype(make_span(cs))::element_type*...>(cs.data()...) },
+             detail::min_size(static_cast<size_t>(cs.size())...) };
+}
+
+// Pair each element with its index.
+template <typename C>
+auto enumerate(C&& c) noexcept
+    -> detail::index_range<detail::enumerate_accessor<typename decltype(make_span(c))::element_type>>
+{
+    using accessor = detail::enumerate_accessor<typename decltype(make_span(c))::element_type>;
+    return { accessor{ c.data() }, static_cast<size_t>(c.size()) };
+}
+
+// Every stride'th element, starting with the first. Throws
+// std::invalid_argument if stride is 0.
+template <typename C>
+auto strided(C&& c, size_t stride)
+    -> detail::index_range<detail::strided_accessor<typename decltype(make_span(c))::element_type>>
+{
+    if (stride == 0)
+        throw std::invalid_argument("dtm::strided");
+
+    using accessor = detail::strided_accessor<typename decltype(make_span(c))::element_type>;
+    size_t size = static_cast<size_t>(c.size());
+    return { accessor{ c.data(), stride }, size / stride + (size % stride != 0) };
+}
+
+// Consecutive spans of chunk_size elements. The last one may be shorter.
+// Throws std::invalid_argument if chunk_size is 0.
+template <typename C>
+auto chunked(C&& c, size_t chunk_size)
+    -> detail::index_range<detail::chunk_accessor<typename decltype(make_span(c))::element_type>>
+{
+    if (chunk_size == 0)
+        throw std::invalid_argument("dtm::chunked");
+
+    using accessor = detail::chunk_accessor<typename decltype(make_span(c))::element_type>;
+    size_t size = static_cast<size_t>(c.size());
+    return { accessor{ c.data(), size, chunk_size }, size / chunk_size + (size % chunk_size != 0) };
+}
+
 } // namespace dtm
 
-#endif //INCLUDED_DATUM_ITERATOR_HPP
\ No newline at end of file
+#endif //INCLUDED_DATUM_ITERATOR_HPP
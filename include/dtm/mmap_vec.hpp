@@ -0,0 +1,225 @@
+// mmap_vec.hpp
+//
+// A vec whose buffer is a shared mapping of a file.
+//
+// Opening an existing file maps it instead of reading it, so loading is
+// independent of the amount of data and pages are faulted in on first use.
+// Only trivially copyable types can be stored. Elements are moved around by
+// the kernel rather than by their constructors, and their bytes outlive the
+// process, so a relocatable type that points into the heap, like str, is
+// not enough.
+//
+// An mmap_view maps such a file read only. It is a separate type so that
+// it can only hand out const elements: writing through a read only mapping
+// would fault.
+//
+// POSIX only; growth uses mremap where the platform has it.
+//
+
+#ifndef INCLUDED_DATUM_MMAP_VEC_HPP
+#define INCLUDED_DATUM_MMAP_VEC_HPP
+
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dtm/vec.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/ptr.hpp"
+
+namespace dtm {
+
+enum class mmap_mode {
+    create,         // Create the file, truncating it if it exists.
+    read_write      // Open an existing file, creating it if it doesn't exist.
+};
+
+enum class mmap_advice {
+    normal,
+    sequential,
+    random,
+    willneed
+};
+
+template <typename T>
+class mmap_view;
+
+template <typename T>
+class mmap_vec {
+    static_assert(is_relocatable<T>::value && std::is_trivially_copyable<T>::value,
+                  "dtm::mmap_vec requires a trivially copyable element type");
+    static_assert(alignof(T) <= 64, "dtm::mmap_vec elements must fit the 64 byte header alignment");
+
+public:
+    using value_type = T;
+
+    using iterator = detail::ptr<T>;
+    using const_iterator = const detail::ptr<T>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    explicit mmap_vec(const char* path, mmap_mode mode = mmap_mode::read_write,
+                      mmap_advice advice = mmap_advice::normal);
+
+    mmap_vec(mmap_vec&& v) noexcept;
+    mmap_vec& operator= (mmap_vec&& rhs) noexcept;
+
+    mmap_vec(const mmap_vec&) = delete;
+    mmap_vec& operator= (const mmap_vec&) = delete;
+
+    // Unmaps the file. Dirty pages are written back by the kernel; call
+    // flush() first if the data must be on disk when this returns.
+    ~mmap_vec();
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+    const_iterator cbegin() const noexcept;
+    const_iterator cend() const noexcept;
+
+    reverse_iterator rbegin() noexcept;
+    reverse_iterator rend() noexcept;
+    const_reverse_iterator rbegin() const noexcept;
+    const_reverse_iterator rend() const noexcept;
+
+    T* data() noexcept;
+    const T* data() const noexcept;
+
+    T& front() noexcept;
+    T& back() noexcept;
+    const T& front() const noexcept;
+    const T& back() const noexcept;
+
+    T& operator[] (size_t) noexcept;
+    const T& operator[] (size_t) const noexcept;
+
+    T& at(size_t);
+    const T& at(size_t) const;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+    size_t capacity() const noexcept;
+
+    void reserve(size_t size);
+    void shrink_to_fit();
+
+    void clear();
+
+    template <typename... Args>
+    void resize(size_t new_size, Args&&...);
+
+    template <typename... Args>
+    void fill(size_t count, Args&&... args);
+
+    void pop_back();
+
+    void push_back(const T&);
+    void push_back(T&&);
+
+    template <typename... Args>
+    void emplace_back(Args&&...);
+
+    // Synchronously write dirty pages back to the file.
+    void flush();
+
+    // Pass an access pattern hint for the element pages to the kernel.
+    void advise(mmap_advice advice);
+
+private:
+    // The first 64 bytes of the file. The element count lives in the mapping
+    // itself, so it is persisted along with the elements.
+    struct header {
+        char magic[8];
+        uint32_t version;
+        uint32_t element_size;
+        uint64_t size;
+        char reserved[40];
+    };
+    static_assert(sizeof(header) == 64, "mmap_vec header must be one cache line");
+
+    static constexpr uint32_t current_version = 1;
+
+    friend class mmap_view<T>;
+
+    int m_fd;
+    // Only an mmap_view's vec is read only.
+    bool m_read_only;
+    mmap_advice m_advice;
+    void* m_map;
+    size_t m_map_length;
+    size_t m_capacity;
+
+    mmap_vec(const char* path, mmap_mode mode, mmap_advice advice, bool read_only);
+
+    header* get_header() const noexcept;
+    T* elements() const noexcept;
+
+    void check_writable() const;
+    void grow_if_necessary();
+    void remap(size_t new_capacity);
+    void map_file(size_t length);
+    void release() noexcept;
+};
+
+// A read only mapping of a file written by an mmap_vec.
+template <typename T>
+class mmap_view {
+public:
+    using value_type = T;
+
+    using const_iterator = const T*;
+    using iterator = const_iterator;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using reverse_iterator = const_reverse_iterator;
+
+    // Throws if the file doesn't exist, is empty or holds another type.
+    explicit mmap_view(const char* path, mmap_advice advice = mmap_advice::normal);
+
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+    const_iterator cbegin() const noexcept;
+    const_iterator cend() const noexcept;
+
+    const_reverse_iterator rbegin() const noexcept;
+    const_reverse_iterator rend() const noexcept;
+
+    const T* data() const noexcept;
+
+    const T& front() const noexcept;
+    const T& back() const noexcept;
+
+    const T& operator[] (size_t) const noexcept;
+    const T& at(size_t) const;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    // Pass an access pattern hint for the element pages to the kernel.
+    void advise(mmap_advice advice);
+
+private:
+    mmap_vec<T> m_vec;
+};
+
+}
+
+// Implementation of mmap_vec is in detail/mmap_vec_impl.hpp
+#define INCLUDING_DATUM_DETAIL_MMAP_VEC_IMPL_HPP
+#include "detail/mmap_vec_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_MMAP_VEC_IMPL_HPP
+
+#endif //INCLUDED_DATUM_MMAP_VEC_HPP
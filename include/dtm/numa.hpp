@@ -0,0 +1,267 @@
+// numa.hpp
+//
+// Placement of large vecs on the memory nodes of NUMA machines.
+//
+//     dtm::vec<double> v;
+//     v.reserve(n);
+//     dtm::numa_place(v, dtm::numa_placement::interleave);
+//
+//     dtm::numa_distribution d = dtm::numa_page_distribution(v);
+//     size_t on_node_1 = d.pages[1];
+//
+// Linux allocates a page on the node of the thread that first writes it.
+// A vec filled by one thread therefore sits on one node, and workers on
+// the other sockets read it at a fraction of the bandwidth. numa_place
+// sets the memory policy of the pages of a vec's buffer with mbind, moving
+// pages that are already resident:
+//
+//   - interleave spreads the pages round robin over every node with
+//     memory. Best for data every thread reads all of.
+//   - node_local puts every page on one node, that of the calling thread
+//     unless numa_bind names another.
+//   - by_worker splits the buffer into the same page aligned chunks as the
+//     parallel algorithms and puts each chunk on the node of the pool worker
+//     that places it, spreading the vec over the nodes the pool runs on.
+//     Filling a fresh vec with parallel_fill does much the same by first
+//     touch, without moving anything.
+//   - first_touch restores the default policy. Pages already resident stay
+//     where they are.
+//
+// Placement covers whole pages within the vec's capacity. A later reserve
+// that moves the buffer loses it, so reserve first. The system calls are
+// made directly rather than through libnuma. A machine with one node
+// accepts every placement and keeps every page on node 0.
+//
+
+#ifndef INCLUDED_DATUM_NUMA_HPP
+#define INCLUDED_DATUM_NUMA_HPP
+
+#include <system_error>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "dtm/vec.hpp"
+#include "dtm/thread_pool.hpp"
+#include "dtm/parallel.hpp"
+
+#include "dtm/detail/config.hpp"
+
+namespace dtm {
+
+enum class numa_placement {
+    interleave,
+    node_local,
+    by_worker,
+    first_touch
+};
+
+// Resident pages of a range by node.
+struct numa_distribution {
+    // pages[node] is the number of pages on node.
+    vec<size_t> pages;
+    // Pages never touched, swapped out or otherwise not on any node.
+    size_t not_present = 0;
+};
+
+namespace detail {
+
+// From linux/mempolicy.h, which libc doesn't wrap.
+constexpr int numa_mpol_default = 0;
+constexpr int numa_mpol_preferred = 1;
+constexpr int numa_mpol_bind = 2;
+constexpr int numa_mpol_interleave = 3;
+constexpr unsigned numa_mpol_mf_move = 1 << 1;
+
+constexpr size_t numa_bits_per_mask_word = sizeof(unsigned long) * 8;
+
+// A node mask for mbind.
+struct numa_node_mask {
+    vec<unsigned long> words;
+
+    void set(size_t node) {
+        size_t word = node / numa_bits_per_mask_word;
+        if (words.size() <= word)
+            words.resize(word + 1, 0ul);
+        words[word] |= 1ul << (node % numa_bits_per_mask_word);
+    }
+
+    bool test(size_t node) const noexcept {
+        size_t word = node / numa_bits_per_mask_word;
+        return word < words.size() && (words[word] >> (node % numa_bits_per_mask_word)) & 1;
+    }
+
+    // The kernel reads one bit fewer than it is told to.
+    unsigned long max_node() const noexcept {
+        return words.size() * numa_bits_per_mask_word + 1;
+    }
+};
+
+// Parse a sysfs node list such as "0-3,5". A missing file means a kernel
+// without NUMA, which is one node.
+inline numa_node_mask numa_read_node_list(const char* path) {
+    numa_node_mask mask;
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        mask.set(0);
+        return mask;
+    }
+    unsigned long first = 0, last = 0;
+    int c = 0;
+    while (fscanf(file, "%lu", &first) == 1) {
+        last = first;
+        c = fgetc(file);
+        if (c == '-') {
+            if (fscanf(file, "%lu", &last) != 1)
+                break;
+            c = fgetc(file);
+        }
+        for (unsigned long node = first; node <= last; node++)
+            mask.set(node);
+        if (c != ',')
+            break;
+    }
+    fclose(file);
+    if (mask.words.empty())
+        mask.set(0);
+    return mask;
+}
+
+inline const numa_node_mask& numa_nodes_with_memory() {
+    static const numa_node_mask mask = numa_read_node_list("/sys/devices/system/node/has_memory");
+    return mask;
+}
+
+// Whole pages inside [data, data + bytes). Partial pages at either end may
+// belong to something else.
+inline bool numa_inner_pages(const void* data, size_t bytes, uintptr_t& begin, size_t& length) noexcept {
+    uintptr_t start = reinterpret_cast<uintptr_t>(data);
+    begin = (start + DATUM_PAGE_SIZE - 1) / DATUM_PAGE_SIZE * DATUM_PAGE_SIZE;
+    uintptr_t end = (start + bytes) / DATUM_PAGE_SIZE * DATUM_PAGE_SIZE;
+    length = end > begin ? end - begin : 0;
+    return length > 0;
+}
+
+inline void numa_mbind(const void* data, size_t bytes, int mode, const numa_node_mask* mask) {
+    uintptr_t begin;
+    size_t length;
+    if (!numa_inner_pages(data, bytes, begin, length))
+        return;
+    const unsigned long* words = mask ? mask->words.data() : nullptr;
+    unsigned long max_node = mask ? mask->max_node() : 0;
+    unsigned flags = mode == numa_mpol_default ? 0 : numa_mpol_mf_move;
+    if (syscall(SYS_mbind, begin, length, mode, words, max_node, flags) != 0)
+        throw std::system_error(errno, std::generic_category(), "dtm::numa_place: mbind");
+}
+
+}
+
+// Number of node ids, which is one more than the highest online node.
+inline size_t numa_node_count() {
+    static const size_t count = [] {
+        detail::numa_node_mask online = detail::numa_read_node_list("/sys/devices/system/node/online");
+        size_t nodes = 1;
+        for (size_t node = 0; node < online.words.size() * detail::numa_bits_per_mask_word; node++) {
+            if (online.test(node))
+                nodes = node + 1;
+        }
+        return nodes;
+    }();
+    return count;
+}
+
+// The node of the CPU the calling thread is running on.
+inline size_t numa_current_node() {
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        return 0;
+    return node;
+}
+
+// Put the pages of [data, data + bytes) on node, moving them if need be.
+inline void numa_bind(const void* data, size_t bytes, size_t node) {
+    detail::numa_node_mask mask;
+    mask.set(node);
+    detail::numa_mbind(data, bytes, detail::numa_mpol_bind, &mask);
+}
+
+// Place the pages of [data, data + bytes), moving them if need be.
+inline void numa_place(const void* data, size_t bytes, numa_placement placement, thread_pool& pool = default_thread_pool()) {
+    switch (placement) {
+    case numa_placement::interleave:
+        detail::numa_mbind(data, bytes, detail::numa_mpol_interleave, &detail::numa_nodes_with_memory());
+        break;
+    case numa_placement::node_local:
+        numa_bind(data, bytes, numa_current_node());
+        break;
+    case numa_placement::by_worker: {
+        // Preferred rather than bound, so a full node spills over.
+        const unsigned char* bytes_data = static_cast<const unsigned char*>(data);
+        detail::parallel_page_chunks(pool, bytes_data, bytes, [&](size_t begin, size_t end) {
+            detail::numa_node_mask mask;
+            mask.set(numa_current_node());
+            detail::numa_mbind(bytes_data + begin, end - begin, detail::numa_mpol_preferred, &mask);
+        });
+        break;
+    }
+    case numa_placement::first_touch:
+        detail::numa_mbind(data, bytes, detail::numa_mpol_default, nullptr);
+        break;
+    }
+}
+
+// Where the pages of [data, data + bytes) are. Partial pages at either
+// end are counted too.
+inline numa_distribution numa_page_distribution(const void* data, size_t bytes) {
+    numa_distribution distribution;
+    distribution.pages.resize(numa_node_count(), size_t(0));
+    if (bytes == 0)
+        return distribution;
+
+    uintptr_t first = reinterpret_cast<uintptr_t>(data) / DATUM_PAGE_SIZE * DATUM_PAGE_SIZE;
+    uintptr_t end = reinterpret_cast<uintptr_t>(data) + bytes;
+
+    // move_pages with no target nodes only reports where pages are.
+    const size_t batch = 1024;
+    void* pages[batch];
+    int status[batch];
+    for (uintptr_t page = first; page < end; ) {
+        size_t count = 0;
+        for (; count < batch && page < end; count++, page += DATUM_PAGE_SIZE)
+            pages[count] = reinterpret_cast<void*>(page);
+        if (syscall(SYS_move_pages, 0, count, pages, nullptr, status, 0) != 0)
+            throw std::system_error(errno, std::generic_category(), "dtm::numa_page_distribution: move_pages");
+        for (size_t i = 0; i < count; i++) {
+            if (status[i] >= 0 && size_t(status[i]) < distribution.pages.size())
+                distribution.pages[status[i]]++;
+            else
+                distribution.not_present++;
+        }
+    }
+    return distribution;
+}
+
+// Place the pages of v's buffer, up to its capacity.
+template <typename T>
+void numa_place(vec<T>& v, numa_placement placement, thread_pool& pool = default_thread_pool()) {
+    numa_place(v.data(), v.capacity() * sizeof(T), placement, pool);
+}
+
+template <typename T>
+void numa_bind(vec<T>& v, size_t node) {
+    numa_bind(v.data(), v.capacity() * sizeof(T), node);
+}
+
+// Where the pages of v's elements are.
+template <typename T>
+numa_distribution numa_page_distribution(const vec<T>& v) {
+    return numa_page_distribution(v.data(), v.size() * sizeof(T));
+}
+
+}
+
+#endif //INCLUDED_DATUM_NUMA_HPP
@@ -0,0 +1,212 @@
+// packed_vec.hpp
+//
+// An append-only vector of integers stored in as few bits as they need.
+//
+//     dtm::packed_vec<uint64_t> ids(sorted_ids, dtm::packed_encoding::delta);
+//     uint64_t id = ids[12345];
+//
+// Values are packed in blocks of 128. With frame_of_reference encoding a
+// block stores its minimum once, and each value as its offset from the
+// minimum, in just enough bits for the largest offset. A column of values
+// between 1,000,000 and 1,100,000 takes 17 bits per value, not 64.
+//
+// delta encoding is for non-decreasing data such as sorted ids. A block
+// stores its first value and smallest gap, and each value as how much its
+// gap to the previous value exceeds the smallest one. Evenly spaced values
+// then take no bits at all. Reading one value means summing the gaps
+// before it in its block, so operator[] costs up to 128 additions rather
+// than a shift and a mask.
+//
+// Whole blocks decode at once through decode_block, decode and for_each,
+// which unpack four values per AVX2 gather when the CPU has it. The last
+// size() % 128 values wait unpacked until their block fills up.
+//
+
+#ifndef INCLUDED_DATUM_PACKED_VEC_HPP
+#define INCLUDED_DATUM_PACKED_VEC_HPP
+
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+#include "dtm/vec.hpp"
+#include "dtm/iterator.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/cpu.hpp"
+
+namespace dtm {
+
+enum class packed_encoding {
+    frame_of_reference,
+    delta
+};
+
+namespace detail {
+
+struct packed_block {
+    // The minimum value, or for delta encoding the first value, as the
+    // bits of the unsigned type of the same width.
+    uint64_t reference;
+    // Smallest gap between consecutive values; delta encoding only.
+    uint64_t step;
+    // First word of the block's packed values.
+    uint64_t offset;
+    uint32_t width;
+};
+
+inline uint64_t packed_mask(unsigned width) noexcept {
+    return width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+}
+
+inline unsigned packed_width(uint64_t max_value) noexcept {
+    return max_value == 0 ? 0 : unsigned(64 - __builtin_clzll(max_value));
+}
+
+// The width bit value at index. Values may straddle two words, so words
+// must have a word of padding after the last value.
+inline uint64_t packed_get(const uint64_t* words, size_t index, unsigned width) noexcept {
+    size_t bit = index * width;
+    const uint64_t* p = words + bit / 64;
+    unsigned shift = unsigned(bit % 64);
+    // Two shifts, so that shift == 0 shifts the second word all the way
+    // out rather than by an undefined 64.
+    uint64_t value = (p[0] >> shift) | ((p[1] << 1) << (63 - shift));
+    return value & packed_mask(width);
+}
+
+// Words must be zero where the value goes.
+inline void packed_put(uint64_t* words, size_t index, unsigned width, uint64_t value) noexcept {
+    size_t bit = index * width;
+    uint64_t* p = words + bit / 64;
+    unsigned shift = unsigned(bit % 64);
+    p[0] |= value << shift;
+    if (shift + width > 64)
+        p[1] |= value >> (64 - shift);
+}
+
+inline void packed_unpack_scalar(const uint64_t* words, unsigned width, size_t count, uint64_t base, uint64_t* out) noexcept {
+    for (size_t i = 0; i < count; i++)
+        out[i] = base + packed_get(words, i, width);
+}
+
+#if DATUM_X86
+// Gather the eight bytes holding each of four values, then shift each into
+// place. Values must be at most 57 bits, which fit in any eight bytes
+// starting at their first byte.
+DATUM_TARGET("avx2")
+inline void packed_unpack_avx2(const uint64_t* words, unsigned width, size_t count, uint64_t base, uint64_t* out) noexcept {
+    const long long* bytes = reinterpret_cast<const long long*>(words);
+    __m256i bits = _mm256_setr_epi64x(0, width, 2 * width, 3 * width);
+    const __m256i advance = _mm256_set1_epi64x(4 * width);
+    const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(packed_mask(width)));
+    const __m256i add = _mm256_set1_epi64x(static_cast<long long>(base));
+    const __m256i seven = _mm256_set1_epi64x(7);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_i64gather_epi64(bytes, _mm256_srli_epi64(bits, 3), 1);
+        v = _mm256_srlv_epi64(v, _mm256_and_si256(bits, seven));
+        v = _mm256_add_epi64(_mm256_and_si256(v, mask), add);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+        bits = _mm256_add_epi64(bits, advance);
+    }
+    for (; i < count; i++)
+        out[i] = base + packed_get(words, i, width);
+}
+#endif
+
+// out[i] = base + the i-th packed value, for i < count.
+inline void packed_unpack(const uint64_t* words, unsigned width, size_t count, uint64_t base, uint64_t* out) noexcept {
+    if (width == 0) {
+        std::fill(out, out + count, base);
+        return;
+    }
+#if DATUM_X86
+    if (width <= 57 && cpu().avx2) {
+        packed_unpack_avx2(words, width, count, base, out);
+        return;
+    }
+#endif
+    packed_unpack_scalar(words, width, count, base, out);
+}
+
+}
+
+template <typename T = uint64_t>
+class packed_vec {
+    static_assert(std::is_integral<T>::value && sizeof(T) <= 8, "dtm::packed_vec holds integers of up to 64 bits");
+
+public:
+    using value_type = T;
+    static constexpr size_t block_size = 128;
+
+    explicit packed_vec(packed_encoding encoding = packed_encoding::frame_of_reference) noexcept;
+
+    // Throws std::invalid_argument if the encoding is delta and values
+    // decrease anywhere.
+    explicit packed_vec(span<const T> values, packed_encoding encoding = packed_encoding::frame_of_reference);
+
+    packed_encoding encoding() const noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    T operator[] (size_t index) const noexcept;
+    T at(size_t index) const;
+    T front() const noexcept;
+    T back() const noexcept;
+
+    // Throws std::invalid_argument if the encoding is delta and value is
+    // less than back().
+    void push_back(T value);
+    void clear();
+    void swap(packed_vec& rhs) noexcept;
+
+    // Number of packed blocks. The last size() % block_size values are
+    // not in one yet.
+    size_t block_count() const noexcept;
+
+    // Bits per value in a block.
+    unsigned block_width(size_t block) const noexcept;
+
+    // Write the block_size values of a packed block to out.
+    void decode_block(size_t block, T* out) const noexcept;
+
+    // Replace the contents of out with every value.
+    void decode(vec<T>& out) const;
+
+    // Calls fn(value) for every value in order, decoding a block at a time.
+    template <typename Fn>
+    void for_each(Fn&& fn) const;
+
+    // Memory used by the values and block headers.
+    size_t size_in_bytes() const noexcept;
+
+private:
+    using unsigned_type = typename std::make_unsigned<T>::type;
+
+    // All blocks but the last, unfinished one are packed into m_words,
+    // followed by a word of padding for reads that straddle the end.
+    vec<uint64_t> m_words;
+    vec<detail::packed_block> m_blocks;
+    vec<T> m_tail;
+    packed_encoding m_encoding;
+
+    static uint64_t to_bits(T value) noexcept;
+    static T from_bits(uint64_t bits) noexcept;
+
+    void pack_block(const T* values);
+};
+
+}
+
+// Implementation of packed_vec is in detail/packed_vec_impl.hpp
+#define INCLUDING_DATUM_DETAIL_PACKED_VEC_IMPL_HPP
+#include "detail/packed_vec_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_PACKED_VEC_IMPL_HPP
+
+#endif //INCLUDED_DATUM_PACKED_VEC_HPP
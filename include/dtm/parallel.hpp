@@ -0,0 +1,560 @@
+// parallel.hpp
+//
+// Parallel algorithms for large vecs: fill, resize, assign, transform,
+// prefix scans and sort, and bulk insertion into hash tables.
+//
+//     dtm::vec<double> v;
+//     dtm::parallel_fill(v, 1 << 30, 0.0);
+//     dtm::parallel_transform(v, v, [](double x) { return x * 2; });
+//     dtm::parallel_inclusive_scan(counts, offsets);
+//     dtm::parallel_sort(ids);
+//     dtm::parallel_insert(table, keys, values);
+//
+// One core can't keep up with the memory bandwidth of a large machine, so
+// these split the vec into chunks that start and end on page boundaries and
+// hand the chunks to the workers of a thread pool, the default one unless
+// another is passed last. No two workers write the same page.
+//
+// A fresh vec's pages are only allocated when first written. Filling,
+// resizing or assigning in parallel therefore also spreads the pages over
+// the NUMA nodes of the workers that wrote them, rather than putting the
+// whole vec on the node of the thread that allocated it.
+//
+// Vecs below a couple of hundred kilobytes, or pools of one worker, are
+// processed serially on the calling thread. Elements must be trivially
+// copyable, since vecs are resized for overwrite and then written from
+// several threads.
+//
+// The scans run in two passes: each chunk is reduced in parallel, the
+// chunk totals are scanned serially, and each chunk is then scanned in
+// parallel starting from its total. op must be associative, and is called
+// about twice per element. in and out may be the same vec.
+//
+// parallel_sort is a sample sort, which moves every element twice and
+// needs a second buffer the size of the vec. parallel_insert partitions
+// the keys by the top bits of their hashes; those bits pick the home slot,
+// so each worker fills its own region of the table without locking.
+//
+
+#ifndef INCLUDED_DATUM_PARALLEL_HPP
+#define INCLUDED_DATUM_PARALLEL_HPP
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+
+#include "dtm/vec.hpp"
+#include "dtm/sort.hpp"
+#include "dtm/hash_table.hpp"
+#include "dtm/thread_pool.hpp"
+
+#include "dtm/detail/config.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+// Less than this many bytes of elements are processed serially.
+constexpr size_t parallel_min_bytes = 256 * 1024;
+
+// Chunks of count elements of element_size bytes starting at data, split
+// on page boundaries. Every chunk has at least one element.
+class page_chunks {
+public:
+    page_chunks(const void* data, size_t count, size_t element_size, size_t workers) noexcept
+        : m_begin(reinterpret_cast<uintptr_t>(data)), m_count(count), m_element_size(element_size)
+    {
+        // About eight chunks per worker for balance, each a whole number
+        // of pages and at least one element.
+        size_t bytes = count * element_size;
+        size_t target = std::max(bytes / (8 * workers), element_size);
+        m_chunk_bytes = std::max<size_t>(1, (target + DATUM_PAGE_SIZE - 1) / DATUM_PAGE_SIZE) * DATUM_PAGE_SIZE;
+
+        // The first chunk runs up to the first boundary after the start.
+        // Each later boundary starts a chunk unless it falls inside the
+        // last element.
+        m_first_boundary = (m_begin / m_chunk_bytes + 1) * m_chunk_bytes;
+        uintptr_t last = m_begin + (count - 1) * element_size;
+        if (count == 0)
+            m_size = 0;
+        else if (m_first_boundary > last)
+            m_size = 1;
+        else
+            m_size = 2 + (last - m_first_boundary) / m_chunk_bytes;
+    }
+
+    size_t size() const noexcept { return m_size; }
+
+    // Index of the first element of chunk, or the element count for
+    // size().
+    size_t first(size_t chunk) const noexcept {
+        if (chunk == 0)
+            return 0;
+        if (chunk >= m_size)
+            return m_count;
+        uintptr_t boundary = m_first_boundary + (chunk - 1) * m_chunk_bytes;
+        return std::min(m_count, size_t(boundary - m_begin + m_element_size - 1) / m_element_size);
+    }
+
+private:
+    uintptr_t m_begin;
+    uintptr_t m_first_boundary;
+    size_t m_count;
+    size_t m_element_size;
+    size_t m_chunk_bytes;
+    size_t m_size;
+};
+
+template <typename T>
+bool parallel_worthwhile(const thread_pool& pool, size_t count) noexcept {
+    return pool.size() > 1 && count * sizeof(T) >= parallel_min_bytes;
+}
+
+// Calls fn(begin, end) for the page aligned chunks of data[0, count).
+template <typename T, typename Fn>
+void parallel_page_chunks(thread_pool& pool, const T* data, size_t count, Fn&& fn) {
+    if (!parallel_worthwhile<T>(pool, count)) {
+        if (count > 0)
+            fn(size_t(0), count);
+        return;
+    }
+    page_chunks chunks(data, count, sizeof(T), pool.size());
+    pool.parallel_for(0, chunks.size(), [&](size_t chunk) {
+        fn(chunks.first(chunk), chunks.first(chunk + 1));
+    }, 1);
+}
+
+template <typename T>
+void parallel_check_element() noexcept {
+    static_assert(std::is_trivially_copyable<T>::value, "dtm parallel vec algorithms need trivially copyable elements");
+}
+
+// out[i] = in[0] op ... op in[i] if Inclusive, else init op in[0] op ...
+// op in[i - 1]. Inclusive scans have no init.
+template <bool Inclusive, typename T, typename Op>
+void parallel_scan(const vec<T>& in, vec<T>& out, T init, Op& op, thread_pool& pool) {
+    parallel_check_element<T>();
+    size_t count = in.size();
+    if (&out != &in) {
+        out.clear();
+        out.resize_for_overwrite(count);
+    }
+    if (count == 0)
+        return;
+
+    const T* src = in.data();
+    T* dst = out.data();
+    auto scan = [&](size_t begin, size_t end, T acc) {
+        for (size_t i = begin; i < end; i++) {
+            T x = src[i];
+            if (Inclusive) {
+                acc = op(acc, x);
+                dst[i] = acc;
+            } else {
+                dst[i] = acc;
+                acc = op(acc, x);
+            }
+        }
+    };
+    // An inclusive scan starts from its first element.
+    auto scan_first = [&](size_t end) {
+        if (Inclusive) {
+            T first = src[0];
+            dst[0] = first;
+            scan(1, end, first);
+        } else {
+            scan(0, end, init);
+        }
+    };
+
+    if (!parallel_worthwhile<T>(pool, count)) {
+        scan_first(count);
+        return;
+    }
+
+    // Chunk on the output, whose pages are the ones written.
+    page_chunks chunks(dst, count, sizeof(T), pool.size());
+    vec<T> carries;
+    carries.resize_for_overwrite(chunks.size());
+    pool.parallel_for(0, chunks.size() - 1, [&](size_t chunk) {
+        size_t begin = chunks.first(chunk), end = chunks.first(chunk + 1);
+        T acc = src[begin];
+        for (size_t i = begin + 1; i < end; i++)
+            acc = op(acc, src[i]);
+        carries[chunk + 1] = acc;
+    }, 1);
+
+    // Turn the chunk totals into the value carried into each chunk.
+    for (size_t chunk = 1; chunk < chunks.size(); chunk++) {
+        if (chunk > 1)
+            carries[chunk] = op(carries[chunk - 1], carries[chunk]);
+        else if (!Inclusive)
+            carries[chunk] = op(init, carries[chunk]);
+    }
+
+    pool.parallel_for(0, chunks.size(), [&](size_t chunk) {
+        if (chunk == 0)
+            scan_first(chunks.first(1));
+        else
+            scan(chunks.first(chunk), chunks.first(chunk + 1), carries[chunk]);
+    }, 1);
+}
+
+inline unsigned parallel_ceil_log2(size_t n) noexcept {
+    return n <= 1 ? 0 : unsigned(64 - __builtin_clzll(uint64_t(n - 1)));
+}
+
+// Sample sort draws this many sample elements per bucket.
+constexpr size_t sample_sort_oversampling = 16;
+
+// Splitters for sample sort: a sorted random sample, thinned out and with
+// duplicates removed.
+template <typename T, typename Compare>
+void sample_sort_splitters(const T* data, size_t count, size_t wanted, Compare& comp, vec<T>& splitters) {
+    size_t sample_size = (wanted + 1) * sample_sort_oversampling;
+    vec<T> sample;
+    sample.resize_for_overwrite(sample_size);
+    uint64_t rng = 0x9e3779b97f4a7c15ull ^ count;
+    for (size_t i = 0; i < sample_size; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        sample[i] = data[rng % count];
+    }
+    sort(sample.data(), sample.data() + sample_size, comp);
+
+    splitters.clear();
+    for (size_t i = 1; i <= wanted; i++) {
+        const T& s = sample[i * sample_sort_oversampling];
+        if (splitters.empty() || comp(splitters.back(), s))
+            splitters.push_back(s);
+    }
+}
+
+// Sample sort: pick splitters from a random sample, scatter every element
+// into the bucket between its splitters, then sort the buckets in parallel.
+// Each splitter also gets a bucket of the elements equal to it, which needs
+// no sorting, so heavily duplicated keys don't make one bucket too big.
+template <typename T, typename Compare>
+void parallel_sample_sort(vec<T>& v, Compare& comp, thread_pool& pool) {
+    parallel_check_element<T>();
+    size_t count = v.size();
+    T* data = v.data();
+    if (!parallel_worthwhile<T>(pool, count)) {
+        sort(data, data + count, comp);
+        return;
+    }
+
+    // Bucket numbers fit 16 bits.
+    vec<T> splitters;
+    sample_sort_splitters(data, count, std::min<size_t>(8 * pool.size(), 2048) - 1, comp, splitters);
+    const T* splitters_begin = splitters.data();
+    const T* splitters_end = splitters_begin + splitters.size();
+    size_t buckets = 2 * splitters.size() + 1;
+    auto classify = [&](const T& x) -> size_t {
+        const T* s = std::lower_bound(splitters_begin, splitters_end, x, comp);
+        size_t j = size_t(s - splitters_begin);
+        return 2 * j + (s != splitters_end && !comp(x, *s));
+    };
+
+    // Count every chunk's elements per bucket, remembering each element's
+    // bucket for the scatter.
+    page_chunks chunks(data, count, sizeof(T), pool.size());
+    vec<uint16_t> bucket_of;
+    bucket_of.resize_for_overwrite(count);
+    vec<size_t> offsets(chunks.size() * buckets, size_t(0));
+    pool.parallel_for(0, chunks.size(), [&](size_t chunk) {
+        size_t* counts = offsets.data() + chunk * buckets;
+        for (size_t i = chunks.first(chunk); i < chunks.first(chunk + 1); i++) {
+            size_t b = classify(data[i]);
+            bucket_of[i] = uint16_t(b);
+            counts[b]++;
+        }
+    }, 1);
+
+    // Buckets in order, and within a bucket the chunks in order.
+    vec<size_t> bucket_begin;
+    bucket_begin.resize_for_overwrite(buckets + 1);
+    size_t position = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        bucket_begin[b] = position;
+        for (size_t chunk = 0; chunk < chunks.size(); chunk++) {
+            size_t n = offsets[chunk * buckets + b];
+            offsets[chunk * buckets + b] = position;
+            position += n;
+        }
+    }
+    bucket_begin[buckets] = count;
+
+    vec<T> scattered;
+    scattered.resize_for_overwrite(count);
+    T* out = scattered.data();
+    pool.parallel_for(0, chunks.size(), [&](size_t chunk) {
+        size_t* next = offsets.data() + chunk * buckets;
+        for (size_t i = chunks.first(chunk); i < chunks.first(chunk + 1); i++)
+            out[next[bucket_of[i]]++] = data[i];
+    }, 1);
+
+    pool.parallel_for(0, buckets, [&](size_t b) {
+        if (b % 2 == 0)
+            sort(out + bucket_begin[b], out + bucket_begin[b + 1], comp);
+    }, 1);
+
+    v.swap(scattered);
+}
+
+struct parallel_build_item {
+    size_t hash;
+    size_t index;
+};
+
+// Inserts into a hash_table from several threads at once. Slots are
+// indexed by the high bits of the hash, so splitting the keys by hash
+// prefix splits the slot array too: each partition's keys have their home
+// slots in one region of the table, which one worker fills without locks.
+// Keys whose probe runs off the end of their region are inserted
+// afterwards on the calling thread.
+struct parallel_builder {
+    // Regions have at least this many slots.
+    static constexpr unsigned min_region_log2 = 12;
+
+    template <typename K, typename V, typename H, typename E, typename ValueAt>
+    static void insert(hash_table<K, V, H, E>& table, const K* keys, size_t count, ValueAt value_at, thread_pool& pool);
+};
+
+template <typename K, typename V, typename H, typename E, typename ValueAt>
+void parallel_builder::insert(hash_table<K, V, H, E>& table, const K* keys, size_t count, ValueAt value_at, thread_pool& pool)
+{   // XXX not exception safe
+    using table_type = hash_table<K, V, H, E>;
+    using entry = typename table_type::entry;
+
+    table.reserve(table.size() + count);
+
+    unsigned capacity_log2 = unsigned(__builtin_ctzll(table.m_capacity));
+    unsigned partition_bits = std::min(parallel_ceil_log2(8 * pool.size()),
+                                       capacity_log2 > min_region_log2 ? capacity_log2 - min_region_log2 : 0);
+    if (pool.size() == 1 || partition_bits == 0 || count * sizeof(K) < parallel_min_bytes) {
+        for (size_t i = 0; i < count; i++)
+            table.emplace(keys[i], value_at(i));
+        return;
+    }
+
+    size_t partitions = size_t(1) << partition_bits;
+    unsigned partition_shift = unsigned(sizeof(size_t) * 8) - partition_bits;
+    unsigned region_log2 = capacity_log2 - partition_bits;
+
+    // Hash every key and count each chunk's keys per partition.
+    page_chunks chunks(keys, count, sizeof(K), pool.size());
+    vec<size_t> hashes;
+    hashes.resize_for_overwrite(count);
+    vec<size_t> offsets(chunks.size() * partitions, size_t(0));
+    pool.parallel_for(0, chunks.size(), [&](size_t chunk) {
+        size_t* counts = offsets.data() + chunk * partitions;
+        for (size_t i = chunks.first(chunk); i < chunks.first(chunk + 1); i++) {
+            size_t h = table.m_hash(keys[i]);
+            hashes[i] = h;
+            counts[h >> partition_shift]++;
+        }
+    }, 1);
+
+    vec<size_t> partition_begin;
+    partition_begin.resize_for_overwrite(partitions + 1);
+    size_t position = 0;
+    for (size_t p = 0; p < partitions; p++) {
+        partition_begin[p] = position;
+        for (size_t chunk = 0; chunk < chunks.size(); chunk++) {
+            size_t n = offsets[chunk * partitions + p];
+            offsets[chunk * partitions + p] = position;
+            position += n;
+        }
+    }
+    partition_begin[partitions] = count;
+
+    // Group the keys by partition, keeping their order within each.
+    vec<parallel_build_item> items;
+    items.resize_for_overwrite(count);
+    pool.parallel_for(0, chunks.size(), [&](size_t chunk) {
+        size_t* next = offsets.data() + chunk * partitions;
+        for (size_t i = chunks.first(chunk); i < chunks.first(chunk + 1); i++) {
+            size_t h = hashes[i];
+            items[next[h >> partition_shift]++] = parallel_build_item{h, i};
+        }
+    }, 1);
+
+    // Fill each region, moving keys that overflow it to the front of the
+    // partition's items.
+    vec<size_t> overflow(partitions, size_t(0));
+    vec<size_t> inserted(partitions, size_t(0));
+    vec<size_t> reused(partitions, size_t(0));
+    pool.parallel_for(0, partitions, [&](size_t p) {
+        size_t region_end = (p + 1) << region_log2;
+        size_t overflowed = 0, added = 0, erased = 0;
+        for (size_t k = partition_begin[p]; k < partition_begin[p + 1]; k++) {
+            parallel_build_item item = items[k];
+            const K& key = keys[item.index];
+            uint8_t tag = table_type::control_for(item.hash);
+
+            // As emplace does: look for the key until an empty slot,
+            // remembering the first slot that could take it.
+            size_t target = region_end;
+            size_t slot = table.home_slot(item.hash);
+            bool present = false;
+            for (; slot < region_end; slot++) {
+                uint8_t control = table.m_control[slot];
+                if (control == table_type::control_empty) {
+                    if (target == region_end)
+                        target = slot;
+                    break;
+                }
+                if (control == table_type::control_erased) {
+                    if (target == region_end)
+                        target = slot;
+                } else if (control == tag && table.m_equal(table.m_entries[slot].key, key)) {
+                    present = true;
+                    break;
+                }
+            }
+
+            if (present)
+                continue;
+            if (slot == region_end) {
+                items[partition_begin[p] + overflowed++] = item;
+                continue;
+            }
+            new (&table.m_entries[target]) entry{key, V(value_at(item.index))};
+            if (table.m_control[target] == table_type::control_erased)
+                erased++;
+            table.m_control[target] = tag;
+            added++;
+        }
+        overflow[p] = overflowed;
+        inserted[p] = added;
+        reused[p] = erased;
+    }, 1);
+
+    for (size_t p = 0; p < partitions; p++) {
+        table.m_size += inserted[p];
+        table.m_erased -= reused[p];
+    }
+    for (size_t p = 0; p < partitions; p++) {
+        for (size_t k = partition_begin[p]; k < partition_begin[p] + overflow[p]; k++)
+            table.emplace(keys[items[k].index], value_at(items[k].index));
+    }
+}
+
+}
+
+// Replace the contents of v with count copies of value.
+template <typename T>
+void parallel_fill(vec<T>& v, size_t count, const T& value, thread_pool& pool = default_thread_pool()) {
+    detail::parallel_check_element<T>();
+    v.clear();
+    v.resize_for_overwrite(count);
+    T* data = v.data();
+    detail::parallel_page_chunks(pool, data, count, [&](size_t begin, size_t end) {
+        std::fill(data + begin, data + end, value);
+    });
+}
+
+// Resize v to new_size, filling any new elements with value.
+template <typename T>
+void parallel_resize(vec<T>& v, size_t new_size, const T& value, thread_pool& pool = default_thread_pool()) {
+    detail::parallel_check_element<T>();
+    size_t old_size = v.size();
+    if (new_size <= old_size) {
+        v.resize(new_size);
+        return;
+    }
+    v.resize_for_overwrite(new_size);
+    T* data = v.data() + old_size;
+    detail::parallel_page_chunks(pool, data, new_size - old_size, [&](size_t begin, size_t end) {
+        std::fill(data + begin, data + end, value);
+    });
+}
+
+// Replace the contents of v with the elements of [begin, end), which must
+// not overlap v.
+template <typename T, typename It>
+void parallel_assign(vec<T>& v, It begin, It end, thread_pool& pool = default_thread_pool()) {
+    static_assert(std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value,
+                  "dtm::parallel_assign needs random access iterators");
+    detail::parallel_check_element<T>();
+    size_t count = size_t(end - begin);
+    v.clear();
+    v.resize_for_overwrite(count);
+    T* data = v.data();
+    detail::parallel_page_chunks(pool, data, count, [&](size_t chunk_begin, size_t chunk_end) {
+        for (size_t i = chunk_begin; i < chunk_end; i++)
+            data[i] = begin[i];
+    });
+}
+
+// Replace the contents of out with fn(x) for every x in in. out may be in.
+template <typename T, typename U, typename Fn>
+void parallel_transform(const vec<T>& in, vec<U>& out, Fn fn, thread_pool& pool = default_thread_pool()) {
+    detail::parallel_check_element<U>();
+    size_t count = in.size();
+    if (static_cast<const void*>(&out) != static_cast<const void*>(&in)) {
+        out.clear();
+        out.resize_for_overwrite(count);
+    }
+    const T* src = in.data();
+    U* dst = out.data();
+    detail::parallel_page_chunks(pool, dst, count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            dst[i] = fn(src[i]);
+    });
+}
+
+// Replace the contents of out with the running op-sums of in, each
+// including its own element.
+template <typename T, typename Op = std::plus<T>>
+void parallel_inclusive_scan(const vec<T>& in, vec<T>& out, Op op = Op(), thread_pool& pool = default_thread_pool()) {
+    detail::parallel_scan<true>(in, out, T(), op, pool);
+}
+
+// Replace the contents of out with the running op-sums of in starting
+// from init, each excluding its own element.
+template <typename T, typename Op = std::plus<T>>
+void parallel_exclusive_scan(const vec<T>& in, vec<T>& out, T init, Op op = Op(), thread_pool& pool = default_thread_pool()) {
+    detail::parallel_scan<false>(in, out, init, op, pool);
+}
+
+// Sort v with a parallel sample sort. Like dtm::sort, it is not stable.
+template <typename T, typename Compare>
+void parallel_sort(vec<T>& v, Compare comp, thread_pool& pool = default_thread_pool()) {
+    detail::parallel_sample_sort(v, comp, pool);
+}
+
+template <typename T>
+void parallel_sort(vec<T>& v) {
+    std::less<T> comp;
+    detail::parallel_sample_sort(v, comp, default_thread_pool());
+}
+
+// Insert keys[i] -> values[i] for every i, as calling insert for each in
+// turn would: keys already in table keep their values, and of repeated
+// keys the first wins. Hash and KeyEqual are called from several threads.
+template <typename K, typename V, typename H, typename E>
+void parallel_insert(hash_table<K, V, H, E>& table, const vec<K>& keys, const vec<V>& values,
+                     thread_pool& pool = default_thread_pool()) {
+    if (keys.size() != values.size())
+        throw std::invalid_argument("dtm::parallel_insert: keys and values differ in length");
+    const V* value_data = values.data();
+    detail::parallel_builder::insert(table, keys.data(), keys.size(),
+                                     [value_data](size_t i) -> const V& { return value_data[i]; }, pool);
+}
+
+// Insert every key into a set.
+template <typename K, typename H, typename E>
+void parallel_insert(hash_table<K, empty_t, H, E>& table, const vec<K>& keys, thread_pool& pool = default_thread_pool()) {
+    detail::parallel_builder::insert(table, keys.data(), keys.size(), [](size_t) { return empty_t(); }, pool);
+}
+
+}
+
+#endif //INCLUDED_DATUM_PARALLEL_HPP
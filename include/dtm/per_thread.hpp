@@ -0,0 +1,110 @@
+// per_thread.hpp
+//
+// A value per worker thread, for partial results that are combined at the
+// end.
+//
+//     dtm::per_thread<uint64_t> hits(pool);
+//     pool.parallel_for(0, n, [&](size_t i) { if (test(i)) hits.local()++; });
+//     uint64_t total = hits.combine(std::plus<uint64_t>());
+//
+//     dtm::per_thread<dtm::vec<record>> matches(pool);
+//     ... matches.local().push_back(r); ...
+//     matches.merge_into(all_matches);
+//
+// Every slot sits on its own cache lines, so workers updating their slots
+// never share a line. local() finds the slot from the calling thread's
+// worker index; there is no locking. Threads outside the pool, including
+// the one that starts a parallel_for small enough to run inline, share one
+// extra slot. Only one of them may use it at a time.
+//
+
+#ifndef INCLUDED_DATUM_PER_THREAD_HPP
+#define INCLUDED_DATUM_PER_THREAD_HPP
+
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+
+#include "dtm/vec.hpp"
+#include "dtm/hash_table.hpp"
+#include "dtm/thread_pool.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/aligned_alloc.hpp"
+
+namespace dtm {
+
+template <typename T>
+class per_thread {
+public:
+    using value_type = T;
+
+    // A slot of T(args...) for every worker of pool and one for other
+    // threads.
+    template <typename... Args>
+    explicit per_thread(thread_pool& pool, Args&&... args);
+
+    // Slots for the workers of the default pool.
+    per_thread();
+
+    ~per_thread();
+
+    per_thread(const per_thread&) = delete;
+    per_thread& operator= (const per_thread&) = delete;
+
+    // The calling thread's slot.
+    T& local() noexcept;
+
+    // Number of slots: one per worker, plus the shared one, which is last.
+    size_t size() const noexcept;
+
+    T& operator[] (size_t slot) noexcept;
+    const T& operator[] (size_t slot) const noexcept;
+
+    // Calls fn(value) for every slot in order.
+    template <typename Fn>
+    void for_each(Fn&& fn);
+    template <typename Fn>
+    void for_each(Fn&& fn) const;
+
+    // The first slot's value folded with every other in order, as
+    // fn(combined, value).
+    template <typename Fn>
+    T combine(Fn fn) const;
+
+    // For slots holding vecs: append every slot's elements to out, in slot
+    // order.
+    template <typename U>
+    void merge_into(vec<U>& out) const;
+
+    // For slots holding hash tables: insert every slot's entries into out.
+    // Keys already present keep their values.
+    template <typename K, typename V, typename H, typename E>
+    void merge_into(hash_table<K, V, H, E>& out) const;
+
+    // As above, but a key already present gets fn(present, value).
+    template <typename K, typename V, typename H, typename E, typename Fn>
+    void merge_into(hash_table<K, V, H, E>& out, Fn fn) const;
+
+private:
+    struct alignas(DATUM_CACHE_LINE_SIZE) slot {
+        T value;
+
+        template <typename... Args>
+        explicit slot(Args&&... args) : value(std::forward<Args>(args)...) {}
+    };
+
+    const thread_pool* m_pool;
+    slot* m_slots;
+    size_t m_size;
+};
+
+}
+
+// Implementation of per_thread is in detail/per_thread_impl.hpp
+#define INCLUDING_DATUM_DETAIL_PER_THREAD_IMPL_HPP
+#include "detail/per_thread_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_PER_THREAD_IMPL_HPP
+
+#endif //INCLUDED_DATUM_PER_THREAD_HPP
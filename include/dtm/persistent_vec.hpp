@@ -0,0 +1,278 @@
+// persistent_vec.hpp
+//
+// A vector whose versions share structure, so that keeping a snapshot of it
+// is O(1) instead of a copy of every element.
+//
+//     dtm::persistent_vec<int> v1 = {1, 2, 3};
+//     dtm::persistent_vec<int> v2 = v1.set(0, 10).push_back(4);
+//     // v1 is still {1, 2, 3}; v2 is {10, 2, 3, 4}
+//
+//     dtm::transient_vec<int> edit = v2.transient();
+//     for (int i = 0; i < 1000; i++)
+//         edit.push_back(i);          // in place, no copies of v2's nodes kept
+//     dtm::persistent_vec<int> v3 = edit.persistent();
+//
+// The elements sit in leaves of 32 under a tree of nodes with 32 children,
+// so reaching one takes log32(n) steps: at most 4 for a million elements.
+// The last leaf, the tail, is kept outside the tree, which makes push_back
+// and pop_back touch just the tail 31 times out of 32.
+//
+// A persistent_vec is never changed. set, push_back and pop_back return a
+// new version that copies only the path from the root to the changed leaf,
+// O(32 log32 n), and shares every other node with the old one. Copying a
+// persistent_vec copies two pointers. Nodes are reference counted with
+// atomics, so versions can be read, copied and dropped on many threads.
+//
+// For many edits in a row, a transient_vec changes in place every node it
+// holds the only reference to, which after the first edit to a leaf is all
+// the nodes on its path. persistent() makes an O(1) snapshot of it.
+//
+// Iterators look up a new leaf every 32 steps, but the check on each step
+// keeps loops over them from being vectorized, so they run several times
+// slower than over a vec. for_each_chunk hands out whole leaves instead,
+// and loops over plain arrays of 32 run close to vec speed.
+//
+
+#ifndef INCLUDED_DATUM_PERSISTENT_VEC_HPP
+#define INCLUDED_DATUM_PERSISTENT_VEC_HPP
+
+#include <atomic>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "dtm/vec.hpp"
+
+#include "dtm/detail/iterators.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+// Header of every node. A leaf's elements, or an inner node's children,
+// follow it.
+struct persistent_vec_node {
+    std::atomic<size_t> references;
+    size_t count;
+};
+
+}
+
+template <typename T>
+class transient_vec;
+
+template <typename T>
+class persistent_vec {
+public:
+    using value_type = T;
+    class const_iterator;
+    using iterator = const_iterator;
+
+    persistent_vec() noexcept;
+    persistent_vec(std::initializer_list<T> init);
+
+    template <typename It, typename = detail::require_input_iterator<It>>
+    persistent_vec(It first, It last);
+
+    persistent_vec(const persistent_vec& rhs) noexcept;
+    persistent_vec(persistent_vec&& rhs) noexcept;
+    ~persistent_vec();
+
+    persistent_vec& operator= (const persistent_vec& rhs) noexcept;
+    persistent_vec& operator= (persistent_vec&& rhs) noexcept;
+
+    void swap(persistent_vec& rhs) noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    const T& operator[] (size_t index) const noexcept;
+    const T& at(size_t index) const;
+    const T& front() const noexcept;
+    const T& back() const noexcept;
+
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    // New versions. index must be below size(), and pop_back needs a
+    // non-empty vec.
+    persistent_vec set(size_t index, const T& value) const;
+    persistent_vec set(size_t index, T&& value) const;
+    persistent_vec push_back(const T& value) const;
+    persistent_vec push_back(T&& value) const;
+    persistent_vec pop_back() const;
+
+    // A transient_vec starting from these elements.
+    transient_vec<T> transient() const noexcept;
+
+    // Calls f(const T* data, size_t count) for each leaf in order.
+    template <typename F>
+    void for_each_chunk(F&& f) const;
+
+    // Calls f(const T&) for each element in order.
+    template <typename F>
+    void for_each(F&& f) const;
+
+    vec<T> to_vec() const;
+
+private:
+    using node = detail::persistent_vec_node;
+
+    enum : unsigned { bits = 5 };
+    enum : size_t { branches = 32, mask = 31 };
+
+    static_assert(alignof(T) <= alignof(std::max_align_t), "dtm::persistent_vec holds types aligned up to max_align_t");
+
+    // Inner nodes above the tail, or null while everything fits in it.
+    node* m_root;
+    // The last leaf, 1 to 32 elements, or null when empty.
+    node* m_tail;
+    size_t m_size;
+    // Shift of the root's index bits; each level down is bits less, and
+    // leaves are at 0.
+    unsigned m_shift;
+
+    friend class transient_vec<T>;
+
+    size_t tail_offset() const noexcept;
+    const node* leaf_for(size_t index) const noexcept;
+    // The element at index, or null past the end.
+    const T* element_or_null(size_t index) const noexcept;
+
+    // Edits of this version, in place where nothing else holds the nodes.
+    template <typename U>
+    void push_back_in_place(U&& value);
+    template <typename U>
+    void set_in_place(size_t index, U&& value);
+    void pop_back_in_place();
+
+    // Adds a full tail to the tree, taking over the reference.
+    void push_tail(node* leaf);
+    // Detaches and returns the last leaf below n, a writable node.
+    static node* pop_last(node* n, unsigned level);
+    // A chain of inner nodes from level down to leaf.
+    static node* new_path(unsigned level, node* leaf);
+
+    static node* allocate_leaf();
+    static node* allocate_inner();
+    static size_t elements_offset() noexcept;
+    static T* elements(const node* n) noexcept;
+    static node** children(const node* n) noexcept;
+    static void retain(node* n) noexcept;
+    static void release(node* n, unsigned level) noexcept;
+    static node* copy(const node* n, unsigned level);
+    // Replaces n with a copy unless this is its only holder.
+    static void make_writable(node*& n, unsigned level);
+
+    template <typename F>
+    static void visit_chunks(const node* n, unsigned level, F& f);
+};
+
+template <typename T>
+class persistent_vec<T>::const_iterator {
+public:
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using reference = const T&;
+    using pointer = const T*;
+    using iterator_category = std::random_access_iterator_tag;
+
+    const_iterator(const persistent_vec* owner, size_t index) noexcept
+        : m_owner(owner), m_index(index), m_element(owner->element_or_null(index)) {}
+
+    // Stepping only looks up a leaf when it crosses into the next one.
+    const_iterator& operator ++ () noexcept {
+        ++m_element;
+        if ((++m_index & mask) == 0)
+            m_element = m_owner->element_or_null(m_index);
+        return *this;
+    }
+
+    const_iterator& operator -- () noexcept {
+        --m_index;
+        if ((m_index & mask) == mask || !m_element)
+            m_element = m_owner->element_or_null(m_index);
+        else
+            --m_element;
+        return *this;
+    }
+
+    const_iterator operator ++ (int) noexcept { const_iterator old = *this; ++*this; return old; }
+    const_iterator operator -- (int) noexcept { const_iterator old = *this; --*this; return old; }
+
+    const_iterator& operator += (std::ptrdiff_t n) noexcept { seek(m_index + n); return *this; }
+    const_iterator& operator -= (std::ptrdiff_t n) noexcept { seek(m_index - n); return *this; }
+
+    const_iterator operator + (std::ptrdiff_t n) const noexcept { return const_iterator(m_owner, m_index + n); }
+    const_iterator operator - (std::ptrdiff_t n) const noexcept { return const_iterator(m_owner, m_index - n); }
+
+    std::ptrdiff_t operator - (const const_iterator& rhs) const noexcept { return m_index - rhs.m_index; }
+
+    bool operator == (const const_iterator& rhs) const noexcept { return m_index == rhs.m_index; }
+    bool operator != (const const_iterator& rhs) const noexcept { return m_index != rhs.m_index; }
+    bool operator < (const const_iterator& rhs) const noexcept { return m_index < rhs.m_index; }
+    bool operator > (const const_iterator& rhs) const noexcept { return m_index > rhs.m_index; }
+    bool operator <= (const const_iterator& rhs) const noexcept { return m_index <= rhs.m_index; }
+    bool operator >= (const const_iterator& rhs) const noexcept { return m_index >= rhs.m_index; }
+
+    const T& operator[] (size_t n) const noexcept { return (*m_owner)[m_index + n]; }
+    const T& operator* () const noexcept { return *m_element; }
+    const T* operator-> () const noexcept { return m_element; }
+
+private:
+    const persistent_vec* m_owner;
+    size_t m_index;
+    // Null past the end.
+    const T* m_element;
+
+    void seek(size_t index) noexcept {
+        if ((index ^ m_index) > mask || !m_element)
+            m_element = m_owner->element_or_null(index);
+        else
+            m_element += std::ptrdiff_t(index - m_index);
+        m_index = index;
+    }
+};
+
+template <typename T>
+class transient_vec {
+public:
+    using value_type = T;
+
+    transient_vec() noexcept = default;
+    explicit transient_vec(persistent_vec<T> v) noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    const T& operator[] (size_t index) const noexcept;
+    const T& at(size_t index) const;
+
+    void set(size_t index, const T& value);
+    void set(size_t index, T&& value);
+    void push_back(const T& value);
+    void push_back(T&& value);
+    void pop_back();
+
+    // The elements as they are now, in O(1). The transient stays usable;
+    // its next edits copy the nodes the snapshot shares.
+    persistent_vec<T> persistent() const noexcept;
+
+private:
+    persistent_vec<T> m_vec;
+};
+
+}
+
+// Implementation of persistent_vec is in detail/persistent_vec_impl.hpp
+#define INCLUDING_DATUM_DETAIL_PERSISTENT_VEC_IMPL_HPP
+#include "detail/persistent_vec_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_PERSISTENT_VEC_IMPL_HPP
+
+#endif //INCLUDED_DATUM_PERSISTENT_VEC_HPP
@@ -0,0 +1,210 @@
+// pipeline.hpp
+//
+// Lazy map/filter/take pipelines over spans and datum containers.
+//
+//     int total = dtm::from(v)
+//         .map([](const record& r) { return r.amount; })
+//         .filter([](int amount) { return amount > 0; })
+//         .take(1000)
+//         .reduce(0, std::plus<int>());
+//
+// Nothing runs until a terminal operation (reduce, collect, for_each,
+// count) is called. Stages push elements into the next stage through
+// nested lambdas, so the whole chain is inlined into one loop over the
+// source and no intermediate containers are built.
+//
+
+#ifndef INCLUDED_DATUM_PIPELINE_HPP
+#define INCLUDED_DATUM_PIPELINE_HPP
+
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+
+#include "dtm/vec.hpp"
+#include "dtm/iterator.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+// Every stage has:
+//   reference      - what it passes downstream
+//   exact_size     - whether size() is the exact number of elements
+//   size()         - an upper bound on the number of elements
+//   run(sink)      - push elements into sink until sink returns false.
+//                    Returns false if it was stopped early.
+
+template <typename T>
+struct source_stage {
+    using reference = T&;
+    static constexpr bool exact_size = true;
+
+    span<T> source;
+
+    size_t size() const noexcept { return source.size(); }
+
+    template <typename Sink>
+    bool run(Sink&& sink) const {
+        T* ptr = source.data();
+        T* end = ptr + source.size();
+        for (; ptr != end; ++ptr)
+            if (!sink(*ptr))
+                return false;
+        return true;
+    }
+};
+
+template <typename Parent, typename Fn>
+struct map_stage {
+    using reference = decltype(std::declval<const Fn&>()(std::declval<typename Parent::reference>()));
+    static constexpr bool exact_size = Parent::exact_size;
+
+    Parent parent;
+    Fn fn;
+
+    size_t size() const noexcept { return parent.size(); }
+
+    template <typename Sink>
+    bool run(Sink&& sink) const {
+        const Fn& f = fn;
+        return parent.run([&](typename Parent::reference val) {
+            return sink(f(std::forward<typename Parent::reference>(val)));
+        });
+    }
+};
+
+template <typename Parent, typename Pred>
+struct filter_stage {
+    using reference = typename Parent::reference;
+    static constexpr bool exact_size = false;
+
+    Parent parent;
+    Pred pred;
+
+    size_t size() const noexcept { return parent.size(); }
+
+    template <typename Sink>
+    bool run(Sink&& sink) const {
+        const Pred& p = pred;
+        return parent.run([&](reference val) {
+            return p(static_cast<const typename std::decay<reference>::type&>(val))
+                ? sink(std::forward<reference>(val))
+                : true;
+        });
+    }
+};
+
+template <typename Parent>
+struct take_stage {
+    using reference = typename Parent::reference;
+    static constexpr bool exact_size = Parent::exact_size;
+
+    Parent parent;
+    size_t count;
+
+    size_t size() const noexcept {
+        size_t parent_size = parent.size();
+        return parent_size < count ? parent_size : count;
+    }
+
+    template <typename Sink>
+    bool run(Sink&& sink) const {
+        size_t remaining = count;
+        if (remaining == 0)
+            return false;
+        return parent.run([&](reference val) {
+            return sink(std::forward<reference>(val)) && --remaining != 0;
+        });
+    }
+};
+
+}
+
+template <typename Stage>
+class pipeline {
+public:
+    using reference = typename Stage::reference;
+    using value_type = typename std::decay<reference>::type;
+
+    explicit pipeline(const Stage& stage) : m_stage(stage) {}
+
+    // Stages
+
+    template <typename Fn>
+    pipeline<detail::map_stage<Stage, typename std::decay<Fn>::type>> map(Fn&& fn) const {
+        using stage = detail::map_stage<Stage, typename std::decay<Fn>::type>;
+        return pipeline<stage>(stage{ m_stage, std::forward<Fn>(fn) });
+    }
+
+    template <typename Pred>
+    pipeline<detail::filter_stage<Stage, typename std::decay<Pred>::type>> filter(Pred&& pred) const {
+        using stage = detail::filter_stage<Stage, typename std::decay<Pred>::type>;
+        return pipeline<stage>(stage{ m_stage, std::forward<Pred>(pred) });
+    }
+
+    pipeline<detail::take_stage<Stage>> take(size_t count) const {
+        using stage = detail::take_stage<Stage>;
+        return pipeline<stage>(stage{ m_stage, count });
+    }
+
+    // Terminals
+
+    template <typename Acc, typename Op>
+    Acc reduce(Acc init, Op&& op) const {
+        m_stage.run([&](reference val) {
+            init = op(std::move(init), std::forward<reference>(val));
+            return true;
+        });
+        return init;
+    }
+
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        m_stage.run([&](reference val) {
+            fn(std::forward<reference>(val));
+            return true;
+        });
+    }
+
+    size_t count() const {
+        size_t n = 0;
+        m_stage.run([&](reference) {
+            ++n;
+            return true;
+        });
+        return n;
+    }
+
+    // Gather the results into a new container, e.g. collect<dtm::vec>().
+    // When the number of results is known up front it is reserved first.
+    template <template <typename> class Container>
+    Container<value_type> collect() const {
+        Container<value_type> result;
+        if (Stage::exact_size)
+            result.reserve(m_stage.size());
+        m_stage.run([&](reference val) {
+            result.push_back(std::forward<reference>(val));
+            return true;
+        });
+        return result;
+    }
+
+    // Upper bound on the number of elements; exact if exact_size() is true.
+    size_t size_hint() const noexcept { return m_stage.size(); }
+    static constexpr bool exact_size() noexcept { return Stage::exact_size; }
+
+private:
+    Stage m_stage;
+};
+
+// Start a pipeline over a span or contiguous container.
+template <typename C>
+auto from(C&& c) -> pipeline<detail::source_stage<typename decltype(make_span(c))::element_type>> {
+    using stage = detail::source_stage<typename decltype(make_span(c))::element_type>;
+    return pipeline<stage>(stage{ make_span(c) });
+}
+
+}
+
+#endif //INCLUDED_DATUM_PIPELINE_HPP
@@ -0,0 +1,275 @@
+// poly_vec.hpp
+//
+// A vector of objects of different classes derived from one base, stored
+// inline in one contiguous buffer rather than each in its own allocation.
+//
+//     dtm::poly_vec<shape> shapes;
+//     shapes.emplace_back<circle>(1.0);
+//     shapes.emplace_back<square>(2.0);
+//     for (shape& s : shapes)
+//         total += s.area();
+//
+//     shapes.group_by_type();
+//     shapes.for_each_of<circle>([&](circle& c) { total += c.area(); });
+//
+// A vec<std::unique_ptr<shape>> scatters its objects over the heap, and a
+// loop over it misses the cache on every pointer. poly_vec places each
+// object right after the previous one, aligned as its class needs, and
+// keeps an index of where each object's base starts and which class it
+// is. Iteration walks the buffer in order.
+//
+// group_by_type reorders the objects so that those of each class are
+// adjacent, in the order the classes were first added. A virtual call in a
+// loop then goes to the same function for long runs, and for_each_of calls
+// a function taking the derived class directly, which needs no virtual
+// call at all.
+//
+// When the buffer grows, objects of relocatable classes are copied byte for
+// byte and others are moved and destroyed one by one, each through its own
+// class. References to elements don't survive growth or group_by_type.
+// Classes may be aligned up to DATUM_CACHE_LINE_SIZE.
+//
+
+#ifndef INCLUDED_DATUM_POLY_VEC_HPP
+#define INCLUDED_DATUM_POLY_VEC_HPP
+
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+#include <typeinfo>
+#include <iterator>
+#include <stdexcept>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "dtm/vec.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/aligned_alloc.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+// What poly_vec needs to know about each class it holds.
+struct poly_ops {
+    const std::type_info* type;
+    size_t size;
+    size_t alignment;
+    // Move construct at to from from, then destroy from. Null for
+    // relocatable classes, which are copied byte for byte.
+    void (*relocate)(void* from, void* to);
+    // Null for trivially destructible classes.
+    void (*destroy)(void* object);
+};
+
+template <typename D>
+void poly_relocate(void* from, void* to) {
+    D* object = static_cast<D*>(from);
+    new (to) D(std::move(*object));
+    object->~D();
+}
+
+template <typename D>
+void poly_destroy(void* object) {
+    static_cast<D*>(object)->~D();
+}
+
+// One table per class, whose address identifies the class.
+template <typename D>
+struct poly_ops_of {
+    static const poly_ops ops;
+};
+
+template <typename D>
+const poly_ops poly_ops_of<D>::ops = {
+    &typeid(D),
+    sizeof(D),
+    alignof(D),
+    is_relocatable<D>::value ? nullptr : &poly_relocate<D>,
+    std::is_trivially_destructible<D>::value ? nullptr : &poly_destroy<D>
+};
+
+struct poly_type {
+    const poly_ops* ops;
+    // Offset of the base within an object of the class.
+    size_t base_offset;
+};
+
+struct poly_entry {
+    // Offset of the object's base within the buffer.
+    size_t offset;
+    uint32_t type;
+};
+
+}
+
+template <typename Base>
+class poly_vec {
+public:
+    using value_type = Base;
+
+    template <typename B>
+    class basic_iterator;
+    using iterator = basic_iterator<Base>;
+    using const_iterator = basic_iterator<const Base>;
+
+    poly_vec() noexcept;
+    ~poly_vec();
+
+    poly_vec(poly_vec&& rhs) noexcept;
+    poly_vec& operator= (poly_vec&& rhs) noexcept;
+
+    poly_vec(const poly_vec&) = delete;
+    poly_vec& operator= (const poly_vec&) = delete;
+
+    // Constructs a D from args at the end.
+    template <typename D, typename... Args>
+    D& emplace_back(Args&&... args);
+
+    template <typename D>
+    typename std::decay<D>::type& push_back(D&& value);
+
+    void pop_back() noexcept;
+    void clear() noexcept;
+    void swap(poly_vec& rhs) noexcept;
+
+    // Room for count objects taking bytes bytes of the buffer in all.
+    void reserve(size_t count, size_t bytes);
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    Base& operator[] (size_t index) noexcept;
+    const Base& operator[] (size_t index) const noexcept;
+
+    Base& at(size_t index);
+    const Base& at(size_t index) const;
+
+    Base& front() noexcept;
+    const Base& front() const noexcept;
+    Base& back() noexcept;
+    const Base& back() const noexcept;
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+
+    // The class of the object at index.
+    const std::type_info& type(size_t index) const noexcept;
+
+    // Whether the object at index is exactly a D.
+    template <typename D>
+    bool holds(size_t index) const noexcept;
+
+    // Number of classes ever added.
+    size_t type_count() const noexcept;
+
+    // Calls fn(object) for every object in order, as a Base.
+    template <typename Fn>
+    void for_each(Fn&& fn);
+    template <typename Fn>
+    void for_each(Fn&& fn) const;
+
+    // Calls fn(object) for every object that is exactly a D, as a D. After
+    // group_by_type, goes straight to the objects of class D.
+    template <typename D, typename Fn>
+    void for_each_of(Fn&& fn);
+    template <typename D, typename Fn>
+    void for_each_of(Fn&& fn) const;
+
+    // Reorders the objects so that those of each class are adjacent, in
+    // the order the classes were first added. Keeps the order of objects
+    // of the same class.
+    void group_by_type();
+
+    // Bytes of the buffer in use, including alignment padding.
+    size_t buffer_size() const noexcept;
+    size_t buffer_capacity() const noexcept;
+
+    // Memory used by the buffer and index.
+    size_t size_in_bytes() const noexcept;
+
+private:
+    unsigned char* m_data;
+    size_t m_bytes;
+    size_t m_capacity;
+    vec<detail::poly_entry> m_entries;
+    vec<detail::poly_type> m_types;
+    // The class added last, which is likely the next one too.
+    uint32_t m_last_type;
+    // After group_by_type, the first m_grouped entries are grouped, and
+    // those of class t are at [m_type_begin[t], m_type_begin[t + 1]).
+    vec<size_t> m_type_begin;
+    size_t m_grouped;
+
+    unsigned char* object(const detail::poly_entry& entry) const noexcept;
+    uint32_t find_type(const detail::poly_ops* ops) const noexcept;
+    void grow(size_t bytes);
+    void release() noexcept;
+};
+
+template <typename Base>
+template <typename B>
+class poly_vec<Base>::basic_iterator {
+    using owner_type = typename std::conditional<std::is_const<B>::value, const poly_vec, poly_vec>::type;
+
+public:
+    using value_type = Base;
+    using difference_type = std::ptrdiff_t;
+    using reference = B&;
+    using pointer = B*;
+    using iterator_category = std::random_access_iterator_tag;
+
+    basic_iterator(owner_type* owner, size_t index) noexcept
+        : m_owner(owner), m_index(index) {}
+
+    // iterator converts to const_iterator
+    template <typename U, typename = typename std::enable_if<std::is_convertible<U*, B*>::value>::type>
+    basic_iterator(const basic_iterator<U>& rhs) noexcept
+        : m_owner(rhs.m_owner), m_index(rhs.m_index) {}
+
+    basic_iterator& operator ++ () noexcept { ++m_index; return *this; }
+    basic_iterator& operator -- () noexcept { --m_index; return *this; }
+
+    basic_iterator operator ++ (int) noexcept { return basic_iterator(m_owner, m_index++); }
+    basic_iterator operator -- (int) noexcept { return basic_iterator(m_owner, m_index--); }
+
+    basic_iterator& operator += (std::ptrdiff_t n) noexcept { m_index += n; return *this; }
+    basic_iterator& operator -= (std::ptrdiff_t n) noexcept { m_index -= n; return *this; }
+
+    basic_iterator operator + (std::ptrdiff_t n) const noexcept { return basic_iterator(m_owner, m_index + n); }
+    basic_iterator operator - (std::ptrdiff_t n) const noexcept { return basic_iterator(m_owner, m_index - n); }
+
+    std::ptrdiff_t operator - (basic_iterator rhs) const noexcept { return m_index - rhs.m_index; }
+
+    bool operator == (basic_iterator rhs) const noexcept { return m_index == rhs.m_index; }
+    bool operator != (basic_iterator rhs) const noexcept { return m_index != rhs.m_index; }
+    bool operator < (basic_iterator rhs) const noexcept { return m_index < rhs.m_index; }
+    bool operator > (basic_iterator rhs) const noexcept { return m_index > rhs.m_index; }
+    bool operator <= (basic_iterator rhs) const noexcept { return m_index <= rhs.m_index; }
+    bool operator >= (basic_iterator rhs) const noexcept { return m_index >= rhs.m_index; }
+
+    B& operator[] (size_t n) const noexcept { return (*m_owner)[m_index + n]; }
+    B& operator* () const noexcept { return (*m_owner)[m_index]; }
+    B* operator-> () const noexcept { return &(*m_owner)[m_index]; }
+
+private:
+    template <typename U>
+    friend class basic_iterator;
+
+    owner_type* m_owner;
+    size_t m_index;
+};
+
+}
+
+// Implementation of poly_vec is in detail/poly_vec_impl.hpp
+#define INCLUDING_DATUM_DETAIL_POLY_VEC_IMPL_HPP
+#include "detail/poly_vec_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_POLY_VEC_IMPL_HPP
+
+#endif //INCLUDED_DATUM_POLY_VEC_HPP
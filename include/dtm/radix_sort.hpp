@@ -0,0 +1,178 @@
+// radix_sort.hpp
+//
+// Least significant digit radix sort for vecs of numbers or of records
+// sorted by a numeric key.
+//
+//     dtm::radix_sort(values);
+//     dtm::radix_sort(records, [](const record& r) { return r.timestamp; });
+//
+// The key may be any integer or floating point type. Keys are mapped to
+// unsigned integers that sort in the same order (negative numbers flip,
+// floats order as numbers with -0.0 before 0.0 and NaNs at the ends), then
+// sorted one digit per pass. A single pass over the input builds the
+// histograms of every digit up front; digits on which all keys agree are
+// skipped, so small keys in a wide type cost only the passes they need.
+//
+// The sort is stable. Elements must be trivially copyable, since passes
+// copy them between the vec and a scratch buffer of the same size. Pass a
+// scratch vec to reuse its memory across calls.
+//
+
+#ifndef INCLUDED_DATUM_RADIX_SORT_HPP
+#define INCLUDED_DATUM_RADIX_SORT_HPP
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "dtm/vec.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+// Below this many elements a comparison sort wins.
+constexpr size_t radix_sort_threshold = 256;
+
+template <size_t Bytes> struct radix_unsigned;
+template <> struct radix_unsigned<1> { using type = uint8_t; };
+template <> struct radix_unsigned<2> { using type = uint16_t; };
+template <> struct radix_unsigned<4> { using type = uint32_t; };
+template <> struct radix_unsigned<8> { using type = uint64_t; };
+
+// Map a key to an unsigned integer with the same ordering.
+template <typename Key, typename = void>
+struct radix_traits;
+
+template <typename Key>
+struct radix_traits<Key, typename std::enable_if<std::is_integral<Key>::value>::type> {
+    using bits_type = typename radix_unsigned<sizeof(Key)>::type;
+
+    static bits_type to_bits(Key key) noexcept {
+        bits_type bits = static_cast<bits_type>(key);
+        if (std::is_signed<Key>::value)
+            bits ^= bits_type(bits_type(1) << (sizeof(Key) * 8 - 1));
+        return bits;
+    }
+};
+
+template <typename Key>
+struct radix_traits<Key, typename std::enable_if<std::is_floating_point<Key>::value>::type> {
+    using bits_type = typename radix_unsigned<sizeof(Key)>::type;
+
+    static bits_type to_bits(Key key) noexcept {
+        // Positive floats order like their bit patterns once the sign bit is
+        // set; negative ones order in reverse, so flip all their bits.
+        bits_type bits;
+        memcpy(&bits, &key, sizeof(bits));
+        bits_type sign = bits_type(1) << (sizeof(Key) * 8 - 1);
+        bits_type mask = (bits & sign) ? bits_type(~bits_type(0)) : sign;
+        return bits ^ mask;
+    }
+};
+
+template <typename T, typename KeyFn>
+using radix_key_t = typename std::decay<decltype(std::declval<const KeyFn&>()(std::declval<const T&>()))>::type;
+
+// Sorts with DigitBits bit digits. Returns true if the result ended up in
+// scratch rather than in data.
+template <size_t DigitBits, typename T, typename KeyFn>
+bool radix_sort_passes(T* data, T* scratch, size_t size, const KeyFn& key_fn) {
+    using traits = radix_traits<radix_key_t<T, KeyFn>>;
+    using bits_type = typename traits::bits_type;
+
+    constexpr size_t key_bits = sizeof(bits_type) * 8;
+    constexpr size_t num_digits = (key_bits + DigitBits - 1) / DigitBits;
+    constexpr size_t radix = size_t(1) << DigitBits;
+    constexpr bits_type digit_mask = bits_type(radix - 1);
+
+    vec<size_t> counts(num_digits * radix);
+    size_t* histograms = counts.data();
+    for (size_t i = 0; i < size; i++) {
+        bits_type bits = traits::to_bits(key_fn(data[i]));
+        for (size_t d = 0; d < num_digits; d++)
+            histograms[d * radix + ((bits >> (d * DigitBits)) & digit_mask)]++;
+    }
+
+    T* src = data;
+    T* dst = scratch;
+    for (size_t d = 0; d < num_digits; d++) {
+        size_t* histogram = histograms + d * radix;
+
+        // Every key has the same digit here, so the pass would not move
+        // anything.
+        bits_type first_digit = (traits::to_bits(key_fn(src[0])) >> (d * DigitBits)) & digit_mask;
+        if (histogram[first_digit] == size)
+            continue;
+
+        // Turn counts into starting offsets.
+        size_t offset = 0;
+        for (size_t b = 0; b < radix; b++) {
+            size_t count = histogram[b];
+            histogram[b] = offset;
+            offset += count;
+        }
+
+        for (size_t i = 0; i < size; i++) {
+            size_t digit = (traits::to_bits(key_fn(src[i])) >> (d * DigitBits)) & digit_mask;
+            memcpy(static_cast<void*>(&dst[histogram[digit]++]), &src[i], sizeof(T));
+        }
+        std::swap(src, dst);
+    }
+
+    return src != data;
+}
+
+}
+
+// Sort v by key_fn(element) using scratch as the second buffer. scratch is
+// resized to v.size() and its contents are unspecified afterwards; v and
+// scratch may trade storage.
+template <typename T, typename KeyFn>
+void radix_sort(vec<T>& v, KeyFn key_fn, vec<T>& scratch) {
+    static_assert(std::is_trivially_copyable<T>::value, "dtm::radix_sort requires trivially copyable elements");
+    using key_type = detail::radix_key_t<T, KeyFn>;
+    static_assert(std::is_arithmetic<key_type>::value, "dtm::radix_sort keys must be integers or floating point");
+    using traits = detail::radix_traits<key_type>;
+
+    size_t size = v.size();
+    if (size < detail::radix_sort_threshold) {
+        std::stable_sort(v.begin(), v.end(), [&](const T& a, const T& b) {
+            return traits::to_bits(key_fn(a)) < traits::to_bits(key_fn(b));
+        });
+        return;
+    }
+
+    scratch.resize_for_overwrite(size);
+
+    // 11 bit digits take three passes instead of four over 32 bit keys, but
+    // scattering into 2048 buckets only pays off once the input is well
+    // past the size of the caches.
+    bool in_scratch;
+    if (sizeof(key_type) == 4 && size >= (size_t(1) << 22))
+        in_scratch = detail::radix_sort_passes<11>(v.data(), scratch.data(), size, key_fn);
+    else
+        in_scratch = detail::radix_sort_passes<8>(v.data(), scratch.data(), size, key_fn);
+
+    if (in_scratch)
+        v.swap(scratch);
+}
+
+template <typename T, typename KeyFn>
+void radix_sort(vec<T>& v, KeyFn key_fn) {
+    vec<T> scratch;
+    radix_sort(v, key_fn, scratch);
+}
+
+// Sort a vec of numbers.
+template <typename T>
+void radix_sort(vec<T>& v) {
+    radix_sort(v, [](T val) { return val; });
+}
+
+}
+
+#endif //INCLUDED_DATUM_RADIX_SORT_HPP
@@ -0,0 +1,487 @@
+// serialize.hpp
+//
+// Binary snapshots of datum containers.
+//
+// A snapshot is a 64 byte header followed by the container's buffers
+// exactly as they are laid out in memory; there is no per-element encoding.
+// Writing is one gathered write of the header and buffers. Reading is one
+// read straight into a pre-sized container, or, with view(), no copy at all
+// over a buffer the caller has already mapped.
+//
+// Only element types whose bytes mean the same thing in another process
+// can be serialized; see is_serializable. The header records the element
+// size and the writer's byte order, and readers reject snapshots that
+// don't match rather than converting them.
+//
+
+#ifndef INCLUDED_DATUM_SERIALIZE_HPP
+#define INCLUDED_DATUM_SERIALIZE_HPP
+
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "dtm/vec.hpp"
+#include "dtm/hash_table.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/ptr.hpp"
+
+namespace dtm {
+
+template <typename T>
+struct is_serializable {
+    // Being relocatable is not enough: a relocatable str moves fine in memory
+    // but its bytes are a pointer to this process's heap. By default only
+    // trivially copyable types are written as bytes; specialize this for a
+    // type that holds no pointers but has its own copy constructor.
+    static constexpr bool value = std::is_trivially_copyable<T>::value;
+};
+
+class serialize_error : public std::runtime_error {
+public:
+    explicit serialize_error(const char* what)
+        : std::runtime_error(what) {}
+};
+
+// A read-only vec over a serialized buffer.
+template <typename T>
+class vec_view {
+public:
+    using value_type = T;
+    using const_iterator = const T*;
+
+    vec_view() noexcept : m_begin(nullptr), m_size(0) {}
+    vec_view(const T* begin, size_t size) noexcept : m_begin(begin), m_size(size) {}
+
+    const_iterator begin() const noexcept { return m_begin; }
+    const_iterator end() const noexcept { return m_begin + m_size; }
+
+    const T* data() const noexcept { return m_begin; }
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+
+    const T& operator[] (size_t index) const noexcept { return m_begin[index]; }
+
+private:
+    const T* m_begin;
+    size_t m_size;
+};
+
+namespace detail {
+
+enum class snapshot_kind : uint32_t {
+    vec = 1,
+    hash_table = 2
+};
+
+struct snapshot_header {
+    char magic[4];
+    uint32_t byte_order;
+    uint16_t version;
+    uint16_t kind;
+    uint32_t element_size;
+    uint64_t size;
+    uint64_t capacity;
+    uint64_t payload_size;
+    char reserved[24];
+};
+static_assert(sizeof(snapshot_header) == 64, "snapshot header must be one cache line");
+
+static const char snapshot_magic[4] = { 'd', 't', 'm', 's' };
+static const uint32_t snapshot_byte_order = 0x01020304;
+static const uint16_t snapshot_version = 1;
+
+inline snapshot_header make_snapshot_header(snapshot_kind kind, size_t element_size, size_t size,
+                                            size_t capacity, size_t payload_size) {
+    snapshot_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, snapshot_magic, sizeof(h.magic));
+    h.byte_order = snapshot_byte_order;
+    h.version = snapshot_version;
+    h.kind = static_cast<uint16_t>(kind);
+    h.element_size = static_cast<uint32_t>(element_size);
+    h.size = size;
+    h.capacity = capacity;
+    h.payload_size = payload_size;
+    return h;
+}
+
+inline void check_snapshot_header(const snapshot_header& h, snapshot_kind kind, size_t element_size) {
+    if (memcmp(h.magic, snapshot_magic, sizeof(h.magic)) != 0)
+        throw serialize_error("dtm: not a datum snapshot");
+    if (h.byte_order != snapshot_byte_order)
+        throw serialize_error("dtm: snapshot byte order does not match this machine");
+    if (h.version != snapshot_version)
+        throw serialize_error("dtm: unsupported snapshot version");
+    if (h.kind != static_cast<uint16_t>(kind))
+        throw serialize_error("dtm: snapshot holds a different container");
+    if (h.element_size != element_size)
+        throw serialize_error("dtm: snapshot element size mismatch");
+}
+
+// Write all of the buffers, retrying after short writes.
+inline void write_all(int fd, iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = ::writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "dtm: writev");
+        }
+
+        size_t remaining = static_cast<size_t>(written);
+        while (count > 0 && remaining >= iov->iov_len) {
+            remaining -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + remaining;
+            iov->iov_len -= remaining;
+        }
+    }
+}
+
+inline void read_all(int fd, void* buffer, size_t length) {
+    char* p = static_cast<char*>(buffer);
+    while (length > 0) {
+        ssize_t got = ::read(fd, p, length);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "dtm: read");
+        }
+        if (got == 0)
+            throw serialize_error("dtm: snapshot is truncated");
+        p += got;
+        length -= static_cast<size_t>(got);
+    }
+}
+
+// Has access to container internals that the public interfaces don't expose.
+struct serializer {
+    template <typename K, typename V, typename H, typename E>
+    static void write(int fd, const hash_table<K, V, H, E>& table);
+
+    template <typename K, typename V, typename H, typename E>
+    static void read(int fd, hash_table<K, V, H, E>& table);
+
+    template <typename K, typename V, typename H, typename E>
+    static hash_table_view<K, V, H, E> view(const void* buffer, size_t length);
+
+    // The slot count of a hash table snapshot, after checking the header
+    // agrees with it.
+    template <typename Table>
+    static size_t checked_capacity(const snapshot_header& h);
+
+    // Checks the control bytes and returns how many slots are erased.
+    template <typename Table>
+    static size_t checked_erased(const uint8_t* control, size_t capacity, size_t size);
+};
+
+}
+
+// A read-only hash_table over a serialized buffer. Lookups probe the
+// snapshot's arrays in place, with the same hash function as the table
+// that was written.
+template <typename Key, typename Value = empty_t, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class hash_table_view {
+    using table_type = hash_table<Key, Value, Hash, KeyEqual>;
+
+public:
+    using entry = typename table_type::entry;
+
+    hash_table_view() noexcept
+        : m_control(nullptr), m_entries(nullptr), m_capacity(0), m_size(0), m_shift(0) {}
+
+    size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    size_t capacity() const noexcept { return m_capacity; }
+
+    // The entry for key, or null.
+    const entry* find(const Key& key) const noexcept {
+        if (m_capacity == 0)
+            return nullptr;
+
+        size_t h = m_hash(key);
+        size_t mask = m_capacity - 1;
+        uint8_t tag = table_type::control_for(h);
+        for (size_t slot = h >> m_shift; ; slot = (slot + 1) & mask) {
+            uint8_t control = m_control[slot];
+            if (control == table_type::control_empty)
+                return nullptr;
+            if (control == tag && m_equal(m_entries[slot].key, key))
+                return &m_entries[slot];
+        }
+    }
+
+    bool contains(const Key& key) const noexcept { return find(key) != nullptr; }
+
+    // Calls f(const entry&) for each entry in slot order.
+    template <typename F>
+    void for_each(F&& f) const {
+        for (size_t slot = 0; slot < m_capacity; slot++) {
+            if (table_type::is_full(m_control[slot]))
+                f(m_entries[slot]);
+        }
+    }
+
+private:
+    friend struct detail::serializer;
+
+    const uint8_t* m_control;
+    const entry* m_entries;
+    size_t m_capacity;
+    size_t m_size;
+    unsigned m_shift;
+    Hash m_hash;
+    KeyEqual m_equal;
+};
+
+// Write a snapshot of v to fd.
+template <typename T>
+void serialize(int fd, const vec<T>& v)
+{
+    static_assert(is_serializable<T>::value, "dtm::serialize requires a serializable element type");
+
+    size_t payload_size = sizeof(T) * v.size();
+    detail::snapshot_header h = detail::make_snapshot_header(
+        detail::snapshot_kind::vec, sizeof(T), v.size(), v.size(), payload_size);
+
+    iovec iov[2];
+    iov[0].iov_base = &h;
+    iov[0].iov_len = sizeof(h);
+    iov[1].iov_base = const_cast<T*>(v.data());
+    iov[1].iov_len = payload_size;
+    detail::write_all(fd, iov, payload_size ? 2 : 1);
+}
+
+// Replace the contents of v with the snapshot read from fd. Works for
+// small_vec as well.
+template <typename T>
+void deserialize(int fd, vec<T>& v)
+{
+    static_assert(is_serializable<T>::value, "dtm::deserialize requires a serializable element type");
+
+    detail::snapshot_header h;
+    detail::read_all(fd, &h, sizeof(h));
+    detail::check_snapshot_header(h, detail::snapshot_kind::vec, sizeof(T));
+    if (h.size > SIZE_MAX / sizeof(T) || h.payload_size != sizeof(T) * h.size)
+        throw serialize_error("dtm: corrupt snapshot");
+
+    v.clear();
+    v.resize_for_overwrite(h.size);
+    detail::read_all(fd, v.data(), h.payload_size);
+}
+
+// View a vec snapshot held in memory, typically a mapped file. buffer must
+// be suitably aligned for T and outlive the view.
+template <typename T>
+vec_view<T> view(const void* buffer, size_t length)
+{
+    static_assert(is_serializable<T>::value, "dtm::view requires a serializable element type");
+
+    if (length < sizeof(detail::snapshot_header))
+        throw serialize_error("dtm: snapshot is truncated");
+
+    detail::snapshot_header h;
+    memcpy(&h, buffer, sizeof(h));
+    detail::check_snapshot_header(h, detail::snapshot_kind::vec, sizeof(T));
+    if (h.size > SIZE_MAX / sizeof(T) || h.payload_size != sizeof(T) * h.size)
+        throw serialize_error("dtm: corrupt snapshot");
+    if (length - sizeof(h) < h.payload_size)
+        throw serialize_error("dtm: snapshot is truncated");
+
+    const T* begin = reinterpret_cast<const T*>(static_cast<const char*>(buffer) + sizeof(h));
+    return vec_view<T>(begin, h.size);
+}
+
+// Write a snapshot of table to fd. The snapshot stores slot positions, so
+// it can only be read back with the same hash function.
+template <typename K, typename V, typename H, typename E>
+void serialize(int fd, const hash_table<K, V, H, E>& table)
+{
+    detail::serializer::write(fd, table);
+}
+
+template <typename K, typename V, typename H, typename E>
+void deserialize(int fd, hash_table<K, V, H, E>& table)
+{
+    detail::serializer::read(fd, table);
+}
+
+// View a hash table snapshot held in memory, typically a mapped file.
+// buffer must be aligned for the entries and outlive the view. The control
+// bytes are checked once here, which reads them but copies nothing.
+template <typename K, typename V = empty_t, typename H = hash<K>, typename E = std::equal_to<K>>
+hash_table_view<K, V, H, E> view_hash_table(const void* buffer, size_t length)
+{
+    return detail::serializer::view<K, V, H, E>(buffer, length);
+}
+
+namespace detail {
+
+template <typename K, typename V, typename H, typename E>
+void serializer::write(int fd, const hash_table<K, V, H, E>& table)
+{
+    using table_type = hash_table<K, V, H, E>;
+    using entry = typename table_type::entry;
+    static_assert(is_serializable<K>::value && is_serializable<V>::value, "dtm::serialize requires serializable keys and values");
+
+    // Control bytes, then the entry array, whose empty and erased slots the
+    // table keeps zeroed.
+    size_t capacity = table.m_capacity;
+    size_t payload_size = capacity + sizeof(entry) * capacity;
+    snapshot_header h = make_snapshot_header(
+        snapshot_kind::hash_table, sizeof(entry), table.m_size, capacity, payload_size);
+
+    iovec iov[3];
+    iov[0].iov_base = &h;
+    iov[0].iov_len = sizeof(h);
+    iov[1].iov_base = table.m_control;
+    iov[1].iov_len = capacity;
+    iov[2].iov_base = table.m_entries;
+    iov[2].iov_len = sizeof(entry) * capacity;
+    write_all(fd, iov, capacity ? 3 : 1);
+}
+
+template <typename Table>
+size_t serializer::checked_capacity(const snapshot_header& h)
+{
+    using entry = typename Table::entry;
+
+    // A table is empty or a power of two of at least min_capacity slots;
+    // anything smaller would leave no bits for home_slot to shift in.
+    size_t capacity = h.capacity;
+    if (capacity != 0 && (capacity < Table::min_capacity || (capacity & (capacity - 1)) != 0))
+        throw serialize_error("dtm: corrupt snapshot");
+    if (capacity > SIZE_MAX / (sizeof(entry) + 1) || h.payload_size != capacity + sizeof(entry) * capacity)
+        throw serialize_error("dtm: corrupt snapshot");
+    if (!capacity && h.size != 0)
+        throw serialize_error("dtm: corrupt snapshot");
+    return capacity;
+}
+
+template <typename Table>
+size_t serializer::checked_erased(const uint8_t* control, size_t capacity, size_t size)
+{
+    // Every control byte must be empty, erased or full, the full ones must
+    // add up to the size, and the load must be within the 7/8 that keeps an
+    // empty slot to end every probe.
+    size_t full = 0;
+    size_t erased = 0;
+    bool known = true;
+    for (size_t slot = 0; slot < capacity; slot++) {
+        uint8_t c = control[slot];
+        full += Table::is_full(c);
+        erased += c == Table::control_erased;
+        known = known && (Table::is_full(c) || c <= Table::control_erased);
+    }
+    if (!known || full != size || (full + erased) * 8 > capacity * 7)
+        throw serialize_error("dtm: corrupt snapshot");
+    return erased;
+}
+
+template <typename K, typename V, typename H, typename E>
+void serializer::read(int fd, hash_table<K, V, H, E>& table)
+{
+    using table_type = hash_table<K, V, H, E>;
+    using entry = typename table_type::entry;
+    static_assert(is_serializable<K>::value && is_serializable<V>::value, "dtm::deserialize requires serializable keys and values");
+
+    snapshot_header h;
+    read_all(fd, &h, sizeof(h));
+    check_snapshot_header(h, snapshot_kind::hash_table, sizeof(entry));
+    size_t capacity = checked_capacity<table_type>(h);
+
+    table_type loaded;
+    if (capacity) {
+        loaded.allocate(capacity);
+        iovec iov[2];
+        iov[0].iov_base = loaded.m_control;
+        iov[0].iov_len = capacity;
+        iov[1].iov_base = loaded.m_entries;
+        iov[1].iov_len = sizeof(entry) * capacity;
+
+        // Until the control bytes are checked, loaded must not destroy the
+        // entries they claim are full.
+        try {
+            size_t remaining = h.payload_size;
+            while (remaining > 0) {
+                ssize_t got = ::readv(fd, iov, 2);
+                if (got < 0 && errno == EINTR)
+                    continue;
+                if (got < 0)
+                    throw std::system_error(errno, std::generic_category(), "dtm: readv");
+                if (got == 0)
+                    throw serialize_error("dtm: snapshot is truncated");
+
+                remaining -= static_cast<size_t>(got);
+                size_t advance = static_cast<size_t>(got);
+                for (iovec* v = iov; v != iov + 2 && advance > 0; ++v) {
+                    size_t step = advance < v->iov_len ? advance : v->iov_len;
+                    v->iov_base = static_cast<char*>(v->iov_base) + step;
+                    v->iov_len -= step;
+                    advance -= step;
+                }
+            }
+
+            loaded.m_erased = checked_erased<table_type>(loaded.m_control, capacity, h.size);
+            loaded.m_size = h.size;
+        }
+        catch (...) {
+            memset(loaded.m_control, table_type::control_empty, capacity);
+            throw;
+        }
+    }
+    table.swap(loaded);
+}
+
+template <typename K, typename V, typename H, typename E>
+hash_table_view<K, V, H, E> serializer::view(const void* buffer, size_t length)
+{
+    using table_type = hash_table<K, V, H, E>;
+    using entry = typename table_type::entry;
+    static_assert(is_serializable<K>::value && is_serializable<V>::value, "dtm::view_hash_table requires serializable keys and values");
+
+    if (length < sizeof(snapshot_header))
+        throw serialize_error("dtm: snapshot is truncated");
+
+    snapshot_header h;
+    memcpy(&h, buffer, sizeof(h));
+    check_snapshot_header(h, snapshot_kind::hash_table, sizeof(entry));
+    size_t capacity = checked_capacity<table_type>(h);
+    if (length - sizeof(h) < h.payload_size)
+        throw serialize_error("dtm: snapshot is truncated");
+
+    hash_table_view<K, V, H, E> result;
+    if (!capacity)
+        return result;
+
+    const char* control = static_cast<const char*>(buffer) + sizeof(h);
+    const char* entries = control + capacity;
+    if (reinterpret_cast<uintptr_t>(entries) % alignof(entry) != 0)
+        throw serialize_error("dtm: snapshot is misaligned");
+
+    result.m_control = reinterpret_cast<const uint8_t*>(control);
+    checked_erased<table_type>(result.m_control, capacity, h.size);
+    result.m_entries = reinterpret_cast<const entry*>(entries);
+    result.m_capacity = capacity;
+    result.m_size = h.size;
+    result.m_shift = sizeof(size_t) * 8 - __builtin_ctzll(capacity);
+    return result;
+}
+
+}
+
+}
+
+#endif //INCLUDED_DATUM_SERIALIZE_HPP
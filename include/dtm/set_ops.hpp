@@ -0,0 +1,425 @@
+// set_ops.hpp
+//
+// Intersection, union and merge of sorted sequences.
+//
+//     dtm::vec<uint32_t> hits;
+//     dtm::intersect(postings_a, postings_b, hits);
+//
+// intersect and unite treat their inputs as sets: each must be strictly
+// increasing, and so is the result. merge keeps every element of both
+// inputs, duplicates included, and only needs them to be non-decreasing.
+//
+// The vec overloads size the output for the worst case up front and write
+// into it directly, so an output vec with enough capacity is never
+// reallocated. The pointer overloads write to out, which must have room
+// for min(a_size, b_size) elements for intersect and a_size + b_size for
+// unite and merge, and return the number written.
+//
+// Any ordered type works through a scalar merge loop. uint32_t, the usual
+// type of posting lists, has vector kernels for SSE4.1 and AVX2 that are
+// chosen at run time from the CPU we are on, so one binary runs on any
+// x86-64 host. When one input is much shorter than the other, intersect
+// instead gallops through the long one, costing O(m log(n / m)) rather
+// than O(m + n).
+//
+
+#ifndef INCLUDED_DATUM_SET_OPS_HPP
+#define INCLUDED_DATUM_SET_OPS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "dtm/vec.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/cpu.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+// Gallop once the long input is this many times the length of the short
+// one.
+constexpr size_t set_gallop_ratio = 32;
+
+template <typename T>
+size_t intersect_scalar(const T* a, size_t a_size, const T* b, size_t b_size, T* out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < a_size && j < b_size) {
+        T x = a[i], y = b[j];
+        out[k] = x;
+        k += !(x < y) && !(y < x);
+        i += !(y < x);
+        j += !(x < y);
+    }
+    return k;
+}
+
+// Intersect a short set with a much longer one: find each element of
+// small by doubling steps through large, then a binary search within the
+// last step.
+template <typename T>
+size_t intersect_gallop(const T* small, size_t small_size, const T* large, size_t large_size, T* out) {
+    size_t k = 0;
+    size_t lo = 0;
+    for (size_t i = 0; i < small_size && lo < large_size; i++) {
+        const T& x = small[i];
+        size_t step = 1;
+        size_t hi = lo;
+        while (hi < large_size && large[hi] < x) {
+            lo = hi + 1;
+            hi += step;
+            step *= 2;
+        }
+        hi = std::min(hi, large_size);
+        lo = size_t(std::lower_bound(large + lo, large + hi, x) - large);
+        if (lo < large_size && !(x < large[lo]))
+            out[k++] = x;
+    }
+    return k;
+}
+
+template <typename T>
+size_t unite_scalar(const T* a, size_t a_size, const T* b, size_t b_size, T* out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < a_size && j < b_size) {
+        T x = a[i], y = b[j];
+        if (x < y) {
+            out[k++] = x;
+            i++;
+        } else if (y < x) {
+            out[k++] = y;
+            j++;
+        } else {
+            out[k++] = x;
+            i++;
+            j++;
+        }
+    }
+    k = size_t(std::copy(a + i, a + a_size, out + k) - out);
+    k = size_t(std::copy(b + j, b + b_size, out + k) - out);
+    return k;
+}
+
+template <typename T>
+size_t merge_scalar(const T* a, size_t a_size, const T* b, size_t b_size, T* out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < a_size && j < b_size) {
+        // Take from b only when strictly smaller, so equal elements of a
+        // come first.
+        bool take_b = b[j] < a[i];
+        out[k++] = take_b ? b[j] : a[i];
+        j += take_b;
+        i += !take_b;
+    }
+    k = size_t(std::copy(a + i, a + a_size, out + k) - out);
+    k = size_t(std::copy(b + j, b + b_size, out + k) - out);
+    return k;
+}
+
+#if DATUM_X86
+
+// Shuffles that move the lanes selected by a mask to the front of a
+// vector, for writing out only the matching elements of a block.
+struct set_compact_tables {
+    // pshufb control for each 4 bit mask of 32 bit lanes.
+    uint8_t sse[16][16];
+    // Lane indices for each 8 bit mask, one per byte, for vpermd.
+    uint64_t avx2[256];
+
+    constexpr set_compact_tables() : sse(), avx2() {
+        for (unsigned mask = 0; mask < 16; mask++) {
+            unsigned out = 0;
+            for (unsigned lane = 0; lane < 4; lane++) {
+                if (mask & (1u << lane)) {
+                    for (unsigned byte = 0; byte < 4; byte++)
+                        sse[mask][out * 4 + byte] = uint8_t(lane * 4 + byte);
+                    out++;
+                }
+            }
+            for (unsigned byte = out * 4; byte < 16; byte++)
+                sse[mask][byte] = 0x80;
+        }
+        for (unsigned mask = 0; mask < 256; mask++) {
+            unsigned out = 0;
+            uint64_t lanes = 0;
+            for (unsigned lane = 0; lane < 8; lane++) {
+                if (mask & (1u << lane))
+                    lanes |= uint64_t(lane) << (8 * out++);
+            }
+            avx2[mask] = lanes;
+        }
+    }
+};
+
+inline const set_compact_tables& set_tables() noexcept {
+    static constexpr set_compact_tables tables{};
+    return tables;
+}
+
+// Compare blocks of four from each input; every element of a's block is
+// checked against every rotation of b's. Whichever block has the smaller
+// last element is used up, or both if they are equal.
+//
+// The store writes all four lanes at out + k, however few of them match,
+// so the block loop runs only while four slots of the room at out are
+// left. A block that is not used up can match again against the next
+// block of the other input, so k is not bounded by min(i, j).
+DATUM_TARGET("sse4.1")
+inline size_t intersect_sse41(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size, uint32_t* out, size_t room) {
+    const set_compact_tables& tables = set_tables();
+    size_t i = 0, j = 0, k = 0;
+
+    while (i + 4 <= a_size && j + 4 <= b_size && k + 4 <= room) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+
+        __m128i eq0 = _mm_cmpeq_epi32(va, vb);
+        __m128i eq1 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)));
+        __m128i eq2 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)));
+        __m128i eq3 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)));
+        __m128i eq = _mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3));
+        unsigned mask = unsigned(_mm_movemask_ps(_mm_castsi128_ps(eq)));
+
+        __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.sse[mask]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), _mm_shuffle_epi8(va, shuffle));
+        k += size_t(__builtin_popcount(mask));
+
+        uint32_t a_last = a[i + 3], b_last = b[j + 3];
+        i += (a_last <= b_last) * 4;
+        j += (b_last <= a_last) * 4;
+    }
+
+    // The scalar loop only writes at out + k while another match is still
+    // possible, which the room always has space for.
+    return k + intersect_scalar(a + i, a_size - i, b + j, b_size - j, out + k);
+}
+
+// out has room for min(a_size, b_size), as for intersect.
+DATUM_TARGET("sse4.1")
+inline size_t intersect_sse41(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size, uint32_t* out) {
+    return intersect_sse41(a, a_size, b, b_size, out, std::min(a_size, b_size));
+}
+
+// As intersect_sse41, eight lanes at a time.
+DATUM_TARGET("avx2")
+inline size_t intersect_avx2(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size, uint32_t* out) {
+    const set_compact_tables& tables = set_tables();
+    const size_t room = std::min(a_size, b_size);
+    size_t i = 0, j = 0, k = 0;
+
+    const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+    while (i + 8 <= a_size && j + 8 <= b_size && k + 8 <= room) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+
+        __m256i eq = _mm256_cmpeq_epi32(va, vb);
+        for (int r = 1; r < 8; r++) {
+            vb = _mm256_permutevar8x32_epi32(vb, rotate);
+            eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(va, vb));
+        }
+        unsigned mask = unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+
+        __m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&tables.avx2[mask])));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + k), _mm256_permutevar8x32_epi32(va, lanes));
+        k += size_t(__builtin_popcount(mask));
+
+        uint32_t a_last = a[i + 7], b_last = b[j + 7];
+        i += (a_last <= b_last) * 8;
+        j += (b_last <= a_last) * 8;
+    }
+
+    return k + intersect_sse41(a + i, a_size - i, b + j, b_size - j, out + k, room - k);
+}
+
+// Merge two sorted vectors of four into the four smallest, in lo, and the
+// four largest, in hi, both sorted. b is reversed so that together they
+// form a bitonic sequence, which three rounds of min/max then sort.
+DATUM_TARGET("sse4.1")
+inline void bitonic_merge4(__m128i& lo, __m128i& hi) {
+    __m128i b = _mm_shuffle_epi32(hi, _MM_SHUFFLE(0, 1, 2, 3));
+    __m128i l1 = _mm_min_epu32(lo, b);
+    __m128i h1 = _mm_max_epu32(lo, b);
+
+    __m128i l1p = _mm_unpacklo_epi64(l1, h1);
+    __m128i h1p = _mm_unpackhi_epi64(l1, h1);
+    __m128i l2 = _mm_min_epu32(l1p, h1p);
+    __m128i h2 = _mm_max_epu32(l1p, h1p);
+
+    __m128i l2p = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(l2), _mm_castsi128_ps(h2), _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i h2p = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(l2), _mm_castsi128_ps(h2), _MM_SHUFFLE(3, 1, 3, 1)));
+    __m128i l3 = _mm_min_epu32(l2p, h2p);
+    __m128i h3 = _mm_max_epu32(l2p, h2p);
+
+    __m128i t0 = _mm_unpacklo_epi32(l3, h3);
+    __m128i t1 = _mm_unpackhi_epi32(l3, h3);
+    lo = _mm_unpacklo_epi64(t0, t1);
+    hi = _mm_unpackhi_epi64(t0, t1);
+}
+
+// Merge a and b four at a time. pending holds the four largest elements
+// seen so far; each step loads the next block from whichever input has
+// the smaller next element, and emits the lower half of merging it with
+// pending. Dedup drops elements equal to the one before them, which
+// turns the merge of two sets into their union.
+template <bool Dedup>
+DATUM_TARGET("sse4.1")
+size_t merge_sse41(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size, uint32_t* out) {
+    if (a_size < 4 || b_size < 4) {
+        return Dedup ? unite_scalar(a, a_size, b, b_size, out)
+                     : merge_scalar(a, a_size, b, b_size, out);
+    }
+
+    const set_compact_tables& tables = set_tables();
+    size_t i = 4, j = 4, k = 0;
+    __m128i emit = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    __m128i pending = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    // Something no element equals, for deduplicating the first block.
+    __m128i previous = _mm_set1_epi32(int(~std::min(a[0], b[0])));
+
+    for (;;) {
+        bitonic_merge4(emit, pending);
+        if (Dedup) {
+            // Elements still pending and not yet emitted number at least
+            // eight, so the four lane store stays in bounds.
+            __m128i shifted = _mm_alignr_epi8(emit, previous, 12);
+            __m128i dup = _mm_cmpeq_epi32(emit, shifted);
+            unsigned keep = ~unsigned(_mm_movemask_ps(_mm_castsi128_ps(dup))) & 0xf;
+            __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.sse[keep]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), _mm_shuffle_epi8(emit, shuffle));
+            k += size_t(__builtin_popcount(keep));
+            previous = emit;
+        } else {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), emit);
+            k += 4;
+        }
+
+        bool from_a;
+        if (i + 4 <= a_size && j + 4 <= b_size)
+            from_a = a[i] < b[j];
+        else
+            break;
+        if (from_a) {
+            emit = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            i += 4;
+        } else {
+            emit = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+            j += 4;
+        }
+    }
+
+    // Finish with a three way merge of pending and what is left of each
+    // input.
+    alignas(16) uint32_t rest[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(rest), pending);
+    uint32_t last = uint32_t(_mm_extract_epi32(previous, 3));
+    bool have_last = Dedup && k > 0;
+    size_t r = 0;
+    while (r < 4 || i < a_size || j < b_size) {
+        uint32_t x;
+        if (r < 4 && (i == a_size || rest[r] <= a[i]) && (j == b_size || rest[r] <= b[j]))
+            x = rest[r++];
+        else if (i < a_size && (j == b_size || a[i] <= b[j]))
+            x = a[i++];
+        else
+            x = b[j++];
+
+        if (Dedup) {
+            if (have_last && x == last)
+                continue;
+            last = x;
+            have_last = true;
+        }
+        out[k++] = x;
+    }
+    return k;
+}
+
+#endif
+
+} // namespace detail
+
+// Elements in both a and b. out needs room for min(a_size, b_size).
+template <typename T>
+size_t intersect(const T* a, size_t a_size, const T* b, size_t b_size, T* out) {
+    if (a_size > b_size) {
+        std::swap(a, b);
+        std::swap(a_size, b_size);
+    }
+    if (a_size * detail::set_gallop_ratio < b_size)
+        return detail::intersect_gallop(a, a_size, b, b_size, out);
+    return detail::intersect_scalar(a, a_size, b, b_size, out);
+}
+
+inline size_t intersect(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size, uint32_t* out) {
+    if (a_size > b_size) {
+        std::swap(a, b);
+        std::swap(a_size, b_size);
+    }
+    if (a_size * detail::set_gallop_ratio < b_size)
+        return detail::intersect_gallop(a, a_size, b, b_size, out);
+#if DATUM_X86
+    if (detail::cpu().avx2)
+        return detail::intersect_avx2(a, a_size, b, b_size, out);
+    if (detail::cpu().sse41)
+        return detail::intersect_sse41(a, a_size, b, b_size, out);
+#endif
+    return detail::intersect_scalar(a, a_size, b, b_size, out);
+}
+
+// Elements in a or b or both. out needs room for a_size + b_size.
+template <typename T>
+size_t unite(const T* a, size_t a_size, const T* b, size_t b_size, T* out) {
+    return detail::unite_scalar(a, a_size, b, b_size, out);
+}
+
+inline size_t unite(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size, uint32_t* out) {
+#if DATUM_X86
+    if (detail::cpu().sse41)
+        return detail::merge_sse41<true>(a, a_size, b, b_size, out);
+#endif
+    return detail::unite_scalar(a, a_size, b, b_size, out);
+}
+
+// All elements of a and b in order. out needs room for a_size + b_size.
+template <typename T>
+size_t merge(const T* a, size_t a_size, const T* b, size_t b_size, T* out) {
+    return detail::merge_scalar(a, a_size, b, b_size, out);
+}
+
+inline size_t merge(const uint32_t* a, size_t a_size, const uint32_t* b, size_t b_size, uint32_t* out) {
+#if DATUM_X86
+    if (detail::cpu().sse41)
+        return detail::merge_sse41<false>(a, a_size, b, b_size, out);
+#endif
+    return detail::merge_scalar(a, a_size, b, b_size, out);
+}
+
+// Replace the contents of out with the intersection of a and b.
+template <typename T>
+void intersect(const vec<T>& a, const vec<T>& b, vec<T>& out) {
+    out.clear();
+    out.resize_for_overwrite(std::min(a.size(), b.size()));
+    out.resize(intersect(a.data(), a.size(), b.data(), b.size(), out.data()));
+}
+
+// Replace the contents of out with the union of a and b.
+template <typename T>
+void unite(const vec<T>& a, const vec<T>& b, vec<T>& out) {
+    out.clear();
+    out.resize_for_overwrite(a.size() + b.size());
+    out.resize(unite(a.data(), a.size(), b.data(), b.size(), out.data()));
+}
+
+// Replace the contents of out with the merge of a and b.
+template <typename T>
+void merge(const vec<T>& a, const vec<T>& b, vec<T>& out) {
+    out.clear();
+    out.resize_for_overwrite(a.size() + b.size());
+    merge(a.data(), a.size(), b.data(), b.size(), out.data());
+}
+
+}
+
+#endif //INCLUDED_DATUM_SET_OPS_HPP
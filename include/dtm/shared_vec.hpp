@@ -0,0 +1,128 @@
+// shared_vec.hpp
+//
+// An immutable array shared by reference count, for handing the same large
+// data to many threads.
+//
+//     dtm::vec<double> weights = load_weights();
+//     dtm::shared_vec<double> shared(std::move(weights));
+//     for (int t = 0; t < 8; t++)
+//         threads.emplace_back([shared] { use(shared[0]); });
+//
+//     dtm::span<double> mine = shared.mutate();   // copies if shared
+//
+// A shared_ptr<vec<T>> reaches the elements through two pointers and two
+// allocations. shared_vec keeps the elements and an atomic reference
+// count in one allocation and points straight at the elements, so it is a
+// pointer and a size, copying it is an atomic increment, and reading it is
+// as cheap as reading a vec.
+//
+// The count sits after the elements rather than before them. That lets a
+// vec be converted without copying its elements: if the vec's spare
+// capacity has room for the count, its buffer is taken as it is, and
+// otherwise a relocatable vec's buffer is realloc'ed a little bigger. Only
+// non-relocatable elements with no spare room are moved one by one.
+//
+// Copies are read only. mutate gives write access, copying the elements
+// first unless this shared_vec holds the only reference. Like shared_ptr,
+// distinct shared_vecs of the same elements may be copied, destroyed and
+// read from different threads at once; one shared_vec object may not be
+// written by one thread while another uses it.
+//
+
+#ifndef INCLUDED_DATUM_SHARED_VEC_HPP
+#define INCLUDED_DATUM_SHARED_VEC_HPP
+
+#include <atomic>
+#include <initializer_list>
+#include <new>
+#include <utility>
+#include <stdexcept>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "dtm/vec.hpp"
+#include "dtm/iterator.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+struct shared_vec_header {
+    std::atomic<size_t> references;
+};
+
+}
+
+template <typename T>
+class shared_vec {
+public:
+    using value_type = T;
+    using iterator = const T*;
+    using const_iterator = const T*;
+
+    shared_vec() noexcept;
+
+    // Takes over v's buffer where it can. v is left empty.
+    explicit shared_vec(vec<T>&& v);
+    explicit shared_vec(const vec<T>& v);
+    shared_vec(std::initializer_list<T> init);
+
+    shared_vec(const shared_vec& rhs) noexcept;
+    shared_vec(shared_vec&& rhs) noexcept;
+    ~shared_vec();
+
+    shared_vec& operator= (const shared_vec& rhs) noexcept;
+    shared_vec& operator= (shared_vec&& rhs) noexcept;
+
+    void swap(shared_vec& rhs) noexcept;
+
+    size_t size() const noexcept;
+    bool empty() const noexcept;
+
+    const T* data() const noexcept;
+    const T& operator[] (size_t index) const noexcept;
+    const T& at(size_t index) const;
+    const T& front() const noexcept;
+    const T& back() const noexcept;
+
+    const T* begin() const noexcept;
+    const T* end() const noexcept;
+
+    // Number of shared_vecs holding these elements; 0 when empty.
+    size_t use_count() const noexcept;
+    bool unique() const noexcept;
+
+    // Writable elements. Copies them first if they are shared, so other
+    // holders never see the writes.
+    span<T> mutate();
+
+    // A vec with a copy of the elements.
+    vec<T> to_vec() const;
+
+    // Drops this reference.
+    void reset() noexcept;
+
+private:
+    T* m_data;
+    size_t m_size;
+
+    static size_t header_offset(size_t size) noexcept;
+    detail::shared_vec_header* header() const noexcept;
+
+    // Room for size elements and the header, with the header set to one
+    // reference.
+    void allocate(size_t size);
+
+    template <typename It>
+    void copy_from(It first, size_t size);
+};
+
+}
+
+// Implementation of shared_vec is in detail/shared_vec_impl.hpp
+#define INCLUDING_DATUM_DETAIL_SHARED_VEC_IMPL_HPP
+#include "detail/shared_vec_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_SHARED_VEC_IMPL_HPP
+
+#endif //INCLUDED_DATUM_SHARED_VEC_HPP
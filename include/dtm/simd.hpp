@@ -0,0 +1,509 @@
+// simd.hpp
+//
+// Vectorized searches and reductions over contiguous numbers.
+//
+//     dtm::vec<float> prices = ...;
+//     float lowest = dtm::simd::min(prices);
+//     size_t first_zero = dtm::simd::find(prices, 0.0f);
+//
+// Every function takes a vec, small_vec, span or anything else with data()
+// and size(). Loops like these often don't auto-vectorize: find and count
+// exit early or branch per element, and min, max and sum of floats need
+// reassociation the compiler may not do on its own.
+//
+// int32_t and float have SSE2, AVX2 and AVX-512 kernels. The widest one
+// the CPU supports is chosen the first time a type is used. Other
+// arithmetic types use plain loops.
+//
+// sum adds into int64_t, uint64_t or double, so int32_t sums don't
+// overflow and float sums keep their precision. min and max of an empty
+// range return the largest and smallest value of the type (infinities for
+// floats); with NaNs in the input their result is unspecified.
+//
+
+#ifndef INCLUDED_DATUM_SIMD_HPP
+#define INCLUDED_DATUM_SIMD_HPP
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "dtm/iterator.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/cpu.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+template <typename T, typename = void>
+struct simd_sum { using type = double; };
+
+template <typename T>
+struct simd_sum<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type> {
+    using type = int64_t;
+};
+
+template <typename T>
+struct simd_sum<T, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type> {
+    using type = uint64_t;
+};
+
+template <typename T>
+using simd_sum_t = typename simd_sum<T>::type;
+
+template <typename T>
+constexpr T simd_highest() noexcept {
+    return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                : std::numeric_limits<T>::max();
+}
+
+template <typename T>
+constexpr T simd_lowest() noexcept {
+    return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity()
+                                                : std::numeric_limits<T>::lowest();
+}
+
+template <typename C>
+using simd_element_t = typename std::remove_const<
+    typename decltype(make_span(std::declval<const C&>()))::element_type>::type;
+
+// Plain loops, for types without vector kernels and for the ends of
+// ranges the kernels leave over.
+
+template <typename T>
+size_t find_scalar(const T* data, size_t size, T value) {
+    for (size_t i = 0; i < size; i++) {
+        if (data[i] == value)
+            return i;
+    }
+    return size;
+}
+
+template <typename T>
+size_t count_scalar(const T* data, size_t size, T value) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; i++)
+        count += data[i] == value;
+    return count;
+}
+
+template <typename T>
+T min_scalar(const T* data, size_t size) {
+    T result = simd_highest<T>();
+    for (size_t i = 0; i < size; i++)
+        result = data[i] < result ? data[i] : result;
+    return result;
+}
+
+template <typename T>
+T max_scalar(const T* data, size_t size) {
+    T result = simd_lowest<T>();
+    for (size_t i = 0; i < size; i++)
+        result = result < data[i] ? data[i] : result;
+    return result;
+}
+
+template <typename T>
+simd_sum_t<T> sum_scalar(const T* data, size_t size) {
+    simd_sum_t<T> result = 0;
+    for (size_t i = 0; i < size; i++)
+        result += data[i];
+    return result;
+}
+
+enum class simd_level {
+    scalar,
+    sse2,
+    avx2,
+    avx512
+};
+
+template <typename T>
+struct simd_functions {
+    size_t (*find)(const T*, size_t, T);
+    size_t (*count)(const T*, size_t, T);
+    T (*min)(const T*, size_t);
+    T (*max)(const T*, size_t);
+    simd_sum_t<T> (*sum)(const T*, size_t);
+};
+
+// Types without vector kernels always get the plain loops.
+template <typename T>
+simd_functions<T> make_simd_functions(simd_level) noexcept {
+    return { &find_scalar<T>, &count_scalar<T>, &min_scalar<T>, &max_scalar<T>, &sum_scalar<T> };
+}
+
+#if DATUM_X86
+
+inline simd_level best_simd_level() noexcept {
+    const cpu_features& features = cpu();
+    if (features.avx512f && features.popcnt)
+        return simd_level::avx512;
+    if (features.avx2 && features.popcnt)
+        return simd_level::avx2;
+    return simd_level::sse2;
+}
+
+// Each ISA has an ops struct per element type with the same members:
+//
+//     vec            the vector type, holding lanes elements
+//     load, set1     load from memory, broadcast a value
+//     eq_mask        one bit per lane, set where the lanes are equal
+//     min, max       lanewise
+//     acc            a pair of vectors summing in the wider sum type
+//     add_to, total  widen and accumulate a vector; reduce to a number
+//
+// The kernels below are generic over the ops struct, but the target
+// attribute can't be, and a function only inlines into one compiled for
+// at least its ISA. So DATUM_SIMD_KERNELS stamps out the kernels once per
+// ISA.
+
+struct sse2_i32 {
+    using value_type = int32_t;
+    using vec = __m128i;
+    static constexpr size_t lanes = 4;
+    struct acc { __m128i lo, hi; };
+
+    DATUM_TARGET("sse2") static vec load(const int32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    DATUM_TARGET("sse2") static vec set1(int32_t x) { return _mm_set1_epi32(x); }
+    DATUM_TARGET("sse2") static uint64_t eq_mask(vec a, vec b) {
+        return uint64_t(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))));
+    }
+    // SSE2 has no 32 bit min or max; select with a comparison instead.
+    DATUM_TARGET("sse2") static vec min(vec a, vec b) {
+        __m128i gt = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+    }
+    DATUM_TARGET("sse2") static vec max(vec a, vec b) {
+        __m128i gt = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+    }
+    DATUM_TARGET("sse2") static acc acc_zero() { return { _mm_setzero_si128(), _mm_setzero_si128() }; }
+    DATUM_TARGET("sse2") static void add_to(acc& s, vec v) {
+        __m128i sign = _mm_cmpgt_epi32(_mm_setzero_si128(), v);
+        s.lo = _mm_add_epi64(s.lo, _mm_unpacklo_epi32(v, sign));
+        s.hi = _mm_add_epi64(s.hi, _mm_unpackhi_epi32(v, sign));
+    }
+    DATUM_TARGET("sse2") static int64_t total(const acc& s) {
+        int64_t parts[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(parts), _mm_add_epi64(s.lo, s.hi));
+        return parts[0] + parts[1];
+    }
+};
+
+struct sse2_f32 {
+    using value_type = float;
+    using vec = __m128;
+    static constexpr size_t lanes = 4;
+    struct acc { __m128d lo, hi; };
+
+    DATUM_TARGET("sse2") static vec load(const float* p) { return _mm_loadu_ps(p); }
+    DATUM_TARGET("sse2") static vec set1(float x) { return _mm_set1_ps(x); }
+    DATUM_TARGET("sse2") static uint64_t eq_mask(vec a, vec b) { return uint64_t(_mm_movemask_ps(_mm_cmpeq_ps(a, b))); }
+    DATUM_TARGET("sse2") static vec min(vec a, vec b) { return _mm_min_ps(a, b); }
+    DATUM_TARGET("sse2") static vec max(vec a, vec b) { return _mm_max_ps(a, b); }
+    DATUM_TARGET("sse2") static acc acc_zero() { return { _mm_setzero_pd(), _mm_setzero_pd() }; }
+    DATUM_TARGET("sse2") static void add_to(acc& s, vec v) {
+        s.lo = _mm_add_pd(s.lo, _mm_cvtps_pd(v));
+        s.hi = _mm_add_pd(s.hi, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+    DATUM_TARGET("sse2") static double total(const acc& s) {
+        double parts[2];
+        _mm_storeu_pd(parts, _mm_add_pd(s.lo, s.hi));
+        return parts[0] + parts[1];
+    }
+};
+
+struct avx2_i32 {
+    using value_type = int32_t;
+    using vec = __m256i;
+    static constexpr size_t lanes = 8;
+    struct acc { __m256i lo, hi; };
+
+    DATUM_TARGET("avx2") static vec load(const int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    DATUM_TARGET("avx2") static vec set1(int32_t x) { return _mm256_set1_epi32(x); }
+    DATUM_TARGET("avx2") static uint64_t eq_mask(vec a, vec b) {
+        return uint64_t(unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)))));
+    }
+    DATUM_TARGET("avx2") static vec min(vec a, vec b) { return _mm256_min_epi32(a, b); }
+    DATUM_TARGET("avx2") static vec max(vec a, vec b) { return _mm256_max_epi32(a, b); }
+    DATUM_TARGET("avx2") static acc acc_zero() { return { _mm256_setzero_si256(), _mm256_setzero_si256() }; }
+    DATUM_TARGET("avx2") static void add_to(acc& s, vec v) {
+        s.lo = _mm256_add_epi64(s.lo, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+        s.hi = _mm256_add_epi64(s.hi, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    DATUM_TARGET("avx2") static int64_t total(const acc& s) {
+        int64_t parts[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(parts), _mm256_add_epi64(s.lo, s.hi));
+        return parts[0] + parts[1] + parts[2] + parts[3];
+    }
+};
+
+struct avx2_f32 {
+    using value_type = float;
+    using vec = __m256;
+    static constexpr size_t lanes = 8;
+    struct acc { __m256d lo, hi; };
+
+    DATUM_TARGET("avx2") static vec load(const float* p) { return _mm256_loadu_ps(p); }
+    DATUM_TARGET("avx2") static vec set1(float x) { return _mm256_set1_ps(x); }
+    DATUM_TARGET("avx2") static uint64_t eq_mask(vec a, vec b) {
+        return uint64_t(unsigned(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ))));
+    }
+    DATUM_TARGET("avx2") static vec min(vec a, vec b) { return _mm256_min_ps(a, b); }
+    DATUM_TARGET("avx2") static vec max(vec a, vec b) { return _mm256_max_ps(a, b); }
+    DATUM_TARGET("avx2") static acc acc_zero() { return { _mm256_setzero_pd(), _mm256_setzero_pd() }; }
+    DATUM_TARGET("avx2") static void add_to(acc& s, vec v) {
+        s.lo = _mm256_add_pd(s.lo, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+        s.hi = _mm256_add_pd(s.hi, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+    }
+    DATUM_TARGET("avx2") static double total(const acc& s) {
+        double parts[4];
+        _mm256_storeu_pd(parts, _mm256_add_pd(s.lo, s.hi));
+        return parts[0] + parts[1] + parts[2] + parts[3];
+    }
+};
+
+// GCC 12's AVX-512 intrinsics start from _mm512_undefined vectors, which
+// trips the uninitialized warnings wherever they are inlined.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+struct avx512_i32 {
+    using value_type = int32_t;
+    using vec = __m512i;
+    static constexpr size_t lanes = 16;
+    struct acc { __m512i lo, hi; };
+
+    DATUM_TARGET("avx512f") static vec load(const int32_t* p) { return _mm512_loadu_si512(p); }
+    DATUM_TARGET("avx512f") static vec set1(int32_t x) { return _mm512_set1_epi32(x); }
+    DATUM_TARGET("avx512f") static uint64_t eq_mask(vec a, vec b) { return uint64_t(_mm512_cmpeq_epi32_mask(a, b)); }
+    DATUM_TARGET("avx512f") static vec min(vec a, vec b) { return _mm512_min_epi32(a, b); }
+    DATUM_TARGET("avx512f") static vec max(vec a, vec b) { return _mm512_max_epi32(a, b); }
+    DATUM_TARGET("avx512f") static acc acc_zero() { return { _mm512_setzero_si512(), _mm512_setzero_si512() }; }
+    DATUM_TARGET("avx512f") static void add_to(acc& s, vec v) {
+        s.lo = _mm512_add_epi64(s.lo, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(v)));
+        s.hi = _mm512_add_epi64(s.hi, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(v, 1)));
+    }
+    DATUM_TARGET("avx512f") static int64_t total(const acc& s) {
+        return int64_t(_mm512_reduce_add_epi64(_mm512_add_epi64(s.lo, s.hi)));
+    }
+};
+
+struct avx512_f32 {
+    using value_type = float;
+    using vec = __m512;
+    static constexpr size_t lanes = 16;
+    struct acc { __m512d lo, hi; };
+
+    DATUM_TARGET("avx512f") static vec load(const float* p) { return _mm512_loadu_ps(p); }
+    DATUM_TARGET("avx512f") static vec set1(float x) { return _mm512_set1_ps(x); }
+    DATUM_TARGET("avx512f") static uint64_t eq_mask(vec a, vec b) { return uint64_t(_mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ)); }
+    DATUM_TARGET("avx512f") static vec min(vec a, vec b) { return _mm512_min_ps(a, b); }
+    DATUM_TARGET("avx512f") static vec max(vec a, vec b) { return _mm512_max_ps(a, b); }
+    DATUM_TARGET("avx512f") static acc acc_zero() { return { _mm512_setzero_pd(), _mm512_setzero_pd() }; }
+    DATUM_TARGET("avx512f") static void add_to(acc& s, vec v) {
+        s.lo = _mm512_add_pd(s.lo, _mm512_cvtps_pd(_mm512_castps512_ps256(v)));
+        s.hi = _mm512_add_pd(s.hi, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1))));
+    }
+    DATUM_TARGET("avx512f") static double total(const acc& s) {
+        return _mm512_reduce_add_pd(_mm512_add_pd(s.lo, s.hi));
+    }
+};
+
+// The kernels work on four vectors per iteration, so find and count test
+// one combined mask per 4 * lanes elements, and the reductions keep four
+// independent accumulators. What's left at the end goes to the plain loop.
+#define DATUM_SIMD_KERNELS(isa, target, popcount)                                               \
+template <typename Ops>                                                                         \
+DATUM_TARGET(target)                                                                            \
+size_t find_##isa(const typename Ops::value_type* data, size_t size, typename Ops::value_type value) { \
+    constexpr size_t L = Ops::lanes;                                                            \
+    typename Ops::vec needle = Ops::set1(value);                                                \
+    size_t i = 0;                                                                               \
+    for (; i + 4 * L <= size; i += 4 * L) {                                                     \
+        uint64_t mask = Ops::eq_mask(Ops::load(data + i), needle)                               \
+                      | Ops::eq_mask(Ops::load(data + i + L), needle) << L                      \
+                      | Ops::eq_mask(Ops::load(data + i + 2 * L), needle) << (2 * L)            \
+                      | Ops::eq_mask(Ops::load(data + i + 3 * L), needle) << (3 * L);           \
+        if (mask)                                                                               \
+            return i + size_t(__builtin_ctzll(mask));                                           \
+    }                                                                                           \
+    return i + find_scalar(data + i, size - i, value);                                          \
+}                                                                                               \
+                                                                                                \
+template <typename Ops>                                                                         \
+DATUM_TARGET(target)                                                                            \
+size_t count_##isa(const typename Ops::value_type* data, size_t size, typename Ops::value_type value) { \
+    constexpr size_t L = Ops::lanes;                                                            \
+    typename Ops::vec needle = Ops::set1(value);                                                \
+    size_t count = 0;                                                                           \
+    size_t i = 0;                                                                               \
+    for (; i + 4 * L <= size; i += 4 * L) {                                                     \
+        uint64_t mask = Ops::eq_mask(Ops::load(data + i), needle)                               \
+                      | Ops::eq_mask(Ops::load(data + i + L), needle) << L                      \
+                      | Ops::eq_mask(Ops::load(data + i + 2 * L), needle) << (2 * L)            \
+                      | Ops::eq_mask(Ops::load(data + i + 3 * L), needle) << (3 * L);           \
+        count += size_t(popcount(mask));                                                        \
+    }                                                                                           \
+    return count + count_scalar(data + i, size - i, value);                                     \
+}                                                                                               \
+                                                                                                \
+template <typename Ops, bool Max>                                                               \
+DATUM_TARGET(target)                                                                            \
+typename Ops::value_type extreme_##isa(const typename Ops::value_type* data, size_t size) {     \
+    using T = typename Ops::value_type;                                                         \
+    constexpr size_t L = Ops::lanes;                                                            \
+    T result = Max ? max_scalar(data, size % (4 * L)) : min_scalar(data, size % (4 * L));       \
+    if (size < 4 * L)                                                                           \
+        return result;                                                                          \
+    size_t i = size % (4 * L);                                                                  \
+    typename Ops::vec r0 = Ops::load(data + i), r1 = Ops::load(data + i + L);                   \
+    typename Ops::vec r2 = Ops::load(data + i + 2 * L), r3 = Ops::load(data + i + 3 * L);       \
+    for (i += 4 * L; i < size; i += 4 * L) {                                                    \
+        if (Max) {                                                                              \
+            r0 = Ops::max(r0, Ops::load(data + i));                                             \
+            r1 = Ops::max(r1, Ops::load(data + i + L));                                         \
+            r2 = Ops::max(r2, Ops::load(data + i + 2 * L));                                     \
+            r3 = Ops::max(r3, Ops::load(data + i + 3 * L));                                     \
+        } else {                                                                                \
+            r0 = Ops::min(r0, Ops::load(data + i));                                             \
+            r1 = Ops::min(r1, Ops::load(data + i + L));                                         \
+            r2 = Ops::min(r2, Ops::load(data + i + 2 * L));                                     \
+            r3 = Ops::min(r3, Ops::load(data + i + 3 * L));                                     \
+        }                                                                                       \
+    }                                                                                           \
+    r0 = Max ? Ops::max(Ops::max(r0, r1), Ops::max(r2, r3))                                     \
+             : Ops::min(Ops::min(r0, r1), Ops::min(r2, r3));                                    \
+    T lane_values[L];                                                                           \
+    memcpy(lane_values, &r0, sizeof(r0));                                                       \
+    T lanes_result = Max ? max_scalar(lane_values, L) : min_scalar(lane_values, L);             \
+    return Max ? std::max(result, lanes_result) : std::min(result, lanes_result);               \
+}                                                                                               \
+                                                                                                \
+template <typename Ops>                                                                         \
+DATUM_TARGET(target)                                                                            \
+simd_sum_t<typename Ops::value_type> sum_##isa(const typename Ops::value_type* data, size_t size) { \
+    constexpr size_t L = Ops::lanes;                                                            \
+    typename Ops::acc s0 = Ops::acc_zero(), s1 = Ops::acc_zero();                               \
+    typename Ops::acc s2 = Ops::acc_zero(), s3 = Ops::acc_zero();                               \
+    size_t i = 0;                                                                               \
+    for (; i + 4 * L <= size; i += 4 * L) {                                                     \
+        Ops::add_to(s0, Ops::load(data + i));                                                   \
+        Ops::add_to(s1, Ops::load(data + i + L));                                               \
+        Ops::add_to(s2, Ops::load(data + i + 2 * L));                                           \
+        Ops::add_to(s3, Ops::load(data + i + 3 * L));                                           \
+    }                                                                                           \
+    return (Ops::total(s0) + Ops::total(s1)) + (Ops::total(s2) + Ops::total(s3))                \
+         + sum_scalar(data + i, size - i);                                                      \
+}                                                                                               \
+                                                                                                \
+template <typename Ops>                                                                         \
+simd_functions<typename Ops::value_type> isa##_functions() noexcept {                           \
+    return { &find_##isa<Ops>, &count_##isa<Ops>, &extreme_##isa<Ops, false>,                   \
+             &extreme_##isa<Ops, true>, &sum_##isa<Ops> };                                      \
+}
+
+DATUM_SIMD_KERNELS(sse2, "sse2", popcount_swar)
+DATUM_SIMD_KERNELS(avx2, "avx2,popcnt", __builtin_popcountll)
+DATUM_SIMD_KERNELS(avx512, "avx512f,popcnt", __builtin_popcountll)
+
+#undef DATUM_SIMD_KERNELS
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+template <>
+inline simd_functions<int32_t> make_simd_functions<int32_t>(simd_level level) noexcept {
+    switch (level) {
+    case simd_level::avx512: return avx512_functions<avx512_i32>();
+    case simd_level::avx2: return avx2_functions<avx2_i32>();
+    case simd_level::sse2: return sse2_functions<sse2_i32>();
+    default: return { &find_scalar<int32_t>, &count_scalar<int32_t>, &min_scalar<int32_t>,
+                      &max_scalar<int32_t>, &sum_scalar<int32_t> };
+    }
+}
+
+template <>
+inline simd_functions<float> make_simd_functions<float>(simd_level level) noexcept {
+    switch (level) {
+    case simd_level::avx512: return avx512_functions<avx512_f32>();
+    case simd_level::avx2: return avx2_functions<avx2_f32>();
+    case simd_level::sse2: return sse2_functions<sse2_f32>();
+    default: return { &find_scalar<float>, &count_scalar<float>, &min_scalar<float>,
+                      &max_scalar<float>, &sum_scalar<float> };
+    }
+}
+
+#else
+
+inline simd_level best_simd_level() noexcept {
+    return simd_level::scalar;
+}
+
+#endif
+
+// The kernels for T on this CPU, picked on first use.
+template <typename T>
+const simd_functions<T>& simd_functions_for() noexcept {
+    static const simd_functions<T> functions = make_simd_functions<T>(best_simd_level());
+    return functions;
+}
+
+} // namespace detail
+
+namespace simd {
+
+// Index of the first element equal to value, or size() if there is none.
+template <typename C>
+size_t find(const C& c, detail::simd_element_t<C> value) {
+    auto s = make_span(c);
+    return detail::simd_functions_for<detail::simd_element_t<C>>().find(s.data(), s.size(), value);
+}
+
+template <typename C>
+bool contains(const C& c, detail::simd_element_t<C> value) {
+    auto s = make_span(c);
+    return simd::find(s, value) != s.size();
+}
+
+// Number of elements equal to value.
+template <typename C>
+size_t count(const C& c, detail::simd_element_t<C> value) {
+    auto s = make_span(c);
+    return detail::simd_functions_for<detail::simd_element_t<C>>().count(s.data(), s.size(), value);
+}
+
+template <typename C>
+detail::simd_element_t<C> min(const C& c) {
+    auto s = make_span(c);
+    return detail::simd_functions_for<detail::simd_element_t<C>>().min(s.data(), s.size());
+}
+
+template <typename C>
+detail::simd_element_t<C> max(const C& c) {
+    auto s = make_span(c);
+    return detail::simd_functions_for<detail::simd_element_t<C>>().max(s.data(), s.size());
+}
+
+template <typename C>
+detail::simd_sum_t<detail::simd_element_t<C>> sum(const C& c) {
+    auto s = make_span(c);
+    return detail::simd_functions_for<detail::simd_element_t<C>>().sum(s.data(), s.size());
+}
+
+} // namespace simd
+
+}
+
+#endif //INCLUDED_DATUM_SIMD_HPP
@@ -0,0 +1,587 @@
+// sort.hpp
+//
+// Unstable comparison sort for vecs and contiguous ranges.
+//
+//     dtm::sort(v);
+//     dtm::sort(v, [](const record& a, const record& b) { return a.id < b.id; });
+//
+// This is pattern-defeating quicksort (Orson Peters' pdqsort): introsort
+// with median-of-3 / ninther pivots, detection of already partitioned and
+// many-equal inputs, shuffling of unlucky partitions and a heapsort
+// fallback, so it is O(n log n) worst case and linear on sorted input.
+//
+// On top of that:
+//   - Small trivially copyable elements are partitioned branchlessly in
+//     blocks (BlockQuicksort): comparison results become offsets rather
+//     than branches, so random data no longer pays for mispredictions.
+//   - Ranges of up to 8 elements are finished with sorting networks of
+//     compare-exchanges, which compile to conditional moves for those
+//     same element types.
+//   - Relocatable elements are moved with memcpy/memmove instead of move
+//     constructors and assignments.
+//
+// Comparisons must not throw.
+//
+// The pdqsort parts are adapted from pdqsort.h and altered as above; its
+// notice follows.
+//
+//     pdqsort.h - Pattern-defeating quicksort.
+//
+//     Copyright (c) 2021 Orson Peters
+//
+//     This software is provided 'as-is', without any express or implied
+//     warranty. In no event will the authors be held liable for any damages
+//     arising from the use of this software.
+//
+//     Permission is granted to anyone to use this software for any purpose,
+//     including commercial applications, and to alter it and redistribute it
+//     freely, subject to the following restrictions:
+//
+//     1. The origin of this software must not be misrepresented; you must not
+//        claim that you wrote the original software. If you use this software
+//        in a product, an acknowledgment in the product documentation would be
+//        appreciated but is not required.
+//
+//     2. Altered source versions must be plainly marked as such, and must not
+//        be misrepresented as being the original software.
+//
+//     3. This notice may not be removed or altered from any source
+//        distribution.
+//
+
+#ifndef INCLUDED_DATUM_SORT_HPP
+#define INCLUDED_DATUM_SORT_HPP
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "dtm/vec.hpp"
+
+namespace dtm {
+
+namespace detail {
+
+constexpr ptrdiff_t sort_insertion_threshold = 24;
+constexpr ptrdiff_t sort_ninther_threshold = 128;
+constexpr size_t sort_partial_insertion_limit = 8;
+constexpr size_t sort_block_size = 64;
+
+// Element moves used by the sort. Relocatable elements are moved as bytes
+// and the slot they leave is treated as raw storage until it is refilled.
+template <typename T, bool Relocate = is_relocatable<T>::value>
+struct sort_ops {
+    class holder {
+    public:
+        holder() = default;
+        holder(const holder&) = delete;
+        holder& operator= (const holder&) = delete;
+
+        T& get() noexcept { return *reinterpret_cast<T*>(&m_storage); }
+
+    private:
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+    };
+
+    // src becomes a hole.
+    static void take(holder& h, T* src) noexcept {
+        memcpy(static_cast<void*>(&h.get()), src, sizeof(T));
+    }
+
+    // dst must be a hole.
+    static void put(T* dst, holder& h) noexcept {
+        memcpy(static_cast<void*>(dst), &h.get(), sizeof(T));
+    }
+
+    // dst must be a hole, src becomes one.
+    static void move(T* dst, T* src) noexcept {
+        memcpy(static_cast<void*>(dst), src, sizeof(T));
+    }
+
+    // Move [first, last) up by one; *last must be a hole, *first becomes one.
+    static void shift_up(T* first, T* last) noexcept {
+        memmove(static_cast<void*>(first + 1), first, (last - first) * sizeof(T));
+    }
+
+    static void swap(T* a, T* b) noexcept {
+        holder tmp;
+        take(tmp, a);
+        move(a, b);
+        put(b, tmp);
+    }
+};
+
+template <typename T>
+struct sort_ops<T, false> {
+    class holder {
+    public:
+        holder() : m_full(false) {}
+        holder(const holder&) = delete;
+        holder& operator= (const holder&) = delete;
+        ~holder() { if (m_full) get().~T(); }
+
+        T& get() noexcept { return *reinterpret_cast<T*>(&m_storage); }
+
+    private:
+        friend struct sort_ops;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+        bool m_full;
+    };
+
+    static void take(holder& h, T* src) {
+        new (&h.m_storage) T(std::move(*src));
+        h.m_full = true;
+    }
+
+    static void put(T* dst, holder& h) {
+        *dst = std::move(h.get());
+    }
+
+    static void move(T* dst, T* src) {
+        *dst = std::move(*src);
+    }
+
+    static void shift_up(T* first, T* last) {
+        std::move_backward(first, last, last + 1);
+    }
+
+    static void swap(T* a, T* b) {
+        using std::swap;
+        swap(*a, *b);
+    }
+};
+
+// Whether partitioning and compare-exchanges should avoid branches.
+template <typename T>
+struct sort_branchless {
+    static constexpr bool value = std::is_trivially_copyable<T>::value && sizeof(T) <= 16;
+};
+
+template <typename T, typename Compare>
+inline void sort_compare_exchange(T& a, T& b, Compare& comp, std::true_type) {
+    T x = a;
+    T y = b;
+    bool swap = comp(y, x);
+    a = swap ? y : x;
+    b = swap ? x : y;
+}
+
+template <typename T, typename Compare>
+inline void sort_compare_exchange(T& a, T& b, Compare& comp, std::false_type) {
+    if (comp(b, a))
+        sort_ops<T>::swap(&a, &b);
+}
+
+template <typename T, typename Compare>
+inline void sort2(T* a, T* b, Compare& comp) {
+    sort_compare_exchange(*a, *b, comp, std::integral_constant<bool, sort_branchless<T>::value>());
+}
+
+template <typename T, typename Compare>
+inline void sort3(T* a, T* b, T* c, Compare& comp) {
+    sort2(a, b, comp);
+    sort2(b, c, comp);
+    sort2(a, b, comp);
+}
+
+// Batcher's network for 8 elements. Dropping the comparators that touch
+// index n or above leaves a network for n elements, and for every n <= 8
+// the result has the optimal number of comparators.
+constexpr unsigned char sort_network8[19][2] = {
+    {0, 1}, {2, 3}, {4, 5}, {6, 7}, {0, 2}, {1, 3}, {4, 6}, {5, 7},
+    {1, 2}, {5, 6}, {0, 4}, {3, 7}, {1, 5}, {2, 6}, {1, 4}, {3, 6},
+    {2, 4}, {3, 5}, {3, 4}
+};
+
+template <size_t N, typename T, typename Compare>
+inline void sort_network(T* a, Compare& comp) {
+    for (size_t i = 0; i < 19; i++)
+        if (sort_network8[i][1] < N)
+            sort2(a + sort_network8[i][0], a + sort_network8[i][1], comp);
+}
+
+template <typename T, typename Compare>
+inline bool sort_small(T* begin, T* end, Compare& comp) {
+    switch (end - begin) {
+    case 0:
+    case 1: return true;
+    case 2: sort_network<2>(begin, comp); return true;
+    case 3: sort_network<3>(begin, comp); return true;
+    case 4: sort_network<4>(begin, comp); return true;
+    case 5: sort_network<5>(begin, comp); return true;
+    case 6: sort_network<6>(begin, comp); return true;
+    case 7: sort_network<7>(begin, comp); return true;
+    case 8: sort_network<8>(begin, comp); return true;
+    default: return false;
+    }
+}
+
+// Insertion sort. When Guarded is false an element not greater than any
+// in the range must precede begin.
+template <bool Guarded, typename T, typename Compare>
+inline void insertion_sort(T* begin, T* end, Compare& comp) {
+    using ops = sort_ops<T>;
+    if (begin == end)
+        return;
+
+    for (T* cur = begin + 1; cur != end; ++cur) {
+        if (comp(*cur, *(cur - 1))) {
+            typename ops::holder tmp;
+            ops::take(tmp, cur);
+            T* sift = cur - 1;
+            while ((!Guarded || sift != begin) && comp(tmp.get(), *(sift - 1)))
+                --sift;
+            ops::shift_up(sift, cur);
+            ops::put(sift, tmp);
+        }
+    }
+}
+
+// Insertion sort that gives up after moving a few elements. Returns true if
+// it finished sorting.
+template <typename T, typename Compare>
+inline bool partial_insertion_sort(T* begin, T* end, Compare& comp) {
+    using ops = sort_ops<T>;
+    if (begin == end)
+        return true;
+
+    size_t moved = 0;
+    for (T* cur = begin + 1; cur != end; ++cur) {
+        if (moved > sort_partial_insertion_limit)
+            return false;
+
+        if (comp(*cur, *(cur - 1))) {
+            typename ops::holder tmp;
+            ops::take(tmp, cur);
+            T* sift = cur - 1;
+            while (sift != begin && comp(tmp.get(), *(sift - 1)))
+                --sift;
+            ops::shift_up(sift, cur);
+            ops::put(sift, tmp);
+            moved += cur - sift;
+        }
+    }
+    return true;
+}
+
+// Puts elements equal to the pivot *begin on its left. Used when the range
+// is preceded by an element equal to the pivot, i.e. with many duplicates.
+template <typename T, typename Compare>
+inline T* partition_left(T* begin, T* end, Compare& comp) {
+    using ops = sort_ops<T>;
+    typename ops::holder pivot;
+    ops::take(pivot, begin);
+
+    T* first = begin;
+    T* last = end;
+    while (comp(pivot.get(), *--last));
+    if (last + 1 == end)
+        while (first < last && !comp(pivot.get(), *++first));
+    else
+        while (!comp(pivot.get(), *++first));
+
+    while (first < last) {
+        ops::swap(first, last);
+        while (comp(pivot.get(), *--last));
+        while (!comp(pivot.get(), *++first));
+    }
+
+    ops::move(begin, last);
+    ops::put(last, pivot);
+    return last;
+}
+
+// Partitions around the pivot *begin, elements equal to it go right.
+// Returns the pivot's final position and whether no element had to move.
+template <typename T, typename Compare>
+inline std::pair<T*, bool> partition_right(T* begin, T* end, Compare& comp) {
+    using ops = sort_ops<T>;
+    typename ops::holder pivot;
+    ops::take(pivot, begin);
+
+    T* first = begin;
+    T* last = end;
+    while (comp(*++first, pivot.get()));
+    if (first - 1 == begin)
+        while (first < last && !comp(*--last, pivot.get()));
+    else
+        while (!comp(*--last, pivot.get()));
+
+    bool already_partitioned = first >= last;
+    while (first < last) {
+        ops::swap(first, last);
+        while (comp(*++first, pivot.get()));
+        while (!comp(*--last, pivot.get()));
+    }
+
+    T* pivot_pos = first - 1;
+    ops::move(begin, pivot_pos);
+    ops::put(pivot_pos, pivot);
+    return std::make_pair(pivot_pos, already_partitioned);
+}
+
+// Swap the elements at the given offsets from first and from last. If the
+// counts differ the swaps become a single cyclic permutation.
+template <typename T>
+inline void swap_offsets(T* first, T* last, const unsigned char* offsets_l, const unsigned char* offsets_r,
+                         size_t num, bool use_swaps) {
+    using ops = sort_ops<T>;
+    if (use_swaps) {
+        for (size_t i = 0; i < num; ++i)
+            ops::swap(first + offsets_l[i], last - offsets_r[i]);
+    }
+    else if (num > 0) {
+        T* l = first + offsets_l[0];
+        T* r = last - offsets_r[0];
+        typename ops::holder tmp;
+        ops::take(tmp, l);
+        ops::move(l, r);
+        for (size_t i = 1; i < num; ++i) {
+            l = first + offsets_l[i];
+            ops::move(r, l);
+            r = last - offsets_r[i];
+            ops::move(l, r);
+        }
+        ops::put(r, tmp);
+    }
+}
+
+// partition_right without data dependent branches: each block of elements
+// is compared first, recording the offsets of misplaced ones, and then the
+// misplaced elements are swapped pairwise.
+template <typename T, typename Compare>
+inline std::pair<T*, bool> partition_right_branchless(T* begin, T* end, Compare& comp) {
+    using ops = sort_ops<T>;
+    typename ops::holder pivot_holder;
+    ops::take(pivot_holder, begin);
+    const T& pivot = pivot_holder.get();
+
+    T* first = begin;
+    T* last = end;
+    while (comp(*++first, pivot));
+    if (first - 1 == begin)
+        while (first < last && !comp(*--last, pivot));
+    else
+        while (!comp(*--last, pivot));
+
+    bool already_partitioned = first >= last;
+    if (!already_partitioned) {
+        ops::swap(first, last);
+        ++first;
+
+        alignas(64) unsigned char offsets_l[sort_block_size];
+        alignas(64) unsigned char offsets_r[sort_block_size];
+
+        T* offsets_l_base = first;
+        T* offsets_r_base = last;
+        size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+        while (first < last) {
+            // Fill the offset buffers that are empty from the unknown middle.
+            size_t num_unknown = last - first;
+            size_t left_split = num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+            size_t right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+
+            if (left_split >= sort_block_size) {
+                for (size_t i = 0; i < sort_block_size; ) {
+                    offsets_l[num_l] = static_cast<unsigned char>(i++); num_l += !comp(*first, pivot); ++first;
+                    offsets_l[num_l] = static_cast<unsigned char>(i++); num_l += !comp(*first, pivot); ++first;
+                    offsets_l[num_l] = static_cast<unsigned char>(i++); num_l += !comp(*first, pivot); ++first;
+                    offsets_l[num_l] = static_cast<unsigned char>(i++); num_l += !comp(*first, pivot); ++first;
+                }
+            }
+            else {
+                for (size_t i = 0; i < left_split; ) {
+                    offsets_l[num_l] = static_cast<unsigned char>(i++); num_l += !comp(*first, pivot); ++first;
+                }
+            }
+
+            if (right_split >= sort_block_size) {
+                for (size_t i = 0; i < sort_block_size; ) {
+                    offsets_r[num_r] = static_cast<unsigned char>(++i); num_r += comp(*--last, pivot);
+                    offsets_r[num_r] = static_cast<unsigned char>(++i); num_r += comp(*--last, pivot);
+                    offsets_r[num_r] = static_cast<unsigned char>(++i); num_r += comp(*--last, pivot);
+                    offsets_r[num_r] = static_cast<unsigned char>(++i); num_r += comp(*--last, pivot);
+                }
+            }
+            else {
+                for (size_t i = 0; i < right_split; ) {
+                    offsets_r[num_r] = static_cast<unsigned char>(++i); num_r += comp(*--last, pivot);
+                }
+            }
+
+            size_t num = num_l < num_r ? num_l : num_r;
+            swap_offsets(offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r,
+                         num, num_l == num_r);
+            num_l -= num;
+            num_r -= num;
+            start_l += num;
+            start_r += num;
+
+            if (num_l == 0) {
+                start_l = 0;
+                offsets_l_base = first;
+            }
+            if (num_r == 0) {
+                start_r = 0;
+                offsets_r_base = last;
+            }
+        }
+
+        // One side has leftover misplaced elements; move them to the middle.
+        if (num_l) {
+            const unsigned char* offsets = offsets_l + start_l;
+            while (num_l--)
+                ops::swap(offsets_l_base + offsets[num_l], --last);
+            first = last;
+        }
+        if (num_r) {
+            const unsigned char* offsets = offsets_r + start_r;
+            while (num_r--) {
+                ops::swap(offsets_r_base - offsets[num_r], first);
+                ++first;
+            }
+            last = first;
+        }
+    }
+
+    T* pivot_pos = first - 1;
+    ops::move(begin, pivot_pos);
+    ops::put(pivot_pos, pivot_holder);
+    return std::make_pair(pivot_pos, already_partitioned);
+}
+
+template <bool Branchless, typename T, typename Compare>
+void pdqsort_loop(T* begin, T* end, Compare& comp, int bad_allowed, bool leftmost) {
+    using ops = sort_ops<T>;
+
+    while (true) {
+        ptrdiff_t size = end - begin;
+
+        if (size < sort_insertion_threshold) {
+            if (!sort_small(begin, end, comp)) {
+                if (leftmost)
+                    insertion_sort<true>(begin, end, comp);
+                else
+                    insertion_sort<false>(begin, end, comp);
+            }
+            return;
+        }
+
+        // Median of three, or pseudomedian of nine for large ranges, is
+        // moved to *begin.
+        ptrdiff_t s2 = size / 2;
+        if (size > sort_ninther_threshold) {
+            sort3(begin, begin + s2, end - 1, comp);
+            sort3(begin + 1, begin + (s2 - 1), end - 2, comp);
+            sort3(begin + 2, begin + (s2 + 1), end - 3, comp);
+            sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), comp);
+            ops::swap(begin, begin + s2);
+        }
+        else {
+            sort3(begin + s2, begin, end - 1, comp);
+        }
+
+        // If the element before the range equals the pivot, everything here
+        // is at least the pivot. Split off the equal elements, which are
+        // then done.
+        if (!leftmost && !comp(*(begin - 1), *begin)) {
+            begin = partition_left(begin, end, comp) + 1;
+            continue;
+        }
+
+        std::pair<T*, bool> part = Branchless
+            ? partition_right_branchless(begin, end, comp)
+            : partition_right(begin, end, comp);
+        T* pivot_pos = part.first;
+        bool already_partitioned = part.second;
+
+        ptrdiff_t l_size = pivot_pos - begin;
+        ptrdiff_t r_size = end - (pivot_pos + 1);
+        bool highly_unbalanced = l_size < size / 8 || r_size < size / 8;
+
+        if (highly_unbalanced) {
+            // Too many bad pivots: fall back to heapsort for O(n log n).
+            if (--bad_allowed == 0) {
+                std::make_heap(begin, end, comp);
+                std::sort_heap(begin, end, comp);
+                return;
+            }
+
+            // Break up patterns that fool the pivot choice.
+            if (l_size >= sort_insertion_threshold) {
+                ops::swap(begin, begin + l_size / 4);
+                ops::swap(pivot_pos - 1, pivot_pos - l_size / 4);
+                if (l_size > sort_ninther_threshold) {
+                    ops::swap(begin + 1, begin + (l_size / 4 + 1));
+                    ops::swap(begin + 2, begin + (l_size / 4 + 2));
+                    ops::swap(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+                    ops::swap(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+                }
+            }
+            if (r_size >= sort_insertion_threshold) {
+                ops::swap(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+                ops::swap(end - 1, end - r_size / 4);
+                if (r_size > sort_ninther_threshold) {
+                    ops::swap(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+                    ops::swap(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+                    ops::swap(end - 2, end - (1 + r_size / 4));
+                    ops::swap(end - 3, end - (2 + r_size / 4));
+                }
+            }
+        }
+        else if (already_partitioned
+                 && partial_insertion_sort(begin, pivot_pos, comp)
+                 && partial_insertion_sort(pivot_pos + 1, end, comp)) {
+            // The input looked sorted and a cheap insertion sort confirmed it.
+            return;
+        }
+
+        // Recurse into the left part, loop on the right.
+        pdqsort_loop<Branchless>(begin, pivot_pos, comp, bad_allowed, leftmost);
+        begin = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+inline int sort_log2(size_t n) {
+    int log = 0;
+    while (n >>= 1)
+        ++log;
+    return log;
+}
+
+}
+
+// Sort [first, last) by comp.
+template <typename T, typename Compare>
+void sort(T* first, T* last, Compare comp) {
+    if (last - first < 2)
+        return;
+    detail::pdqsort_loop<detail::sort_branchless<T>::value>(
+        first, last, comp, detail::sort_log2(last - first), true);
+}
+
+template <typename T>
+void sort(T* first, T* last) {
+    dtm::sort(first, last, std::less<T>());
+}
+
+template <typename T, typename Compare>
+void sort(vec<T>& v, Compare comp) {
+    dtm::sort(v.data(), v.data() + v.size(), comp);
+}
+
+template <typename T>
+void sort(vec<T>& v) {
+    dtm::sort(v.data(), v.data() + v.size(), std::less<T>());
+}
+
+}
+
+#endif //INCLUDED_DATUM_SORT_HPP
@@ -0,0 +1,335 @@
+// str.hpp
+//
+// A string that keeps up to 23 characters inline, and a non-owning view.
+//
+//     dtm::vec<dtm::str> names;
+//     names.push_back("ada");
+//     dtm::str_view first = names[0];
+//     size_t at = dtm::str_view(text).find("needle");
+//
+// str is 24 bytes. Strings of up to 23 characters live in those bytes,
+// with the last byte holding 23 minus the length; a full inline string's
+// length byte is zero and doubles as its terminator. Longer strings keep
+// a pointer, length and capacity, with the top bit of the capacity marking
+// the heap form. Either way size() is stored, never counted.
+//
+// Unlike std::string, whose inline buffer may point into the object
+// itself, a str can be moved by copying its bytes. It is relocatable, so a
+// vec<str> grows with realloc rather than moving strings one at a time.
+// small_vec<char> isn't, for the same reason as std::string.
+//
+// find with a needle of two or more characters compares the needle's
+// first and last characters against 16 or 32 positions at a time, with
+// SSE2 or AVX2 when the CPU has it, and checks the middle only where both
+// match. Single characters go to memchr, comparisons to memcmp and hashing
+// to dtm's hash_bytes, each of which already works a word or a vector at
+// a time. str and str_view of the same characters hash alike.
+//
+// The layout assumes a little endian machine.
+//
+
+#ifndef INCLUDED_DATUM_STR_HPP
+#define INCLUDED_DATUM_STR_HPP
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <stdexcept>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "dtm/vec.hpp"
+#include "dtm/hash.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/cpu.hpp"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "dtm::str assumes a little endian machine"
+#endif
+
+namespace dtm {
+
+namespace detail {
+
+const size_t str_npos = size_t(-1);
+
+// First match of needle at or after from, where 1 < m and from + m <= n
+// unless no match is possible.
+inline size_t str_find_scalar(const char* haystack, size_t n, const char* needle, size_t m, size_t from) noexcept {
+    if (from + m > n)
+        return str_npos;
+    const char* p = haystack + from;
+    const char* last = haystack + n - m;
+    while (p <= last) {
+        p = static_cast<const char*>(memchr(p, needle[0], last - p + 1));
+        if (!p)
+            return str_npos;
+        if (memcmp(p + 1, needle + 1, m - 1) == 0)
+            return p - haystack;
+        p++;
+    }
+    return str_npos;
+}
+
+#if DATUM_X86
+// Candidates are positions whose first and last characters both match.
+DATUM_TARGET("sse2")
+inline size_t str_find_sse2(const char* haystack, size_t n, const char* needle, size_t m, size_t from) noexcept {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+    size_t i = from;
+    for (; i + 16 + m - 1 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i + m - 1));
+        unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+        while (mask) {
+            unsigned bit = unsigned(__builtin_ctz(mask));
+            if (memcmp(haystack + i + bit + 1, needle + 1, m - 2) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return str_find_scalar(haystack, n, needle, m, i);
+}
+
+DATUM_TARGET("avx2")
+inline size_t str_find_avx2(const char* haystack, size_t n, const char* needle, size_t m, size_t from) noexcept {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+    size_t i = from;
+    for (; i + 32 + m - 1 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(haystack + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(haystack + i + m - 1));
+        unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last))));
+        while (mask) {
+            unsigned bit = unsigned(__builtin_ctz(mask));
+            if (memcmp(haystack + i + bit + 1, needle + 1, m - 2) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return str_find_sse2(haystack, n, needle, m, i);
+}
+#endif
+
+inline size_t str_find(const char* haystack, size_t n, const char* needle, size_t m, size_t from) noexcept {
+    if (m > n || from > n - m)
+        return str_npos;
+    if (m == 0)
+        return from;
+    if (m == 1) {
+        const void* p = memchr(haystack + from, needle[0], n - from);
+        return p ? static_cast<const char*>(p) - haystack : str_npos;
+    }
+#if DATUM_X86
+    if (cpu().avx2)
+        return str_find_avx2(haystack, n, needle, m, from);
+    return str_find_sse2(haystack, n, needle, m, from);
+#else
+    return str_find_scalar(haystack, n, needle, m, from);
+#endif
+}
+
+}
+
+class str_view {
+public:
+    using value_type = char;
+    using iterator = const char*;
+    using const_iterator = const char*;
+
+    enum : size_t { npos = size_t(-1) };
+
+    str_view() noexcept : m_data(""), m_size(0) {}
+    str_view(const char* s) noexcept : m_data(s), m_size(strlen(s)) {}
+    str_view(const char* s, size_t length) noexcept : m_data(s), m_size(length) {}
+    str_view(const std::string& s) noexcept : m_data(s.data()), m_size(s.size()) {}
+
+    const char* data() const noexcept { return m_data; }
+    size_t size() const noexcept { return m_size; }
+    size_t length() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+
+    const char* begin() const noexcept { return m_data; }
+    const char* end() const noexcept { return m_data + m_size; }
+
+    char operator[] (size_t index) const noexcept { return m_data[index]; }
+    char front() const noexcept { return m_data[0]; }
+    char back() const noexcept { return m_data[m_size - 1]; }
+
+    // Throws std::out_of_range if pos > size().
+    str_view substr(size_t pos, size_t count = npos) const;
+
+    void remove_prefix(size_t count) noexcept { m_data += count; m_size -= count; }
+    void remove_suffix(size_t count) noexcept { m_size -= count; }
+
+    // Negative, zero or positive as this sorts before, with or after rhs,
+    // comparing characters as unsigned.
+    int compare(str_view rhs) const noexcept;
+
+    // Position of the first match at or after pos, or npos.
+    size_t find(str_view needle, size_t pos = 0) const noexcept;
+    size_t find(char c, size_t pos = 0) const noexcept;
+
+    // Position of the last match starting at or before pos, or npos.
+    size_t rfind(str_view needle, size_t pos = npos) const noexcept;
+    size_t rfind(char c, size_t pos = npos) const noexcept;
+
+    bool contains(str_view needle) const noexcept { return find(needle) != npos; }
+    bool contains(char c) const noexcept { return find(c) != npos; }
+    bool starts_with(str_view prefix) const noexcept;
+    bool ends_with(str_view suffix) const noexcept;
+
+    explicit operator std::string() const { return std::string(m_data, m_size); }
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+class str {
+public:
+    using value_type = char;
+    using iterator = char*;
+    using const_iterator = const char*;
+
+    enum : size_t {
+        npos = size_t(-1),
+        // Longest string kept inline.
+        inline_capacity = 23
+    };
+
+    str() noexcept;
+    str(const char* s);
+    str(const char* s, size_t length);
+    str(size_t count, char c);
+    explicit str(str_view s);
+
+    str(const str& rhs);
+    str(str&& rhs) noexcept;
+    ~str();
+
+    str& operator= (const str& rhs);
+    str& operator= (str&& rhs) noexcept;
+    str& operator= (str_view rhs);
+
+    const char* data() const noexcept;
+    char* data() noexcept;
+    const char* c_str() const noexcept;
+
+    size_t size() const noexcept;
+    size_t length() const noexcept;
+    bool empty() const noexcept;
+    size_t capacity() const noexcept;
+
+    // Whether the characters are kept inline rather than on the heap.
+    bool is_inline() const noexcept;
+
+    char* begin() noexcept;
+    char* end() noexcept;
+    const char* begin() const noexcept;
+    const char* end() const noexcept;
+
+    char& operator[] (size_t index) noexcept;
+    char operator[] (size_t index) const noexcept;
+    char& at(size_t index);
+    char at(size_t index) const;
+    char& front() noexcept;
+    char front() const noexcept;
+    char& back() noexcept;
+    char back() const noexcept;
+
+    operator str_view() const noexcept;
+    str_view view() const noexcept;
+
+    void reserve(size_t new_capacity);
+    void clear() noexcept;
+    void resize(size_t new_size, char c = '\0');
+    void push_back(char c);
+    void pop_back() noexcept;
+    void swap(str& rhs) noexcept;
+
+    // s may be part of this string.
+    str& append(const char* s, size_t length);
+    str& append(str_view s);
+    str& operator+= (str_view s);
+    str& operator+= (char c);
+
+    // Throws std::out_of_range if pos > size().
+    str substr(size_t pos, size_t count = npos) const;
+
+    int compare(str_view rhs) const noexcept;
+    size_t find(str_view needle, size_t pos = 0) const noexcept;
+    size_t find(char c, size_t pos = 0) const noexcept;
+    size_t rfind(str_view needle, size_t pos = npos) const noexcept;
+    size_t rfind(char c, size_t pos = npos) const noexcept;
+    bool contains(str_view needle) const noexcept;
+    bool contains(char c) const noexcept;
+    bool starts_with(str_view prefix) const noexcept;
+    bool ends_with(str_view suffix) const noexcept;
+
+private:
+    struct heap_rep {
+        char* data;
+        size_t size;
+        // The capacity with heap_flag set, which sets the top bit of the
+        // last byte.
+        size_t capacity;
+    };
+
+    static const size_t heap_flag = size_t(1) << 63;
+
+    union {
+        heap_rep m_heap;
+        char m_inline[sizeof(heap_rep)];
+    };
+
+    void init(const char* s, size_t length);
+    void set_size(size_t new_size) noexcept;
+    void release() noexcept;
+    static char* allocate(size_t capacity);
+};
+
+// str is relocatable
+template <>
+struct is_relocatable<str> {
+    static constexpr bool value = true;
+};
+
+bool operator== (str_view lhs, str_view rhs) noexcept;
+bool operator!= (str_view lhs, str_view rhs) noexcept;
+bool operator< (str_view lhs, str_view rhs) noexcept;
+bool operator> (str_view lhs, str_view rhs) noexcept;
+bool operator<= (str_view lhs, str_view rhs) noexcept;
+bool operator>= (str_view lhs, str_view rhs) noexcept;
+
+str operator+ (str_view lhs, str_view rhs);
+
+std::ostream& operator<< (std::ostream& out, str_view s);
+
+template <>
+struct hash<str_view> {
+    size_t operator() (str_view val) const noexcept {
+        return detail::hash_bytes(val.data(), val.size());
+    }
+};
+
+template <>
+struct hash<str> {
+    size_t operator() (const str& val) const noexcept {
+        return detail::hash_bytes(val.data(), val.size());
+    }
+};
+
+}
+
+// Implementation of str is in detail/str_impl.hpp
+#define INCLUDING_DATUM_DETAIL_STR_IMPL_HPP
+#include "detail/str_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_STR_IMPL_HPP
+
+#endif //INCLUDED_DATUM_STR_HPP
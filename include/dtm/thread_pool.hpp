@@ -0,0 +1,225 @@
+// thread_pool.hpp
+//
+// A work-stealing thread pool with fork/join parallelism.
+//
+//     dtm::parallel_for(0, v.size(), [&](size_t i) { v[i] = f(v[i]); });
+//
+//     dtm::parallel_invoke([&] { sort(left); }, [&] { sort(right); });
+//
+// Each worker owns a Chase-Lev deque. Forking pushes a task onto the
+// bottom of the forking worker's deque, where it is popped again at the
+// join unless an idle worker stole it from the top first. Thieves pick a
+// random victim and then try each other worker in turn. A worker waiting at
+// a join whose task was stolen runs other stolen work meanwhile, so no
+// worker ever blocks while there is work to do.
+//
+// Workers that find no work after a few sweeps go to sleep on a condition
+// variable. Forking only touches the condition variable when a worker is
+// actually asleep. Threads that are not workers of the pool hand their
+// work to a worker and block until it is done.
+//
+// Tasks live on the stack of the thread that forks them, so forking never
+// allocates. Exceptions thrown by a task are rethrown at its join.
+//
+// default_thread_pool() is a pool with a worker per hardware thread,
+// started on first use. parallel_invoke and parallel_for run on it.
+//
+
+#ifndef INCLUDED_DATUM_THREAD_POOL_HPP
+#define INCLUDED_DATUM_THREAD_POOL_HPP
+
+#include <new>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <deque>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+#include "dtm/vec.hpp"
+
+#include "dtm/detail/config.hpp"
+#include "dtm/detail/aligned_alloc.hpp"
+
+namespace dtm {
+
+class thread_pool;
+
+namespace detail {
+
+// A unit of work. Whoever forks a task waits for done before the task
+// goes out of scope.
+struct pool_task {
+    void (*execute)(pool_task*);
+    std::atomic<bool> done;
+
+    explicit pool_task(void (*execute)(pool_task*)) noexcept
+        : execute(execute), done(false)
+    {}
+};
+
+// Chase-Lev work stealing deque of tasks, with the memory orders of Le et
+// al., "Correct and Efficient Work-Stealing for Weak Memory Models". Only
+// the owning worker may push and pop; any thread may steal.
+class work_deque {
+public:
+    work_deque();
+    ~work_deque();
+
+    work_deque(const work_deque&) = delete;
+    work_deque& operator= (const work_deque&) = delete;
+
+    void push(pool_task* task);
+
+    // The most recently pushed task, or nullptr if there is none.
+    pool_task* pop() noexcept;
+
+    // The least recently pushed task, or nullptr if there is none or
+    // another thread took it first.
+    pool_task* steal() noexcept;
+
+    bool empty() const noexcept;
+
+private:
+    struct ring {
+        int64_t capacity;
+        std::atomic<pool_task*>* slots;
+
+        explicit ring(int64_t capacity);
+        ~ring();
+
+        pool_task* get(int64_t index) const noexcept;
+        void put(int64_t index, pool_task* task) noexcept;
+    };
+
+    // Thieves race on m_top while the owner works at m_bottom, so keep
+    // them on separate cache lines.
+    alignas(DATUM_CACHE_LINE_SIZE) std::atomic<int64_t> m_top;
+    alignas(DATUM_CACHE_LINE_SIZE) std::atomic<int64_t> m_bottom;
+    std::atomic<ring*> m_ring;
+    // Rings outgrown by the owner. A thief may still be reading one, so
+    // they are only freed with the deque.
+    vec<ring*> m_retired;
+
+    ring* grow(ring* old, int64_t top, int64_t bottom);
+};
+
+struct pool_worker {
+    work_deque deque;
+    thread_pool* pool;
+    size_t index;
+    uint64_t rng;
+    std::thread thread;
+};
+
+// The worker running on this thread, or nullptr.
+inline pool_worker*& current_pool_worker() noexcept {
+    static thread_local pool_worker* worker = nullptr;
+    return worker;
+}
+
+}
+
+class thread_pool {
+public:
+    // An enumerator rather than a static member, so that it can be bound
+    // to a reference without a definition in some translation unit.
+    enum : size_t { npos = size_t(-1) };
+
+    // Starts threads workers, or one per hardware thread if threads is 0.
+    explicit thread_pool(size_t threads = 0);
+
+    // Waits for the workers to finish and exit. No work may be running.
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator= (const thread_pool&) = delete;
+
+    // Number of workers.
+    size_t size() const noexcept;
+
+    // Index in [0, size()) of the calling thread's worker, or npos if the
+    // calling thread is not a worker of this pool.
+    size_t this_worker_index() const noexcept;
+
+    // Calls fn() on a worker and waits for it.
+    template <typename Fn>
+    void run(Fn&& fn);
+
+    // Calls f() and g(), possibly in parallel, and returns when both are
+    // done. If either throws, the exception is rethrown here.
+    template <typename F, typename G>
+    void invoke(F&& f, G&& g);
+
+    // Calls fn(chunk_begin, chunk_end) over disjoint chunks covering
+    // [begin, end), in parallel. Chunks are at most grain long; with grain 0
+    // the range is split into about eight chunks per worker. Pass a grain
+    // when each index is cheap enough that a fork would dominate it.
+    template <typename Fn>
+    void parallel_for_chunks(size_t begin, size_t end, Fn&& fn, size_t grain = 0);
+
+    // Calls fn(i) for every i in [begin, end), in parallel.
+    template <typename Fn>
+    void parallel_for(size_t begin, size_t end, Fn&& fn, size_t grain = 0);
+
+private:
+    // Sweeps over the other workers' deques before an idle worker sleeps.
+    static constexpr size_t idle_sweeps = 64;
+
+    detail::pool_worker* m_workers;
+    size_t m_size;
+
+    // Tasks from threads outside the pool.
+    std::mutex m_inject_mutex;
+    std::deque<detail::pool_task*> m_injected;
+    std::atomic<size_t> m_injected_count;
+
+    // Sleeping workers wait for m_epoch to change.
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_sleep_cv;
+    std::atomic<uint64_t> m_epoch;
+    std::atomic<size_t> m_sleepers;
+    std::atomic<bool> m_stopping;
+
+    detail::pool_worker* current_worker() const noexcept;
+    size_t auto_grain(size_t count) const noexcept;
+
+    void worker_main(detail::pool_worker& self);
+    detail::pool_task* steal(detail::pool_worker& self) noexcept;
+    detail::pool_task* take_injected();
+    bool has_work() const noexcept;
+    void sleep();
+    void wake_one();
+
+    void inject(detail::pool_task* task);
+    void wait_for(detail::pool_task& task, detail::pool_worker& self);
+
+    template <typename Fn>
+    void split(size_t begin, size_t end, size_t grain, Fn& fn);
+};
+
+// The process wide pool, with one worker per hardware thread.
+thread_pool& default_thread_pool();
+
+// Calls every function, possibly in parallel, on the default pool.
+template <typename F, typename G, typename... Rest>
+void parallel_invoke(F&& f, G&& g, Rest&&... rest);
+
+template <typename Fn>
+void parallel_for_chunks(size_t begin, size_t end, Fn&& fn, size_t grain = 0);
+
+template <typename Fn>
+void parallel_for(size_t begin, size_t end, Fn&& fn, size_t grain = 0);
+
+}
+
+// Implementation of thread_pool is in detail/thread_pool_impl.hpp
+#define INCLUDING_DATUM_DETAIL_THREAD_POOL_IMPL_HPP
+#include "detail/thread_pool_impl.hpp"
+#undef INCLUDING_DATUM_DETAIL_THREAD_POOL_IMPL_HPP
+
+#endif //INCLUDED_DATUM_THREAD_POOL_HPP
@@ -34,6 +34,9 @@ struct is_relocatable {
 template <typename T>
 using is_relocatable_t = typename std::conditional<is_relocatable<T>::value, std::true_type, std::false_type>::type;
 
+template <typename T>
+class shared_vec;
+
 template <typename T>
 class vec {
 public:
@@ -92,6 +95,9 @@ public:
     T& at(size_t);
     const T& at(size_t) const;
 
+    T* data() noexcept;
+    const T* data() const noexcept;
+
     size_t size() const noexcept;
     bool empty() const noexcept;
     size_t capacity() const noexcept;
@@ -104,6 +110,11 @@ public:
     template <typename... Args>
     void resize(size_t new_size, Args&&...);
 
+    // Like resize(), but new elements are default-initialized rather than
+    // value-initialized. For trivial types their contents are indeterminate
+    // until the caller writes them, which skips a pass over the memory.
+    void resize_for_overwrite(size_t new_size);
+
     void assign(const vec<T>& rhs);
     void assign(vec<T>&& rhs);
     void assign(std::initializer_list<T> init);
@@ -147,6 +158,9 @@ protected:
     vec(T* local_store, size_t local_store_capacity, vec<T>&& v);
 
 private:
+    // Takes over the buffer.
+    friend class shared_vec<T>;
+
     T* m_begin;
     T* m_end;
 
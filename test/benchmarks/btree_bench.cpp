@@ -0,0 +1,115 @@
+// btree_bench.cpp
+//
+// Compare btree_map against std::map for inserts, point lookups and
+// ordered scans over integer keys
+
+#include <map>
+#include <random>
+#include <cstdint>
+#include "dtm/vec.hpp"
+#include "dtm/btree_map.hpp"
+
+#include "benchmark/benchmark.h"
+
+static dtm::vec<int64_t> make_keys(size_t num_elements) {
+    std::mt19937_64 rng(42);
+    dtm::vec<int64_t> keys(num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        keys[i] = static_cast<int64_t>(rng() >> 1);
+    return keys;
+}
+
+static void BM_insert_std_map(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<int64_t> keys = make_keys(num_elements);
+    for (auto _ : state) {
+        std::map<int64_t, int64_t> map;
+        for (size_t i = 0; i < num_elements; i++)
+            map.insert({ keys[i], int64_t(i) });
+        benchmark::DoNotOptimize(map);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_insert_btree(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<int64_t> keys = make_keys(num_elements);
+    for (auto _ : state) {
+        dtm::btree_map<int64_t, int64_t> map;
+        for (size_t i = 0; i < num_elements; i++)
+            map.insert(keys[i], int64_t(i));
+        benchmark::DoNotOptimize(map);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_lookup_std_map(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<int64_t> keys = make_keys(num_elements);
+    std::map<int64_t, int64_t> map;
+    for (size_t i = 0; i < num_elements; i++)
+        map.insert({ keys[i], int64_t(i) });
+    std::mt19937_64 rng(7);
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (size_t i = 0; i < 1024; i++)
+            sum += map.find(keys[rng() % num_elements])->second;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(1024 * state.iterations());
+}
+
+static void BM_lookup_btree(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<int64_t> keys = make_keys(num_elements);
+    dtm::btree_map<int64_t, int64_t> map;
+    for (size_t i = 0; i < num_elements; i++)
+        map.insert(keys[i], int64_t(i));
+    std::mt19937_64 rng(7);
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (size_t i = 0; i < 1024; i++)
+            sum += map.find(keys[rng() % num_elements])->value;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(1024 * state.iterations());
+}
+
+static void BM_scan_std_map(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<int64_t> keys = make_keys(num_elements);
+    std::map<int64_t, int64_t> map;
+    for (size_t i = 0; i < num_elements; i++)
+        map.insert({ keys[i], int64_t(i) });
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (const auto& e : map)
+            sum += e.second;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_scan_btree(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<int64_t> keys = make_keys(num_elements);
+    dtm::btree_map<int64_t, int64_t> map;
+    for (size_t i = 0; i < num_elements; i++)
+        map.insert(keys[i], int64_t(i));
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (auto e : map)
+            sum += e.value;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+BENCHMARK(BM_insert_std_map)->Range(1<<10, 1<<20);
+BENCHMARK(BM_insert_btree)->Range(1<<10, 1<<20);
+BENCHMARK(BM_lookup_std_map)->Range(1<<10, 1<<22);
+BENCHMARK(BM_lookup_btree)->Range(1<<10, 1<<22);
+BENCHMARK(BM_scan_std_map)->Range(1<<10, 1<<20);
+BENCHMARK(BM_scan_btree)->Range(1<<10, 1<<20);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,105 @@
+// heap_bench.cpp
+//
+// Compare std::priority_queue against dtm::heap with 2, 4 and 8 children
+// a node, filling and draining a queue, holding its size steady with
+// pop_push, and building it in bulk
+
+#include <queue>
+#include <random>
+#include <vector>
+#include "dtm/heap.hpp"
+
+#include "benchmark/benchmark.h"
+
+static std::vector<uint64_t> keys(size_t count) {
+    std::mt19937_64 rng(1);
+    std::vector<uint64_t> out(count);
+    for (uint64_t& key : out)
+        key = rng();
+    return out;
+}
+
+static void BM_fill_drain_priority_queue(benchmark::State& state) {
+    std::vector<uint64_t> input = keys(state.range(0));
+    for (auto _ : state) {
+        std::priority_queue<uint64_t> queue;
+        for (uint64_t key : input)
+            queue.push(key);
+        while (!queue.empty()) {
+            benchmark::DoNotOptimize(queue.top());
+            queue.pop();
+        }
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+template <size_t D>
+static void BM_fill_drain_heap(benchmark::State& state) {
+    std::vector<uint64_t> input = keys(state.range(0));
+    for (auto _ : state) {
+        dtm::heap<uint64_t, D> queue;
+        for (uint64_t key : input)
+            queue.push(key);
+        while (!queue.empty()) {
+            benchmark::DoNotOptimize(queue.top());
+            queue.pop();
+        }
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+// A scheduler's steady state: take the next event, queue one later.
+static void BM_hold_priority_queue(benchmark::State& state) {
+    std::vector<uint64_t> input = keys(state.range(0));
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> queue(input.begin(), input.end());
+    std::mt19937_64 rng(2);
+    for (auto _ : state) {
+        uint64_t next = queue.top() + rng() % (uint64_t(1) << 40);
+        queue.pop();
+        queue.push(next);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <size_t D>
+static void BM_hold_heap(benchmark::State& state) {
+    std::vector<uint64_t> input = keys(state.range(0));
+    dtm::heap<uint64_t, D, std::greater<uint64_t>> queue(input.begin(), input.end());
+    std::mt19937_64 rng(2);
+    for (auto _ : state)
+        queue.pop_push(queue.top() + rng() % (uint64_t(1) << 40));
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_build_priority_queue(benchmark::State& state) {
+    std::vector<uint64_t> input = keys(state.range(0));
+    for (auto _ : state) {
+        std::priority_queue<uint64_t> queue(input.begin(), input.end());
+        benchmark::DoNotOptimize(queue.top());
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+template <size_t D>
+static void BM_build_heap(benchmark::State& state) {
+    std::vector<uint64_t> input = keys(state.range(0));
+    for (auto _ : state) {
+        dtm::heap<uint64_t, D> queue(input.begin(), input.end());
+        benchmark::DoNotOptimize(queue.top());
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+BENCHMARK(BM_fill_drain_priority_queue)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_fill_drain_heap, 2)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_fill_drain_heap, 4)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_fill_drain_heap, 8)->Arg(1000)->Arg(1000000);
+BENCHMARK(BM_hold_priority_queue)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_hold_heap, 2)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_hold_heap, 4)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_hold_heap, 8)->Arg(1000000);
+BENCHMARK(BM_build_priority_queue)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_build_heap, 4)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_build_heap, 8)->Arg(1000000);
+
+BENCHMARK_MAIN();
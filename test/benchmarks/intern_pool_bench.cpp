@@ -0,0 +1,95 @@
+// intern_pool_bench.cpp
+//
+// Compare interning symbols into an intern_pool against a std::unordered_map
+// of std::string, and the concurrent pool from several threads
+
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "dtm/intern_pool.hpp"
+
+#include "benchmark/benchmark.h"
+
+// Symbols drawn from a smaller vocabulary, so most are repeats.
+static std::vector<std::string> symbols(size_t count) {
+    std::mt19937 rng(1);
+    std::vector<std::string> out;
+    for (size_t i = 0; i < count; i++)
+        out.push_back("identifier_" + std::to_string(rng() % (count / 8 + 1)));
+    return out;
+}
+
+static void BM_unordered_map(benchmark::State& state) {
+    std::vector<std::string> input = symbols(state.range(0));
+    for (auto _ : state) {
+        std::unordered_map<std::string, uint32_t> ids;
+        for (const std::string& s : input)
+            benchmark::DoNotOptimize(ids.emplace(s, uint32_t(ids.size())).first->second);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_intern_pool(benchmark::State& state) {
+    std::vector<std::string> input = symbols(state.range(0));
+    for (auto _ : state) {
+        dtm::intern_pool pool;
+        for (const std::string& s : input)
+            benchmark::DoNotOptimize(pool.intern(s));
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_concurrent_intern_pool(benchmark::State& state) {
+    std::vector<std::string> input = symbols(1 << 20);
+    size_t threads = state.range(0);
+    for (auto _ : state) {
+        dtm::concurrent_intern_pool pool;
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                for (size_t i = t; i < input.size(); i += threads)
+                    benchmark::DoNotOptimize(pool.intern(input[i]));
+            });
+        }
+        for (std::thread& w : workers)
+            w.join();
+    }
+    state.SetItemsProcessed(input.size() * state.iterations());
+}
+
+// Comparing interned symbols against comparing the strings.
+static void BM_compare_strings(benchmark::State& state) {
+    std::vector<std::string> input = symbols(state.range(0));
+    for (auto _ : state) {
+        size_t equal = 0;
+        for (size_t i = 1; i < input.size(); i++)
+            equal += input[i] == input[i - 1];
+        benchmark::DoNotOptimize(equal);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_compare_ids(benchmark::State& state) {
+    std::vector<std::string> input = symbols(state.range(0));
+    dtm::intern_pool pool;
+    std::vector<uint32_t> ids;
+    for (const std::string& s : input)
+        ids.push_back(pool.intern(s));
+    for (auto _ : state) {
+        size_t equal = 0;
+        for (size_t i = 1; i < ids.size(); i++)
+            equal += ids[i] == ids[i - 1];
+        benchmark::DoNotOptimize(equal);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+BENCHMARK(BM_unordered_map)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_intern_pool)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_concurrent_intern_pool)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+BENCHMARK(BM_compare_strings)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_compare_ids)->Range(1 << 10, 1 << 20);
+
+BENCHMARK_MAIN();
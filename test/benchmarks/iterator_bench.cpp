@@ -0,0 +1,138 @@
+// iterator_bench.cpp
+//
+// Compare the span adaptors against the hand-written loops they replace
+
+#include <numeric>
+#include "dtm/vec.hpp"
+#include "dtm/iterator.hpp"
+
+#include "benchmark/benchmark.h"
+
+static dtm::vec<float> make_data(size_t num_elements) {
+    dtm::vec<float> v(num_elements);
+    std::iota(v.begin(), v.end(), 0.0f);
+    return v;
+}
+
+static void BM_dot_raw(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<float> a = make_data(num_elements);
+    dtm::vec<float> b = make_data(num_elements);
+    for (auto _ : state) {
+        const float* pa = a.data();
+        const float* pb = b.data();
+        float sum = 0;
+        for (size_t i = 0; i < num_elements; i++)
+            sum += pa[i] * pb[i];
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_dot_zip(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<float> a = make_data(num_elements);
+    dtm::vec<float> b = make_data(num_elements);
+    for (auto _ : state) {
+        float sum = 0;
+        for (auto t : dtm::zip(a, b))
+            sum += std::get<0>(t) * std::get<1>(t);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_weighted_raw(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<float> a = make_data(num_elements);
+    for (auto _ : state) {
+        const float* pa = a.data();
+        float sum = 0;
+        for (size_t i = 0; i < num_elements; i++)
+            sum += pa[i] * i;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_weighted_enumerate(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<float> a = make_data(num_elements);
+    for (auto _ : state) {
+        float sum = 0;
+        for (auto e : dtm::enumerate(a))
+            sum += e.value * e.index;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_strided_raw(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<float> a = make_data(num_elements);
+    for (auto _ : state) {
+        const float* pa = a.data();
+        float sum = 0;
+        for (size_t i = 0; i < num_elements; i += 4)
+            sum += pa[i];
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements / 4 * state.iterations());
+}
+
+static void BM_strided_adaptor(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<float> a = make_data(num_elements);
+    for (auto _ : state) {
+        float sum = 0;
+        for (float val : dtm::strided(a, 4))
+            sum += val;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements / 4 * state.iterations());
+}
+
+static void BM_chunked_raw(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<float> a = make_data(num_elements);
+    for (auto _ : state) {
+        const float* pa = a.data();
+        float max_chunk_sum = 0;
+        for (size_t offset = 0; offset < num_elements; offset += 64) {
+            size_t end = std::min(offset + 64, num_elements);
+            float sum = 0;
+            for (size_t i = offset; i < end; i++)
+                sum += pa[i];
+            max_chunk_sum = std::max(max_chunk_sum, sum);
+        }
+        benchmark::DoNotOptimize(max_chunk_sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_chunked_adaptor(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<float> a = make_data(num_elements);
+    for (auto _ : state) {
+        float max_chunk_sum = 0;
+        for (dtm::span<const float> chunk : dtm::chunked(a, 64)) {
+            float sum = 0;
+            for (float val : chunk)
+                sum += val;
+            max_chunk_sum = std::max(max_chunk_sum, sum);
+        }
+        benchmark::DoNotOptimize(max_chunk_sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+BENCHMARK(BM_dot_raw)->Range(1<<10, 1<<20);
+BENCHMARK(BM_dot_zip)->Range(1<<10, 1<<20);
+BENCHMARK(BM_weighted_raw)->Range(1<<10, 1<<20);
+BENCHMARK(BM_weighted_enumerate)->Range(1<<10, 1<<20);
+BENCHMARK(BM_strided_raw)->Range(1<<10, 1<<20);
+BENCHMARK(BM_strided_adaptor)->Range(1<<10, 1<<20);
+BENCHMARK(BM_chunked_raw)->Range(1<<10, 1<<20);
+BENCHMARK(BM_chunked_adaptor)->Range(1<<10, 1<<20);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,50 @@
+// numa_bench.cpp
+//
+// Compare parallel read bandwidth over a vec filled by one thread against
+// the same vec after each numa_placement, and report where its pages are
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include "dtm/vec.hpp"
+#include "dtm/numa.hpp"
+#include "dtm/parallel.hpp"
+
+#include "benchmark/benchmark.h"
+
+static void BM_parallel_sum(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::thread_pool& pool = dtm::default_thread_pool();
+
+    // Filled serially, so every page starts on this thread's node.
+    dtm::vec<uint64_t> v;
+    v.fill(num_elements, uint64_t(1));
+    if (state.range(1) >= 0)
+        dtm::numa_place(v, dtm::numa_placement(state.range(1)), pool);
+
+    for (auto _ : state) {
+        std::atomic<uint64_t> total(0);
+        dtm::detail::parallel_page_chunks(pool, v.data(), num_elements, [&](size_t begin, size_t end) {
+            uint64_t sum = 0;
+            for (size_t i = begin; i < end; i++)
+                sum += v[i];
+            total += sum;
+        });
+        benchmark::DoNotOptimize(total.load());
+    }
+    state.SetBytesProcessed(num_elements * sizeof(uint64_t) * state.iterations());
+
+    dtm::numa_distribution d = dtm::numa_page_distribution(v);
+    for (size_t node = 0; node < d.pages.size(); node++)
+        state.counters["node" + std::to_string(node) + "_pages"] = double(d.pages[node]);
+}
+
+// Placement -1 leaves the vec where the serial fill put it.
+BENCHMARK(BM_parallel_sum)
+    ->Args({1 << 25, -1})
+    ->Args({1 << 25, int(dtm::numa_placement::interleave)})
+    ->Args({1 << 25, int(dtm::numa_placement::node_local)})
+    ->Args({1 << 25, int(dtm::numa_placement::by_worker)})
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+// packed_vec_bench.cpp
+//
+// Compare decoding and random access of packed_vec against reading a plain
+// vec<uint64_t>
+
+#include <random>
+#include <cstdint>
+#include "dtm/vec.hpp"
+#include "dtm/packed_vec.hpp"
+
+#include "benchmark/benchmark.h"
+
+// A 20 bit column.
+static dtm::vec<uint64_t> make_column(size_t num_elements) {
+    std::mt19937_64 rng(42);
+    dtm::vec<uint64_t> v(num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        v[i] = 5000000 + rng() % (1 << 20);
+    return v;
+}
+
+static void BM_vec_sum(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint64_t> v = make_column(num_elements);
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        for (uint64_t x : v)
+            sum += x;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_packed_vec_sum(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::packed_vec<uint64_t> packed(make_column(num_elements));
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        packed.for_each([&](uint64_t x) { sum += x; });
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+    state.counters["bytes_per_value"] = double(packed.size_in_bytes()) / num_elements;
+}
+
+static void BM_packed_vec_delta_sum(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint64_t> ids = make_column(num_elements);
+    for (size_t i = 1; i < num_elements; i++)
+        ids[i] = ids[i - 1] + ids[i] % 64;
+    dtm::packed_vec<uint64_t> packed(ids, dtm::packed_encoding::delta);
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        packed.for_each([&](uint64_t x) { sum += x; });
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+    state.counters["bytes_per_value"] = double(packed.size_in_bytes()) / num_elements;
+}
+
+static void BM_vec_random_access(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint64_t> v = make_column(num_elements);
+    std::mt19937 rng(1);
+    for (auto _ : state) {
+        uint64_t x = v[rng() % num_elements];
+        benchmark::DoNotOptimize(x);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_packed_vec_random_access(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::packed_vec<uint64_t> packed(make_column(num_elements));
+    std::mt19937 rng(1);
+    for (auto _ : state) {
+        uint64_t x = packed[rng() % num_elements];
+        benchmark::DoNotOptimize(x);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_vec_sum)->Range(1<<10, 1<<24);
+BENCHMARK(BM_packed_vec_sum)->Range(1<<10, 1<<24);
+BENCHMARK(BM_packed_vec_delta_sum)->Range(1<<10, 1<<24);
+BENCHMARK(BM_vec_random_access)->Range(1<<10, 1<<24);
+BENCHMARK(BM_packed_vec_random_access)->Range(1<<10, 1<<24);
+
+BENCHMARK_MAIN();
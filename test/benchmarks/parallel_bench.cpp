@@ -0,0 +1,179 @@
+// parallel_bench.cpp
+//
+// Compare the memory bandwidth of parallel_fill, parallel_transform and
+// parallel_inclusive_scan on 1 to N workers against serial vec::fill and
+// plain loops, and parallel_sort and parallel_insert against dtm::sort and
+// inserting one key at a time
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <random>
+#include <cstdint>
+#include "dtm/vec.hpp"
+#include "dtm/sort.hpp"
+#include "dtm/hash_table.hpp"
+#include "dtm/parallel.hpp"
+
+#include "benchmark/benchmark.h"
+
+static void BM_vec_fill(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    for (auto _ : state) {
+        // A fresh vec each time, so page faults are part of the cost as
+        // they are for a real first fill.
+        dtm::vec<uint64_t> v;
+        v.fill(num_elements, uint64_t(1));
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetBytesProcessed(num_elements * sizeof(uint64_t) * state.iterations());
+}
+
+static void BM_parallel_fill(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::thread_pool pool(state.range(1));
+    for (auto _ : state) {
+        dtm::vec<uint64_t> v;
+        dtm::parallel_fill(v, num_elements, uint64_t(1), pool);
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetBytesProcessed(num_elements * sizeof(uint64_t) * state.iterations());
+}
+
+static void BM_serial_transform(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint64_t> in(num_elements, uint64_t(3));
+    dtm::vec<uint64_t> out(num_elements, uint64_t(0));
+    for (auto _ : state) {
+        std::transform(in.begin(), in.end(), out.begin(), [](uint64_t x) { return x * 7 + 1; });
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(2 * num_elements * sizeof(uint64_t) * state.iterations());
+}
+
+static void BM_parallel_transform(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::thread_pool pool(state.range(1));
+    dtm::vec<uint64_t> in(num_elements, uint64_t(3));
+    dtm::vec<uint64_t> out(num_elements, uint64_t(0));
+    for (auto _ : state) {
+        dtm::parallel_transform(in, out, [](uint64_t x) { return x * 7 + 1; }, pool);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(2 * num_elements * sizeof(uint64_t) * state.iterations());
+}
+
+static void BM_serial_scan(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint64_t> in(num_elements, uint64_t(3));
+    dtm::vec<uint64_t> out(num_elements, uint64_t(0));
+    for (auto _ : state) {
+        std::partial_sum(in.begin(), in.end(), out.begin());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(2 * num_elements * sizeof(uint64_t) * state.iterations());
+}
+
+static void BM_parallel_scan(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::thread_pool pool(state.range(1));
+    dtm::vec<uint64_t> in(num_elements, uint64_t(3));
+    dtm::vec<uint64_t> out(num_elements, uint64_t(0));
+    for (auto _ : state) {
+        dtm::parallel_inclusive_scan(in, out, std::plus<uint64_t>(), pool);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(2 * num_elements * sizeof(uint64_t) * state.iterations());
+}
+
+static dtm::vec<uint64_t> random_keys(size_t num_elements) {
+    std::mt19937_64 rng(42);
+    dtm::vec<uint64_t> v;
+    v.resize_for_overwrite(num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        v[i] = rng();
+    return v;
+}
+
+static void BM_sort(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint64_t> keys = random_keys(num_elements);
+    for (auto _ : state) {
+        state.PauseTiming();
+        dtm::vec<uint64_t> v = keys;
+        state.ResumeTiming();
+        dtm::sort(v);
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_parallel_sort(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::thread_pool pool(state.range(1));
+    dtm::vec<uint64_t> keys = random_keys(num_elements);
+    for (auto _ : state) {
+        state.PauseTiming();
+        dtm::vec<uint64_t> v = keys;
+        state.ResumeTiming();
+        dtm::parallel_sort(v, std::less<uint64_t>(), pool);
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_hash_table_insert(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint64_t> keys = random_keys(num_elements);
+    for (auto _ : state) {
+        dtm::hash_table<uint64_t, uint64_t> table;
+        table.reserve(num_elements);
+        for (size_t i = 0; i < num_elements; i++)
+            table.insert(keys[i], i);
+        benchmark::DoNotOptimize(table.size());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_parallel_insert(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::thread_pool pool(state.range(1));
+    dtm::vec<uint64_t> keys = random_keys(num_elements);
+    dtm::vec<uint64_t> values;
+    values.resize_for_overwrite(num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        values[i] = i;
+    for (auto _ : state) {
+        dtm::hash_table<uint64_t, uint64_t> table;
+        dtm::parallel_insert(table, keys, values, pool);
+        benchmark::DoNotOptimize(table.size());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+// 256MB of uint64_t, by 1, 2, 4 ... hardware_concurrency workers.
+static void thread_counts(benchmark::internal::Benchmark* b) {
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+        b->Args({1 << 25, threads});
+}
+
+// 8M keys, by 1, 2, 4 ... hardware_concurrency workers.
+static void build_thread_counts(benchmark::internal::Benchmark* b) {
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+        b->Args({1 << 23, threads});
+}
+
+BENCHMARK(BM_vec_fill)->Arg(1 << 25)->UseRealTime();
+BENCHMARK(BM_parallel_fill)->Apply(thread_counts)->UseRealTime();
+BENCHMARK(BM_serial_transform)->Arg(1 << 25)->UseRealTime();
+BENCHMARK(BM_parallel_transform)->Apply(thread_counts)->UseRealTime();
+BENCHMARK(BM_serial_scan)->Arg(1 << 25)->UseRealTime();
+BENCHMARK(BM_parallel_scan)->Apply(thread_counts)->UseRealTime();
+BENCHMARK(BM_sort)->Arg(1 << 23)->UseRealTime();
+BENCHMARK(BM_parallel_sort)->Apply(build_thread_counts)->UseRealTime();
+BENCHMARK(BM_hash_table_insert)->Arg(1 << 23)->UseRealTime();
+BENCHMARK(BM_parallel_insert)->Apply(build_thread_counts)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,72 @@
+// per_thread_bench.cpp
+//
+// Compare counting from every worker into per_thread slots against one
+// shared atomic and against an unpadded array indexed by worker
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include "dtm/vec.hpp"
+#include "dtm/per_thread.hpp"
+
+#include "benchmark/benchmark.h"
+
+static const size_t increments = 1 << 24;
+
+static void BM_shared_atomic(benchmark::State& state) {
+    dtm::thread_pool pool(state.range(0));
+    for (auto _ : state) {
+        std::atomic<uint64_t> count(0);
+        pool.parallel_for(0, increments, [&](size_t) { count.fetch_add(1, std::memory_order_relaxed); });
+        benchmark::DoNotOptimize(count.load());
+    }
+    state.SetItemsProcessed(increments * state.iterations());
+}
+
+static void BM_unpadded_array(benchmark::State& state) {
+    dtm::thread_pool pool(state.range(0));
+    for (auto _ : state) {
+        // Adjacent counters share cache lines.
+        dtm::vec<std::atomic<uint64_t>> counts(pool.size() + 1);
+        for (auto& c : counts)
+            c.store(0, std::memory_order_relaxed);
+        pool.parallel_for(0, increments, [&](size_t) {
+            size_t index = std::min<size_t>(pool.this_worker_index(), pool.size());
+            counts[index].store(counts[index].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        });
+        uint64_t total = 0;
+        for (auto& c : counts)
+            total += c.load(std::memory_order_relaxed);
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(increments * state.iterations());
+}
+
+static void BM_per_thread(benchmark::State& state) {
+    dtm::thread_pool pool(state.range(0));
+    for (auto _ : state) {
+        dtm::per_thread<std::atomic<uint64_t>> counts(pool, uint64_t(0));
+        pool.parallel_for(0, increments, [&](size_t) {
+            std::atomic<uint64_t>& c = counts.local();
+            c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        });
+        uint64_t total = 0;
+        counts.for_each([&](const std::atomic<uint64_t>& c) { total += c.load(std::memory_order_relaxed); });
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(increments * state.iterations());
+}
+
+// 1, 2, 4 ... hardware_concurrency workers.
+static void thread_counts(benchmark::internal::Benchmark* b) {
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+        b->Arg(threads);
+}
+
+BENCHMARK(BM_shared_atomic)->Apply(thread_counts)->UseRealTime();
+BENCHMARK(BM_unpadded_array)->Apply(thread_counts)->UseRealTime();
+BENCHMARK(BM_per_thread)->Apply(thread_counts)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,124 @@
+// persistent_vec_bench.cpp
+//
+// Compare publishing edited versions of a persistent_vec against copying a
+// vec, building one with and without a transient_vec, and scanning it
+// through operator[], iterators and chunks against scanning a vec
+
+#include <numeric>
+#include "dtm/persistent_vec.hpp"
+
+#include "benchmark/benchmark.h"
+
+static dtm::persistent_vec<int> make_persistent(size_t count) {
+    dtm::transient_vec<int> edit;
+    for (size_t i = 0; i < count; i++)
+        edit.push_back(int(i));
+    return edit.persistent();
+}
+
+static dtm::vec<int> make_vec(size_t count) {
+    dtm::vec<int> v;
+    for (size_t i = 0; i < count; i++)
+        v.push_back(int(i));
+    return v;
+}
+
+// A new version with one element changed, keeping the old one.
+static void BM_version_vec_copy(benchmark::State& state) {
+    dtm::vec<int> v = make_vec(state.range(0));
+    size_t index = 0;
+    for (auto _ : state) {
+        dtm::vec<int> next(v.begin(), v.end());
+        next[index] = 1;
+        benchmark::DoNotOptimize(next.data());
+        index = (index + 7919) % v.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_version_persistent_vec(benchmark::State& state) {
+    dtm::persistent_vec<int> v = make_persistent(state.range(0));
+    size_t index = 0;
+    for (auto _ : state) {
+        dtm::persistent_vec<int> next = v.set(index, 1);
+        benchmark::DoNotOptimize(&next);
+        index = (index + 7919) % v.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_build_vec(benchmark::State& state) {
+    for (auto _ : state) {
+        dtm::vec<int> v = make_vec(state.range(0));
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_build_persistent_vec(benchmark::State& state) {
+    for (auto _ : state) {
+        dtm::persistent_vec<int> v;
+        for (int64_t i = 0; i < state.range(0); i++)
+            v = v.push_back(int(i));
+        benchmark::DoNotOptimize(&v);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_build_transient_vec(benchmark::State& state) {
+    for (auto _ : state) {
+        dtm::persistent_vec<int> v = make_persistent(state.range(0));
+        benchmark::DoNotOptimize(&v);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_scan_vec(benchmark::State& state) {
+    dtm::vec<int> v = make_vec(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::accumulate(v.begin(), v.end(), 0LL));
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_scan_persistent_index(benchmark::State& state) {
+    dtm::persistent_vec<int> v = make_persistent(state.range(0));
+    for (auto _ : state) {
+        long long sum = 0;
+        for (size_t i = 0; i < v.size(); i++)
+            sum += v[i];
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_scan_persistent_iterator(benchmark::State& state) {
+    dtm::persistent_vec<int> v = make_persistent(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(std::accumulate(v.begin(), v.end(), 0LL));
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_scan_persistent_chunks(benchmark::State& state) {
+    dtm::persistent_vec<int> v = make_persistent(state.range(0));
+    for (auto _ : state) {
+        long long sum = 0;
+        v.for_each_chunk([&sum](const int* data, size_t count) {
+            for (size_t i = 0; i < count; i++)
+                sum += data[i];
+        });
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+BENCHMARK(BM_version_vec_copy)->Arg(1000)->Arg(1000000);
+BENCHMARK(BM_version_persistent_vec)->Arg(1000)->Arg(1000000);
+BENCHMARK(BM_build_vec)->Arg(100000);
+BENCHMARK(BM_build_persistent_vec)->Arg(100000);
+BENCHMARK(BM_build_transient_vec)->Arg(100000);
+BENCHMARK(BM_scan_vec)->Arg(1000000);
+BENCHMARK(BM_scan_persistent_index)->Arg(1000000);
+BENCHMARK(BM_scan_persistent_iterator)->Arg(1000000);
+BENCHMARK(BM_scan_persistent_chunks)->Arg(1000000);
+
+BENCHMARK_MAIN();
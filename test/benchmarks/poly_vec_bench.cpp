@@ -0,0 +1,130 @@
+// poly_vec_bench.cpp
+//
+// Compare virtual calls over a vec of unique_ptrs against a poly_vec in
+// insertion order, grouped by type, and visited one type at a time
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+#include "dtm/vec.hpp"
+#include "dtm/poly_vec.hpp"
+
+#include "benchmark/benchmark.h"
+
+struct shape {
+    virtual ~shape() {}
+    virtual double area() const = 0;
+};
+
+struct square final : shape {
+    explicit square(double side) : side(side) {}
+    double area() const override { return side * side; }
+    double side;
+};
+
+struct rectangle final : shape {
+    rectangle(double w, double h) : w(w), h(h) {}
+    double area() const override { return w * h; }
+    double w, h;
+};
+
+struct circle final : shape {
+    explicit circle(double r) : r(r) {}
+    double area() const override { return 3.14159 * r * r; }
+    double r;
+};
+
+struct triangle final : shape {
+    triangle(double b, double h) : b(b), h(h) {}
+    double area() const override { return 0.5 * b * h; }
+    double b, h, padding[2];
+};
+
+template <typename Add>
+static void add_shapes(size_t count, Add&& add) {
+    std::mt19937 rng(1);
+    for (size_t i = 0; i < count; i++) {
+        double x = double(rng() % 100);
+        switch (rng() % 4) {
+        case 0: add(std::unique_ptr<shape>(new square(x))); break;
+        case 1: add(std::unique_ptr<shape>(new rectangle(x, x + 1))); break;
+        case 2: add(std::unique_ptr<shape>(new circle(x))); break;
+        case 3: add(std::unique_ptr<shape>(new triangle(x, x + 2))); break;
+        }
+    }
+}
+
+static void BM_unique_ptrs(benchmark::State& state) {
+    // Shuffled, as a long-lived vector that has been sorted and erased from
+    // would be.
+    std::vector<std::unique_ptr<shape>> shapes;
+    add_shapes(state.range(0), [&](std::unique_ptr<shape> s) { shapes.push_back(std::move(s)); });
+    std::shuffle(shapes.begin(), shapes.end(), std::mt19937(2));
+    for (auto _ : state) {
+        double total = 0;
+        for (const auto& s : shapes)
+            total += s->area();
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void fill(dtm::poly_vec<shape>& shapes, size_t count) {
+    add_shapes(count, [&](std::unique_ptr<shape> s) {
+        if (auto p = dynamic_cast<square*>(s.get()))
+            shapes.push_back(*p);
+        else if (auto p = dynamic_cast<rectangle*>(s.get()))
+            shapes.push_back(*p);
+        else if (auto p = dynamic_cast<circle*>(s.get()))
+            shapes.push_back(*p);
+        else
+            shapes.push_back(*dynamic_cast<triangle*>(s.get()));
+    });
+}
+
+static void BM_poly_vec(benchmark::State& state) {
+    dtm::poly_vec<shape> shapes;
+    fill(shapes, state.range(0));
+    for (auto _ : state) {
+        double total = 0;
+        for (const shape& s : shapes)
+            total += s.area();
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_poly_vec_grouped(benchmark::State& state) {
+    dtm::poly_vec<shape> shapes;
+    fill(shapes, state.range(0));
+    shapes.group_by_type();
+    for (auto _ : state) {
+        double total = 0;
+        shapes.for_each([&](const shape& s) { total += s.area(); });
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static void BM_poly_vec_for_each_of(benchmark::State& state) {
+    dtm::poly_vec<shape> shapes;
+    fill(shapes, state.range(0));
+    shapes.group_by_type();
+    for (auto _ : state) {
+        double total = 0;
+        shapes.for_each_of<square>([&](const square& s) { total += s.area(); });
+        shapes.for_each_of<rectangle>([&](const rectangle& s) { total += s.area(); });
+        shapes.for_each_of<circle>([&](const circle& s) { total += s.area(); });
+        shapes.for_each_of<triangle>([&](const triangle& s) { total += s.area(); });
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+BENCHMARK(BM_unique_ptrs)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_poly_vec)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_poly_vec_grouped)->Range(1 << 10, 1 << 22);
+BENCHMARK(BM_poly_vec_for_each_of)->Range(1 << 10, 1 << 22);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,101 @@
+// radix_sort_bench.cpp
+//
+// Compare radix_sort against std::sort on random keys and records
+
+#include <algorithm>
+#include <random>
+#include <cstdint>
+#include "dtm/vec.hpp"
+#include "dtm/radix_sort.hpp"
+
+#include "benchmark/benchmark.h"
+
+template <typename T>
+static dtm::vec<T> make_keys(size_t num_elements) {
+    std::mt19937_64 rng(42);
+    dtm::vec<T> v(num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        v[i] = static_cast<T>(rng());
+    return v;
+}
+
+template <typename T>
+static void BM_std_sort(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<T> keys = make_keys<T>(num_elements);
+    dtm::vec<T> v;
+    for (auto _ : state) {
+        state.PauseTiming();
+        v = keys;
+        state.ResumeTiming();
+        std::sort(v.begin(), v.end());
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+template <typename T>
+static void BM_radix_sort(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<T> keys = make_keys<T>(num_elements);
+    dtm::vec<T> v;
+    dtm::vec<T> scratch;
+    for (auto _ : state) {
+        state.PauseTiming();
+        v = keys;
+        state.ResumeTiming();
+        dtm::radix_sort(v, [](T x) { return x; }, scratch);
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+struct record {
+    uint64_t key;
+    uint64_t payload[3];
+};
+
+static void BM_radix_sort_records(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint64_t> keys = make_keys<uint64_t>(num_elements);
+    dtm::vec<record> records(num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        records[i].key = keys[i];
+    dtm::vec<record> v;
+    dtm::vec<record> scratch;
+    for (auto _ : state) {
+        state.PauseTiming();
+        v = records;
+        state.ResumeTiming();
+        dtm::radix_sort(v, [](const record& r) { return r.key; }, scratch);
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_std_sort_records(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint64_t> keys = make_keys<uint64_t>(num_elements);
+    dtm::vec<record> records(num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        records[i].key = keys[i];
+    dtm::vec<record> v;
+    for (auto _ : state) {
+        state.PauseTiming();
+        v = records;
+        state.ResumeTiming();
+        std::sort(v.begin(), v.end(), [](const record& a, const record& b) { return a.key < b.key; });
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_std_sort, uint32_t)->Range(1<<8, 1<<24);
+BENCHMARK_TEMPLATE(BM_radix_sort, uint32_t)->Range(1<<8, 1<<24);
+BENCHMARK_TEMPLATE(BM_std_sort, uint64_t)->Range(1<<8, 1<<24);
+BENCHMARK_TEMPLATE(BM_radix_sort, uint64_t)->Range(1<<8, 1<<24);
+BENCHMARK_TEMPLATE(BM_radix_sort, float)->Range(1<<8, 1<<24);
+BENCHMARK(BM_std_sort_records)->Range(1<<8, 1<<22);
+BENCHMARK(BM_radix_sort_records)->Range(1<<8, 1<<22);
+
+BENCHMARK_MAIN();
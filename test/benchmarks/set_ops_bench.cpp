@@ -0,0 +1,138 @@
+// set_ops_bench.cpp
+//
+// Compare dtm::intersect, unite and merge against the std algorithms on
+// sorted lists of uint32_t
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <cstdint>
+#include "dtm/vec.hpp"
+#include "dtm/set_ops.hpp"
+
+#include "benchmark/benchmark.h"
+
+// About n distinct values, each present with probability density.
+static dtm::vec<uint32_t> make_set(size_t n, double density, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution keep(density);
+    dtm::vec<uint32_t> v;
+    for (uint32_t x = 0; v.size() < n; x++) {
+        if (keep(rng))
+            v.push_back(x);
+    }
+    return v;
+}
+
+// Two lists of the same length that share about half their elements.
+static void BM_std_set_intersection(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint32_t> a = make_set(num_elements, 0.5, 1);
+    dtm::vec<uint32_t> b = make_set(num_elements, 0.5, 2);
+    dtm::vec<uint32_t> out(num_elements);
+    for (auto _ : state) {
+        uint32_t* end = std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), out.data());
+        benchmark::DoNotOptimize(end);
+    }
+    state.SetItemsProcessed(2 * num_elements * state.iterations());
+}
+
+static void BM_intersect(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint32_t> a = make_set(num_elements, 0.5, 1);
+    dtm::vec<uint32_t> b = make_set(num_elements, 0.5, 2);
+    dtm::vec<uint32_t> out;
+    out.reserve(num_elements);
+    for (auto _ : state) {
+        dtm::intersect(a, b, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(2 * num_elements * state.iterations());
+}
+
+// A short list against one 1000 times longer.
+static void BM_std_set_intersection_skewed(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint32_t> a = make_set(num_elements / 1000 + 1, 0.001, 1);
+    dtm::vec<uint32_t> b = make_set(num_elements, 0.5, 2);
+    dtm::vec<uint32_t> out(a.size());
+    for (auto _ : state) {
+        uint32_t* end = std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), out.data());
+        benchmark::DoNotOptimize(end);
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_intersect_skewed(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint32_t> a = make_set(num_elements / 1000 + 1, 0.001, 1);
+    dtm::vec<uint32_t> b = make_set(num_elements, 0.5, 2);
+    dtm::vec<uint32_t> out;
+    out.reserve(a.size());
+    for (auto _ : state) {
+        dtm::intersect(a, b, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_std_set_union(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint32_t> a = make_set(num_elements, 0.5, 1);
+    dtm::vec<uint32_t> b = make_set(num_elements, 0.5, 2);
+    dtm::vec<uint32_t> out(2 * num_elements);
+    for (auto _ : state) {
+        uint32_t* end = std::set_union(a.begin(), a.end(), b.begin(), b.end(), out.data());
+        benchmark::DoNotOptimize(end);
+    }
+    state.SetItemsProcessed(2 * num_elements * state.iterations());
+}
+
+static void BM_unite(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint32_t> a = make_set(num_elements, 0.5, 1);
+    dtm::vec<uint32_t> b = make_set(num_elements, 0.5, 2);
+    dtm::vec<uint32_t> out;
+    out.reserve(2 * num_elements);
+    for (auto _ : state) {
+        dtm::unite(a, b, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(2 * num_elements * state.iterations());
+}
+
+static void BM_std_merge(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint32_t> a = make_set(num_elements, 0.5, 1);
+    dtm::vec<uint32_t> b = make_set(num_elements, 0.5, 2);
+    dtm::vec<uint32_t> out(2 * num_elements);
+    for (auto _ : state) {
+        uint32_t* end = std::merge(a.begin(), a.end(), b.begin(), b.end(), out.data());
+        benchmark::DoNotOptimize(end);
+    }
+    state.SetItemsProcessed(2 * num_elements * state.iterations());
+}
+
+static void BM_merge(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<uint32_t> a = make_set(num_elements, 0.5, 1);
+    dtm::vec<uint32_t> b = make_set(num_elements, 0.5, 2);
+    dtm::vec<uint32_t> out;
+    out.reserve(2 * num_elements);
+    for (auto _ : state) {
+        dtm::merge(a, b, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(2 * num_elements * state.iterations());
+}
+
+BENCHMARK(BM_std_set_intersection)->Range(1<<10, 1<<20);
+BENCHMARK(BM_intersect)->Range(1<<10, 1<<20);
+BENCHMARK(BM_std_set_intersection_skewed)->Range(1<<14, 1<<22);
+BENCHMARK(BM_intersect_skewed)->Range(1<<14, 1<<22);
+BENCHMARK(BM_std_set_union)->Range(1<<10, 1<<20);
+BENCHMARK(BM_unite)->Range(1<<10, 1<<20);
+BENCHMARK(BM_std_merge)->Range(1<<10, 1<<20);
+BENCHMARK(BM_merge)->Range(1<<10, 1<<20);
+
+BENCHMARK_MAIN();
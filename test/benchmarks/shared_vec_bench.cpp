@@ -0,0 +1,109 @@
+// shared_vec_bench.cpp
+//
+// Compare handing an array to other owners as a shared_vec, a
+// std::shared_ptr to a vec and a deep copy, and reading through each
+
+#include <memory>
+#include "dtm/shared_vec.hpp"
+
+#include "benchmark/benchmark.h"
+
+static dtm::vec<double> values(size_t count) {
+    dtm::vec<double> v;
+    v.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        v.push_back(double(i));
+    return v;
+}
+
+static void BM_copy_deep(benchmark::State& state) {
+    dtm::vec<double> v = values(state.range(0));
+    for (auto _ : state) {
+        dtm::vec<double> copy(v.begin(), v.end());
+        benchmark::DoNotOptimize(copy.data());
+        copy.clear();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// libstdc++ counts without atomics until a second thread starts, so this
+// is only comparable to shared_vec in a program that has threads.
+static void BM_copy_shared_ptr(benchmark::State& state) {
+    auto v = std::make_shared<dtm::vec<double>>(values(state.range(0)));
+    for (auto _ : state) {
+        std::shared_ptr<dtm::vec<double>> copy = v;
+        benchmark::DoNotOptimize(copy.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_copy_shared_vec(benchmark::State& state) {
+    dtm::shared_vec<double> v(values(state.range(0)));
+    for (auto _ : state) {
+        dtm::shared_vec<double> copy = v;
+        benchmark::DoNotOptimize(copy.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Random reads of the shared array through a holder passed by value.
+static double sum_shared_ptr(std::shared_ptr<dtm::vec<double>> v, size_t count) {
+    double sum = 0;
+    size_t index = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += (*v)[index];
+        index = (index * 7 + 3) % v->size();
+    }
+    return sum;
+}
+
+static double sum_shared_vec(dtm::shared_vec<double> v, size_t count) {
+    double sum = 0;
+    size_t index = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += v[index];
+        index = (index * 7 + 3) % v.size();
+    }
+    return sum;
+}
+
+static void BM_read_shared_ptr(benchmark::State& state) {
+    auto v = std::make_shared<dtm::vec<double>>(values(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sum_shared_ptr(v, 64));
+    state.SetItemsProcessed(64 * state.iterations());
+}
+
+static void BM_read_shared_vec(benchmark::State& state) {
+    dtm::shared_vec<double> v(values(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sum_shared_vec(v, 64));
+    state.SetItemsProcessed(64 * state.iterations());
+}
+
+// Building the shared array from a vec that was just filled.
+static void BM_make_shared_ptr(benchmark::State& state) {
+    for (auto _ : state) {
+        auto v = std::make_shared<dtm::vec<double>>(values(state.range(0)));
+        benchmark::DoNotOptimize(v->data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_make_shared_vec(benchmark::State& state) {
+    for (auto _ : state) {
+        dtm::shared_vec<double> v(values(state.range(0)));
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_copy_deep)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_copy_shared_ptr)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_copy_shared_vec)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_read_shared_ptr)->Arg(100000);
+BENCHMARK(BM_read_shared_vec)->Arg(100000);
+BENCHMARK(BM_make_shared_ptr)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_make_shared_vec)->Arg(1000)->Arg(100000);
+
+BENCHMARK_MAIN();
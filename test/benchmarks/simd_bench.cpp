@@ -0,0 +1,104 @@
+// simd_bench.cpp
+//
+// Compare the dtm::simd kernels at each instruction set against plain loops,
+// in bytes scanned per second
+
+#include <random>
+#include <cstdint>
+#include "dtm/vec.hpp"
+#include "dtm/simd.hpp"
+
+#include "benchmark/benchmark.h"
+
+using dtm::detail::simd_level;
+
+template <typename T>
+static dtm::vec<T> make_values(size_t num_elements) {
+    std::mt19937 rng(42);
+    dtm::vec<T> v(num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        v[i] = static_cast<T>(rng() % 1000);
+    return v;
+}
+
+// Skip levels this CPU can't run.
+static bool runnable(benchmark::State& state, simd_level level) {
+    if (level <= dtm::detail::best_simd_level())
+        return true;
+    state.SkipWithError("not supported on this CPU");
+    return false;
+}
+
+template <typename T, simd_level Level>
+static void BM_find(benchmark::State& state) {
+    if (!runnable(state, Level))
+        return;
+    size_t num_elements = state.range(0);
+    dtm::vec<T> v = make_values<T>(num_elements);
+    auto functions = dtm::detail::make_simd_functions<T>(Level);
+    for (auto _ : state) {
+        // Not present, so the whole vec is scanned.
+        size_t index = functions.find(v.data(), v.size(), T(5000));
+        benchmark::DoNotOptimize(index);
+    }
+    state.SetBytesProcessed(num_elements * sizeof(T) * state.iterations());
+}
+
+template <typename T, simd_level Level>
+static void BM_count(benchmark::State& state) {
+    if (!runnable(state, Level))
+        return;
+    size_t num_elements = state.range(0);
+    dtm::vec<T> v = make_values<T>(num_elements);
+    auto functions = dtm::detail::make_simd_functions<T>(Level);
+    for (auto _ : state) {
+        size_t count = functions.count(v.data(), v.size(), T(500));
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetBytesProcessed(num_elements * sizeof(T) * state.iterations());
+}
+
+template <typename T, simd_level Level>
+static void BM_min(benchmark::State& state) {
+    if (!runnable(state, Level))
+        return;
+    size_t num_elements = state.range(0);
+    dtm::vec<T> v = make_values<T>(num_elements);
+    auto functions = dtm::detail::make_simd_functions<T>(Level);
+    for (auto _ : state) {
+        T result = functions.min(v.data(), v.size());
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetBytesProcessed(num_elements * sizeof(T) * state.iterations());
+}
+
+template <typename T, simd_level Level>
+static void BM_sum(benchmark::State& state) {
+    if (!runnable(state, Level))
+        return;
+    size_t num_elements = state.range(0);
+    dtm::vec<T> v = make_values<T>(num_elements);
+    auto functions = dtm::detail::make_simd_functions<T>(Level);
+    for (auto _ : state) {
+        auto result = functions.sum(v.data(), v.size());
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetBytesProcessed(num_elements * sizeof(T) * state.iterations());
+}
+
+#define DATUM_BENCH_LEVELS(bm, T)                                                  \
+    BENCHMARK_TEMPLATE(bm, T, simd_level::scalar)->Range(1<<10, 1<<22);            \
+    BENCHMARK_TEMPLATE(bm, T, simd_level::sse2)->Range(1<<10, 1<<22);              \
+    BENCHMARK_TEMPLATE(bm, T, simd_level::avx2)->Range(1<<10, 1<<22);              \
+    BENCHMARK_TEMPLATE(bm, T, simd_level::avx512)->Range(1<<10, 1<<22);
+
+DATUM_BENCH_LEVELS(BM_find, int32_t)
+DATUM_BENCH_LEVELS(BM_find, float)
+DATUM_BENCH_LEVELS(BM_count, int32_t)
+DATUM_BENCH_LEVELS(BM_count, float)
+DATUM_BENCH_LEVELS(BM_min, int32_t)
+DATUM_BENCH_LEVELS(BM_min, float)
+DATUM_BENCH_LEVELS(BM_sum, int32_t)
+DATUM_BENCH_LEVELS(BM_sum, float)
+
+BENCHMARK_MAIN();
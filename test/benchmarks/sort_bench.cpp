@@ -0,0 +1,98 @@
+// sort_bench.cpp
+//
+// Compare dtm::sort against std::sort on random and patterned inputs
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <cstdint>
+#include "dtm/vec.hpp"
+#include "dtm/sort.hpp"
+
+#include "benchmark/benchmark.h"
+
+template <typename T>
+static dtm::vec<T> make_random(size_t num_elements) {
+    std::mt19937_64 rng(42);
+    dtm::vec<T> v(num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        v[i] = static_cast<T>(rng());
+    return v;
+}
+
+template <typename T>
+static dtm::vec<T> make_nearly_sorted(size_t num_elements) {
+    dtm::vec<T> v(num_elements);
+    for (size_t i = 0; i < num_elements; i++)
+        v[i] = static_cast<T>(i);
+    for (size_t i = 0; i + 1 < num_elements; i += 100)
+        std::swap(v[i], v[i + 1]);
+    return v;
+}
+
+template <typename T>
+static void BM_std_sort_random(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<T> input = make_random<T>(num_elements);
+    dtm::vec<T> v;
+    for (auto _ : state) {
+        state.PauseTiming();
+        v = input;
+        state.ResumeTiming();
+        std::sort(v.data(), v.data() + v.size());
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+template <typename T>
+static void BM_dtm_sort_random(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<T> input = make_random<T>(num_elements);
+    dtm::vec<T> v;
+    for (auto _ : state) {
+        state.PauseTiming();
+        v = input;
+        state.ResumeTiming();
+        dtm::sort(v);
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_std_sort_nearly_sorted(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<int> input = make_nearly_sorted<int>(num_elements);
+    dtm::vec<int> v;
+    for (auto _ : state) {
+        state.PauseTiming();
+        v = input;
+        state.ResumeTiming();
+        std::sort(v.data(), v.data() + v.size());
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_dtm_sort_nearly_sorted(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<int> input = make_nearly_sorted<int>(num_elements);
+    dtm::vec<int> v;
+    for (auto _ : state) {
+        state.PauseTiming();
+        v = input;
+        state.ResumeTiming();
+        dtm::sort(v);
+        benchmark::DoNotOptimize(v.data());
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_std_sort_random, int)->Range(1<<4, 1<<20);
+BENCHMARK_TEMPLATE(BM_dtm_sort_random, int)->Range(1<<4, 1<<20);
+BENCHMARK_TEMPLATE(BM_std_sort_random, double)->Range(1<<4, 1<<20);
+BENCHMARK_TEMPLATE(BM_dtm_sort_random, double)->Range(1<<4, 1<<20);
+BENCHMARK(BM_std_sort_nearly_sorted)->Range(1<<10, 1<<20);
+BENCHMARK(BM_dtm_sort_nearly_sorted)->Range(1<<10, 1<<20);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,87 @@
+// str_bench.cpp
+//
+// Compare dtm::str against std::string: filling a vec of short strings,
+// searching long text and counting strings in a hash_table
+
+#include <random>
+#include <string>
+#include "dtm/vec.hpp"
+#include "dtm/str.hpp"
+#include "dtm/hash_table.hpp"
+
+#include "benchmark/benchmark.h"
+
+static std::string random_word(std::mt19937& rng, size_t max_length) {
+    std::string word(1 + rng() % max_length, ' ');
+    for (char& c : word)
+        c = char('a' + rng() % 26);
+    return word;
+}
+
+template <typename S>
+static void BM_fill_vec(benchmark::State& state) {
+    std::mt19937 rng(1);
+    dtm::vec<std::string> words;
+    for (int i = 0; i < state.range(0); i++)
+        words.push_back(random_word(rng, 20));
+    for (auto _ : state) {
+        dtm::vec<S> v;
+        for (const std::string& w : words)
+            v.push_back(S(w.data(), w.size()));
+        benchmark::DoNotOptimize(v.data());
+        v.clear();
+    }
+    words.clear();
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+static std::string haystack(size_t length) {
+    // Frequent partial matches of the needle.
+    std::mt19937 rng(2);
+    std::string text;
+    while (text.size() < length)
+        text += rng() % 4 ? "needl" : "nee";
+    text += "needle";
+    return text;
+}
+
+static void BM_find_std(benchmark::State& state) {
+    std::string text = haystack(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(text.find("needle"));
+    state.SetBytesProcessed(text.size() * state.iterations());
+}
+
+static void BM_find_str(benchmark::State& state) {
+    dtm::str text(haystack(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(text.find("needle"));
+    state.SetBytesProcessed(text.size() * state.iterations());
+}
+
+template <typename S>
+static void BM_count_words(benchmark::State& state) {
+    std::mt19937 rng(3);
+    dtm::vec<S> words;
+    for (int i = 0; i < state.range(0); i++) {
+        std::string w = random_word(rng, 3);
+        words.push_back(S(w.data(), w.size()));
+    }
+    for (auto _ : state) {
+        dtm::hash_table<S, int> counts;
+        for (const S& w : words)
+            counts[w]++;
+        benchmark::DoNotOptimize(counts.size());
+    }
+    words.clear();
+    state.SetItemsProcessed(state.range(0) * state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_fill_vec, std::string)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_fill_vec, dtm::str)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_find_std)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_find_str)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_count_words, std::string)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(BM_count_words, dtm::str)->Range(1 << 10, 1 << 20);
+
+BENCHMARK_MAIN();
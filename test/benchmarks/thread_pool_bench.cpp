@@ -0,0 +1,74 @@
+// thread_pool_bench.cpp
+//
+// Compare parallel_for and parallel_invoke on 1 to N workers against a
+// plain serial loop
+
+#include <algorithm>
+#include <thread>
+#include <cmath>
+#include <cstdint>
+#include "dtm/vec.hpp"
+#include "dtm/thread_pool.hpp"
+
+#include "benchmark/benchmark.h"
+
+// Enough arithmetic per element that the loop is compute bound.
+static double work(double x) {
+    for (int i = 0; i < 32; i++)
+        x = std::sqrt(x * x + 1.0);
+    return x;
+}
+
+static void BM_serial_for(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::vec<double> v(num_elements, 1.0);
+    for (auto _ : state) {
+        for (size_t i = 0; i < num_elements; i++)
+            v[i] = work(v[i]);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static void BM_parallel_for(benchmark::State& state) {
+    size_t num_elements = state.range(0);
+    dtm::thread_pool pool(state.range(1));
+    dtm::vec<double> v(num_elements, 1.0);
+    for (auto _ : state) {
+        pool.parallel_for(0, num_elements, [&](size_t i) { v[i] = work(v[i]); });
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(num_elements * state.iterations());
+}
+
+static uint64_t fib(dtm::thread_pool& pool, unsigned n) {
+    if (n < 2)
+        return n;
+    uint64_t a = 0, b = 0;
+    pool.invoke([&] { a = fib(pool, n - 1); }, [&] { b = fib(pool, n - 2); });
+    return a + b;
+}
+
+// Nothing but forks and joins, so this measures their overhead.
+static void BM_invoke_fib(benchmark::State& state) {
+    dtm::thread_pool pool(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(fib(pool, 25));
+    state.SetItemsProcessed(242785 * state.iterations());
+}
+
+static void thread_counts(benchmark::internal::Benchmark* b, bool with_size) {
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        if (with_size)
+            b->Args({1 << 20, threads});
+        else
+            b->Arg(threads);
+    }
+}
+
+BENCHMARK(BM_serial_for)->Arg(1 << 20)->UseRealTime();
+BENCHMARK(BM_parallel_for)->Apply([](benchmark::internal::Benchmark* b) { thread_counts(b, true); })->UseRealTime();
+BENCHMARK(BM_invoke_fib)->Apply([](benchmark::internal::Benchmark* b) { thread_counts(b, false); })->UseRealTime();
+
+BENCHMARK_MAIN();
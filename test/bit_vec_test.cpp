@@ -0,0 +1,204 @@
+#include "dtm/bit_vec.hpp"
+
+#include <vector>
+#include <random>
+#include <cstdint>
+
+#include "catch.hpp"
+
+static std::vector<bool> random_bits(size_t n, unsigned density_percent, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<bool> bits(n);
+    for (size_t i = 0; i < n; i++)
+        bits[i] = rng() % 100 < density_percent;
+    return bits;
+}
+
+static dtm::bit_vec to_bit_vec(const std::vector<bool>& bits)
+{
+    dtm::bit_vec result;
+    for (bool b : bits)
+        result.push_back(b);
+    return result;
+}
+
+TEST_CASE("bit_vec_basic", "[bit_vec]")
+{
+    dtm::bit_vec bits(130);
+    CHECK(bits.size() == 130);
+    CHECK(bits.word_count() == 3);
+    CHECK(bits.capacity() % 512 == 0);
+    CHECK(reinterpret_cast<uintptr_t>(bits.words()) % 64 == 0);
+    CHECK(bits.none());
+
+    bits.set(0);
+    bits.set(64);
+    bits.set(129, true);
+    bits.set(5, false);
+    CHECK(bits[0]);
+    CHECK(bits.test(64));
+    CHECK(bits[129]);
+    CHECK(!bits[5]);
+    CHECK(bits.count() == 3);
+
+    bits.flip(64);
+    bits.reset(0);
+    CHECK(bits.count() == 1);
+    CHECK(bits.find_first() == 129);
+    CHECK_THROWS_AS(bits.at(130), std::out_of_range);
+
+    bits.set_all();
+    CHECK(bits.all());
+    CHECK(bits.count() == 130);
+    bits.flip_all();
+    CHECK(bits.none());
+    // Bits past size() stay zero.
+    CHECK(bits.words()[2] == 0);
+}
+
+TEST_CASE("bit_vec_resize", "[bit_vec]")
+{
+    dtm::bit_vec bits(10, true);
+    CHECK(bits.count() == 10);
+
+    bits.resize(200, true);
+    CHECK(bits.count() == 200);
+    bits.resize(70);
+    CHECK(bits.count() == 70);
+    bits.resize(1000);
+    CHECK(bits.count() == 70);
+    CHECK(!bits[70]);
+
+    bits.pop_back();
+    CHECK(bits.size() == 999);
+
+    dtm::bit_vec copy = bits;
+    CHECK(copy == bits);
+    copy.set(998);
+    CHECK(copy != bits);
+
+    dtm::bit_vec small{true, false, true};
+    copy = small;
+    CHECK(copy.size() == 3);
+    CHECK(copy.count() == 2);
+    CHECK(copy.words()[1] == 0);
+
+    bits.clear();
+    CHECK(bits.empty());
+    CHECK(bits.count() == 0);
+}
+
+TEST_CASE("bit_vec_bulk_ops", "[bit_vec]")
+{
+    for (size_t n : {1, 63, 64, 65, 1000, 4099}) {
+        std::vector<bool> a = random_bits(n, 50, 1);
+        std::vector<bool> b = random_bits(n, 30, 2);
+        dtm::bit_vec va = to_bit_vec(a);
+        dtm::bit_vec vb = to_bit_vec(b);
+
+        dtm::bit_vec vand = va & vb;
+        dtm::bit_vec vor = va | vb;
+        dtm::bit_vec vxor = va ^ vb;
+        dtm::bit_vec vandnot = va;
+        vandnot.and_not(vb);
+
+        size_t expected_count = 0;
+        for (size_t i = 0; i < n; i++) {
+            CHECK(vand[i] == (a[i] && b[i]));
+            CHECK(vor[i] == (a[i] || b[i]));
+            CHECK(vxor[i] == (a[i] != b[i]));
+            CHECK(vandnot[i] == (a[i] && !b[i]));
+            expected_count += a[i];
+        }
+        CHECK(va.count() == expected_count);
+
+        dtm::bit_vec self = va;
+        self ^= self;
+        CHECK(self.none());
+    }
+
+    dtm::bit_vec a(10), b(11);
+    CHECK_THROWS_AS(a |= b, std::invalid_argument);
+}
+
+TEST_CASE("bit_vec_count_kernels", "[bit_vec]")
+{
+    using kernel = size_t (*)(const uint64_t*, size_t);
+    std::vector<kernel> kernels;
+    kernels.push_back(&dtm::detail::popcount_words_scalar);
+#if DATUM_X86
+    if (dtm::detail::cpu().popcnt)
+        kernels.push_back(&dtm::detail::popcount_words_popcnt);
+#endif
+
+    std::mt19937_64 rng(3);
+    std::vector<uint64_t> words(1029);
+    for (uint64_t& w : words)
+        w = rng() & rng();
+    words[0] = ~uint64_t(0);
+    words[1] = 0;
+    words[2] = uint64_t(1) << 63;
+
+    for (size_t n : {0, 1, 3, 4, 5, 1029}) {
+        size_t expected = 0;
+        for (size_t i = 0; i < n; i++) {
+            for (int bit = 0; bit < 64; bit++)
+                expected += (words[i] >> bit) & 1;
+        }
+        for (kernel k : kernels)
+            CHECK(k(words.data(), n) == expected);
+        CHECK(dtm::detail::popcount_words(words.data(), n) == expected);
+    }
+}
+
+TEST_CASE("bit_vec_iteration", "[bit_vec]")
+{
+    std::vector<bool> ref = random_bits(3000, 5, 3);
+    dtm::bit_vec bits = to_bit_vec(ref);
+
+    std::vector<size_t> expected;
+    for (size_t i = 0; i < ref.size(); i++)
+        if (ref[i])
+            expected.push_back(i);
+
+    std::vector<size_t> seen;
+    bits.for_each_set([&](size_t i) { seen.push_back(i); });
+    CHECK(seen == expected);
+
+    seen.clear();
+    for (size_t i = bits.find_first(); i != bits.size(); i = bits.find_next(i + 1))
+        seen.push_back(i);
+    CHECK(seen == expected);
+
+    dtm::bit_vec empty;
+    CHECK(empty.find_first() == 0);
+    empty.for_each_set([](size_t) { FAIL(); });
+}
+
+TEST_CASE("bit_vec_rank_select", "[bit_vec]")
+{
+    for (unsigned density : {0, 1, 50, 99, 100}) {
+        for (size_t n : {0, 1, 511, 512, 513, 20000, 100000}) {
+            std::vector<bool> ref = random_bits(n, density, uint32_t(n + density));
+            dtm::bit_vec bits = to_bit_vec(ref);
+            dtm::rank_select index(bits);
+
+            size_t ones = 0;
+            std::vector<size_t> positions;
+            for (size_t i = 0; i < n; i++) {
+                if (i % 7 == 0 || i + 1 == n)
+                    REQUIRE(index.rank(i) == ones);
+                if (ref[i]) {
+                    positions.push_back(i);
+                    ones++;
+                }
+            }
+            CHECK(index.rank(n) == ones);
+            CHECK(index.count() == ones);
+
+            for (size_t k = 0; k < positions.size(); k++)
+                REQUIRE(index.select(k) == positions[k]);
+        }
+    }
+}
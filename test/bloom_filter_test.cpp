@@ -0,0 +1,155 @@
+#include "dtm/bloom_filter.hpp"
+
+#include <algorithm>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "dtm/vec.hpp"
+
+#include "catch.hpp"
+
+TEST_CASE("bloom_filter_no_false_negatives", "[bloom_filter]")
+{
+    dtm::bloom_filter<uint64_t> filter(10000, 0.01);
+    CHECK(filter.size_in_bytes() == filter.block_count() * 64);
+
+    for (uint64_t i = 0; i < 10000; i++)
+        filter.insert(i * 7);
+    for (uint64_t i = 0; i < 10000; i++)
+        REQUIRE(filter.contains(i * 7));
+
+    dtm::bloom_filter<std::string> strings(100);
+    strings.insert("alpha");
+    strings.insert("beta");
+    CHECK(strings.contains("alpha"));
+    CHECK(strings.contains("beta"));
+
+    strings.clear();
+    CHECK(!strings.contains("alpha"));
+}
+
+TEST_CASE("bloom_filter_kernels", "[bloom_filter]")
+{
+    using block = dtm::detail::bloom_block;
+    alignas(64) uint64_t scalar[block::words] = {};
+    alignas(64) uint64_t vector[block::words] = {};
+    bool use_vector = false;
+#if DATUM_X86
+    use_vector = dtm::detail::cpu().avx2;
+#endif
+
+    // The same bits from both, so filters built either way agree.
+    uint32_t hash = 0x9e3779b9u;
+    bool masks_match = true;
+    bool blocks_match = true;
+    bool queries_match = true;
+    for (int i = 0; i < 2000; i++, hash = hash * 0x2c1b3c6du + 0x297a2d39u) {
+        block::insert_scalar(scalar, hash);
+        bool found = block::contains_scalar(scalar, hash ^ 0x5bd1e995u);
+#if DATUM_X86
+        if (use_vector) {
+            uint64_t masks[block::words];
+            block::masks_avx2(hash, masks);
+            for (size_t w = 0; w < block::words; w++)
+                masks_match = masks_match && masks[w] == block::mask(hash, w);
+            block::insert_avx2(vector, hash);
+            queries_match = queries_match && block::contains_avx2(vector, hash ^ 0x5bd1e995u) == found;
+            queries_match = queries_match && block::contains_avx2(vector, hash);
+        }
+#endif
+        queries_match = queries_match && block::contains_scalar(scalar, hash);
+        if (i % 50 == 49) {
+            for (size_t w = 0; w < block::words; w++)
+                blocks_match = blocks_match && (!use_vector || scalar[w] == vector[w]);
+            std::fill(scalar, scalar + block::words, 0);
+            std::fill(vector, vector + block::words, 0);
+        }
+    }
+    CHECK(masks_match);
+    CHECK(blocks_match);
+    CHECK(queries_match);
+}
+
+TEST_CASE("bloom_filter_false_positive_rate", "[bloom_filter]")
+{
+    for (double target : {0.1, 0.01, 0.001}) {
+        const uint64_t n = 50000;
+        dtm::bloom_filter<uint64_t> filter(n, target);
+        CHECK(filter.false_positive_rate(n) <= target);
+
+        for (uint64_t i = 0; i < n; i++)
+            filter.insert(i);
+
+        size_t false_positives = 0;
+        const uint64_t probes = 200000;
+        for (uint64_t i = n; i < n + probes; i++)
+            false_positives += filter.contains(i);
+
+        double measured = double(false_positives) / probes;
+        CHECK(measured < target * 1.5);
+        CHECK(measured > target / 4);
+    }
+}
+
+TEST_CASE("bloom_filter_sizing", "[bloom_filter]")
+{
+    using filter = dtm::bloom_filter<int>;
+
+    CHECK(filter::blocks_for(0, 0.01) == 1);
+    CHECK(filter::blocks_for(1000, 0.01) < filter::blocks_for(1000, 0.001));
+    CHECK(filter::blocks_for(1000, 0.01) < filter::blocks_for(2000, 0.01));
+
+    size_t blocks = filter::blocks_for(100000, 0.01);
+    CHECK(filter::false_positive_rate(100000, blocks) <= 0.01);
+    CHECK(filter::false_positive_rate(100000, blocks - 1) > 0.01);
+
+    // Large loads must not underflow into looking perfect.
+    CHECK(filter::false_positive_rate(100000000, 1) > 0.99);
+    CHECK(filter::blocks_for(100000000, 0.01) > 100000000 / 64);
+
+    CHECK_THROWS_AS(filter(10, 0.0), std::invalid_argument);
+    CHECK_THROWS_AS(filter(10, 1.0), std::invalid_argument);
+}
+
+TEST_CASE("bloom_filter_batch", "[bloom_filter]")
+{
+    dtm::bloom_filter<int> filter(1000, 0.05);
+    for (int i = 0; i < 1000; i += 2)
+        filter.insert(i);
+
+    dtm::vec<int> keys;
+    for (int i = 0; i < 1037; i++)
+        keys.push_back(i);
+
+    std::unique_ptr<bool[]> results(new bool[keys.size()]);
+    size_t hits = filter.contains(keys, results.get());
+
+    size_t expected_hits = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        CHECK(results[i] == filter.contains(keys[i]));
+        expected_hits += filter.contains(keys[i]);
+    }
+    CHECK(hits == expected_hits);
+    CHECK(hits >= 500);
+}
+
+TEST_CASE("bloom_filter_copy_merge", "[bloom_filter]")
+{
+    dtm::bloom_filter<int> a(1000), b(1000);
+    for (int i = 0; i < 500; i++) {
+        a.insert(i);
+        b.insert(i + 500);
+    }
+
+    dtm::bloom_filter<int> merged = a;
+    merged |= b;
+    for (int i = 0; i < 1000; i++)
+        REQUIRE(merged.contains(i));
+
+    dtm::bloom_filter<int> moved(std::move(merged));
+    CHECK(moved.contains(999));
+
+    dtm::bloom_filter<int> other(5000);
+    CHECK_THROWS_AS(a |= other, std::invalid_argument);
+}
@@ -0,0 +1,258 @@
+#include "dtm/btree_map.hpp"
+
+#include <vector>
+#include <map>
+#include <random>
+#include <cstdint>
+
+#include "catch.hpp"
+
+template <typename Map, typename Ref>
+void check_same(const Map& map, const Ref& reference)
+{
+    REQUIRE(map.size() == reference.size());
+    auto ref_it = reference.begin();
+    for (auto e : map) {
+        REQUIRE(ref_it != reference.end());
+        CHECK(e.key == ref_it->first);
+        CHECK(e.value == ref_it->second);
+        ++ref_it;
+    }
+    CHECK(ref_it == reference.end());
+}
+
+template <typename Key>
+void check_random_ops(Key range)
+{
+    std::mt19937_64 rng(7);
+    std::map<Key, int> reference;
+    dtm::btree_map<Key, int> map;
+
+    for (int i = 0; i < 20000; i++) {
+        Key k = Key(rng() % uint64_t(range));
+        bool fresh = reference.emplace(k, i).second;
+        CHECK(map.insert(k, i) == fresh);
+    }
+    check_same(map, reference);
+
+    for (int i = 0; i < 10000; i++) {
+        Key k = Key(rng() % uint64_t(range));
+        CHECK(map.erase(k) == reference.erase(k));
+    }
+    check_same(map, reference);
+
+    for (int i = 0; i < 2000; i++) {
+        Key k = Key(rng() % uint64_t(range));
+        auto it = map.lower_bound(k);
+        auto ref = reference.lower_bound(k);
+        if (ref == reference.end()) {
+            CHECK(it == map.end());
+        }
+        else {
+            REQUIRE(it != map.end());
+            CHECK(it->key == ref->first);
+        }
+        CHECK(map.contains(k) == (reference.count(k) == 1));
+    }
+}
+
+TEST_CASE("btree_map_insert_find", "[btree_map]")
+{
+    SECTION("int32") {
+        check_random_ops<int32_t>(30000);
+    }
+
+    SECTION("uint32") {
+        check_random_ops<uint32_t>(30000);
+    }
+
+    SECTION("int64") {
+        check_random_ops<int64_t>(30000);
+    }
+
+    SECTION("uint64") {
+        check_random_ops<uint64_t>(30000);
+    }
+
+    SECTION("double") {
+        check_random_ops<double>(30000);
+    }
+}
+
+TEST_CASE("btree_map_simd_edge_keys", "[btree_map]")
+{
+    // Unsigned keys straddling the sign bit and extreme signed keys.
+    dtm::btree_map<uint32_t, int> u;
+    std::map<uint32_t, int> ur;
+    dtm::btree_map<int64_t, int> s;
+    std::map<int64_t, int> sr;
+    for (int i = 0; i < 500; i++) {
+        u.insert(0x80000000u + i, i);
+        u.insert(0x7fffffffu - i, i);
+        ur[0x80000000u + i] = i;
+        ur[0x7fffffffu - i] = i;
+        s.insert(INT64_MIN + i, i);
+        s.insert(INT64_MAX - i, i);
+        sr[INT64_MIN + i] = i;
+        sr[INT64_MAX - i] = i;
+    }
+    check_same(u, ur);
+    check_same(s, sr);
+    CHECK(u.at(0x80000005u) == 5);
+    CHECK(u.lower_bound(0x7fffffffu)->key == 0x7fffffffu);
+    CHECK(s.lower_bound(0) == s.find(INT64_MAX - 499));
+}
+
+// Owns heap memory, so copies and destruction must be balanced, but can be
+// moved with memcpy.
+struct boxed {
+    int* ptr;
+
+    boxed(int v = 0) : ptr(new int(v)) {}
+    boxed(const boxed& rhs) : ptr(new int(*rhs.ptr)) {}
+    boxed& operator= (const boxed& rhs) { *ptr = *rhs.ptr; return *this; }
+    ~boxed() { delete ptr; }
+
+    bool operator< (const boxed& rhs) const { return *ptr < *rhs.ptr; }
+    bool operator== (const boxed& rhs) const { return *ptr == *rhs.ptr; }
+};
+
+namespace dtm {
+template <> struct is_relocatable<boxed> { static constexpr bool value = true; };
+}
+
+TEST_CASE("btree_map_owning", "[btree_map]")
+{
+    dtm::btree_map<boxed, boxed> map;
+    std::map<int, int> reference;
+    for (int i = 0; i < 3000; i++) {
+        int k = i * 7919 % 3001;
+        map[k] = i;
+        reference[k] = i;
+    }
+    REQUIRE(map.size() == reference.size());
+    auto ref_it = reference.begin();
+    for (auto e : map) {
+        CHECK(*e.key.ptr == ref_it->first);
+        CHECK(*e.value.ptr == ref_it->second);
+        ++ref_it;
+    }
+
+    *map[5].ptr += 100000;
+    CHECK(*map.at(5).ptr == reference[5] + 100000);
+    CHECK_THROWS_AS(map.at(-1), std::out_of_range);
+
+    SECTION("erase") {
+        for (int k = 0; k < 3001; k += 2)
+            CHECK(map.erase(k) == reference.erase(k));
+        CHECK(map.size() == reference.size());
+    }
+
+    SECTION("copy") {
+        dtm::btree_map<boxed, boxed> copy(map);
+        map.clear();
+        CHECK(map.empty());
+        CHECK(map.begin() == map.end());
+        CHECK(copy.size() == reference.size());
+        CHECK(*copy.at(5).ptr == reference[5] + 100000);
+    }
+
+    SECTION("move") {
+        dtm::btree_map<boxed, boxed> moved(std::move(map));
+        CHECK(map.empty());
+        CHECK(moved.size() == reference.size());
+        map = moved;
+        CHECK(map.size() == reference.size());
+        CHECK(*map.at(7).ptr == reference[7]);
+    }
+}
+
+TEST_CASE("btree_map_erase_all", "[btree_map]")
+{
+    dtm::btree_map<int, int> map;
+    for (int i = 0; i < 5000; i++)
+        map.insert(i, -i);
+    for (int i = 0; i < 5000; i++)
+        if (i != 4321)
+            CHECK(map.erase(i) == 1);
+
+    // Emptied leaves are skipped.
+    REQUIRE(map.size() == 1);
+    REQUIRE(map.begin() != map.end());
+    CHECK(map.begin()->key == 4321);
+    CHECK(++map.begin() == map.end());
+    CHECK(map.lower_bound(0)->key == 4321);
+    CHECK(map.upper_bound(4321) == map.end());
+
+    // The tree is still usable after heavy erasing.
+    for (int i = 0; i < 5000; i++)
+        map.insert(i, i);
+    CHECK(map.size() == 5000);
+    CHECK(map.at(4321) == -4321);
+    CHECK(map.at(4320) == 4320);
+}
+
+TEST_CASE("btree_map_bulk_load", "[btree_map]")
+{
+    for (size_t n : {0, 1, 7, 100, 5000, 100000}) {
+        dtm::vec<int64_t> keys;
+        dtm::vec<int> values;
+        for (size_t i = 0; i < n; i++) {
+            keys.push_back(int64_t(i) * 3);
+            values.push_back(int(i));
+        }
+
+        dtm::btree_map<int64_t, int> map;
+        map.insert(-1, -1);
+        map.bulk_load(keys, values);
+        REQUIRE(map.size() == n);
+        CHECK(!map.contains(-1));
+
+        size_t i = 0;
+        for (auto e : map) {
+            CHECK(e.key == int64_t(i) * 3);
+            CHECK(e.value == int(i));
+            ++i;
+        }
+        CHECK(i == n);
+
+        for (size_t j = 0; j < n; j += 97)
+            CHECK(map.at(int64_t(j) * 3) == int(j));
+
+        // Inserting into packed leaves splits them.
+        for (size_t j = 0; j < n; j += 5)
+            CHECK(map.insert(int64_t(j) * 3 + 1, 0));
+        CHECK(map.size() == n + (n + 4) / 5);
+    }
+
+    dtm::btree_map<int, int> map;
+    CHECK_THROWS_AS(map.bulk_load(dtm::vec<int>{1, 3, 3}, dtm::vec<int>{1, 2, 3}), std::invalid_argument);
+    CHECK_THROWS_AS(map.bulk_load(dtm::vec<int>{1, 2}, dtm::vec<int>{1}), std::invalid_argument);
+}
+
+TEST_CASE("btree_map_range", "[btree_map]")
+{
+    dtm::btree_map<int, int> map;
+    for (int i = 0; i < 10000; i += 2)
+        map.insert(i, i / 2);
+
+    long sum = 0;
+    int calls = 0;
+    map.for_each_in_range(101, 1001, [&](int k, int v) {
+        CHECK(k == v * 2);
+        sum += k;
+        ++calls;
+    });
+    CHECK(calls == 450);
+    CHECK(sum == (102 + 1000) * 450 / 2);
+
+    calls = 0;
+    map.for_each_in_range(20000, 30000, [&](int, int) { ++calls; });
+    CHECK(calls == 0);
+
+    const dtm::btree_map<int, int>& cmap = map;
+    dtm::btree_map<int, int>::const_iterator it = cmap.upper_bound(10);
+    CHECK(it->key == 12);
+    map.find(12)->value = 99;
+    CHECK(cmap.at(12) == 99);
+}
@@ -0,0 +1,215 @@
+#include "dtm/concurrent_vec.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "catch.hpp"
+#include "construction_test_type.hpp"
+
+TEST_CASE("concurrent_vec_push_back", "[concurrent_vec]")
+{
+    SECTION("empty") {
+        dtm::concurrent_vec<int> v;
+        CHECK(v.empty());
+        CHECK(v.size() == 0);
+        CHECK(v.begin() == v.end());
+    }
+
+    SECTION("single_thread") {
+        int N = 10000;
+        dtm::concurrent_vec<int> v;
+        for (int i = 0; i < N; i++)
+            CHECK(v.push_back(i) == size_t(i));
+
+        REQUIRE(v.size() == size_t(N));
+        for (int i = 0; i < N; i++)
+            CHECK(v[i] == i);
+    }
+
+    SECTION("move_only") {
+        dtm::concurrent_vec<std::unique_ptr<int>> v;
+        for (int i = 0; i < 100; i++)
+            v.push_back(std::make_unique<int>(i));
+
+        REQUIRE(v.size() == 100);
+        for (int i = 0; i < 100; i++)
+            CHECK(*v[i] == i);
+    }
+
+    SECTION("over_aligned") {
+        struct alignas(64) line {
+            int value;
+        };
+        dtm::concurrent_vec<line> v;
+        bool aligned = true;
+        for (int i = 0; i < 1000; i++) {
+            v.push_back(line{i});
+            aligned = aligned && reinterpret_cast<uintptr_t>(&v[i]) % 64 == 0;
+        }
+        CHECK(aligned);
+        CHECK(v[999].value == 999);
+    }
+
+    SECTION("elements_never_move") {
+        dtm::concurrent_vec<int> v;
+        v.push_back(0);
+        const int* first = &v[0];
+        for (int i = 1; i < 100000; i++)
+            v.push_back(i);
+        CHECK(&v[0] == first);
+    }
+
+    SECTION("many_threads") {
+        const int num_threads = 8;
+        const int per_thread = 20000;
+        dtm::concurrent_vec<int> v;
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&v, t] {
+                for (int i = 0; i < per_thread; i++)
+                    v.push_back(t * per_thread + i);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        REQUIRE(v.size() == num_threads * per_thread);
+        std::vector<int> seen(num_threads * per_thread, 0);
+        for (int val : v)
+            seen[val]++;
+        for (int count : seen)
+            CHECK(count == 1);
+    }
+}
+
+TEST_CASE("concurrent_vec_grow_by", "[concurrent_vec]")
+{
+    SECTION("fill") {
+        dtm::concurrent_vec<int> v;
+        v.push_back(-1);
+        size_t first = v.grow_by(100, 7);
+        CHECK(first == 1);
+        REQUIRE(v.size() == 101);
+        for (size_t i = 1; i < 101; i++)
+            CHECK(v[i] == 7);
+    }
+
+    SECTION("range_spanning_segments") {
+        std::vector<int> src(1000);
+        for (int i = 0; i < 1000; i++)
+            src[i] = i;
+
+        dtm::concurrent_vec<int> v;
+        v.grow_by(src.begin(), src.end());
+        REQUIRE(v.size() == 1000);
+        for (int i = 0; i < 1000; i++)
+            CHECK(v[i] == i);
+
+        size_t total = 0;
+        v.for_each_chunk(v.size(), [&](const int* chunk, size_t length) {
+            for (size_t i = 0; i < length; i++)
+                CHECK(chunk[i] == int(total + i));
+            total += length;
+        });
+        CHECK(total == 1000);
+    }
+
+    SECTION("batches_stay_contiguous") {
+        const int num_threads = 4;
+        const int batch = 37;
+        dtm::concurrent_vec<int> v;
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&v, t] {
+                for (int i = 0; i < 500; i++)
+                    v.grow_by(batch, t);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        REQUIRE(v.size() == num_threads * 500 * batch);
+        for (size_t i = 0; i < v.size(); i += batch)
+            for (size_t j = 1; j < batch; j++)
+                CHECK(v[i + j] == v[i]);
+    }
+}
+
+TEST_CASE("concurrent_vec_readers", "[concurrent_vec]")
+{
+    // Readers only ever see fully constructed elements.
+    const int N = 200000;
+    dtm::concurrent_vec<int> v;
+
+    std::thread writer([&v] {
+        for (int i = 0; i < N; i++)
+            v.push_back(i);
+    });
+
+    bool ok = true;
+    while (v.size() < N) {
+        size_t published = v.size();
+        for (size_t i = published > 100 ? published - 100 : 0; i < published; i++)
+            ok = ok && v[i] == int(i);
+    }
+    writer.join();
+    CHECK(ok);
+}
+
+static std::atomic<bool> concurrent_vec_test_entered(false);
+static std::atomic<bool> concurrent_vec_test_open(false);
+
+// Negative values hold their constructor up until the gate opens.
+struct concurrent_vec_test_gated {
+    explicit concurrent_vec_test_gated(int v) : value(v) {
+        if (v < 0) {
+            concurrent_vec_test_entered = true;
+            while (!concurrent_vec_test_open)
+                std::this_thread::yield();
+        }
+    }
+    int value;
+};
+
+TEST_CASE("concurrent_vec_stalled_writer", "[concurrent_vec]")
+{
+    // A writer stuck in a constructor holds size() back at its slot, but
+    // not the writers after it.
+    dtm::concurrent_vec<concurrent_vec_test_gated> v;
+    std::thread slow([&v] { v.emplace_back(-1); });
+    while (!concurrent_vec_test_entered)
+        std::this_thread::yield();
+
+    for (int i = 0; i < 1000; i++)
+        v.emplace_back(i);
+    CHECK(v.size() == 0u);
+
+    concurrent_vec_test_open = true;
+    slow.join();
+    REQUIRE(v.size() == 1001u);
+    CHECK(v[0].value == -1);
+    CHECK(v[1000].value == 999);
+}
+
+TEST_CASE("concurrent_vec_clear", "[concurrent_vec]")
+{
+    construction_test_type::reset();
+    {
+        dtm::concurrent_vec<construction_test_type> v;
+        v.grow_by(10);
+        CHECK(construction_test_type::num_default_constructions == 10);
+
+        v.clear();
+        CHECK(v.empty());
+        CHECK(construction_test_type::num_destructions == 10);
+
+        v.grow_by(5);
+        CHECK(v.size() == 5);
+    }
+    CHECK(construction_test_type::num_destructions == 15);
+}
@@ -0,0 +1,161 @@
+#include "dtm/flat_map.hpp"
+
+#include <string>
+#include <vector>
+#include <set>
+#include <random>
+
+#include "catch.hpp"
+
+TEST_CASE("flat_set_build", "[flat_map]")
+{
+    SECTION("sorts_and_dedupes") {
+        dtm::flat_set<int> set{5, 3, 9, 3, 1, 5};
+        REQUIRE(set.size() == 4);
+        std::vector<int> seen(set.begin(), set.end());
+        CHECK(seen == std::vector<int>({1, 3, 5, 9}));
+    }
+
+    SECTION("empty") {
+        dtm::flat_set<int> set;
+        CHECK(set.empty());
+        CHECK(set.begin() == set.end());
+        CHECK(!set.contains(0));
+
+        dtm::flat_set<int, std::less<int>, dtm::eytzinger_layout> tree;
+        CHECK(tree.begin() == tree.end());
+        CHECK(!tree.contains(0));
+    }
+
+    SECTION("custom_compare") {
+        dtm::flat_set<int, std::greater<int>> set{1, 2, 3};
+        CHECK(*set.begin() == 3);
+        CHECK(set.contains(2));
+    }
+}
+
+TEST_CASE("flat_set_insert_erase", "[flat_map]")
+{
+    dtm::flat_set<int> set{10, 20};
+    CHECK(set.insert(15));
+    CHECK(!set.insert(15));
+    CHECK(set.insert(5));
+    CHECK(set.insert(25));
+    std::vector<int> seen(set.begin(), set.end());
+    CHECK(seen == std::vector<int>({5, 10, 15, 20, 25}));
+
+    CHECK(set.erase(10) == 1);
+    CHECK(set.erase(10) == 0);
+    CHECK(!set.contains(10));
+    CHECK(set.size() == 4);
+}
+
+template <typename Layout>
+void check_flat_set_search()
+{
+    // Check every tree shape up to a few levels, then a large one.
+    std::vector<size_t> sizes;
+    for (size_t n = 1; n <= 70; n++)
+        sizes.push_back(n);
+    sizes.push_back(10000);
+
+    for (size_t n : sizes) {
+        dtm::vec<int> keys;
+        for (size_t i = 0; i < n; i++)
+            keys.push_back(int(i) * 2);
+
+        dtm::flat_set<int, std::less<int>, Layout> set(keys);
+        REQUIRE(set.size() == n);
+
+        std::vector<int> seen(set.begin(), set.end());
+        REQUIRE(seen.size() == n);
+        for (size_t i = 0; i < n; i++)
+            CHECK(seen[i] == int(i) * 2);
+
+        for (int k = -1; k <= int(n) * 2; k++) {
+            CHECK(set.contains(k) == (k >= 0 && k < int(n) * 2 && k % 2 == 0));
+            auto it = set.lower_bound(k);
+            if (k >= int(n) * 2 - 1)
+                CHECK(it == set.end());
+            else
+                CHECK(*it == (k < 0 ? 0 : (k + 1) / 2 * 2));
+        }
+    }
+}
+
+template <typename Layout>
+void check_flat_map_lookup()
+{
+    std::mt19937 rng(1);
+    std::set<int> reference;
+    dtm::vec<int> keys;
+    dtm::vec<std::string> values;
+    for (int i = 0; i < 2000; i++) {
+        int k = rng() % 5000;
+        keys.push_back(k);
+        values.push_back(std::to_string(k) + (reference.count(k) ? "dup" : ""));
+        reference.insert(k);
+    }
+
+    dtm::flat_map<int, std::string, std::less<int>, Layout> map(keys, values);
+    REQUIRE(map.size() == reference.size());
+
+    auto ref_it = reference.begin();
+    for (auto e : map) {
+        CHECK(e.key == *ref_it++);
+        CHECK(e.value == std::to_string(e.key));
+    }
+
+    for (int k = 0; k < 5000; k++) {
+        auto it = map.find(k);
+        if (reference.count(k)) {
+            REQUIRE(it != map.end());
+            CHECK(it->value == std::to_string(k));
+            CHECK(map.at(k) == std::to_string(k));
+        }
+        else {
+            CHECK(it == map.end());
+            CHECK_THROWS_AS(map.at(k), std::out_of_range);
+        }
+    }
+
+    // Values stay writable in either layout.
+    map.find(*reference.begin())->value = "changed";
+    CHECK(map.at(*reference.begin()) == "changed");
+}
+
+TEST_CASE("flat_map_search", "[flat_map]")
+{
+    SECTION("sorted") {
+        check_flat_set_search<dtm::sorted_layout>();
+        check_flat_map_lookup<dtm::sorted_layout>();
+    }
+
+    SECTION("eytzinger") {
+        check_flat_set_search<dtm::eytzinger_layout>();
+        check_flat_map_lookup<dtm::eytzinger_layout>();
+    }
+}
+
+TEST_CASE("flat_map_modify", "[flat_map]")
+{
+    dtm::flat_map<std::string, int> map{{"b", 2}, {"a", 1}, {"b", 3}};
+    REQUIRE(map.size() == 2);
+    CHECK(map.at("b") == 2);
+
+    map["c"] = 3;
+    map["a"] += 10;
+    CHECK(map.at("a") == 11);
+    CHECK(map.size() == 3);
+
+    CHECK(!map.insert("c", 0).second);
+    CHECK(map.erase("b") == 1);
+
+    std::vector<std::string> keys;
+    for (auto e : map)
+        keys.push_back(e.key);
+    CHECK(keys == std::vector<std::string>({"a", "c"}));
+
+    using int_map = dtm::flat_map<int, int>;
+    CHECK_THROWS_AS(int_map(dtm::vec<int>{1, 2}, dtm::vec<int>{1}), std::invalid_argument);
+}
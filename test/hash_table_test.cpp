@@ -0,0 +1,148 @@
+#include "dtm/hash_table.hpp"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "catch.hpp"
+#include "construction_test_type.hpp"
+
+TEST_CASE("hash_table_construction", "[hash_table]")
+{
+    SECTION("default_is_empty") {
+        dtm::hash_table<int, int> table;
+        CHECK(table.empty());
+        CHECK(table.size() == 0);
+        CHECK(table.capacity() == 0);
+        CHECK(table.begin() == table.end());
+        CHECK(!table.contains(0));
+    }
+
+    SECTION("reserve") {
+        dtm::hash_table<int, int> table(100);
+        CHECK(table.capacity() >= 100);
+        size_t capacity = table.capacity();
+        for (int i = 0; i < 100; i++)
+            table.insert(i, i);
+        CHECK(table.capacity() == capacity);
+    }
+
+    SECTION("copy_and_move") {
+        dtm::hash_table<int, std::string> table;
+        table.insert(1, "one");
+        table.insert(2, "two");
+
+        dtm::hash_table<int, std::string> copy(table);
+        CHECK(copy.size() == 2);
+        CHECK(copy.find(1)->value == "one");
+
+        dtm::hash_table<int, std::string> moved(std::move(table));
+        CHECK(moved.size() == 2);
+        CHECK(table.empty());
+        CHECK(moved.find(2)->value == "two");
+    }
+}
+
+TEST_CASE("hash_table_insert", "[hash_table]")
+{
+    SECTION("many") {
+        int N = 10000;
+        dtm::hash_table<int, int> table;
+        for (int i = 0; i < N; i++)
+            CHECK(table.insert(i, i * 2).second);
+
+        REQUIRE(table.size() == size_t(N));
+        for (int i = 0; i < N; i++) {
+            auto it = table.find(i);
+            REQUIRE(it != table.end());
+            CHECK(it->value == i * 2);
+        }
+        CHECK(table.find(N) == table.end());
+    }
+
+    SECTION("duplicate") {
+        dtm::hash_table<std::string, int> table;
+        CHECK(table.insert("a", 1).second);
+        auto result = table.insert("a", 2);
+        CHECK(!result.second);
+        CHECK(result.first->value == 1);
+        CHECK(table.size() == 1);
+    }
+
+    SECTION("subscript") {
+        dtm::hash_table<std::string, int> table;
+        table["a"] += 1;
+        table["a"] += 1;
+        table["b"] += 1;
+        CHECK(table.size() == 2);
+        CHECK(table["a"] == 2);
+        CHECK(table["b"] == 1);
+    }
+
+    SECTION("set") {
+        dtm::hash_table<uint64_t> set;
+        for (uint64_t i = 0; i < 1000; i++)
+            set.insert(i << 32);
+        CHECK(set.size() == 1000);
+        CHECK(set.contains(uint64_t(999) << 32));
+        CHECK(!set.contains(999));
+    }
+}
+
+TEST_CASE("hash_table_erase", "[hash_table]")
+{
+    SECTION("erase_half") {
+        dtm::hash_table<int, int> table;
+        for (int i = 0; i < 1000; i++)
+            table.insert(i, i);
+        for (int i = 0; i < 1000; i += 2)
+            CHECK(table.erase(i) == 1);
+        CHECK(table.erase(0) == 0);
+
+        CHECK(table.size() == 500);
+        for (int i = 0; i < 1000; i++)
+            CHECK(table.contains(i) == (i % 2 == 1));
+    }
+
+    SECTION("churn") {
+        // Repeated insert/erase must not grow the table without bound.
+        dtm::hash_table<int, int> table;
+        for (int i = 0; i < 100000; i++) {
+            table.insert(i, i);
+            if (i >= 10)
+                table.erase(i - 10);
+        }
+        CHECK(table.size() == 10);
+        CHECK(table.capacity() <= 64);
+    }
+
+    SECTION("destroys_entries") {
+        dtm::hash_table<int, construction_test_type> table;
+        for (int i = 0; i < 10; i++)
+            table.emplace(i);
+
+        construction_test_type::reset();
+        table.erase(3);
+        CHECK(construction_test_type::num_destructions == 1);
+        table.clear();
+        CHECK(construction_test_type::num_destructions == 10);
+        CHECK(table.empty());
+    }
+}
+
+TEST_CASE("hash_table_iteration", "[hash_table]")
+{
+    dtm::hash_table<int, int> table;
+    for (int i = 0; i < 100; i++)
+        table.insert(i, -i);
+
+    std::vector<int> keys;
+    for (const auto& e : table) {
+        CHECK(e.value == -e.key);
+        keys.push_back(e.key);
+    }
+    std::sort(keys.begin(), keys.end());
+    REQUIRE(keys.size() == 100);
+    for (int i = 0; i < 100; i++)
+        CHECK(keys[i] == i);
+}
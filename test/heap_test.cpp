@@ -0,0 +1,215 @@
+#include "dtm/heap.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "catch.hpp"
+
+template <size_t D, typename Compare>
+static bool heap_test_matches_priority_queue(uint32_t seed)
+{
+    // Random pushes, pops and pop_pushes against std::priority_queue.
+    std::mt19937 rng(seed);
+    dtm::heap<int, D, Compare> h;
+    std::priority_queue<int, std::vector<int>, Compare> expected;
+    bool right = true;
+    for (int step = 0; step < 20000; step++) {
+        int op = rng() % 8;
+        int value = int(rng() % 1000);
+        if (op < 4 || expected.empty()) {
+            h.push(value);
+            expected.push(value);
+        }
+        else if (op < 7) {
+            h.pop();
+            expected.pop();
+        }
+        else {
+            h.pop_push(value);
+            expected.pop();
+            expected.push(value);
+        }
+        right = right && h.size() == expected.size();
+        right = right && (expected.empty() || h.top() == expected.top());
+    }
+    while (!expected.empty()) {
+        right = right && h.top() == expected.top();
+        h.pop();
+        expected.pop();
+    }
+    return right && h.empty();
+}
+
+TEST_CASE("heap_order", "[heap]")
+{
+    dtm::heap<int> queue = {3, 1, 4};
+    queue.push(5);
+    CHECK(queue.top() == 5);
+    queue.pop_push(2);
+    CHECK(queue.top() == 4);
+    CHECK(queue.size() == 4);
+    queue.emplace(10);
+    CHECK(queue.top() == 10);
+
+    CHECK(heap_test_matches_priority_queue<2, std::less<int>>(1));
+    CHECK(heap_test_matches_priority_queue<3, std::less<int>>(2));
+    CHECK(heap_test_matches_priority_queue<4, std::less<int>>(3));
+    CHECK(heap_test_matches_priority_queue<8, std::less<int>>(4));
+    CHECK(heap_test_matches_priority_queue<4, std::greater<int>>(5));
+    CHECK(heap_test_matches_priority_queue<8, std::greater<int>>(6));
+}
+
+TEST_CASE("heap_bulk", "[heap]")
+{
+    std::mt19937 rng(9);
+    dtm::vec<std::string> values;
+    for (int i = 0; i < 5000; i++)
+        values.push_back(std::to_string(rng() % 100000));
+    std::vector<std::string> sorted(values.begin(), values.end());
+    std::sort(sorted.begin(), sorted.end(), std::greater<std::string>());
+
+    SECTION("from_vec") {
+        dtm::heap<std::string, 8> h(std::move(values));
+        bool right = true;
+        for (const std::string& s : sorted) {
+            right = right && h.top() == s;
+            h.pop();
+        }
+        CHECK(right);
+        CHECK(h.empty());
+    }
+
+    SECTION("push_range") {
+        // A few into a big heap go one by one, many into a small one
+        // rebuild it; both must come out in order.
+        dtm::heap<std::string> h(values.begin(), values.begin() + 4000);
+        h.push(values.begin() + 4000, values.begin() + 4100);
+        dtm::heap<std::string> small(values.begin() + 4100, values.begin() + 4110);
+        small.push(values.begin() + 4110, values.end());
+        while (!small.empty()) {
+            h.push(small.top());
+            small.pop();
+        }
+        dtm::heap<std::string> copy = h;
+        bool right = true;
+        for (const std::string& s : sorted) {
+            right = right && h.top() == s;
+            h.pop();
+        }
+        CHECK(right);
+        CHECK(copy.size() == 5000);
+        CHECK(copy.top() == sorted[0]);
+        values.clear();
+    }
+}
+
+struct heap_test_entry {
+    uint32_t id;
+    uint64_t distance;
+};
+
+struct heap_test_by_distance {
+    bool operator() (const heap_test_entry& a, const heap_test_entry& b) const {
+        return a.distance > b.distance;
+    }
+};
+
+struct heap_test_track {
+    dtm::vec<size_t>* where;
+    void operator() (const heap_test_entry& e, size_t position) const {
+        (*where)[e.id] = position;
+    }
+};
+
+TEST_CASE("heap_index", "[heap]")
+{
+    using queue_type = dtm::heap<heap_test_entry, 4, heap_test_by_distance, heap_test_track>;
+    const size_t npos = queue_type::npos;
+
+    // Dijkstra with decrease-key, against one that pushes duplicates into
+    // a std::priority_queue and skips the stale ones.
+    const uint32_t nodes = 2000;
+    std::mt19937 rng(11);
+    std::vector<std::vector<std::pair<uint32_t, uint64_t>>> edges(nodes);
+    for (uint32_t i = 0; i < nodes * 8; i++)
+        edges[rng() % nodes].push_back(std::make_pair(uint32_t(rng() % nodes), uint64_t(rng() % 1000 + 1)));
+
+    const uint64_t unreached = ~uint64_t(0);
+    std::vector<uint64_t> expected(nodes, unreached);
+    {
+        using item = std::pair<uint64_t, uint32_t>;
+        std::priority_queue<item, std::vector<item>, std::greater<item>> queue;
+        expected[0] = 0;
+        queue.push(item(0, 0));
+        while (!queue.empty()) {
+            item top = queue.top();
+            queue.pop();
+            if (top.first != expected[top.second])
+                continue;
+            for (const auto& edge : edges[top.second]) {
+                if (top.first + edge.second < expected[edge.first]) {
+                    expected[edge.first] = top.first + edge.second;
+                    queue.push(item(expected[edge.first], edge.first));
+                }
+            }
+        }
+    }
+
+    dtm::vec<size_t> where(nodes, npos);
+    std::vector<uint64_t> distance(nodes, unreached);
+    queue_type queue(heap_test_by_distance(), heap_test_track{&where});
+    distance[0] = 0;
+    queue.push(heap_test_entry{0, 0});
+    bool positions_right = true;
+    while (!queue.empty()) {
+        heap_test_entry top = queue.top();
+        queue.pop();
+        positions_right = positions_right && where[top.id] == npos;
+        for (const auto& edge : edges[top.id]) {
+            uint64_t shorter = top.distance + edge.second;
+            if (shorter >= distance[edge.first])
+                continue;
+            distance[edge.first] = shorter;
+            if (where[edge.first] == npos)
+                queue.push(heap_test_entry{edge.first, shorter});
+            else
+                queue.update(where[edge.first], heap_test_entry{edge.first, shorter});
+        }
+        for (size_t i = 0; i < queue.size(); i++)
+            positions_right = positions_right && where[queue[i].id] == i;
+    }
+    CHECK(positions_right);
+    CHECK(distance == expected);
+
+    SECTION("erase") {
+        for (uint32_t i = 0; i < 100; i++)
+            queue.push(heap_test_entry{i, (i * 37) % 100});
+        for (uint32_t i = 0; i < 100; i += 2)
+            queue.erase(where[i]);
+        CHECK(queue.size() == 50);
+        CHECK(where[0] == npos);
+        bool right = true;
+        uint64_t last = 0;
+        while (!queue.empty()) {
+            right = right && queue.top().id % 2 == 1 && queue.top().distance >= last;
+            last = queue.top().distance;
+            queue.pop();
+        }
+        CHECK(right);
+    }
+
+    SECTION("clear") {
+        queue.push(heap_test_entry{5, 1});
+        queue.push(heap_test_entry{6, 2});
+        CHECK(where[6] != npos);
+        queue.clear();
+        CHECK(queue.empty());
+        CHECK(where[5] == npos);
+        CHECK(where[6] == npos);
+    }
+}
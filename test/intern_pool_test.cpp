@@ -0,0 +1,98 @@
+#include "dtm/intern_pool.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstring>
+
+#include "catch.hpp"
+
+TEST_CASE("intern_pool", "[intern_pool]")
+{
+    dtm::intern_pool pool(256);
+    CHECK(pool.empty());
+
+    uint32_t width = pool.intern("width");
+    uint32_t height = pool.intern("height");
+    CHECK(width == 0);
+    CHECK(height == 1);
+    CHECK(pool.intern(std::string("wid") + "th") == width);
+    CHECK(pool.size() == 2);
+    CHECK(pool[width] == "width");
+    CHECK(strcmp(pool.c_str(height), "height") == 0);
+    CHECK(pool.find("height") == height);
+    CHECK(pool.find("depth") == dtm::intern_pool::npos);
+    CHECK_THROWS_AS(pool.at(2), std::out_of_range);
+
+    uint32_t empty = pool.intern("");
+    CHECK(pool[empty].empty());
+    CHECK(pool.intern(dtm::str_view()) == empty);
+
+    SECTION("stable") {
+        // Views stay put while chunks are added and the index grows.
+        const char* first = pool[width].data();
+        std::string big(1000, 'b');
+        uint32_t big_id = pool.intern(big);
+        for (int i = 0; i < 10000; i++)
+            pool.intern("symbol_" + std::to_string(i));
+        CHECK(pool.size() == 10004);
+        CHECK(pool[width].data() == first);
+        CHECK(pool[big_id] == big);
+
+        bool right = true;
+        for (int i = 0; i < 10000; i++) {
+            std::string s = "symbol_" + std::to_string(i);
+            uint32_t id = pool.find(s);
+            right = right && id == uint32_t(i + 4) && pool[id] == s && pool.c_str(id)[s.size()] == '\0';
+        }
+        CHECK(right);
+        CHECK(pool.size_in_bytes() > 10000 * 8);
+    }
+
+    SECTION("clear") {
+        pool.clear();
+        CHECK(pool.empty());
+        CHECK(pool.find("width") == dtm::intern_pool::npos);
+        CHECK(pool.intern("height") == 0);
+    }
+}
+
+TEST_CASE("concurrent_intern_pool", "[intern_pool]")
+{
+    dtm::concurrent_intern_pool pool(5, 512);
+    CHECK(pool.shard_count() == 8);
+
+    uint32_t a = pool.intern("alpha");
+    CHECK(pool.intern("alpha") == a);
+    CHECK(pool[a] == "alpha");
+    CHECK(strcmp(pool.c_str(a), "alpha") == 0);
+    CHECK(pool.find("alpha") == a);
+    CHECK(pool.find("beta") == dtm::concurrent_intern_pool::npos);
+
+    // Threads intern overlapping strings; all must agree on every id.
+    const int threads = 4;
+    const int strings = 5000;
+    std::vector<std::vector<uint32_t>> ids(threads, std::vector<uint32_t>(strings));
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < strings; i++) {
+                int k = (i + t * 997) % strings;
+                ids[t][k] = pool.intern("key_" + std::to_string(k));
+            }
+        });
+    }
+    for (std::thread& w : workers)
+        w.join();
+
+    CHECK(pool.size() == strings + 1);
+    bool agree = true;
+    for (int k = 0; k < strings; k++) {
+        for (int t = 1; t < threads; t++)
+            agree = agree && ids[t][k] == ids[0][k];
+        agree = agree && pool[ids[0][k]] == "key_" + std::to_string(k);
+        agree = agree && pool.find("key_" + std::to_string(k)) == ids[0][k];
+    }
+    CHECK(agree);
+    CHECK_THROWS_AS(pool.at(0xfffffff0u), std::out_of_range);
+}
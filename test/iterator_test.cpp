@@ -0,0 +1,152 @@
+#include "dtm/iterator.hpp"
+#include "dtm/vec.hpp"
+
+#include <vector>
+#include <numeric>
+#include <cstdint>
+
+#include "catch.hpp"
+
+namespace {
+    int sum(dtm::span<const int> s) {
+        return std::accumulate(s.begin(), s.end(), 0);
+    }
+}
+
+TEST_CASE("span", "[iterator]")
+{
+    SECTION("default_is_empty") {
+        dtm::span<int> s;
+        CHECK(s.empty());
+        CHECK(s.size() == 0);
+        CHECK(s.begin() == s.end());
+    }
+
+    SECTION("from_containers") {
+        dtm::vec<int> v{1, 2, 3};
+        dtm::small_vec<int, 4> sv{4, 5};
+        std::vector<int> stdv{6};
+        int array[] = {7, 8};
+
+        CHECK(sum(v) == 6);
+        CHECK(sum(sv) == 9);
+        CHECK(sum(stdv) == 6);
+        CHECK(sum(array) == 15);
+
+        const dtm::vec<int>& cv = v;
+        dtm::span<const int> cs = cv;
+        CHECK(cs.data() == v.data());
+        CHECK(cs.size() == 3);
+    }
+
+    SECTION("writes_through") {
+        dtm::vec<int> v(4);
+        dtm::span<int> s = v;
+        for (size_t i = 0; i < s.size(); i++)
+            s[i] = int(i);
+        CHECK(v[3] == 3);
+    }
+
+    SECTION("sub_ranges") {
+        dtm::vec<int> v{0, 1, 2, 3, 4, 5};
+        dtm::span<int> s = v;
+        CHECK(sum(s.first(2)) == 1);
+        CHECK(sum(s.last(2)) == 9);
+        CHECK(sum(s.subspan(1, 3)) == 6);
+        CHECK(sum(s.subspan(4)) == 9);
+        CHECK(s.front() == 0);
+        CHECK(s.back() == 5);
+    }
+}
+
+TEST_CASE("zip", "[iterator]")
+{
+    SECTION("lockstep") {
+        dtm::vec<int> a{1, 2, 3};
+        dtm::vec<double> b{0.5, 1.5, 2.5};
+        double total = 0;
+        for (auto t : dtm::zip(a, b))
+            total += std::get<0>(t) * std::get<1>(t);
+        CHECK(total == 0.5 + 3.0 + 7.5);
+    }
+
+    SECTION("shortest_wins") {
+        dtm::vec<int> a{1, 2, 3, 4};
+        std::vector<int> b{1, 2};
+        CHECK(dtm::zip(a, b).size() == 2);
+    }
+
+    SECTION("writes_through") {
+        dtm::vec<int> in{1, 2, 3};
+        dtm::vec<int> out(3);
+        for (auto t : dtm::zip(in, out))
+            std::get<1>(t) = std::get<0>(t) * 10;
+        CHECK(out[2] == 30);
+    }
+
+    SECTION("random_access") {
+        dtm::vec<int> a{1, 2, 3};
+        dtm::vec<int> b{4, 5, 6};
+        auto z = dtm::zip(a, b);
+        CHECK(z.end() - z.begin() == 3);
+        CHECK(std::get<1>(z[2]) == 6);
+        CHECK(std::get<0>(*(z.begin() + 1)) == 2);
+    }
+}
+
+TEST_CASE("enumerate", "[iterator]")
+{
+    dtm::vec<int> v{10, 11, 12};
+    size_t count = 0;
+    for (auto e : dtm::enumerate(v)) {
+        CHECK(e.value == int(e.index) + 10);
+        e.value = 0;
+        count++;
+    }
+    CHECK(count == 3);
+    CHECK(v[2] == 0);
+}
+
+TEST_CASE("strided", "[iterator]")
+{
+    dtm::vec<int> v{0, 1, 2, 3, 4, 5, 6};
+    std::vector<int> seen;
+    for (int val : dtm::strided(v, 3))
+        seen.push_back(val);
+    REQUIRE(seen.size() == 3);
+    CHECK(seen[0] == 0);
+    CHECK(seen[1] == 3);
+    CHECK(seen[2] == 6);
+
+    CHECK(dtm::strided(dtm::span<int>(v.data(), 6), 3).size() == 2);
+    CHECK_THROWS_AS(dtm::strided(v, 0), std::invalid_argument);
+
+    // Strides too big to round up by adding.
+    auto first = dtm::strided(v, SIZE_MAX);
+    REQUIRE(first.size() == 1);
+    CHECK(first[0] == 0);
+    CHECK(dtm::strided(v, SIZE_MAX - 1).size() == 1);
+    CHECK(dtm::strided(dtm::span<int>(v.data(), size_t(0)), SIZE_MAX).size() == 0);
+}
+
+TEST_CASE("chunked", "[iterator]")
+{
+    dtm::vec<int> v{0, 1, 2, 3, 4, 5, 6};
+    auto chunks = dtm::chunked(v, 3);
+    REQUIRE(chunks.size() == 3);
+    CHECK(chunks[0].size() == 3);
+    CHECK(chunks[2].size() == 1);
+    CHECK(chunks[2][0] == 6);
+
+    int total = 0;
+    for (dtm::span<int> chunk : chunks)
+        total += sum(chunk);
+    CHECK(total == 21);
+
+    CHECK_THROWS_AS(dtm::chunked(v, 0), std::invalid_argument);
+
+    auto whole = dtm::chunked(v, SIZE_MAX);
+    REQUIRE(whole.size() == 1);
+    CHECK(whole[0].size() == 7);
+    CHECK(dtm::chunked(dtm::span<int>(v.data(), size_t(0)), SIZE_MAX).size() == 0);
+}
@@ -0,0 +1,142 @@
+#include "dtm/mmap_vec.hpp"
+
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <cerrno>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "catch.hpp"
+
+namespace {
+    // A fresh file in $TMPDIR, removed when the test is done with it even if
+    // a REQUIRE fails, so tests can run in parallel.
+    struct temp_path {
+        temp_path() {
+            const char* dir = std::getenv("TMPDIR");
+            path = std::string(dir && *dir ? dir : "/tmp") + "/mmap_vec_test.XXXXXX";
+            int fd = ::mkstemp(&path[0]);
+            if (fd < 0)
+                throw std::system_error(errno, std::generic_category(), "mkstemp");
+            ::close(fd);
+        }
+        ~temp_path() { ::unlink(path.c_str()); }
+
+        temp_path(const temp_path&) = delete;
+        temp_path& operator= (const temp_path&) = delete;
+
+        operator const char* () const { return path.c_str(); }
+
+        std::string path;
+    };
+
+    struct record {
+        int64_t id;
+        double value;
+    };
+}
+
+TEST_CASE("mmap_vec_create", "[mmap_vec]")
+{
+    temp_path test_path;
+
+    SECTION("empty") {
+        dtm::mmap_vec<int> v(test_path, dtm::mmap_mode::create);
+        CHECK(v.empty());
+        CHECK(v.size() == 0);
+        CHECK(v.begin() == v.end());
+    }
+
+    SECTION("push_back") {
+        int N = 100000;
+        dtm::mmap_vec<int> v(test_path, dtm::mmap_mode::create);
+        for (int i = 0; i < N; i++)
+            v.push_back(i);
+
+        CHECK(v.capacity() >= v.size());
+        REQUIRE(v.size() == size_t(N));
+        for (int i = 0; i < N; i++)
+            CHECK(v[i] == i);
+        CHECK(v.front() == 0);
+        CHECK(v.back() == N - 1);
+    }
+
+    SECTION("resize_and_pop") {
+        dtm::mmap_vec<int> v(test_path, dtm::mmap_mode::create);
+        v.resize(10, 3);
+        REQUIRE(v.size() == 10);
+        CHECK(v[9] == 3);
+
+        v.pop_back();
+        CHECK(v.size() == 9);
+
+        v.resize(2);
+        CHECK(v.size() == 2);
+
+        v.shrink_to_fit();
+        CHECK(v.capacity() >= 2);
+        CHECK(v[1] == 3);
+    }
+}
+
+TEST_CASE("mmap_vec_reopen", "[mmap_vec]")
+{
+    temp_path test_path;
+    {
+        dtm::mmap_vec<record> v(test_path, dtm::mmap_mode::create);
+        for (int i = 0; i < 5000; i++)
+            v.push_back(record{i, i * 0.5});
+        v.flush();
+    }
+
+    SECTION("read_write") {
+        dtm::mmap_vec<record> v(test_path);
+        REQUIRE(v.size() == 5000);
+        CHECK(v[4999].id == 4999);
+        CHECK(v[4999].value == 4999 * 0.5);
+
+        v.push_back(record{-1, 0});
+        CHECK(v.size() == 5001);
+    }
+
+    SECTION("view") {
+        dtm::mmap_view<record> v(test_path, dtm::mmap_advice::sequential);
+        REQUIRE(v.size() == 5000);
+        static_assert(std::is_same<decltype(*v.begin()), const record&>::value, "views hand out const elements");
+        static_assert(std::is_same<decltype(v.data()), const record*>::value, "views hand out const elements");
+
+        int64_t sum = 0;
+        for (const record& r : v)
+            sum += r.id;
+        CHECK(sum == int64_t(4999) * 5000 / 2);
+        CHECK(v.back().id == 4999);
+        CHECK(v.rbegin()->id == 4999);
+
+        CHECK_THROWS_AS(v.at(5000), std::out_of_range);
+    }
+
+    SECTION("element_size_mismatch") {
+        CHECK_THROWS_AS(dtm::mmap_view<int>(test_path), std::runtime_error);
+    }
+
+    SECTION("move") {
+        dtm::mmap_vec<record> v(test_path);
+        dtm::mmap_vec<record> w(std::move(v));
+        CHECK(v.size() == 0);
+        CHECK(w.size() == 5000);
+
+        dtm::mmap_view<record> x(test_path);
+        dtm::mmap_view<record> y(std::move(x));
+        CHECK(x.empty());
+        CHECK(y.size() == 5000);
+    }
+}
+
+TEST_CASE("mmap_vec_missing_file", "[mmap_vec]")
+{
+    temp_path missing;
+    ::unlink(missing);
+    CHECK_THROWS_AS(dtm::mmap_view<int>(missing), std::system_error);
+}
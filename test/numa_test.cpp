@@ -0,0 +1,143 @@
+#include "dtm/numa.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+#include <sys/mman.h>
+
+#include "catch.hpp"
+
+static const size_t numa_test_pages = 1024;
+
+static size_t numa_test_resident(const dtm::numa_distribution& d) {
+    size_t pages = 0;
+    for (size_t n : d.pages)
+        pages += n;
+    return pages;
+}
+
+static std::string numa_test_describe(const dtm::numa_distribution& d) {
+    std::ostringstream out;
+    for (size_t node = 0; node < d.pages.size(); node++)
+        out << "node " << node << ": " << d.pages[node] << " pages, ";
+    out << d.not_present << " not present";
+    return out.str();
+}
+
+TEST_CASE("numa_nodes", "[numa]")
+{
+    CHECK(dtm::numa_node_count() >= 1);
+    CHECK(dtm::numa_current_node() < dtm::numa_node_count());
+
+    SECTION("node_list") {
+        dtm::detail::numa_node_mask mask = dtm::detail::numa_read_node_list("/nonexistent");
+        CHECK(mask.test(0));
+        CHECK(!mask.test(1));
+        CHECK(dtm::detail::numa_nodes_with_memory().test(0));
+    }
+
+    SECTION("mask") {
+        dtm::detail::numa_node_mask mask;
+        mask.set(3);
+        mask.set(70);
+        CHECK(mask.test(3));
+        CHECK(mask.test(70));
+        CHECK(!mask.test(4));
+        CHECK(!mask.test(1000));
+        CHECK(mask.max_node() > 70);
+    }
+}
+
+TEST_CASE("numa_place", "[numa]")
+{
+    dtm::thread_pool pool(4);
+    size_t count = numa_test_pages * DATUM_PAGE_SIZE / sizeof(uint64_t);
+
+    SECTION("distribution_counts_every_page") {
+        dtm::vec<uint64_t> v;
+        dtm::parallel_fill(v, count, uint64_t(1), pool);
+        dtm::numa_distribution d = dtm::numa_page_distribution(v);
+        INFO(numa_test_describe(d));
+        CHECK(d.pages.size() == dtm::numa_node_count());
+        size_t spanned = (reinterpret_cast<uintptr_t>(v.data() + count) - 1) / DATUM_PAGE_SIZE
+                       - reinterpret_cast<uintptr_t>(v.data()) / DATUM_PAGE_SIZE + 1;
+        CHECK(numa_test_resident(d) + d.not_present == spanned);
+        CHECK(d.not_present == 0);
+    }
+
+    SECTION("every_placement") {
+        dtm::numa_placement placements[] = {
+            dtm::numa_placement::interleave,
+            dtm::numa_placement::node_local,
+            dtm::numa_placement::by_worker,
+            dtm::numa_placement::first_touch
+        };
+        for (dtm::numa_placement placement : placements) {
+            // Place before filling, then again once resident.
+            dtm::vec<uint64_t> v;
+            v.reserve(count);
+            dtm::numa_place(v, placement, pool);
+            dtm::parallel_fill(v, count, uint64_t(7), pool);
+            dtm::numa_place(v, placement, pool);
+
+            dtm::numa_distribution d = dtm::numa_page_distribution(v);
+            INFO("placement " << int(placement) << ": " << numa_test_describe(d));
+            CHECK(d.not_present == 0);
+            CHECK(numa_test_resident(d) >= numa_test_pages);
+            CHECK(std::count(v.begin(), v.end(), uint64_t(7)) == ptrdiff_t(count));
+
+            if (placement == dtm::numa_placement::node_local) {
+                // Every whole page is on the calling thread's node.
+                CHECK(d.pages[dtm::numa_current_node()] >= numa_test_pages - 1);
+            }
+            if (placement == dtm::numa_placement::interleave) {
+                for (size_t node = 0; node < d.pages.size(); node++) {
+                    if (dtm::detail::numa_nodes_with_memory().test(node))
+                        CHECK(d.pages[node] > 0);
+                }
+            }
+            if (placement == dtm::numa_placement::by_worker)
+                WARN("by_worker page distribution: " << numa_test_describe(d));
+        }
+    }
+
+    SECTION("bind") {
+        dtm::vec<uint64_t> v;
+        dtm::parallel_fill(v, count, uint64_t(1), pool);
+        dtm::numa_bind(v, 0);
+        dtm::numa_distribution d = dtm::numa_page_distribution(v);
+        CHECK(d.pages[0] >= numa_test_pages - 1);
+
+        size_t missing = dtm::numa_node_count() + 1000;
+        CHECK_THROWS_AS(dtm::numa_bind(v, missing), std::system_error);
+    }
+
+    SECTION("small_and_empty") {
+        dtm::vec<uint64_t> v;
+        dtm::numa_place(v, dtm::numa_placement::interleave, pool);
+        CHECK(numa_test_resident(dtm::numa_page_distribution(v)) == 0);
+
+        v.push_back(1);
+        dtm::numa_place(v, dtm::numa_placement::by_worker, pool);
+        dtm::numa_distribution d = dtm::numa_page_distribution(v);
+        CHECK(numa_test_resident(d) + d.not_present == 1);
+    }
+
+    SECTION("untouched_pages") {
+        // malloc may hand back pages freed earlier, so map fresh ones.
+        size_t bytes = numa_test_pages * DATUM_PAGE_SIZE;
+        void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        REQUIRE(data != MAP_FAILED);
+        dtm::numa_place(data, bytes, dtm::numa_placement::interleave, pool);
+        CHECK(dtm::numa_page_distribution(data, bytes).not_present == numa_test_pages);
+
+        memset(data, 1, bytes / 2);
+        dtm::numa_distribution d = dtm::numa_page_distribution(data, bytes);
+        CHECK(numa_test_resident(d) == numa_test_pages / 2);
+        CHECK(d.not_present == numa_test_pages / 2);
+        munmap(data, bytes);
+    }
+}
@@ -0,0 +1,147 @@
+#include "dtm/packed_vec.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+#include <cstdint>
+
+#include "catch.hpp"
+
+template <typename T>
+static void check_matches(const dtm::packed_vec<T>& packed, const dtm::vec<T>& values)
+{
+    REQUIRE(packed.size() == values.size());
+    for (size_t i = 0; i < values.size(); i++)
+        REQUIRE(packed[i] == values[i]);
+
+    dtm::vec<T> decoded;
+    packed.decode(decoded);
+    REQUIRE(decoded.size() == values.size());
+    CHECK(std::equal(decoded.begin(), decoded.end(), values.begin()));
+
+    size_t index = 0;
+    bool all_equal = true;
+    packed.for_each([&](T value) { all_equal &= value == values[index++]; });
+    CHECK(all_equal);
+    CHECK(index == values.size());
+}
+
+TEST_CASE("packed_vec_frame_of_reference", "[packed_vec]")
+{
+    std::mt19937_64 rng(1);
+    for (unsigned bits : {0, 1, 7, 13, 20, 31, 32, 33, 56, 57, 58, 63, 64}) {
+        uint64_t mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+        dtm::vec<uint64_t> values;
+        for (size_t i = 0; i < 1000; i++)
+            values.push_back(1000000 + (rng() & mask));
+
+        dtm::packed_vec<uint64_t> packed(values);
+        CHECK(packed.block_count() == 7);
+        for (size_t b = 0; b < packed.block_count(); b++)
+            CHECK(packed.block_width(b) <= bits);
+        check_matches(packed, values);
+    }
+
+    // A 17 bit column takes about a quarter of the space.
+    dtm::vec<uint64_t> column;
+    for (size_t i = 0; i < 100000; i++)
+        column.push_back(1000000 + rng() % 100000);
+    dtm::packed_vec<uint64_t> packed(column);
+    CHECK(packed.size_in_bytes() < column.size() * sizeof(uint64_t) / 3);
+    check_matches(packed, column);
+}
+
+TEST_CASE("packed_vec_signed", "[packed_vec]")
+{
+    std::mt19937 rng(2);
+    dtm::vec<int32_t> values;
+    for (size_t i = 0; i < 700; i++)
+        values.push_back(int32_t(rng() % 2000) - 1000);
+    values[5] = std::numeric_limits<int32_t>::min();
+    values[300] = std::numeric_limits<int32_t>::max();
+    values[301] = std::numeric_limits<int32_t>::min();
+
+    dtm::packed_vec<int32_t> packed(values);
+    CHECK(packed.block_width(0) == 32);
+    CHECK(packed.block_width(1) <= 11);
+    check_matches(packed, values);
+
+    dtm::vec<int8_t> small;
+    for (int i = 0; i < 300; i++)
+        small.push_back(int8_t(i));
+    check_matches(dtm::packed_vec<int8_t>(small), small);
+}
+
+TEST_CASE("packed_vec_delta", "[packed_vec]")
+{
+    // Evenly spaced ids take no bits.
+    dtm::vec<uint64_t> ids;
+    for (uint64_t i = 0; i < 1024; i++)
+        ids.push_back(5000000000ull + i * 3);
+    dtm::packed_vec<uint64_t> even(ids, dtm::packed_encoding::delta);
+    for (size_t b = 0; b < even.block_count(); b++)
+        CHECK(even.block_width(b) == 0);
+    check_matches(even, ids);
+
+    // Small random gaps take a few bits, far fewer than their range.
+    std::mt19937_64 rng(3);
+    dtm::vec<uint64_t> sorted;
+    uint64_t id = 1ull << 40;
+    for (size_t i = 0; i < 5000; i++) {
+        id += 1 + rng() % 30;
+        sorted.push_back(id);
+    }
+    sorted[2000] = sorted[1999];
+    dtm::packed_vec<uint64_t> gaps(sorted, dtm::packed_encoding::delta);
+    for (size_t b = 0; b < gaps.block_count(); b++)
+        CHECK(gaps.block_width(b) <= 6);
+    check_matches(gaps, sorted);
+
+    // Gaps as wide as the type.
+    dtm::vec<int64_t> extremes;
+    for (int i = 0; i < 128; i++)
+        extremes.push_back(i < 64 ? std::numeric_limits<int64_t>::min() + i : std::numeric_limits<int64_t>::max() - 127 + i);
+    check_matches(dtm::packed_vec<int64_t>(extremes, dtm::packed_encoding::delta), extremes);
+
+    dtm::vec<uint64_t> unsorted = { 3, 2, 1 };
+    CHECK_THROWS_AS(dtm::packed_vec<uint64_t>(unsorted, dtm::packed_encoding::delta), std::invalid_argument);
+}
+
+TEST_CASE("packed_vec_push_back", "[packed_vec]")
+{
+    for (dtm::packed_encoding encoding : { dtm::packed_encoding::frame_of_reference, dtm::packed_encoding::delta }) {
+        dtm::packed_vec<uint32_t> packed(encoding);
+        dtm::vec<uint32_t> values;
+        CHECK(packed.empty());
+
+        for (uint32_t i = 0; i < 1000; i++) {
+            uint32_t value = i * i / 7;
+            packed.push_back(value);
+            values.push_back(value);
+            REQUIRE(packed.back() == value);
+        }
+        CHECK(packed.encoding() == encoding);
+        CHECK(packed.block_count() == 1000 / 128);
+        CHECK(packed.front() == 0);
+        CHECK(packed.at(999) == values[999]);
+        CHECK_THROWS_AS(packed.at(1000), std::out_of_range);
+        check_matches(packed, values);
+
+        dtm::packed_vec<uint32_t> copy = packed;
+        check_matches(copy, values);
+        dtm::packed_vec<uint32_t> other(encoding);
+        other.swap(copy);
+        check_matches(other, values);
+        CHECK(copy.empty());
+
+        packed.clear();
+        CHECK(packed.empty());
+        packed.push_back(5);
+        CHECK(packed[0] == 5);
+    }
+
+    dtm::packed_vec<uint32_t> sorted(dtm::packed_encoding::delta);
+    sorted.push_back(10);
+    CHECK_THROWS_AS(sorted.push_back(9), std::invalid_argument);
+}
@@ -0,0 +1,372 @@
+#include "dtm/parallel.hpp"
+
+#include <numeric>
+#include <vector>
+#include <cstdint>
+#include <random>
+
+#include "catch.hpp"
+
+// Big enough to be split into chunks, and not a whole number of pages.
+static const size_t parallel_test_size = 300007;
+
+struct parallel_test_record {
+    uint32_t key;
+    uint16_t tag;
+    uint8_t pad[7];
+};
+
+TEST_CASE("parallel_page_chunks", "[parallel]")
+{
+    SECTION("cover_in_order") {
+        size_t element_sizes[] = {1, 4, 8, 12, 13, 4096, 5000};
+        size_t counts[] = {1, 2, 1000, 100003};
+        for (size_t element_size : element_sizes) {
+            for (size_t count : counts) {
+                for (uintptr_t offset : {0, 8, 4000}) {
+                    const void* data = reinterpret_cast<const void*>(uintptr_t(1) << 20 | offset);
+                    dtm::detail::page_chunks chunks(data, count, element_size, 4);
+                    REQUIRE(chunks.size() >= 1);
+                    CHECK(chunks.first(0) == 0);
+                    CHECK(chunks.first(chunks.size()) == count);
+                    bool increasing = true;
+                    bool page_aligned = true;
+                    for (size_t k = 0; k < chunks.size(); k++) {
+                        increasing = increasing && chunks.first(k) < chunks.first(k + 1);
+                        // Chunks after the first start in the element that
+                        // holds a page boundary's byte, or the one after.
+                        if (k > 0) {
+                            uintptr_t start = uintptr_t(data) + chunks.first(k) * element_size;
+                            page_aligned = page_aligned && (start % DATUM_PAGE_SIZE < element_size || start % DATUM_PAGE_SIZE == 0);
+                        }
+                    }
+                    CHECK(increasing);
+                    CHECK(page_aligned);
+                }
+            }
+        }
+    }
+
+    SECTION("empty") {
+        dtm::detail::page_chunks chunks(nullptr, 0, 8, 4);
+        CHECK(chunks.size() == 0);
+    }
+}
+
+TEST_CASE("parallel_fill", "[parallel]")
+{
+    dtm::thread_pool pool(4);
+
+    SECTION("fill") {
+        dtm::vec<uint64_t> v = {1, 2, 3};
+        dtm::parallel_fill(v, parallel_test_size, uint64_t(7), pool);
+        REQUIRE(v.size() == parallel_test_size);
+        CHECK(std::count(v.begin(), v.end(), uint64_t(7)) == ptrdiff_t(parallel_test_size));
+
+        dtm::parallel_fill(v, 5, uint64_t(9), pool);
+        REQUIRE(v.size() == 5);
+        CHECK(std::count(v.begin(), v.end(), uint64_t(9)) == 5);
+
+        dtm::parallel_fill(v, 0, uint64_t(9), pool);
+        CHECK(v.empty());
+    }
+
+    SECTION("records") {
+        dtm::vec<parallel_test_record> v;
+        parallel_test_record r = {42, 7, {}};
+        dtm::parallel_fill(v, parallel_test_size, r, pool);
+        REQUIRE(v.size() == parallel_test_size);
+        bool all = true;
+        for (const parallel_test_record& x : v)
+            all = all && x.key == 42 && x.tag == 7;
+        CHECK(all);
+    }
+
+    SECTION("resize") {
+        dtm::vec<int> v = {1, 2, 3};
+        dtm::parallel_resize(v, parallel_test_size, -1, pool);
+        REQUIRE(v.size() == parallel_test_size);
+        CHECK(v[0] == 1);
+        CHECK(v[2] == 3);
+        CHECK(std::count(v.begin() + 3, v.end(), -1) == ptrdiff_t(parallel_test_size - 3));
+
+        dtm::parallel_resize(v, 2, 5, pool);
+        REQUIRE(v.size() == 2);
+        CHECK(v[1] == 2);
+    }
+
+    SECTION("default_pool") {
+        dtm::vec<double> v;
+        dtm::parallel_fill(v, parallel_test_size, 0.5);
+        dtm::parallel_resize(v, parallel_test_size + 10, 1.5);
+        CHECK(v[parallel_test_size - 1] == 0.5);
+        CHECK(v[parallel_test_size] == 1.5);
+    }
+}
+
+TEST_CASE("parallel_assign_transform", "[parallel]")
+{
+    dtm::thread_pool pool(4);
+    dtm::vec<uint32_t> source;
+    source.resize_for_overwrite(parallel_test_size);
+    std::iota(source.begin(), source.end(), uint32_t(0));
+
+    SECTION("assign") {
+        dtm::vec<uint32_t> v;
+        dtm::parallel_assign(v, source.begin(), source.end(), pool);
+        CHECK(v.size() == source.size());
+        CHECK(std::equal(v.begin(), v.end(), source.begin()));
+
+        std::vector<uint32_t> small = {3, 1, 2};
+        dtm::parallel_assign(v, small.begin(), small.end(), pool);
+        REQUIRE(v.size() == 3);
+        CHECK((v[0] == 3 && v[1] == 1 && v[2] == 2));
+    }
+
+    SECTION("transform") {
+        dtm::vec<uint64_t> squares;
+        dtm::parallel_transform(source, squares, [](uint32_t x) { return uint64_t(x) * x; }, pool);
+        REQUIRE(squares.size() == source.size());
+        bool right = true;
+        for (size_t i = 0; i < squares.size(); i++)
+            right = right && squares[i] == uint64_t(i) * i;
+        CHECK(right);
+    }
+
+    SECTION("transform_in_place") {
+        dtm::parallel_transform(source, source, [](uint32_t x) { return x + 1; }, pool);
+        bool right = true;
+        for (size_t i = 0; i < source.size(); i++)
+            right = right && source[i] == i + 1;
+        CHECK(right);
+    }
+}
+
+TEST_CASE("parallel_scan", "[parallel]")
+{
+    dtm::thread_pool pool(4);
+    std::mt19937 rng(17);
+
+    size_t sizes[] = {0, 1, 2, 1000, parallel_test_size};
+    for (size_t n : sizes) {
+        dtm::vec<int64_t> in;
+        in.resize_for_overwrite(n);
+        for (size_t i = 0; i < n; i++)
+            in[i] = int64_t(rng() % 1000) - 500;
+
+        std::vector<int64_t> inclusive(n), exclusive(n);
+        std::partial_sum(in.begin(), in.end(), inclusive.begin());
+        int64_t sum = 100;
+        for (size_t i = 0; i < n; i++) {
+            exclusive[i] = sum;
+            sum += in[i];
+        }
+
+        dtm::vec<int64_t> out = {1, 2, 3};
+        dtm::parallel_inclusive_scan(in, out, std::plus<int64_t>(), pool);
+        CHECK(out.size() == n);
+        CHECK(std::equal(out.begin(), out.end(), inclusive.begin()));
+
+        dtm::parallel_exclusive_scan(in, out, int64_t(100), std::plus<int64_t>(), pool);
+        CHECK(out.size() == n);
+        CHECK(std::equal(out.begin(), out.end(), exclusive.begin()));
+
+        dtm::vec<int64_t> in_place = in;
+        dtm::parallel_exclusive_scan(in_place, in_place, int64_t(100), std::plus<int64_t>(), pool);
+        CHECK(std::equal(in_place.begin(), in_place.end(), exclusive.begin()));
+
+        in_place = in;
+        dtm::parallel_inclusive_scan(in_place, in_place);
+        CHECK(std::equal(in_place.begin(), in_place.end(), inclusive.begin()));
+    }
+
+    SECTION("max") {
+        dtm::vec<uint32_t> in;
+        in.resize_for_overwrite(parallel_test_size);
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = rng();
+        dtm::vec<uint32_t> out;
+        auto max = [](uint32_t a, uint32_t b) { return std::max(a, b); };
+        dtm::parallel_inclusive_scan(in, out, max, pool);
+        uint32_t running = 0;
+        bool right = true;
+        for (size_t i = 0; i < in.size(); i++) {
+            running = std::max(running, in[i]);
+            right = right && out[i] == running;
+        }
+        CHECK(right);
+    }
+}
+
+TEST_CASE("parallel_sort", "[parallel]")
+{
+    dtm::thread_pool pool(4);
+    std::mt19937_64 rng(5);
+
+    SECTION("random") {
+        size_t sizes[] = {0, 1, 1000, parallel_test_size};
+        for (size_t n : sizes) {
+            dtm::vec<uint64_t> v;
+            v.resize_for_overwrite(n);
+            for (size_t i = 0; i < n; i++)
+                v[i] = rng();
+            std::vector<uint64_t> expected(v.begin(), v.end());
+            std::sort(expected.begin(), expected.end());
+            dtm::parallel_sort(v, std::less<uint64_t>(), pool);
+            CHECK(v.size() == n);
+            CHECK(std::equal(v.begin(), v.end(), expected.begin()));
+        }
+    }
+
+    SECTION("duplicates") {
+        for (uint64_t distinct : {1, 3, 100}) {
+            dtm::vec<uint64_t> v;
+            v.resize_for_overwrite(parallel_test_size);
+            for (size_t i = 0; i < v.size(); i++)
+                v[i] = rng() % distinct;
+            std::vector<uint64_t> expected(v.begin(), v.end());
+            std::sort(expected.begin(), expected.end());
+            dtm::parallel_sort(v, std::less<uint64_t>(), pool);
+            CHECK(std::equal(v.begin(), v.end(), expected.begin()));
+        }
+    }
+
+    SECTION("presorted") {
+        dtm::vec<int> v;
+        v.resize_for_overwrite(parallel_test_size);
+        for (size_t i = 0; i < v.size(); i++)
+            v[i] = int(v.size() - i);
+        dtm::parallel_sort(v, std::less<int>(), pool);
+        CHECK(std::is_sorted(v.begin(), v.end()));
+        dtm::parallel_sort(v, std::greater<int>(), pool);
+        CHECK(std::is_sorted(v.begin(), v.end(), std::greater<int>()));
+    }
+
+    SECTION("records") {
+        dtm::vec<parallel_test_record> v;
+        v.resize_for_overwrite(parallel_test_size);
+        for (size_t i = 0; i < v.size(); i++)
+            v[i] = parallel_test_record{uint32_t(rng() % 5000), uint16_t(i), {}};
+        uint64_t tag_sum = 0;
+        for (const parallel_test_record& r : v)
+            tag_sum += r.tag;
+        auto by_key = [](const parallel_test_record& a, const parallel_test_record& b) { return a.key < b.key; };
+        dtm::parallel_sort(v, by_key, pool);
+        CHECK(std::is_sorted(v.begin(), v.end(), by_key));
+        for (const parallel_test_record& r : v)
+            tag_sum -= r.tag;
+        CHECK(tag_sum == 0);
+    }
+
+    SECTION("default_pool") {
+        dtm::vec<double> v;
+        v.resize_for_overwrite(parallel_test_size);
+        for (size_t i = 0; i < v.size(); i++)
+            v[i] = double(rng() % 100000) / 7;
+        dtm::parallel_sort(v);
+        CHECK(std::is_sorted(v.begin(), v.end()));
+    }
+}
+
+// Every key's home slot is the last one of a sixteenth of the table, so
+// probes run off the ends of the regions.
+struct parallel_test_clumped_hash {
+    size_t operator()(uint64_t key) const noexcept {
+        return (size_t(key % 16) << 60) | (size_t(0xfff) << 48) | size_t(key & 0x7f);
+    }
+};
+
+TEST_CASE("parallel_insert", "[parallel]")
+{
+    dtm::thread_pool pool(4);
+    std::mt19937_64 rng(9);
+
+    SECTION("map") {
+        size_t sizes[] = {0, 10, parallel_test_size};
+        for (size_t n : sizes) {
+            dtm::vec<uint64_t> keys, values;
+            keys.resize_for_overwrite(n);
+            values.resize_for_overwrite(n);
+            for (size_t i = 0; i < n; i++) {
+                // About one key in three is a repeat.
+                keys[i] = rng() % (2 * n + 1);
+                values[i] = i;
+            }
+
+            dtm::hash_table<uint64_t, uint64_t> expected;
+            for (size_t i = 0; i < n; i++)
+                expected.insert(keys[i], values[i]);
+
+            dtm::hash_table<uint64_t, uint64_t> table;
+            dtm::parallel_insert(table, keys, values, pool);
+            REQUIRE(table.size() == expected.size());
+            bool same = true;
+            for (const auto& e : expected) {
+                auto it = table.find(e.key);
+                same = same && it != table.end() && it->value == e.value;
+            }
+            CHECK(same);
+        }
+    }
+
+    SECTION("into_existing") {
+        dtm::hash_table<uint64_t, uint64_t> table;
+        for (uint64_t k = 0; k < 200000; k++)
+            table.insert(k, 1);
+        // Leave erased slots about.
+        for (uint64_t k = 0; k < 200000; k += 3)
+            table.erase(k);
+
+        dtm::vec<uint64_t> keys, values;
+        for (uint64_t k = 100000; k < 400000; k++) {
+            keys.push_back(k);
+            values.push_back(2);
+        }
+        dtm::parallel_insert(table, keys, values, pool);
+
+        bool right = true;
+        size_t count = 0;
+        for (uint64_t k = 0; k < 400000; k++) {
+            uint64_t expected = k >= 200000 ? 2 : k % 3 == 0 ? (k >= 100000 ? 2 : 0) : 1;
+            auto it = table.find(k);
+            if (expected == 0) {
+                right = right && it == table.end();
+            } else {
+                right = right && it != table.end() && it->value == expected;
+                count++;
+            }
+        }
+        CHECK(right);
+        CHECK(table.size() == count);
+
+        // Still an ordinary table afterwards.
+        table.erase(150000);
+        table.insert(500000, 3);
+        CHECK(!table.contains(150000));
+        CHECK(table[500000] == 3);
+        CHECK(table.size() == count);
+    }
+
+    SECTION("overflowing_regions") {
+        dtm::vec<uint64_t> keys;
+        for (uint64_t k = 0; k < 40000; k++)
+            keys.push_back(k * 7);
+        for (uint64_t k = 0; k < 1000; k++)
+            keys.push_back(k * 7);
+
+        dtm::hash_table<uint64_t, dtm::empty_t, parallel_test_clumped_hash> set;
+        dtm::parallel_insert(set, keys, pool);
+        CHECK(set.size() == 40000);
+        bool all = true;
+        for (uint64_t k = 0; k < 40000; k++)
+            all = all && set.contains(k * 7) && !set.contains(k * 7 + 1);
+        CHECK(all);
+    }
+
+    SECTION("mismatched") {
+        dtm::hash_table<uint64_t, uint64_t> table;
+        dtm::vec<uint64_t> keys = {1, 2, 3};
+        dtm::vec<uint64_t> values = {1, 2};
+        CHECK_THROWS_AS(dtm::parallel_insert(table, keys, values, pool), std::invalid_argument);
+    }
+}
@@ -0,0 +1,112 @@
+#include "dtm/per_thread.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+
+#include "catch.hpp"
+
+TEST_CASE("per_thread_slots", "[per_thread]")
+{
+    dtm::thread_pool pool(4);
+
+    SECTION("padded") {
+        dtm::per_thread<uint32_t> counts(pool, 5u);
+        REQUIRE(counts.size() == pool.size() + 1);
+        for (size_t i = 0; i < counts.size(); i++) {
+            CHECK(counts[i] == 5);
+            CHECK(reinterpret_cast<uintptr_t>(&counts[i]) % DATUM_CACHE_LINE_SIZE == 0);
+        }
+        for (size_t i = 1; i < counts.size(); i++)
+            CHECK(reinterpret_cast<uintptr_t>(&counts[i]) - reinterpret_cast<uintptr_t>(&counts[i - 1]) >= DATUM_CACHE_LINE_SIZE);
+    }
+
+    SECTION("local") {
+        dtm::per_thread<uint64_t> counts(pool);
+        // Outside the pool, the shared slot.
+        counts.local() = 7;
+        CHECK(counts[counts.size() - 1] == 7);
+
+        pool.parallel_for(0, 100000, [&](size_t) { counts.local()++; }, 100);
+        CHECK(counts.combine(std::plus<uint64_t>()) == 100007);
+
+        // Each worker only touched its own slot.
+        dtm::per_thread<size_t> owner(pool, dtm::thread_pool::npos);
+        bool own = true;
+        pool.parallel_for(0, 10000, [&](size_t) {
+            size_t index = pool.this_worker_index();
+            size_t& slot = owner.local();
+            if (slot != dtm::thread_pool::npos && slot != index)
+                own = false;
+            slot = index;
+        }, 10);
+        CHECK(own);
+    }
+
+    SECTION("for_each") {
+        dtm::per_thread<int> values(pool, 2);
+        values.for_each([](int& x) { x *= 3; });
+        int sum = 0;
+        const dtm::per_thread<int>& view = values;
+        view.for_each([&](const int& x) { sum += x; });
+        CHECK(sum == int(6 * values.size()));
+    }
+
+    SECTION("combine") {
+        dtm::per_thread<int> values(pool);
+        for (size_t i = 0; i < values.size(); i++)
+            values[i] = int(i) * 10 - 3;
+        int max = values.combine([](int a, int b) { return std::max(a, b); });
+        CHECK(max == int(values.size() - 1) * 10 - 3);
+    }
+
+    SECTION("default_pool") {
+        dtm::per_thread<int> values;
+        CHECK(values.size() == dtm::default_thread_pool().size() + 1);
+    }
+}
+
+TEST_CASE("per_thread_merge", "[per_thread]")
+{
+    dtm::thread_pool pool(4);
+
+    SECTION("vec") {
+        dtm::per_thread<dtm::vec<uint32_t>> evens(pool);
+        pool.parallel_for(0, 50000, [&](size_t i) {
+            if (i % 2 == 0)
+                evens.local().push_back(uint32_t(i));
+        }, 64);
+
+        dtm::vec<uint32_t> all = {1};
+        evens.merge_into(all);
+        REQUIRE(all.size() == 25001);
+        CHECK(all[0] == 1);
+        std::sort(all.data() + 1, all.data() + all.size());
+        bool right = true;
+        for (size_t i = 1; i < all.size(); i++)
+            right = right && all[i] == 2 * (i - 1);
+        CHECK(right);
+    }
+
+    SECTION("hash_table") {
+        dtm::per_thread<dtm::hash_table<uint32_t, uint64_t>> counts(pool);
+        pool.parallel_for(0, 100000, [&](size_t i) { counts.local()[uint32_t(i % 1000)]++; }, 64);
+
+        dtm::hash_table<uint32_t, uint64_t> total;
+        total[0] = 5;
+        counts.merge_into(total, [](uint64_t a, uint64_t b) { return a + b; });
+        REQUIRE(total.size() == 1000);
+        bool right = true;
+        for (uint32_t k = 0; k < 1000; k++)
+            right = right && total[k] == (k == 0 ? 105 : 100);
+        CHECK(right);
+    }
+
+    SECTION("set") {
+        dtm::per_thread<dtm::hash_table<uint32_t>> seen(pool);
+        pool.parallel_for(0, 20000, [&](size_t i) { seen.local().insert(uint32_t(i % 777)); }, 64);
+        dtm::hash_table<uint32_t> all;
+        seen.merge_into(all);
+        CHECK(all.size() == 777);
+    }
+}
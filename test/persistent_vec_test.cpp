@@ -0,0 +1,238 @@
+#include "dtm/persistent_vec.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "catch.hpp"
+
+static int persistent_vec_test_live = 0;
+
+struct persistent_vec_test_counted {
+    explicit persistent_vec_test_counted(int v) : value(v) { persistent_vec_test_live++; }
+    persistent_vec_test_counted(const persistent_vec_test_counted& rhs) : value(rhs.value) { persistent_vec_test_live++; }
+    persistent_vec_test_counted& operator= (const persistent_vec_test_counted&) = default;
+    ~persistent_vec_test_counted() { persistent_vec_test_live--; }
+    int value;
+};
+
+template <typename T>
+static bool persistent_vec_test_same(const dtm::persistent_vec<T>& v, const std::vector<T>& expected)
+{
+    if (v.size() != expected.size())
+        return false;
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (v[i] != expected[i])
+            return false;
+    }
+    return std::equal(v.begin(), v.end(), expected.begin());
+}
+
+TEST_CASE("persistent_vec_versions", "[persistent_vec]")
+{
+    dtm::persistent_vec<int> empty;
+    CHECK(empty.empty());
+    CHECK(empty.begin() == empty.end());
+    CHECK_THROWS_AS(empty.at(0), std::out_of_range);
+
+    dtm::persistent_vec<int> v1 = {1, 2, 3};
+    dtm::persistent_vec<int> v2 = v1.set(0, 10).push_back(4);
+    CHECK(persistent_vec_test_same(v1, {1, 2, 3}));
+    CHECK(persistent_vec_test_same(v2, {10, 2, 3, 4}));
+    CHECK(v2.front() == 10);
+    CHECK(v2.back() == 4);
+    CHECK(persistent_vec_test_same(v2.pop_back().pop_back(), {10, 2}));
+    CHECK(v2.pop_back().pop_back().pop_back().pop_back().empty());
+
+    // Every version along a long history stays as it was, across the
+    // sizes where the tree grows a level (32 + 32 * 32 and 32 + 32^3).
+    std::vector<dtm::persistent_vec<int>> history;
+    dtm::persistent_vec<int> v;
+    for (int i = 0; i < 40000; i++) {
+        v = v.push_back(i);
+        if (i % 997 == 0 || i == 1055 || i == 1056 || i == 1057)
+            history.push_back(v);
+    }
+    CHECK(v.size() == 40000);
+    bool right = true;
+    for (const dtm::persistent_vec<int>& h : history) {
+        for (size_t i = 0; i < h.size(); i++)
+            right = right && h[i] == int(i);
+    }
+    CHECK(right);
+
+    // And back down again.
+    for (int i = 40000; i > 0; i--) {
+        right = right && v.size() == size_t(i) && v.back() == i - 1;
+        v = v.pop_back();
+    }
+    CHECK(right);
+    CHECK(v.empty());
+    for (const dtm::persistent_vec<int>& h : history)
+        right = right && h.back() == int(h.size()) - 1;
+    CHECK(right);
+}
+
+TEST_CASE("persistent_vec_random", "[persistent_vec]")
+{
+    // Random edits on random versions, each checked against a std::vector.
+    std::mt19937 rng(7);
+    std::vector<dtm::persistent_vec<std::string>> versions(1);
+    std::vector<std::vector<std::string>> expected(1);
+    for (int step = 0; step < 4000; step++) {
+        size_t from = rng() % versions.size();
+        dtm::persistent_vec<std::string> v = versions[from];
+        std::vector<std::string> e = expected[from];
+        int op = rng() % 10;
+        if (op < 6 || e.empty()) {
+            int count = rng() % 100;
+            for (int i = 0; i < count; i++) {
+                std::string s = std::to_string(step) + "_" + std::to_string(i);
+                v = v.push_back(s);
+                e.push_back(s);
+            }
+        }
+        else if (op < 8) {
+            size_t count = rng() % (e.size() + 1);
+            for (size_t i = 0; i < count; i++) {
+                v = v.pop_back();
+                e.pop_back();
+            }
+        }
+        else {
+            size_t index = rng() % e.size();
+            v = v.set(index, "set");
+            e[index] = "set";
+        }
+        versions.push_back(v);
+        expected.push_back(e);
+    }
+
+    bool right = true;
+    for (size_t i = 0; i < versions.size(); i++)
+        right = right && persistent_vec_test_same(versions[i], expected[i]);
+    CHECK(right);
+}
+
+TEST_CASE("persistent_vec_transient", "[persistent_vec]")
+{
+    {
+        dtm::persistent_vec<persistent_vec_test_counted> base;
+        {
+            dtm::transient_vec<persistent_vec_test_counted> edit = base.transient();
+            for (int i = 0; i < 5000; i++)
+                edit.push_back(persistent_vec_test_counted(i));
+            base = edit.persistent();
+        }
+        CHECK(persistent_vec_test_live == 5000);
+
+        // Edits after a snapshot copy what they touch and nothing else.
+        dtm::transient_vec<persistent_vec_test_counted> edit = base.transient();
+        edit.set(0, persistent_vec_test_counted(-1));
+        CHECK(persistent_vec_test_live == 5000 + 32);
+        edit.set(1, persistent_vec_test_counted(-2));
+        CHECK(persistent_vec_test_live == 5000 + 32);
+        CHECK(base[0].value == 0);
+        CHECK(edit[0].value == -1);
+        CHECK(edit.at(1).value == -2);
+        CHECK_THROWS_AS(edit.at(5000), std::out_of_range);
+
+        dtm::persistent_vec<persistent_vec_test_counted> snapshot = edit.persistent();
+        for (int i = 0; i < 3000; i++)
+            edit.pop_back();
+        edit.push_back(persistent_vec_test_counted(42));
+        CHECK(edit.size() == 2001);
+        CHECK(edit[2000].value == 42);
+        CHECK(snapshot.size() == 5000);
+        CHECK(snapshot[4999].value == 4999);
+        CHECK(snapshot[1].value == -2);
+
+        dtm::vec<persistent_vec_test_counted> copy = snapshot.to_vec();
+        CHECK(copy.size() == 5000);
+        CHECK(copy[4999].value == 4999);
+        copy.clear();
+    }
+    CHECK(persistent_vec_test_live == 0);
+}
+
+TEST_CASE("persistent_vec_iteration", "[persistent_vec]")
+{
+    std::vector<int> source(3000);
+    for (int i = 0; i < 3000; i++)
+        source[i] = i * 3;
+    dtm::persistent_vec<int> v(source.begin(), source.end());
+    static_assert(!std::is_constructible<dtm::persistent_vec<int>, int, int>::value,
+                  "the range constructor takes only iterators");
+
+    size_t chunks = 0;
+    size_t seen = 0;
+    bool right = true;
+    v.for_each_chunk([&](const int* data, size_t count) {
+        right = right && (count == 32 || seen + count == 3000);
+        for (size_t i = 0; i < count; i++)
+            right = right && data[i] == source[seen + i];
+        seen += count;
+        chunks++;
+    });
+    CHECK(right);
+    CHECK(seen == 3000);
+    CHECK(chunks == (3000 + 31) / 32);
+
+    long long sum = 0;
+    v.for_each([&sum](int x) { sum += x; });
+    CHECK(sum == 3LL * 2999 * 3000 / 2);
+
+    auto it = v.begin();
+    it += 1000;
+    CHECK(*it == 3000);
+    it -= 999;
+    CHECK(*it == 3);
+    --it;
+    CHECK(*it == 0);
+    auto last = v.end();
+    --last;
+    CHECK(*last == 8997);
+    CHECK(v.end() - v.begin() == 3000);
+    CHECK(v.begin()[2047] == 6141);
+    CHECK(std::find(v.begin(), v.end(), 4500) - v.begin() == 1500);
+}
+
+TEST_CASE("persistent_vec_threads", "[persistent_vec]")
+{
+    dtm::persistent_vec<int> base;
+    {
+        dtm::transient_vec<int> edit = base.transient();
+        for (int i = 0; i < 10000; i++)
+            edit.push_back(i);
+        base = edit.persistent();
+    }
+
+    // Threads build their own versions from shared nodes and drop them.
+    std::vector<long long> sums(4);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([base, &sums, t] {
+            dtm::persistent_vec<int> mine = base;
+            for (int i = 0; i < 1000; i++)
+                mine = mine.set((i * 37 + t) % 10000, -1).push_back(t);
+            dtm::transient_vec<int> edit = mine.transient();
+            for (int i = 0; i < 500; i++)
+                edit.pop_back();
+            long long sum = 0;
+            base.for_each([&sum](int x) { sum += x; });
+            sums[t] = sum;
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    bool right = true;
+    for (long long sum : sums)
+        right = right && sum == 9999LL * 10000 / 2;
+    CHECK(right);
+    CHECK(base.size() == 10000);
+    CHECK(base[9999] == 9999);
+}
@@ -0,0 +1,93 @@
+#include "dtm/pipeline.hpp"
+
+#include <string>
+#include <functional>
+
+#include "catch.hpp"
+
+TEST_CASE("pipeline_reduce", "[pipeline]")
+{
+    dtm::vec<int> v{1, 2, 3, 4, 5, 6};
+
+    SECTION("source_only") {
+        CHECK(dtm::from(v).reduce(0, std::plus<int>()) == 21);
+        CHECK(dtm::from(v).count() == 6);
+    }
+
+    SECTION("map_filter") {
+        int total = dtm::from(v)
+            .map([](int x) { return x * x; })
+            .filter([](int x) { return x % 2 == 0; })
+            .reduce(0, std::plus<int>());
+        CHECK(total == 4 + 16 + 36);
+    }
+
+    SECTION("take") {
+        CHECK(dtm::from(v).take(3).reduce(0, std::plus<int>()) == 6);
+        CHECK(dtm::from(v).take(0).count() == 0);
+        CHECK(dtm::from(v).take(100).count() == 6);
+    }
+
+    SECTION("take_after_filter") {
+        int total = dtm::from(v)
+            .filter([](int x) { return x > 2; })
+            .take(2)
+            .reduce(0, std::plus<int>());
+        CHECK(total == 3 + 4);
+    }
+
+    SECTION("from_span") {
+        dtm::span<const int> s(v.data() + 4, 2);
+        CHECK(dtm::from(s).reduce(0, std::plus<int>()) == 11);
+    }
+
+    SECTION("changes_type") {
+        std::string joined = dtm::from(v)
+            .take(3)
+            .map([](int x) { return std::to_string(x); })
+            .reduce(std::string(), [](std::string acc, const std::string& s) { return acc + s; });
+        CHECK(joined == "123");
+    }
+}
+
+TEST_CASE("pipeline_stops_early", "[pipeline]")
+{
+    dtm::vec<int> v(1000, 1);
+    int calls = 0;
+    size_t n = dtm::from(v)
+        .map([&calls](int x) { ++calls; return x; })
+        .take(10)
+        .count();
+    CHECK(n == 10);
+    CHECK(calls == 10);
+}
+
+TEST_CASE("pipeline_collect", "[pipeline]")
+{
+    dtm::vec<int> v{1, 2, 3, 4};
+
+    SECTION("exact_size_reserves") {
+        auto p = dtm::from(v).map([](int x) { return x * 0.5; });
+        CHECK(p.exact_size());
+        dtm::vec<double> out = p.collect<dtm::vec>();
+        REQUIRE(out.size() == 4);
+        CHECK(out.capacity() == 4);
+        CHECK(out[3] == 2.0);
+    }
+
+    SECTION("filtered") {
+        auto p = dtm::from(v).filter([](int x) { return x != 2; });
+        CHECK(!p.exact_size());
+        CHECK(p.size_hint() == 4);
+        dtm::vec<int> out = p.collect<dtm::vec>();
+        REQUIRE(out.size() == 3);
+        CHECK(out[1] == 3);
+    }
+
+    SECTION("for_each_writes_through") {
+        dtm::from(v).take(2).for_each([](int& x) { x = 0; });
+        CHECK(v[0] == 0);
+        CHECK(v[1] == 0);
+        CHECK(v[2] == 3);
+    }
+}
@@ -0,0 +1,214 @@
+#include "dtm/poly_vec.hpp"
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include "catch.hpp"
+
+static int poly_test_live = 0;
+
+struct poly_test_shape {
+    poly_test_shape() { poly_test_live++; }
+    poly_test_shape(const poly_test_shape&) { poly_test_live++; }
+    virtual ~poly_test_shape() { poly_test_live--; }
+    virtual double area() const = 0;
+    virtual int kind() const = 0;
+};
+
+struct poly_test_square : poly_test_shape {
+    explicit poly_test_square(double side) : side(side) {}
+    double area() const override { return side * side; }
+    int kind() const override { return 0; }
+    double side;
+};
+
+// Holds a pointer to itself, which a byte copy would break.
+struct poly_test_named : poly_test_shape {
+    explicit poly_test_named(std::string name) : name(std::move(name)), self(this) {}
+    poly_test_named(poly_test_named&& rhs) : poly_test_shape(rhs), name(std::move(rhs.name)), self(this) {}
+    double area() const override { return double(name.size()); }
+    int kind() const override { return self == this ? 1 : -1; }
+    std::string name;
+    const poly_test_named* self;
+};
+
+struct alignas(32) poly_test_aligned : poly_test_shape {
+    explicit poly_test_aligned(double a) : a(a) {}
+    double area() const override { return a; }
+    int kind() const override { return reinterpret_cast<uintptr_t>(this) % 32 == 0 ? 2 : -2; }
+    double a;
+};
+
+// The shape is not the first base, so it doesn't start the object.
+struct poly_test_tagged_base {
+    virtual ~poly_test_tagged_base() {}
+    uint64_t tag = 99;
+};
+
+struct poly_test_tagged : poly_test_tagged_base, poly_test_shape {
+    explicit poly_test_tagged(std::unique_ptr<int> value) : value(std::move(value)) {}
+    double area() const override { return *value; }
+    int kind() const override { return tag == 99 ? 3 : -3; }
+    std::unique_ptr<int> value;
+};
+
+TEST_CASE("poly_vec_basics", "[poly_vec]")
+{
+    {
+        dtm::poly_vec<poly_test_shape> shapes;
+        CHECK(shapes.empty());
+
+        for (int i = 0; i < 1000; i++) {
+            switch (i % 4) {
+            case 0: shapes.emplace_back<poly_test_square>(2.0); break;
+            case 1: shapes.emplace_back<poly_test_named>(std::string(i % 50, 'x')); break;
+            case 2: shapes.emplace_back<poly_test_aligned>(double(i)); break;
+            case 3: shapes.emplace_back<poly_test_tagged>(std::unique_ptr<int>(new int(i))); break;
+            }
+        }
+        REQUIRE(shapes.size() == 1000);
+        CHECK(poly_test_live == 1000);
+        CHECK(shapes.type_count() == 4);
+        CHECK(shapes.buffer_size() <= shapes.buffer_capacity());
+
+        // Every object survived growth, moved through its own class.
+        bool right = true;
+        for (size_t i = 0; i < shapes.size(); i++) {
+            right = right && shapes[i].kind() == int(i % 4);
+            switch (i % 4) {
+            case 0: right = right && shapes[i].area() == 4.0 && shapes.holds<poly_test_square>(i); break;
+            case 1: right = right && shapes[i].area() == double(i % 50) && shapes.type(i) == typeid(poly_test_named); break;
+            case 2: right = right && shapes[i].area() == double(i); break;
+            case 3: right = right && shapes[i].area() == double(i) && !shapes.holds<poly_test_square>(i); break;
+            }
+        }
+        CHECK(right);
+
+        double total = 0;
+        for (const poly_test_shape& s : shapes)
+            total += s.area();
+        double each = 0;
+        shapes.for_each([&](poly_test_shape& s) { each += s.area(); });
+        CHECK(total == each);
+
+        CHECK(&shapes.front() == &shapes[0]);
+        CHECK(&shapes.back() == &shapes[999]);
+        CHECK_THROWS_AS(shapes.at(1000), std::out_of_range);
+
+        shapes.pop_back();
+        shapes.pop_back();
+        CHECK(poly_test_live == 998);
+        shapes.push_back(poly_test_square(3.0));
+        CHECK(shapes.back().area() == 9.0);
+        CHECK(poly_test_live == 999);
+
+        dtm::poly_vec<poly_test_shape> moved(std::move(shapes));
+        CHECK(shapes.empty());
+        CHECK(moved.size() == 999);
+        shapes = std::move(moved);
+        CHECK(shapes.size() == 999);
+
+        shapes.clear();
+        CHECK(shapes.empty());
+        CHECK(shapes.buffer_size() == 0);
+        CHECK(poly_test_live == 0);
+        shapes.emplace_back<poly_test_square>(1.0);
+    }
+    CHECK(poly_test_live == 0);
+}
+
+TEST_CASE("poly_vec_group_by_type", "[poly_vec]")
+{
+    dtm::poly_vec<poly_test_shape> shapes;
+    shapes.reserve(300, 300 * 64);
+    size_t capacity = shapes.buffer_capacity();
+    for (int i = 0; i < 300; i++) {
+        if (i % 3 == 0)
+            shapes.emplace_back<poly_test_aligned>(double(i));
+        else if (i % 3 == 1)
+            shapes.emplace_back<poly_test_named>(std::to_string(i));
+        else
+            shapes.emplace_back<poly_test_tagged>(std::unique_ptr<int>(new int(i)));
+    }
+    CHECK(shapes.buffer_capacity() == capacity);
+
+    shapes.group_by_type();
+    REQUIRE(shapes.size() == 300);
+    CHECK(poly_test_live == 300);
+
+    // Classes in order of first appearance, objects in order within each.
+    bool right = true;
+    for (size_t i = 0; i < 100; i++) {
+        right = right && shapes[i].kind() == 2 && shapes[i].area() == double(3 * i);
+        right = right && shapes[100 + i].kind() == 1 && shapes[100 + i].area() == double(std::to_string(3 * i + 1).size());
+        right = right && shapes[200 + i].kind() == 3 && shapes[200 + i].area() == double(3 * i + 2);
+    }
+    CHECK(right);
+
+    size_t seen = 0;
+    int previous = -1;
+    bool ordered = true;
+    shapes.for_each_of<poly_test_tagged>([&](poly_test_tagged& t) {
+        ordered = ordered && *t.value > previous;
+        previous = *t.value;
+        seen++;
+    });
+    CHECK(ordered);
+    CHECK(seen == 100);
+
+    // Objects added after grouping are found too.
+    shapes.pop_back();
+    shapes.emplace_back<poly_test_tagged>(std::unique_ptr<int>(new int(1000)));
+    shapes.emplace_back<poly_test_square>(1.0);
+    shapes.emplace_back<poly_test_tagged>(std::unique_ptr<int>(new int(1001)));
+    const dtm::poly_vec<poly_test_shape>& view = shapes;
+    seen = 0;
+    previous = -1;
+    ordered = true;
+    view.for_each_of<poly_test_tagged>([&](const poly_test_tagged& t) {
+        ordered = ordered && *t.value > previous;
+        previous = *t.value;
+        seen++;
+    });
+    CHECK(ordered);
+    CHECK(seen == 101);
+    seen = 0;
+    view.for_each_of<poly_test_square>([&](const poly_test_square&) { seen++; });
+    CHECK(seen == 1);
+
+    shapes.clear();
+    CHECK(poly_test_live == 0);
+}
+
+struct poly_test_plain {
+    int x = 0;
+};
+
+struct poly_test_point : poly_test_plain {
+    int y = 0;
+};
+
+TEST_CASE("poly_vec_relocatable", "[poly_vec]")
+{
+    // Trivially copyable classes are copied a buffer at a time.
+    dtm::poly_vec<poly_test_plain> values;
+    for (int i = 0; i < 10000; i++) {
+        if (i % 2) {
+            poly_test_point& p = values.emplace_back<poly_test_point>();
+            p.x = i;
+            p.y = -i;
+        }
+        else {
+            values.emplace_back<poly_test_plain>().x = i;
+        }
+    }
+    bool right = true;
+    for (size_t i = 0; i < values.size(); i++) {
+        right = right && values[i].x == int(i);
+        if (i % 2)
+            right = right && static_cast<poly_test_point&>(values[i]).y == -int(i);
+    }
+    CHECK(right);
+    CHECK(values.buffer_size() == 5000 * sizeof(poly_test_plain) + 5000 * sizeof(poly_test_point));
+}
@@ -0,0 +1,126 @@
+#include "dtm/radix_sort.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+#include "catch.hpp"
+
+template <typename T>
+dtm::vec<T> random_values(size_t n, uint32_t seed)
+{
+    std::mt19937_64 rng(seed);
+    dtm::vec<T> v;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t bits = rng();
+        T val;
+        memcpy(&val, &bits, sizeof(T));
+        v.push_back(val);
+    }
+    return v;
+}
+
+template <typename T>
+void check_sorts_like_std(size_t n)
+{
+    dtm::vec<T> v = random_values<T>(n, uint32_t(n));
+    std::vector<T> expected(v.begin(), v.end());
+    std::sort(expected.begin(), expected.end());
+
+    dtm::radix_sort(v);
+    REQUIRE(v.size() == n);
+    CHECK(std::equal(v.begin(), v.end(), expected.begin()));
+}
+
+TEST_CASE("radix_sort_integers", "[radix_sort]")
+{
+    for (size_t n : {0, 1, 2, 255, 256, 1000, 100000}) {
+        check_sorts_like_std<uint8_t>(n);
+        check_sorts_like_std<int16_t>(n);
+        check_sorts_like_std<int32_t>(n);
+        check_sorts_like_std<uint32_t>(n);
+        check_sorts_like_std<int64_t>(n);
+        check_sorts_like_std<uint64_t>(n);
+    }
+
+    // Large enough to take the 11 bit digit path.
+    check_sorts_like_std<int32_t>(size_t(1) << 22);
+}
+
+TEST_CASE("radix_sort_floats", "[radix_sort]")
+{
+    std::mt19937 rng(3);
+    std::normal_distribution<double> dist(0, 1000);
+
+    for (size_t n : {100, 5000}) {
+        dtm::vec<double> d;
+        dtm::vec<float> f;
+        for (size_t i = 0; i < n; i++) {
+            d.push_back(dist(rng));
+            f.push_back(float(dist(rng)));
+        }
+        d.push_back(std::numeric_limits<double>::infinity());
+        d.push_back(-std::numeric_limits<double>::infinity());
+        d.push_back(0.0);
+        d.push_back(-0.0);
+        f.push_back(-std::numeric_limits<float>::max());
+        f.push_back(std::numeric_limits<float>::denorm_min());
+
+        dtm::radix_sort(d);
+        dtm::radix_sort(f);
+        CHECK(std::is_sorted(d.begin(), d.end()));
+        CHECK(std::is_sorted(f.begin(), f.end()));
+        CHECK(d.front() == -std::numeric_limits<double>::infinity());
+        CHECK(d.back() == std::numeric_limits<double>::infinity());
+    }
+
+    // -0.0 sorts before 0.0.
+    dtm::vec<double> zeros(300, 0.0);
+    zeros[150] = -0.0;
+    dtm::radix_sort(zeros);
+    CHECK(std::signbit(zeros[0]));
+    CHECK(!std::signbit(zeros[1]));
+}
+
+struct record {
+    int64_t key;
+    uint32_t id;
+};
+
+TEST_CASE("radix_sort_records", "[radix_sort]")
+{
+    for (size_t n : {50, 10000}) {
+        std::mt19937 rng(5);
+        dtm::vec<record> records;
+        for (size_t i = 0; i < n; i++)
+            records.push_back(record{ int64_t(rng() % 100) - 50, uint32_t(i) });
+
+        dtm::vec<record> scratch;
+        dtm::radix_sort(records, [](const record& r) { return r.key; }, scratch);
+
+        // Stable: equal keys keep their input order.
+        for (size_t i = 1; i < n; i++) {
+            REQUIRE(records[i - 1].key <= records[i].key);
+            if (records[i - 1].key == records[i].key)
+                REQUIRE(records[i - 1].id < records[i].id);
+        }
+    }
+}
+
+TEST_CASE("radix_sort_skips_constant_digits", "[radix_sort]")
+{
+    // Only the low byte varies; the result must still be right when most
+    // passes are skipped, including an odd number of real passes.
+    dtm::vec<uint64_t> v;
+    for (uint64_t i = 0; i < 1000; i++)
+        v.push_back(0x1234567800000000ull | ((i * 37) % 256));
+    dtm::radix_sort(v);
+    CHECK(std::is_sorted(v.begin(), v.end()));
+
+    dtm::vec<uint32_t> same(1000, 42u);
+    dtm::radix_sort(same);
+    CHECK(std::all_of(same.begin(), same.end(), [](uint32_t x) { return x == 42; }));
+}
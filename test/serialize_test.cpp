@@ -0,0 +1,316 @@
+#include "dtm/serialize.hpp"
+#include "dtm/str.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace {
+    // Snapshots are written to an anonymous temporary file.
+    struct temp_file {
+        temp_file() : file(std::tmpfile()) {}
+        ~temp_file() { std::fclose(file); }
+
+        int fd() const { return fileno(file); }
+        void rewind() const { lseek(fd(), 0, SEEK_SET); }
+
+        std::vector<char> contents() const {
+            rewind();
+            std::vector<char> buffer;
+            char chunk[4096];
+            ssize_t got;
+            while ((got = ::read(fd(), chunk, sizeof(chunk))) > 0)
+                buffer.insert(buffer.end(), chunk, chunk + got);
+            return buffer;
+        }
+
+        FILE* file;
+    };
+
+    // Deserialize a snapshot held in memory, through a fresh file.
+    template <typename Table>
+    void deserialize_bytes(const std::vector<char>& bytes, Table& table) {
+        temp_file file;
+        if (!bytes.empty())
+            REQUIRE(::write(file.fd(), bytes.data(), bytes.size()) == ssize_t(bytes.size()));
+        file.rewind();
+        dtm::deserialize(file.fd(), table);
+    }
+
+    // Header fields that snapshots are checked on.
+    const size_t header_size_offset = 16;
+    const size_t header_capacity_offset = 24;
+    const size_t header_payload_offset = 32;
+
+    void set_header_field(std::vector<char>& bytes, size_t offset, uint64_t value) {
+        memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+
+    struct point {
+        float x, y, z;
+    };
+}
+
+// str moves as bytes but its bytes point into the heap, so it must not be
+// written to a file.
+static_assert(dtm::is_relocatable<dtm::str>::value, "str is relocatable");
+static_assert(!dtm::is_serializable<dtm::str>::value, "vec<str> must not be serializable");
+static_assert(dtm::is_serializable<point>::value, "plain structs are serializable");
+
+TEST_CASE("serialize_vec", "[serialize]")
+{
+    temp_file file;
+
+    SECTION("round_trip") {
+        dtm::vec<int> v;
+        for (int i = 0; i < 10000; i++)
+            v.push_back(i);
+        dtm::serialize(file.fd(), v);
+
+        file.rewind();
+        dtm::vec<int> loaded{1, 2, 3};
+        dtm::deserialize(file.fd(), loaded);
+        REQUIRE(loaded.size() == 10000);
+        for (int i = 0; i < 10000; i++)
+            CHECK(loaded[i] == i);
+    }
+
+    SECTION("empty") {
+        dtm::vec<int> v;
+        dtm::serialize(file.fd(), v);
+        CHECK(file.contents().size() == 64);
+
+        file.rewind();
+        dtm::vec<int> loaded{1};
+        dtm::deserialize(file.fd(), loaded);
+        CHECK(loaded.empty());
+    }
+
+    SECTION("small_vec") {
+        dtm::small_vec<point, 4> v;
+        v.push_back(point{1, 2, 3});
+        v.push_back(point{4, 5, 6});
+        dtm::serialize(file.fd(), v);
+
+        file.rewind();
+        dtm::small_vec<point, 4> loaded;
+        dtm::deserialize(file.fd(), loaded);
+        REQUIRE(loaded.size() == 2);
+        CHECK(loaded[1].z == 6);
+    }
+
+    SECTION("view") {
+        dtm::vec<point> v;
+        for (int i = 0; i < 100; i++)
+            v.push_back(point{float(i), 0, 0});
+        dtm::serialize(file.fd(), v);
+
+        std::vector<char> buffer = file.contents();
+        dtm::vec_view<point> view = dtm::view<point>(buffer.data(), buffer.size());
+        REQUIRE(view.size() == 100);
+        CHECK(static_cast<const void*>(view.data()) == buffer.data() + 64);
+        CHECK(view[99].x == 99);
+    }
+
+    SECTION("mismatches") {
+        dtm::vec<int> v{1, 2, 3};
+        dtm::serialize(file.fd(), v);
+        std::vector<char> buffer = file.contents();
+
+        CHECK_THROWS_AS(dtm::view<double>(buffer.data(), buffer.size()), dtm::serialize_error);
+        CHECK_THROWS_AS(dtm::view<int>(buffer.data(), buffer.size() - 1), dtm::serialize_error);
+
+        // Flip the byte order mark.
+        std::swap(buffer[4], buffer[7]);
+        CHECK_THROWS_AS(dtm::view<int>(buffer.data(), buffer.size()), dtm::serialize_error);
+    }
+
+    SECTION("size_overflow") {
+        // 2^61 + 1 elements of 8 bytes wraps around to a payload of 8.
+        dtm::vec<uint64_t> v{7};
+        dtm::serialize(file.fd(), v);
+        std::vector<char> bytes = file.contents();
+        set_header_field(bytes, header_size_offset, (uint64_t(1) << 61) + 1);
+        set_header_field(bytes, header_payload_offset, 8);
+
+        CHECK_THROWS_AS(dtm::view<uint64_t>(bytes.data(), bytes.size()), dtm::serialize_error);
+        dtm::vec<uint64_t> loaded{1, 2};
+        CHECK_THROWS_AS(deserialize_bytes(bytes, loaded), dtm::serialize_error);
+        CHECK(loaded.size() == 2);
+    }
+}
+
+TEST_CASE("serialize_hash_table", "[serialize]")
+{
+    temp_file file;
+
+    SECTION("round_trip") {
+        dtm::hash_table<int, double> table;
+        for (int i = 0; i < 1000; i++)
+            table.insert(i, i * 0.25);
+        table.erase(10);
+        dtm::serialize(file.fd(), table);
+
+        file.rewind();
+        dtm::hash_table<int, double> loaded;
+        loaded.insert(-1, 0);
+        dtm::deserialize(file.fd(), loaded);
+        REQUIRE(loaded.size() == 999);
+        CHECK(!loaded.contains(-1));
+        CHECK(!loaded.contains(10));
+        for (int i = 11; i < 1000; i++)
+            CHECK(loaded.find(i)->value == i * 0.25);
+
+        loaded.insert(10, 1);
+        CHECK(loaded.size() == 1000);
+    }
+
+    SECTION("wrong_container") {
+        dtm::vec<int> v{1, 2, 3};
+        dtm::serialize(file.fd(), v);
+
+        file.rewind();
+        dtm::hash_table<int> table;
+        CHECK_THROWS_AS(dtm::deserialize(file.fd(), table), dtm::serialize_error);
+    }
+
+    SECTION("unused_slots_zeroed") {
+        dtm::hash_table<int, double> table;
+        for (int i = 0; i < 100; i++)
+            table.insert(i, 1.5);
+        for (int i = 0; i < 100; i += 3)
+            table.erase(i);
+        dtm::serialize(file.fd(), table);
+
+        std::vector<char> bytes = file.contents();
+        size_t capacity = table.capacity();
+        size_t entry_size = sizeof(dtm::hash_table<int, double>::entry);
+        REQUIRE(bytes.size() == 64 + capacity + entry_size * capacity);
+        bool zeroed = true;
+        for (size_t slot = 0; slot < capacity; slot++) {
+            if (bytes[64 + slot] & 0x80)
+                continue;
+            const char* e = bytes.data() + 64 + capacity + entry_size * slot;
+            for (size_t i = 0; i < entry_size; i++)
+                zeroed = zeroed && e[i] == 0;
+        }
+        CHECK(zeroed);
+    }
+
+    SECTION("view") {
+        dtm::hash_table<int, double> table;
+        for (int i = 0; i < 1000; i++)
+            table.insert(i, i * 0.5);
+        for (int i = 0; i < 1000; i += 4)
+            table.erase(i);
+        dtm::serialize(file.fd(), table);
+
+        std::vector<char> buffer = file.contents();
+        dtm::hash_table_view<int, double> view = dtm::view_hash_table<int, double>(buffer.data(), buffer.size());
+        REQUIRE(view.size() == 750);
+        CHECK(view.capacity() == table.capacity());
+        CHECK(!view.contains(0));
+        CHECK(!view.contains(1000));
+        const char* first = buffer.data() + 64 + view.capacity();
+        const char* found = reinterpret_cast<const char*>(view.find(999));
+        CHECK(found >= first);
+        CHECK(found < buffer.data() + buffer.size());
+        bool right = true;
+        for (int i = 0; i < 1000; i++)
+            right = right && (i % 4 == 0 ? !view.contains(i) : view.find(i)->value == i * 0.5);
+        CHECK(right);
+        size_t visited = 0;
+        view.for_each([&](const dtm::hash_table<int, double>::entry& e) { visited += e.key % 4 != 0; });
+        CHECK(visited == 750);
+
+        dtm::hash_table<int, double> empty;
+        file.rewind();
+        REQUIRE(ftruncate(file.fd(), 0) == 0);
+        dtm::serialize(file.fd(), empty);
+        buffer = file.contents();
+        view = dtm::view_hash_table<int, double>(buffer.data(), buffer.size());
+        CHECK(view.empty());
+        CHECK(!view.contains(1));
+
+        CHECK_THROWS_AS(dtm::view_hash_table<int>(buffer.data(), buffer.size()), dtm::serialize_error);
+        CHECK_THROWS_AS((dtm::view_hash_table<int, double>(buffer.data(), 63)), dtm::serialize_error);
+    }
+
+    SECTION("corrupt") {
+        dtm::hash_table<int, double> table;
+        for (int i = 0; i < 50; i++)
+            table.insert(i, i);
+        dtm::serialize(file.fd(), table);
+        const std::vector<char> good = file.contents();
+        const size_t capacity = table.capacity();
+        const size_t entry_size = sizeof(dtm::hash_table<int, double>::entry);
+
+        dtm::hash_table<int, double> loaded;
+        deserialize_bytes(good, loaded);
+        CHECK(loaded.size() == 50);
+
+        // Capacities below the minimum, or not a power of two.
+        for (uint64_t bad : {1, 2, 4, 12}) {
+            std::vector<char> bytes(good.begin(), good.begin() + 64);
+            set_header_field(bytes, header_size_offset, 0);
+            set_header_field(bytes, header_capacity_offset, bad);
+            set_header_field(bytes, header_payload_offset, bad + entry_size * bad);
+            bytes.resize(64 + bad + entry_size * bad, 0);
+            CHECK_THROWS_AS(deserialize_bytes(bytes, loaded), dtm::serialize_error);
+        }
+
+        // A capacity whose payload size overflows.
+        {
+            std::vector<char> bytes = good;
+            uint64_t huge = uint64_t(1) << 62;
+            set_header_field(bytes, header_capacity_offset, huge);
+            set_header_field(bytes, header_payload_offset, huge + entry_size * huge);
+            CHECK_THROWS_AS(deserialize_bytes(bytes, loaded), dtm::serialize_error);
+        }
+
+        // A size that disagrees with the control bytes.
+        {
+            std::vector<char> bytes = good;
+            set_header_field(bytes, header_size_offset, 51);
+            CHECK_THROWS_AS(deserialize_bytes(bytes, loaded), dtm::serialize_error);
+            set_header_field(bytes, header_size_offset, 5000);
+            CHECK_THROWS_AS(deserialize_bytes(bytes, loaded), dtm::serialize_error);
+        }
+
+        // A control byte that is neither empty, erased nor full.
+        {
+            std::vector<char> bytes = good;
+            for (size_t slot = 0; slot < capacity; slot++) {
+                if (bytes[64 + slot] == 0) {
+                    bytes[64 + slot] = 0x11;
+                    break;
+                }
+            }
+            CHECK_THROWS_AS(deserialize_bytes(bytes, loaded), dtm::serialize_error);
+            CHECK_THROWS_AS((dtm::view_hash_table<int, double>(bytes.data(), bytes.size())), dtm::serialize_error);
+        }
+
+        // No empty slot left to end a probe.
+        {
+            std::vector<char> bytes = good;
+            for (size_t slot = 0; slot < capacity; slot++) {
+                if (bytes[64 + slot] == 0)
+                    bytes[64 + slot] = 1;
+            }
+            CHECK_THROWS_AS(deserialize_bytes(bytes, loaded), dtm::serialize_error);
+        }
+
+        // Truncated in the middle of the entries.
+        {
+            std::vector<char> bytes(good.begin(), good.end() - 7);
+            CHECK_THROWS_AS(deserialize_bytes(bytes, loaded), dtm::serialize_error);
+            CHECK_THROWS_AS((dtm::view_hash_table<int, double>(bytes.data(), bytes.size())), dtm::serialize_error);
+        }
+
+        // Failures leave the table as it was.
+        CHECK(loaded.size() == 50);
+        CHECK(loaded.find(49)->value == 49);
+    }
+}
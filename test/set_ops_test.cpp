@@ -0,0 +1,245 @@
+#include "dtm/set_ops.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "catch.hpp"
+
+// A strictly increasing list of about n values below limit.
+static dtm::vec<uint32_t> random_set(size_t n, uint32_t limit, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> values;
+    for (size_t i = 0; i < n; i++)
+        values.push_back(rng() % limit);
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    dtm::vec<uint32_t> v;
+    for (uint32_t x : values)
+        v.push_back(x);
+    return v;
+}
+
+using kernel = size_t (*)(const uint32_t*, size_t, const uint32_t*, size_t, uint32_t*);
+
+// Every intersect kernel this CPU can run, called directly so each is
+// tested whatever dispatch would pick.
+static std::vector<kernel> intersect_kernels()
+{
+    std::vector<kernel> kernels;
+    kernels.push_back(&dtm::detail::intersect_scalar<uint32_t>);
+    kernels.push_back(&dtm::detail::intersect_gallop<uint32_t>);
+#if DATUM_X86
+    if (dtm::detail::cpu().sse41)
+        kernels.push_back(&dtm::detail::intersect_sse41);
+    if (dtm::detail::cpu().avx2)
+        kernels.push_back(&dtm::detail::intersect_avx2);
+#endif
+    return kernels;
+}
+
+static std::vector<kernel> unite_kernels()
+{
+    std::vector<kernel> kernels;
+    kernels.push_back(&dtm::detail::unite_scalar<uint32_t>);
+#if DATUM_X86
+    if (dtm::detail::cpu().sse41)
+        kernels.push_back(&dtm::detail::merge_sse41<true>);
+#endif
+    return kernels;
+}
+
+static std::vector<kernel> merge_kernels()
+{
+    std::vector<kernel> kernels;
+    kernels.push_back(&dtm::detail::merge_scalar<uint32_t>);
+#if DATUM_X86
+    if (dtm::detail::cpu().sse41)
+        kernels.push_back(&dtm::detail::merge_sse41<false>);
+#endif
+    return kernels;
+}
+
+static void check_all_kernels(const dtm::vec<uint32_t>& a, const dtm::vec<uint32_t>& b)
+{
+    std::vector<uint32_t> expected;
+    std::vector<uint32_t> out(a.size() + b.size());
+
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    for (kernel k : intersect_kernels()) {
+        // Exactly the room intersect promises to need, so that the sanitizer
+        // catches a vector store past it.
+        std::vector<uint32_t> tight(std::min(a.size(), b.size()));
+        // The gallop kernel wants the shorter input first.
+        size_t n = a.size() <= b.size() ? k(a.data(), a.size(), b.data(), b.size(), tight.data())
+                                        : k(b.data(), b.size(), a.data(), a.size(), tight.data());
+        REQUIRE(n == expected.size());
+        REQUIRE(std::equal(expected.begin(), expected.end(), tight.begin()));
+    }
+
+    expected.clear();
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    for (kernel k : unite_kernels()) {
+        size_t n = k(a.data(), a.size(), b.data(), b.size(), out.data());
+        REQUIRE(n == expected.size());
+        REQUIRE(std::equal(expected.begin(), expected.end(), out.begin()));
+    }
+
+    expected.clear();
+    std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    for (kernel k : merge_kernels()) {
+        size_t n = k(a.data(), a.size(), b.data(), b.size(), out.data());
+        REQUIRE(n == expected.size());
+        REQUIRE(std::equal(expected.begin(), expected.end(), out.begin()));
+    }
+}
+
+TEST_CASE("set_ops_random", "[set_ops]")
+{
+    uint32_t seed = 1;
+    for (size_t a_size : {0, 1, 3, 4, 7, 8, 9, 31, 100, 1000, 5000}) {
+        for (size_t b_size : {0, 1, 4, 5, 16, 100, 1000, 5000}) {
+            // Dense ranges share most elements, sparse ones few.
+            for (uint32_t limit : {64u, 4096u, 1u << 30}) {
+                dtm::vec<uint32_t> a = random_set(a_size, limit, seed++);
+                dtm::vec<uint32_t> b = random_set(b_size, limit, seed++);
+                check_all_kernels(a, b);
+            }
+        }
+    }
+}
+
+static dtm::vec<uint32_t> set_ops_test_range(uint32_t first, uint32_t last)
+{
+    dtm::vec<uint32_t> v;
+    for (uint32_t x = first; x < last; x++)
+        v.push_back(x);
+    return v;
+}
+
+TEST_CASE("set_ops_tight_output", "[set_ops]")
+{
+    // A block that is not used up matches again against the next block of
+    // the other input, so the matches run ahead of the shorter input and a
+    // whole vector store would land past min(a_size, b_size).
+    check_all_kernels({1, 2, 3, 10}, set_ops_test_range(1, 9));
+    check_all_kernels({1, 2, 3, 4, 5, 6, 7, 40}, set_ops_test_range(1, 33));
+    check_all_kernels({1, 2, 3, 4, 5, 6, 7, 8, 9, 40}, set_ops_test_range(1, 41));
+    check_all_kernels({1, 2, 3, 10, 20}, set_ops_test_range(1, 21));
+
+    // Short inputs against ones many blocks long, offset so that the short
+    // input's blocks stay behind.
+    for (uint32_t a_size = 1; a_size <= 17; a_size++) {
+        for (uint32_t shift = 0; shift < 8; shift++) {
+            dtm::vec<uint32_t> a = set_ops_test_range(shift, shift + a_size - 1);
+            a.push_back(1000);
+            check_all_kernels(a, set_ops_test_range(0, 40 + shift));
+            check_all_kernels(set_ops_test_range(0, 64), a);
+        }
+    }
+}
+
+TEST_CASE("set_ops_edges", "[set_ops]")
+{
+    // Identical, disjoint and interleaved inputs, and values at the top of
+    // the range, where signed comparison would go wrong.
+    dtm::vec<uint32_t> evens, odds, top;
+    for (uint32_t i = 0; i < 200; i++) {
+        evens.push_back(2 * i);
+        odds.push_back(2 * i + 1);
+    }
+    for (uint32_t i = 0; i < 100; i++)
+        top.push_back(0x7fffffc0u + i);
+
+    check_all_kernels(evens, evens);
+    check_all_kernels(evens, odds);
+    check_all_kernels(odds, top);
+    check_all_kernels(top, top);
+
+    dtm::vec<uint32_t> high;
+    for (uint32_t i = 0; i < 50; i++)
+        high.push_back(0xffffffffu - 50 + i);
+    high.push_back(0xffffffffu);
+    check_all_kernels(high, top);
+    check_all_kernels(high, evens);
+
+    // Merge keeps duplicates, within and across inputs.
+    dtm::vec<uint32_t> dups;
+    for (uint32_t i = 0; i < 60; i++)
+        dups.push_back(i / 3);
+    std::vector<uint32_t> out(dups.size() * 2);
+    for (kernel k : merge_kernels()) {
+        size_t n = k(dups.data(), dups.size(), dups.data(), dups.size(), out.data());
+        REQUIRE(n == 120);
+        CHECK(std::is_sorted(out.begin(), out.end()));
+        CHECK(std::count(out.begin(), out.end(), 7u) == 6);
+    }
+}
+
+TEST_CASE("set_ops_vec", "[set_ops]")
+{
+    dtm::vec<uint32_t> a = random_set(3000, 10000, 7);
+    dtm::vec<uint32_t> b = random_set(40, 10000, 8);
+
+    dtm::vec<uint32_t> out;
+    out.reserve(a.size() + b.size());
+    const uint32_t* storage = out.data();
+
+    // Skewed sizes take the gallop path.
+    dtm::intersect(a, b, out);
+    std::vector<uint32_t> expected;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    REQUIRE(out.size() == expected.size());
+    CHECK(std::equal(out.begin(), out.end(), expected.begin()));
+
+    dtm::unite(a, b, out);
+    expected.clear();
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+    REQUIRE(out.size() == expected.size());
+    CHECK(std::equal(out.begin(), out.end(), expected.begin()));
+
+    dtm::merge(a, b, out);
+    CHECK(out.size() == a.size() + b.size());
+    CHECK(std::is_sorted(out.begin(), out.end()));
+
+    // Results went straight into the reserved storage.
+    CHECK(out.data() == storage);
+
+    dtm::vec<uint32_t> empty;
+    dtm::intersect(a, empty, out);
+    CHECK(out.empty());
+    dtm::unite(empty, b, out);
+    CHECK(out.size() == b.size());
+}
+
+TEST_CASE("set_ops_generic", "[set_ops]")
+{
+    dtm::vec<int64_t> a, b;
+    for (int64_t i = -100; i < 100; i += 3)
+        a.push_back(i);
+    for (int64_t i = -100; i < 100; i += 5)
+        b.push_back(i);
+
+    dtm::vec<int64_t> out;
+    dtm::intersect(a, b, out);
+    REQUIRE(out.size() > 0);
+    for (int64_t x : out)
+        CHECK((x + 100) % 15 == 0);
+
+    dtm::unite(a, b, out);
+    CHECK(std::is_sorted(out.begin(), out.end()));
+    CHECK(std::adjacent_find(out.begin(), out.end()) == out.end());
+
+    std::vector<std::string> words = { "ant", "bee", "cat", "dog" };
+    std::vector<std::string> more = { "bee", "dog", "eel" };
+    std::vector<std::string> both(3);
+    size_t n = dtm::intersect(words.data(), words.size(), more.data(), more.size(), both.data());
+    REQUIRE(n == 2);
+    CHECK(both[0] == "bee");
+    CHECK(both[1] == "dog");
+}
@@ -0,0 +1,171 @@
+#include "dtm/shared_vec.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "catch.hpp"
+
+static int shared_vec_test_live = 0;
+
+struct shared_vec_test_counted {
+    explicit shared_vec_test_counted(int v) : value(v) { shared_vec_test_live++; }
+    shared_vec_test_counted(const shared_vec_test_counted& rhs) : value(rhs.value) { shared_vec_test_live++; }
+    shared_vec_test_counted(shared_vec_test_counted&& rhs) : value(rhs.value) { shared_vec_test_live++; }
+    ~shared_vec_test_counted() { shared_vec_test_live--; }
+    int value;
+};
+
+TEST_CASE("shared_vec_from_vec", "[shared_vec]")
+{
+    SECTION("takes_spare_capacity") {
+        dtm::vec<uint64_t> v;
+        v.reserve(1000);
+        for (uint64_t i = 0; i < 900; i++)
+            v.push_back(i * i);
+        const uint64_t* buffer = v.data();
+
+        dtm::shared_vec<uint64_t> s(std::move(v));
+        CHECK(v.empty());
+        CHECK(v.capacity() == 0);
+        CHECK(s.data() == buffer);
+        CHECK(s.size() == 900);
+        CHECK(s.use_count() == 1);
+        bool right = true;
+        for (uint64_t i = 0; i < 900; i++)
+            right = right && s[i] == i * i;
+        CHECK(right);
+    }
+
+    SECTION("full_relocatable") {
+        dtm::vec<uint8_t> v;
+        v.reserve(3);
+        v.push_back(1);
+        v.push_back(2);
+        v.push_back(3);
+        dtm::shared_vec<uint8_t> s(std::move(v));
+        REQUIRE(s.size() == 3);
+        CHECK(s[0] == 1);
+        CHECK(s.back() == 3);
+        CHECK(reinterpret_cast<uintptr_t>(s.data() + 3) <= reinterpret_cast<uintptr_t>(s.data()) + 8);
+    }
+
+    SECTION("full_not_relocatable") {
+        {
+            dtm::vec<shared_vec_test_counted> v;
+            v.reserve(4);
+            for (int i = 0; i < 4; i++)
+                v.emplace_back(i);
+            dtm::shared_vec<shared_vec_test_counted> s(std::move(v));
+            CHECK(shared_vec_test_live == 4);
+            REQUIRE(s.size() == 4);
+            CHECK(s[3].value == 3);
+        }
+        CHECK(shared_vec_test_live == 0);
+    }
+
+    SECTION("small_vec") {
+        dtm::small_vec<std::string, 4> v;
+        v.push_back("a");
+        v.push_back("b");
+        dtm::shared_vec<std::string> s(std::move(v));
+        CHECK(v.empty());
+        REQUIRE(s.size() == 2);
+        CHECK(s[1] == "b");
+    }
+
+    SECTION("empty") {
+        dtm::vec<int> v;
+        dtm::shared_vec<int> s(std::move(v));
+        CHECK(s.empty());
+        CHECK(s.use_count() == 0);
+        CHECK(s.mutate().size() == 0);
+        CHECK_THROWS_AS(s.at(0), std::out_of_range);
+    }
+}
+
+TEST_CASE("shared_vec_sharing", "[shared_vec]")
+{
+    {
+        dtm::shared_vec<shared_vec_test_counted> a;
+        {
+            dtm::vec<shared_vec_test_counted> v;
+            for (int i = 0; i < 100; i++)
+                v.emplace_back(i);
+            a = dtm::shared_vec<shared_vec_test_counted>(std::move(v));
+        }
+        CHECK(shared_vec_test_live == 100);
+
+        dtm::shared_vec<shared_vec_test_counted> b = a;
+        dtm::shared_vec<shared_vec_test_counted> c;
+        c = b;
+        CHECK(a.use_count() == 3);
+        CHECK(b.data() == a.data());
+        CHECK(shared_vec_test_live == 100);
+
+        // Copy on write.
+        dtm::span<shared_vec_test_counted> mine = b.mutate();
+        CHECK(b.data() != a.data());
+        CHECK(a.use_count() == 2);
+        CHECK(b.unique());
+        CHECK(shared_vec_test_live == 200);
+        mine[0].value = -1;
+        CHECK(a[0].value == 0);
+        CHECK(b[0].value == -1);
+
+        // Already unique: no copy.
+        CHECK(b.mutate().data() == b.data());
+
+        c.reset();
+        CHECK(a.unique());
+        dtm::vec<shared_vec_test_counted> copy = a.to_vec();
+        CHECK(copy.size() == 100);
+        CHECK(copy[99].value == 99);
+        copy.clear();
+
+        dtm::shared_vec<shared_vec_test_counted> moved(std::move(a));
+        CHECK(a.empty());
+        CHECK(moved.use_count() == 1);
+    }
+    CHECK(shared_vec_test_live == 0);
+
+    dtm::shared_vec<int> list = {1, 2, 3};
+    int sum = 0;
+    for (int x : list)
+        sum += x;
+    CHECK(sum == 6);
+    CHECK(list.front() == 1);
+}
+
+TEST_CASE("shared_vec_threads", "[shared_vec]")
+{
+    dtm::vec<uint64_t> v;
+    for (uint64_t i = 0; i < 100000; i++)
+        v.push_back(i);
+    dtm::shared_vec<uint64_t> shared(std::move(v));
+
+    // Copies made, read and dropped on many threads at once.
+    std::vector<uint64_t> sums(8);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([shared, &sums, t] {
+            uint64_t sum = 0;
+            for (int round = 0; round < 100; round++) {
+                dtm::shared_vec<uint64_t> copy = shared;
+                sum += copy[round * 1000];
+            }
+            for (uint64_t x : shared)
+                sum += x;
+            sums[t] = sum;
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    bool right = true;
+    for (uint64_t sum : sums)
+        right = right && sum == 99 * 100 / 2 * 1000 + 99999ull * 100000 / 2;
+    CHECK(right);
+    CHECK(shared.unique());
+}
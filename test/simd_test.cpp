@@ -0,0 +1,138 @@
+#include "dtm/simd.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+#include <cstdint>
+
+#include "dtm/vec.hpp"
+
+#include "catch.hpp"
+
+// Every kernel level this CPU can run, so each is tested whatever dispatch
+// would pick.
+static std::vector<dtm::detail::simd_level> runnable_levels()
+{
+    using dtm::detail::simd_level;
+    std::vector<simd_level> levels = { simd_level::scalar };
+    for (simd_level level : { simd_level::sse2, simd_level::avx2, simd_level::avx512 }) {
+        if (level <= dtm::detail::best_simd_level())
+            levels.push_back(level);
+    }
+    return levels;
+}
+
+template <typename T>
+static void check_kernels(const std::vector<T>& values)
+{
+    const T* data = values.data();
+    size_t size = values.size();
+
+    for (auto level : runnable_levels()) {
+        dtm::detail::simd_functions<T> f = dtm::detail::make_simd_functions<T>(level);
+
+        for (size_t probe = 0; probe < std::min<size_t>(size, 20); probe++) {
+            T needle = values[size - 1 - probe * 7 % size];
+            size_t expected = size_t(std::find(values.begin(), values.end(), needle) - values.begin());
+            REQUIRE(f.find(data, size, needle) == expected);
+            REQUIRE(f.count(data, size, needle) == size_t(std::count(values.begin(), values.end(), needle)));
+        }
+        REQUIRE(f.find(data, size, T(-12345)) == size);
+        REQUIRE(f.count(data, size, T(-12345)) == 0);
+
+        if (size > 0) {
+            REQUIRE(f.min(data, size) == *std::min_element(values.begin(), values.end()));
+            REQUIRE(f.max(data, size) == *std::max_element(values.begin(), values.end()));
+        } else {
+            REQUIRE(f.min(data, size) == dtm::detail::simd_highest<T>());
+            REQUIRE(f.max(data, size) == dtm::detail::simd_lowest<T>());
+        }
+
+        dtm::detail::simd_sum_t<T> expected_sum = 0;
+        for (T x : values)
+            expected_sum += x;
+        REQUIRE(f.sum(data, size) == Approx(expected_sum));
+    }
+}
+
+TEST_CASE("simd_int32", "[simd]")
+{
+    std::mt19937 rng(1);
+    for (size_t n : {0, 1, 3, 4, 15, 16, 63, 64, 65, 100, 1000, 4099}) {
+        std::vector<int32_t> values(n);
+        for (int32_t& x : values)
+            x = int32_t(rng() % 200) - 100;
+        check_kernels(values);
+
+        // Full range values: sums that overflow int32_t, extremes at the
+        // limits.
+        for (int32_t& x : values)
+            x = int32_t(rng());
+        if (n > 0) {
+            values[n / 2] = std::numeric_limits<int32_t>::min();
+            values[n / 3] = std::numeric_limits<int32_t>::max();
+        }
+        check_kernels(values);
+    }
+
+    // The match is in the last lane of an unrolled block, and in the tail.
+    std::vector<int32_t> zeros(200, 0);
+    for (size_t at : {0, 15, 16, 63, 127, 128, 199}) {
+        zeros[at] = 9;
+        check_kernels(zeros);
+        zeros[at] = 0;
+    }
+}
+
+TEST_CASE("simd_float", "[simd]")
+{
+    std::mt19937 rng(2);
+    std::normal_distribution<float> dist(0, 1000);
+    for (size_t n : {0, 1, 5, 16, 64, 65, 257, 5000}) {
+        std::vector<float> values(n);
+        for (float& x : values)
+            x = dist(rng);
+        if (n > 0)
+            values[n - 1] = -std::numeric_limits<float>::infinity();
+        check_kernels(values);
+    }
+
+    // -0.0 and 0.0 compare equal.
+    std::vector<float> zeros(100, 1.0f);
+    zeros[70] = -0.0f;
+    auto f = dtm::detail::simd_functions_for<float>();
+    CHECK(f.find(zeros.data(), zeros.size(), 0.0f) == 70);
+}
+
+TEST_CASE("simd_containers", "[simd]")
+{
+    dtm::vec<int32_t> v;
+    for (int32_t i = 0; i < 1000; i++)
+        v.push_back(i % 100);
+
+    CHECK(dtm::simd::find(v, 42) == 42);
+    CHECK(dtm::simd::find(v, 1000) == v.size());
+    CHECK(dtm::simd::contains(v, 99));
+    CHECK(!dtm::simd::contains(v, -1));
+    CHECK(dtm::simd::count(v, 7) == 10);
+    CHECK(dtm::simd::min(v) == 0);
+    CHECK(dtm::simd::max(v) == 99);
+    CHECK(dtm::simd::sum(v) == 49500);
+
+    dtm::span<const int32_t> tail(v.data() + 950, 50);
+    CHECK(dtm::simd::find(tail, 60) == 10);
+    CHECK(dtm::simd::min(tail) == 50);
+
+    dtm::small_vec<float, 8> small;
+    small.push_back(2.5f);
+    small.push_back(-1.0f);
+    CHECK(dtm::simd::max(small) == 2.5f);
+    CHECK(dtm::simd::sum(small) == 1.5);
+
+    // Types without vector kernels use plain loops.
+    dtm::vec<uint8_t> bytes(300, uint8_t(200));
+    CHECK(dtm::simd::sum(bytes) == 60000u);
+    CHECK(dtm::simd::count(bytes, 200) == 300);
+}
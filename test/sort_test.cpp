@@ -0,0 +1,122 @@
+#include "dtm/sort.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "catch.hpp"
+
+// Input shapes that trip up naive quicksorts.
+template <typename T, typename Make>
+std::vector<std::vector<T>> sort_patterns(size_t n, Make make)
+{
+    std::mt19937 rng(static_cast<uint32_t>(n));
+    std::vector<std::vector<T>> patterns(8);
+    for (size_t i = 0; i < n; i++) {
+        patterns[0].push_back(make(rng()));                 // random
+        patterns[1].push_back(make(uint32_t(i)));           // ascending
+        patterns[2].push_back(make(uint32_t(n - i)));       // descending
+        patterns[3].push_back(make(rng() % 4));             // few distinct
+        patterns[4].push_back(make(7));                     // all equal
+        patterns[5].push_back(make(uint32_t(i % 2 ? i : n - i))); // interleaved
+        patterns[6].push_back(make(uint32_t(i < n / 2 ? i : n - i))); // organ pipe
+        patterns[7].push_back(make(uint32_t(i * 7919 % 97))); // sawtooth
+    }
+    // Nearly sorted.
+    for (size_t i = 0; i + 1 < n; i += 50)
+        std::swap(patterns[1][i], patterns[1][i + 1]);
+    return patterns;
+}
+
+template <typename T, typename Make, typename Compare>
+void check_sorts(Make make, Compare comp)
+{
+    for (size_t n : {0, 1, 2, 3, 5, 8, 9, 23, 24, 25, 100, 129, 1000, 30000}) {
+        for (const std::vector<T>& pattern : sort_patterns<T>(n, make)) {
+            dtm::vec<T> v(pattern.begin(), pattern.end());
+            std::vector<T> expected = pattern;
+            std::stable_sort(expected.begin(), expected.end(), comp);
+
+            dtm::sort(v, comp);
+            REQUIRE(v.size() == n);
+            for (size_t i = 0; i < n; i++)
+                REQUIRE((!comp(v[i], expected[i]) && !comp(expected[i], v[i])));
+        }
+    }
+}
+
+struct pair_key {
+    uint32_t key;
+    uint32_t payload;
+};
+
+// Owns memory, so lost or duplicated elements show up under the sanitizers.
+// Declared relocatable, so the sort moves it with memcpy.
+struct owned_int {
+    std::unique_ptr<int> ptr;
+    explicit owned_int(uint32_t v = 0) : ptr(new int(int(v % 100000))) {}
+    owned_int(const owned_int& rhs) : ptr(new int(*rhs.ptr)) {}
+    owned_int(owned_int&&) = default;
+    owned_int& operator= (owned_int&&) = default;
+};
+
+namespace dtm {
+template <> struct is_relocatable<owned_int> { static constexpr bool value = true; };
+}
+
+TEST_CASE("sort_arithmetic", "[sort]")
+{
+    check_sorts<int>([](uint32_t x) { return int(x); }, std::less<int>());
+    check_sorts<uint64_t>([](uint32_t x) { return uint64_t(x) << 20; }, std::greater<uint64_t>());
+    check_sorts<double>([](uint32_t x) { return double(x) / 3; }, std::less<double>());
+    check_sorts<int8_t>([](uint32_t x) { return int8_t(x); }, std::less<int8_t>());
+}
+
+TEST_CASE("sort_records", "[sort]")
+{
+    auto by_key = [](const pair_key& a, const pair_key& b) { return a.key < b.key; };
+    check_sorts<pair_key>([](uint32_t x) { return pair_key{ x, x * 3 }; }, by_key);
+}
+
+TEST_CASE("sort_non_trivial", "[sort]")
+{
+    check_sorts<std::string>([](uint32_t x) { return std::to_string(x); }, std::less<std::string>());
+
+    auto by_value = [](const owned_int& a, const owned_int& b) { return *a.ptr < *b.ptr; };
+    for (size_t n : {7, 20, 1000, 20000}) {
+        std::mt19937 rng(1);
+        std::vector<owned_int> v;
+        for (size_t i = 0; i < n; i++)
+            v.emplace_back(rng() % 50);
+        dtm::sort(v.data(), v.data() + v.size(), by_value);
+        REQUIRE(std::is_sorted(v.begin(), v.end(), by_value));
+    }
+}
+
+TEST_CASE("sort_small_networks", "[sort]")
+{
+    // Every 0/1 input of up to 8 elements: a network that sorts all of
+    // these sorts everything.
+    for (size_t n = 0; n <= 8; n++) {
+        for (uint32_t bits = 0; bits < (1u << n); bits++) {
+            int a[8];
+            for (size_t i = 0; i < n; i++)
+                a[i] = (bits >> i) & 1;
+            dtm::sort(a, a + n);
+            REQUIRE(std::is_sorted(a, a + n));
+        }
+    }
+}
+
+TEST_CASE("sort_small_vec", "[sort]")
+{
+    dtm::small_vec<int, 8> v{5, 3, 8, 1, 9, 2};
+    dtm::sort(v);
+    CHECK(std::is_sorted(v.begin(), v.end()));
+    CHECK(v[0] == 1);
+    CHECK(v[5] == 9);
+}
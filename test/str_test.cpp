@@ -0,0 +1,199 @@
+#include "dtm/str.hpp"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <cstring>
+
+#include "dtm/hash_table.hpp"
+
+#include "catch.hpp"
+
+TEST_CASE("str_inline_and_heap", "[str]")
+{
+    CHECK(sizeof(dtm::str) == 24);
+    CHECK(dtm::is_relocatable<dtm::str>::value);
+
+    dtm::str empty;
+    CHECK(empty.empty());
+    CHECK(empty.is_inline());
+    CHECK(empty.capacity() == 23);
+    CHECK(strcmp(empty.c_str(), "") == 0);
+
+    // Every length from inline through full to heap.
+    std::string expected;
+    dtm::str s;
+    bool right = true;
+    for (int i = 0; i < 100; i++) {
+        char c = char('a' + i % 26);
+        s.push_back(c);
+        expected.push_back(c);
+        right = right && s.size() == expected.size() && s.is_inline() == (expected.size() <= 23);
+        right = right && strcmp(s.c_str(), expected.c_str()) == 0 && s == expected;
+    }
+    CHECK(right);
+
+    for (int i = 0; i < 90; i++) {
+        s.pop_back();
+        expected.pop_back();
+        right = right && strcmp(s.c_str(), expected.c_str()) == 0;
+    }
+    CHECK(right);
+    CHECK(s.size() == 10);
+
+    dtm::str full("abcdefghijklmnopqrstuvw");
+    CHECK(full.size() == 23);
+    CHECK(full.is_inline());
+    CHECK(full.c_str()[23] == '\0');
+    full += 'x';
+    CHECK(!full.is_inline());
+    CHECK(full == "abcdefghijklmnopqrstuvwx");
+
+    SECTION("copy_and_move") {
+        dtm::str small("short");
+        dtm::str big(40, 'z');
+        dtm::str a = small;
+        dtm::str b = big;
+        CHECK(a == small);
+        CHECK(b == big);
+        CHECK(b.data() != big.data());
+
+        dtm::str c = std::move(b);
+        CHECK(b.empty());
+        CHECK(c == std::string(40, 'z'));
+        a = c;
+        CHECK(a == c);
+        a = small;
+        CHECK(a == "short");
+        a = std::move(c);
+        CHECK(a.size() == 40);
+        a.swap(small);
+        CHECK(a == "short");
+        CHECK(small.size() == 40);
+    }
+
+    SECTION("append_self") {
+        dtm::str t("0123456789");
+        t.append(t.data() + 2, 5);
+        CHECK(t == "012345678923456");
+        for (int i = 0; i < 3; i++)
+            t.append(t);
+        CHECK(t.size() == 120);
+        CHECK(t.substr(105) == "012345678923456");
+        t = t.view().substr(100, 10);
+        CHECK(t == "2345601234");
+    }
+
+    SECTION("resize_and_clear") {
+        dtm::str t("abc");
+        t.resize(30, '-');
+        CHECK(t == "abc---------------------------");
+        t.resize(2);
+        CHECK(t == "ab");
+        t.clear();
+        CHECK(t.empty());
+        CHECK(t.c_str()[0] == '\0');
+
+        dtm::str u("abcdef");
+        u.resize(2);
+        u.resize(4);
+        CHECK(std::string(u.data(), 4) == std::string("ab\0\0", 4));
+        CHECK_THROWS_AS(u.at(4), std::out_of_range);
+        CHECK_THROWS_AS(u.substr(5), std::out_of_range);
+    }
+
+    SECTION("vec") {
+        // Grown by realloc, which is only right because str is relocatable.
+        dtm::vec<dtm::str> names;
+        for (int i = 0; i < 1000; i++)
+            names.push_back(dtm::str(std::to_string(i) + (i % 2 ? std::string(30, 'x') : std::string())));
+        bool all = true;
+        for (int i = 0; i < 1000; i++)
+            all = all && names[i] == std::to_string(i) + (i % 2 ? std::string(30, 'x') : std::string());
+        CHECK(all);
+        names.clear();
+    }
+}
+
+TEST_CASE("str_view_search", "[str]")
+{
+    dtm::str_view v("the quick brown fox jumps over the lazy dog");
+    CHECK(v.find("the") == 0);
+    CHECK(v.find("the", 1) == 31);
+    CHECK(v.find("dog") == 40);
+    CHECK(v.find("cat") == dtm::str_view::npos);
+    CHECK(v.find("") == 0);
+    CHECK(v.find("", v.size()) == v.size());
+    CHECK(v.find('q') == 4);
+    CHECK(v.find('z') == 37);
+    CHECK(v.find('!') == dtm::str_view::npos);
+    CHECK(v.rfind("the") == 31);
+    CHECK(v.rfind("the", 30) == 0);
+    CHECK(v.rfind('o') == 41);
+    CHECK(v.rfind('o', 40) == 26);
+    CHECK(v.starts_with("the quick"));
+    CHECK(v.ends_with("lazy dog"));
+    CHECK(!v.ends_with("lazy cat"));
+    CHECK(v.contains("brown fox"));
+    CHECK(v.substr(4, 5) == "quick");
+    CHECK_THROWS_AS(v.substr(100), std::out_of_range);
+
+    // Against std::string::find on random text, so that the vector loops
+    // and their scalar tails see matches at every offset.
+    std::mt19937 rng(3);
+    std::string text;
+    for (int i = 0; i < 5000; i++)
+        text.push_back(char('a' + rng() % 3));
+    bool same = true;
+    for (size_t m = 1; m <= 40; m++) {
+        for (int trial = 0; trial < 20; trial++) {
+            std::string needle;
+            for (size_t k = 0; k < m; k++)
+                needle.push_back(char('a' + rng() % 3));
+            size_t from = rng() % text.size();
+            same = same && dtm::str_view(text).find(needle, from) == text.find(needle, from);
+            same = same && dtm::str_view(text).rfind(needle, from) == text.rfind(needle, from);
+        }
+    }
+    CHECK(same);
+
+    // Needles that only match at the very end.
+    std::string tail(1000, 'a');
+    tail += "bcd";
+    CHECK(dtm::str_view(tail).find("abcd") == 999);
+    CHECK(dtm::str_view(tail).find("bcd") == 1000);
+    CHECK(dtm::str_view(tail).find("bcde") == dtm::str_view::npos);
+}
+
+TEST_CASE("str_compare_and_hash", "[str]")
+{
+    dtm::str a("apple");
+    dtm::str b("banana");
+    dtm::str long_a(std::string(50, 'a'));
+    CHECK(a < b);
+    CHECK(b > a);
+    CHECK(a <= "apple");
+    CHECK(a >= "apple");
+    CHECK(a != b);
+    CHECK(a.compare("apples") < 0);
+    CHECK(dtm::str_view("\xff").compare("a") > 0);
+    CHECK(long_a < a);
+    CHECK(a + "-" + b == "apple-banana");
+
+    dtm::hash<dtm::str> hash_str;
+    dtm::hash<dtm::str_view> hash_view;
+    CHECK(hash_str(a) == hash_view("apple"));
+    CHECK(hash_str(long_a) == hash_view(std::string(50, 'a')));
+    CHECK(hash_str(a) != hash_str(b));
+
+    dtm::hash_table<dtm::str, int> counts;
+    for (int i = 0; i < 1000; i++)
+        counts[dtm::str(std::to_string(i % 100))]++;
+    CHECK(counts.size() == 100);
+    CHECK(counts[dtm::str("42")] == 10);
+
+    std::ostringstream out;
+    out << a << ' ' << long_a.view().substr(0, 3);
+    CHECK(out.str() == "apple aaa");
+}
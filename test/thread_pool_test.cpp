@@ -0,0 +1,177 @@
+#include "dtm/thread_pool.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+
+#include "catch.hpp"
+
+static uint64_t pool_fib(dtm::thread_pool& pool, unsigned n) {
+    if (n < 2)
+        return n;
+    if (n < 12)
+        return pool_fib(pool, n - 1) + pool_fib(pool, n - 2);
+    uint64_t a = 0, b = 0;
+    pool.invoke([&] { a = pool_fib(pool, n - 1); }, [&] { b = pool_fib(pool, n - 2); });
+    return a + b;
+}
+
+TEST_CASE("thread_pool_invoke", "[thread_pool]")
+{
+    dtm::thread_pool pool(4);
+    REQUIRE(pool.size() == 4);
+
+    SECTION("runs_both") {
+        int a = 0, b = 0;
+        pool.invoke([&] { a = 1; }, [&] { b = 2; });
+        CHECK(a == 1);
+        CHECK(b == 2);
+    }
+
+    SECTION("recursive") {
+        CHECK(pool_fib(pool, 30) == 832040);
+    }
+
+    SECTION("exceptions") {
+        int ran = 0;
+        CHECK_THROWS_AS(pool.invoke([&] { throw std::runtime_error("left"); }, [&] { ran++; }), std::runtime_error);
+        CHECK(ran == 1);
+        CHECK_THROWS_AS(pool.invoke([&] { ran++; }, [&] { throw std::logic_error("right"); }), std::logic_error);
+        CHECK(ran == 2);
+        CHECK_THROWS_AS(pool.run([] { throw std::runtime_error("run"); }), std::runtime_error);
+
+        // The pool is still usable afterwards.
+        CHECK(pool_fib(pool, 20) == 6765);
+    }
+
+    SECTION("worker_index") {
+        CHECK((pool.this_worker_index() == dtm::thread_pool::npos));
+        std::atomic<bool> in_range(true);
+        pool.parallel_for(0, 10000, [&](size_t) {
+            if (pool.this_worker_index() >= pool.size())
+                in_range = false;
+        }, 16);
+        CHECK(in_range);
+
+        dtm::thread_pool other(2);
+        size_t index = 0;
+        pool.run([&] { index = other.this_worker_index(); });
+        CHECK((index == dtm::thread_pool::npos));
+    }
+}
+
+TEST_CASE("thread_pool_parallel_for", "[thread_pool]")
+{
+    dtm::thread_pool pool(4);
+
+    SECTION("each_index_once") {
+        size_t sizes[] = {0, 1, 2, 7, 100, 1000, 100003};
+        size_t grains[] = {0, 1, 3, 64, 1000000};
+        for (size_t n : sizes) {
+            for (size_t grain : grains) {
+                std::vector<std::atomic<int>> hits(n + 10);
+                for (auto& h : hits)
+                    h = 0;
+                pool.parallel_for(5, 5 + n, [&](size_t i) { hits[i]++; }, grain);
+                bool once = true;
+                for (size_t i = 0; i < hits.size(); i++)
+                    once = once && hits[i] == (i >= 5 && i < 5 + n ? 1 : 0);
+                CHECK(once);
+            }
+        }
+    }
+
+    SECTION("chunks") {
+        size_t n = 100000;
+        std::atomic<size_t> covered(0);
+        std::atomic<bool> small_enough(true);
+        pool.parallel_for_chunks(0, n, [&](size_t b, size_t e) {
+            if (b >= e || e - b > 1000)
+                small_enough = false;
+            covered += e - b;
+        }, 1000);
+        CHECK(covered == n);
+        CHECK(small_enough);
+    }
+
+    SECTION("nested") {
+        std::atomic<size_t> count(0);
+        pool.parallel_for(0, 64, [&](size_t) {
+            pool.parallel_for(0, 1000, [&](size_t) { count++; });
+        }, 1);
+        CHECK(count == 64000);
+    }
+
+    SECTION("uses_several_workers") {
+        std::vector<std::atomic<int>> used(pool.size());
+        for (auto& u : used)
+            u = 0;
+        pool.parallel_for(0, 256, [&](size_t) {
+            used[pool.this_worker_index()] = 1;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }, 1);
+        int workers = 0;
+        for (auto& u : used)
+            workers += u;
+        CHECK(workers > 1);
+    }
+}
+
+TEST_CASE("thread_pool_callers", "[thread_pool]")
+{
+    SECTION("single_worker") {
+        dtm::thread_pool pool(1);
+        CHECK(pool_fib(pool, 25) == 75025);
+        std::atomic<size_t> sum(0);
+        pool.parallel_for(0, 1000, [&](size_t i) { sum += i; });
+        CHECK(sum == 499500);
+    }
+
+    SECTION("concurrent_external") {
+        dtm::thread_pool pool(3);
+        std::vector<std::thread> threads;
+        std::atomic<int> wrong(0);
+        for (int t = 0; t < 6; t++) {
+            threads.emplace_back([&] {
+                for (int k = 0; k < 20; k++) {
+                    std::atomic<size_t> sum(0);
+                    pool.parallel_for(0, 2000, [&](size_t i) { sum += i; }, 10);
+                    if (sum != 1999000)
+                        wrong++;
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+        CHECK(wrong == 0);
+    }
+
+    SECTION("after_idle") {
+        dtm::thread_pool pool(4);
+        // Long enough for every worker to give up and sleep.
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(pool_fib(pool, 25) == 75025);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(pool_fib(pool, 25) == 75025);
+    }
+
+    SECTION("default_pool") {
+        int a = 0, b = 0, c = 0;
+        dtm::parallel_invoke([&] { a = 1; }, [&] { b = 2; }, [&] { c = 3; });
+        CHECK((a == 1 && b == 2 && c == 3));
+
+        std::vector<int> v(10000, 0);
+        dtm::parallel_for(0, v.size(), [&](size_t i) { v[i] = int(i); });
+        bool ok = true;
+        for (size_t i = 0; i < v.size(); i++)
+            ok = ok && v[i] == int(i);
+        CHECK(ok);
+
+        std::atomic<size_t> covered(0);
+        dtm::parallel_for_chunks(0, 5000, [&](size_t b, size_t e) { covered += e - b; });
+        CHECK(covered == 5000);
+        CHECK(dtm::default_thread_pool().size() >= 1);
+    }
+}
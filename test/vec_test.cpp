@@ -40,6 +40,14 @@ TEST_CASE("vec_construction", "[vec]") {
         CHECK(construction_test_type::num_destructions == 0);
     }
 
+    SECTION("destruction_calls") {
+        {
+            dtm::vec<construction_test_type> vec(5);
+            construction_test_type::reset();
+        }
+        CHECK(construction_test_type::num_destructions == 5);
+    }
+
     SECTION("N_default_construction_values") {
         dtm::vec<int> vec(2);
         CHECK(vec.size() == 2);
@@ -325,7 +333,7 @@ TEST_CASE("vec_push_back", "[vec]") {
         
         CHECK(!v.empty());
         CHECK(v.capacity() >= v.size());
-        REQUIRE(v.size() == N);
+        REQUIRE(v.size() == size_t(N));
         for (int i = 0; i < N; i++)
             CHECK(v[i] == i);
     }